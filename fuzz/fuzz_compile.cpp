@@ -0,0 +1,54 @@
+// Fuzz target for a whole compilation: parse, validate and translate every
+// section the way compile_file does, without writing the script
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string_view>
+#include "diagnostics.hpp"
+#include "flat_ast.hpp"
+#include "parse_driver.hpp"
+#include "route_checker.hpp"
+#include "specialized_sections.hpp"
+#include "symbol_table.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    Diagnostics diagnostics;
+    ProgramDeclaration* program =
+        parse_text(std::string_view(reinterpret_cast<const char*>(data), size), 1, diagnostics);
+    if (!program) {
+        return 0;
+    }
+    FlatAst flat = FlatAst::build(program);
+    SymbolTable symbols;
+    symbols.build(flat);
+
+    // The compiler reports exceptions of validation tasks as errors, so they are not crashes here either
+    for (const SectionStatement* section : program->get_sections()) {
+        if (const auto* specialized = dynamic_cast<const SpecializedSection*>(section)) {
+            for (ValidationTask& task : specialized->validation_tasks()) {
+                try {
+                    task(diagnostics);
+                } catch (const std::exception& e) {
+                    diagnostics.error(specialized, e.what());
+                } catch (...) {
+                    diagnostics.error(specialized, "Unknown error");
+                }
+            }
+        }
+    }
+    symbols.validate(diagnostics);
+    RouteTableChecker route_checker;
+    route_checker.check(flat, diagnostics);
+
+    if (!diagnostics.has_errors()) {
+        TranslationContext context;
+        context.symbol_table = &symbols;
+        for (const SectionStatement* section : program->get_sections()) {
+            const auto* specialized = dynamic_cast<const SpecializedSection*>(section);
+            std::string script = specialized ? specialized->translate("    ", context) : section->to_mikrotik("    ");
+        }
+    }
+    program->destroy();
+    delete program;
+    return 0;
+}
@@ -0,0 +1,13 @@
+// Fuzz target for the scanner alone: indentation, dedent queue and end of
+// input handling, without the grammar deciding what is reachable
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "scanner.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    yyscan_t scanner = scanner_create(std::string_view(reinterpret_cast<const char*>(data), size));
+    scan_all_tokens(scanner);
+    scanner_destroy(scanner);
+    return 0;
+}
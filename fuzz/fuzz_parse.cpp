@@ -0,0 +1,22 @@
+// Fuzz target for the parser: a whole-program parse and a section-at-a-time
+// parse of the same input, error recovery included
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "diagnostics.hpp"
+#include "parse_driver.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string_view text(reinterpret_cast<const char*>(data), size);
+
+    Diagnostics diagnostics;
+    ProgramDeclaration* program = parse_text(text, 1, diagnostics);
+    if (program) {
+        program->destroy();
+        delete program;
+    }
+
+    Diagnostics streamed;
+    parse_text_streaming(text, streamed, [](SectionStatement*) {});
+    return 0;
+}
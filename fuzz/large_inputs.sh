@@ -0,0 +1,42 @@
+#!/bin/sh
+# Write inputs that once took quadratic time in the scanner or parser, or ran
+# the parser out of stack, for `make fuzz-check` to replay under its timeout.
+# They are too large to check in and too large to mutate quickly, so they are
+# kept out of the fuzzing corpus.
+# Usage: fuzz/large_inputs.sh DIR
+
+DIR=${1:?usage: $0 DIR}
+mkdir -p "$DIR" || exit 1
+
+# A list of 200,000 names: every ", item" used to rebuild the whole list
+awk 'BEGIN {
+    printf "interfaces:\n    bond0:\n        type = \"bonding\"\n        mode = \"802.3ad\"\n        slaves = ["
+    for (i = 0; i < 200000; i++) {
+        printf "%s\"ether%d\"", (i ? ", " : ""), i
+    }
+    print "]"
+}' > "$DIR/long_list.dsl" || exit 1
+
+# 3,000 nested sections closed at once: the dedent queue used to be erased from
+# the front, and the depth runs past the parser stack, which must recover
+# without leaking the sections it pops
+awk 'BEGIN {
+    print "firewall:"
+    indent = ""
+    for (i = 1; i <= 3000; i++) {
+        indent = indent " "
+        print indent "s" i ":"
+    }
+    print indent " chain = \"input\""
+    print "ip:"
+}' > "$DIR/deep_nesting.dsl" || exit 1
+
+# A word of 100,000 hyphenated parts: each part used to rescan the rest of the
+# word in case it ended in a ${placeholder}
+awk 'BEGIN {
+    printf "interfaces:\n    ether1:\n        description = a"
+    for (i = 0; i < 100000; i++) {
+        printf "-a"
+    }
+    print ""
+}' > "$DIR/hyphen_run.dsl" || exit 1
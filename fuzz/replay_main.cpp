@@ -0,0 +1,168 @@
+// Runs a fuzz target over files without a fuzzing engine, for compilers that
+// have no libFuzzer and for AFL, which starts the target once per input:
+//
+//   fuzz_parse [-timeout=SECONDS] [-rss_limit_mb=MB] [FILE_OR_DIRECTORY...]
+//
+// The files of a directory are run in name order. Without any path the input
+// is read from standard input. Other flags, such as libFuzzer's -runs=0, are
+// ignored so that one command line replays a corpus with either build. An
+// input that runs longer than the timeout, or takes the process above the
+// memory limit, is reported and ends the run with status 1. Like libFuzzer,
+// both are checked once a second while the input runs.
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+// libFuzzer's defaults
+unsigned timeout_seconds = 1200;
+size_t rss_limit_mb = 2048;
+
+size_t page_size = 4096;
+const char* volatile current_input = "<stdin>";
+volatile sig_atomic_t seconds_running = 0;
+
+// Only async-signal-safe calls from here to on_tick()
+void write_error(const char* first, const char* second) {
+    ssize_t ignored = write(STDERR_FILENO, first, strlen(first));
+    ignored = write(STDERR_FILENO, second, strlen(second));
+    ignored = write(STDERR_FILENO, "\n", 1);
+    (void)ignored;
+}
+
+size_t resident_mb() {
+    char statm[128];
+    int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t length = read(fd, statm, sizeof(statm) - 1);
+    close(fd);
+    if (length <= 0) {
+        return 0;
+    }
+    // Total pages, then resident pages
+    size_t pages = 0;
+    ssize_t i = 0;
+    while (i < length && statm[i] != ' ') {
+        i++;
+    }
+    for (i++; i < length && statm[i] >= '0' && statm[i] <= '9'; i++) {
+        pages = pages * 10 + (statm[i] - '0');
+    }
+    return pages * page_size >> 20;
+}
+
+void on_tick(int) {
+    seconds_running = seconds_running + 1;
+    if (timeout_seconds > 0 && static_cast<unsigned>(seconds_running) >= timeout_seconds) {
+        write_error("Timeout on ", current_input);
+        _exit(1);
+    }
+    if (rss_limit_mb > 0 && resident_mb() > rss_limit_mb) {
+        write_error("Out of memory on ", current_input);
+        _exit(1);
+    }
+}
+
+bool read_all(FILE* file, std::vector<uint8_t>& data) {
+    data.clear();
+    uint8_t block[65536];
+    size_t count = 0;
+    while ((count = fread(block, 1, sizeof(block), file)) > 0) {
+        data.insert(data.end(), block, block + count);
+    }
+    return !ferror(file);
+}
+
+void run(const char* name, const std::vector<uint8_t>& data) {
+    current_input = name;
+    seconds_running = 0;
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+}
+
+// A path, or the files of a directory in name order
+void add_inputs(const std::string& path, std::vector<std::string>& inputs) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+        inputs.push_back(path);
+        return;
+    }
+    DIR* directory = opendir(path.c_str());
+    if (!directory) {
+        inputs.push_back(path);
+        return;
+    }
+    std::vector<std::string> files;
+    while (const dirent* entry = readdir(directory)) {
+        std::string file = path + "/" + entry->d_name;
+        if (entry->d_name[0] != '.' && stat(file.c_str(), &status) == 0 && S_ISREG(status.st_mode)) {
+            files.push_back(std::move(file));
+        }
+    }
+    closedir(directory);
+    std::sort(files.begin(), files.end());
+    inputs.insert(inputs.end(), files.begin(), files.end());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "-timeout=") == 0) {
+            timeout_seconds = static_cast<unsigned>(strtoul(arg.c_str() + 9, nullptr, 10));
+        } else if (arg.compare(0, 14, "-rss_limit_mb=") == 0) {
+            rss_limit_mb = strtoul(arg.c_str() + 14, nullptr, 10);
+        } else if (arg[0] != '-') {
+            add_inputs(arg, inputs);
+        }
+    }
+
+    page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    struct sigaction action {};
+    action.sa_handler = on_tick;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &action, nullptr);
+    itimerval tick{{1, 0}, {1, 0}};
+    setitimer(ITIMER_REAL, &tick, nullptr);
+
+    std::vector<uint8_t> data;
+    if (inputs.empty()) {
+        if (!read_all(stdin, data)) {
+            fprintf(stderr, "Could not read standard input\n");
+            return 1;
+        }
+        run("<stdin>", data);
+        return 0;
+    }
+    for (const std::string& input : inputs) {
+        FILE* file = fopen(input.c_str(), "rb");
+        bool loaded = file && read_all(file, data);
+        if (file) {
+            fclose(file);
+        }
+        if (!loaded) {
+            fprintf(stderr, "Could not read %s\n", input.c_str());
+            return 1;
+        }
+        run(input.c_str(), data);
+    }
+    printf("Ran %zu input(s)\n", inputs.size());
+    return 0;
+}
@@ -0,0 +1,368 @@
+#include "ast_image.hpp"
+#include "section_factory.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using ast_image::Header;
+using ast_image::NodeKind;
+using ast_image::ValueKind;
+using ast_image::NONE;
+
+namespace {
+
+size_t align4(size_t size) noexcept
+{
+    return (size + 3) & ~static_cast<size_t>(3);
+}
+
+// Byte offset of every column for the counts in a header, in file order
+struct ColumnLayout {
+    size_t node_kinds, node_section_types, node_names, node_lines, node_columns, node_origins;
+    size_t node_first_children, node_next_siblings, node_values;
+    size_t value_kinds, value_data, value_sizes;
+    size_t list_items, string_offsets, string_bytes;
+    size_t total;
+};
+
+ColumnLayout layout_columns(const Header& header) noexcept
+{
+    ColumnLayout layout;
+    size_t offset = align4(sizeof(Header));
+    auto column = [&offset](size_t bytes) {
+        size_t start = offset;
+        offset += align4(bytes);
+        return start;
+    };
+    size_t nodes = header.node_count;
+    size_t values = header.value_count;
+    layout.node_kinds = column(nodes);
+    layout.node_section_types = column(nodes);
+    layout.node_names = column(nodes * 4);
+    layout.node_lines = column(nodes * 4);
+    layout.node_columns = column(nodes * 4);
+    layout.node_origins = column(nodes * 4);
+    layout.node_first_children = column(nodes * 4);
+    layout.node_next_siblings = column(nodes * 4);
+    layout.node_values = column(nodes * 4);
+    layout.value_kinds = column(values);
+    layout.value_data = column(values * 4);
+    layout.value_sizes = column(values * 4);
+    layout.list_items = column(static_cast<size_t>(header.list_item_count) * 4);
+    layout.string_offsets = column((static_cast<size_t>(header.string_count) + 1) * 4);
+    layout.string_bytes = column(header.string_bytes);
+    layout.total = offset;
+    return layout;
+}
+
+template <typename T>
+void write_column(std::ofstream& out, const std::vector<T>& column)
+{
+    static const char padding[4] = {0, 0, 0, 0};
+    size_t bytes = column.size() * sizeof(T);
+    out.write(reinterpret_cast<const char*>(column.data()), bytes);
+    out.write(padding, align4(bytes) - bytes);
+}
+
+} // namespace
+
+// AstImageWriter implementation
+std::tuple<bool, std::string> AstImageWriter::write(const FlatAst& ast, const std::string& path)
+{
+    Header header{};
+    std::memcpy(header.magic, ast_image::MAGIC, sizeof(header.magic));
+    header.version = ast_image::VERSION;
+    header.byte_order = ast_image::BYTE_ORDER_MARK;
+    header.root = ast.root_;
+    header.node_count = static_cast<uint32_t>(ast.node_count());
+    header.value_count = static_cast<uint32_t>(ast.value_count());
+    header.list_item_count = static_cast<uint32_t>(ast.list_items_.size());
+    header.string_count = static_cast<uint32_t>(ast.symbol_count());
+    header.string_bytes = static_cast<uint32_t>(ast.symbol_bytes_.size());
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return {false, "Could not open " + path + " for writing"};
+    }
+    std::vector<Header> header_column{header};
+    write_column(out, header_column);
+    write_column(out, ast.kinds_);
+    write_column(out, ast.section_types_);
+    write_column(out, ast.names_);
+    write_column(out, ast.lines_);
+    write_column(out, ast.columns_);
+    write_column(out, ast.origins_);
+    write_column(out, ast.first_children_);
+    write_column(out, ast.next_siblings_);
+    write_column(out, ast.values_);
+    write_column(out, ast.value_kinds_);
+    write_column(out, ast.value_data_);
+    write_column(out, ast.value_sizes_);
+    write_column(out, ast.list_items_);
+    write_column(out, ast.symbol_offsets_);
+    std::vector<char> bytes(ast.symbol_bytes_.begin(), ast.symbol_bytes_.end());
+    write_column(out, bytes);
+
+    if (!out) {
+        return {false, "Could not write " + path};
+    }
+    return {true, ""};
+}
+
+// AstImage implementation
+AstImage::~AstImage()
+{
+    close();
+}
+
+void AstImage::close() noexcept
+{
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    header_ = nullptr;
+}
+
+bool AstImage::is_image(const std::string& path) noexcept
+{
+    char magic[sizeof(ast_image::MAGIC)];
+    std::ifstream in(path, std::ios::binary);
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, ast_image::MAGIC, sizeof(magic)) == 0;
+}
+
+std::tuple<bool, std::string> AstImage::open(const std::string& path) noexcept
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return {false, "Could not open " + path};
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return {false, path + " is not a program image"};
+    }
+    mapping_size_ = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping_size_ = 0;
+        return {false, "Could not map " + path};
+    }
+    mapping_ = mapping;
+
+    auto [mapped, mapping_error] = mapColumns();
+    if (!mapped) {
+        close();
+        return {false, path + ": " + mapping_error};
+    }
+    auto [valid, index_error] = checkIndices();
+    if (!valid) {
+        close();
+        return {false, path + ": " + index_error};
+    }
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> AstImage::mapColumns() noexcept
+{
+    const char* base = static_cast<const char*>(mapping_);
+    header_ = reinterpret_cast<const Header*>(base);
+    if (std::memcmp(header_->magic, ast_image::MAGIC, sizeof(header_->magic)) != 0) {
+        return {false, "not a program image"};
+    }
+    if (header_->byte_order != ast_image::BYTE_ORDER_MARK) {
+        return {false, "image was written on a machine with a different byte order"};
+    }
+    if (header_->version != ast_image::VERSION) {
+        return {false, "unsupported image version " + std::to_string(header_->version)};
+    }
+
+    ColumnLayout layout = layout_columns(*header_);
+    if (layout.total != mapping_size_) {
+        return {false, "image size does not match its header"};
+    }
+
+    node_kinds_ = reinterpret_cast<const uint8_t*>(base + layout.node_kinds);
+    node_section_types_ = reinterpret_cast<const uint8_t*>(base + layout.node_section_types);
+    node_names_ = reinterpret_cast<const uint32_t*>(base + layout.node_names);
+    node_lines_ = reinterpret_cast<const uint32_t*>(base + layout.node_lines);
+    node_columns_ = reinterpret_cast<const uint32_t*>(base + layout.node_columns);
+    node_origins_ = reinterpret_cast<const uint32_t*>(base + layout.node_origins);
+    node_first_children_ = reinterpret_cast<const uint32_t*>(base + layout.node_first_children);
+    node_next_siblings_ = reinterpret_cast<const uint32_t*>(base + layout.node_next_siblings);
+    node_values_ = reinterpret_cast<const uint32_t*>(base + layout.node_values);
+    value_kinds_ = reinterpret_cast<const uint8_t*>(base + layout.value_kinds);
+    value_data_ = reinterpret_cast<const uint32_t*>(base + layout.value_data);
+    value_sizes_ = reinterpret_cast<const uint32_t*>(base + layout.value_sizes);
+    list_items_ = reinterpret_cast<const uint32_t*>(base + layout.list_items);
+    string_offsets_ = reinterpret_cast<const uint32_t*>(base + layout.string_offsets);
+    string_bytes_ = base + layout.string_bytes;
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> AstImage::checkIndices() const noexcept
+{
+    const Header& header = *header_;
+
+    // Children and siblings always come later in pre-order, which also rules out cycles
+    auto valid_link = [&header](uint32_t from, uint32_t to) {
+        return to == NONE || (to > from && to < header.node_count);
+    };
+    if (header.root != NONE && header.root >= header.node_count) {
+        return {false, "root node out of range"};
+    }
+    for (uint32_t node = 0; node < header.node_count; node++) {
+        if (node_kinds_[node] > static_cast<uint8_t>(NodeKind::PROPERTY) ||
+            node_section_types_[node] > static_cast<uint8_t>(SectionStatement::SectionType::CUSTOM) ||
+            node_names_[node] >= header.string_count ||
+            !valid_link(node, node_first_children_[node]) ||
+            !valid_link(node, node_next_siblings_[node]) ||
+            (node_values_[node] != NONE && node_values_[node] >= header.value_count)) {
+            return {false, "corrupt node " + std::to_string(node)};
+        }
+    }
+
+    for (uint32_t value = 0; value < header.value_count; value++) {
+        ValueKind kind = static_cast<ValueKind>(value_kinds_[value]);
+        bool valid = true;
+        switch (kind) {
+            case ValueKind::STRING:
+            case ValueKind::QUOTED_STRING:
+            case ValueKind::IP_ADDRESS:
+            case ValueKind::IP_CIDR:
+                valid = value_data_[value] < header.string_count;
+                break;
+            case ValueKind::NUMBER:
+            case ValueKind::BOOLEAN:
+                break;
+            case ValueKind::LIST:
+                valid = value_sizes_[value] <= header.list_item_count &&
+                        value_data_[value] <= header.list_item_count - value_sizes_[value];
+                for (uint32_t i = 0; valid && i < value_sizes_[value]; i++) {
+                    uint32_t item = list_items_[value_data_[value] + i];
+                    valid = item > value && item < header.value_count &&
+                            value_kinds_[item] != static_cast<uint8_t>(ValueKind::LIST);
+                }
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            return {false, "corrupt value " + std::to_string(value)};
+        }
+    }
+
+    if (string_offsets_[0] != 0 || string_offsets_[header.string_count] != header.string_bytes) {
+        return {false, "corrupt string table"};
+    }
+    for (uint32_t id = 0; id < header.string_count; id++) {
+        if (string_offsets_[id] > string_offsets_[id + 1]) {
+            return {false, "corrupt string table"};
+        }
+    }
+    return {true, ""};
+}
+
+NodeKind AstImage::node_kind(uint32_t node) const noexcept
+{
+    return static_cast<NodeKind>(node_kinds_[node]);
+}
+
+SectionStatement::SectionType AstImage::section_type(uint32_t node) const noexcept
+{
+    return static_cast<SectionStatement::SectionType>(node_section_types_[node]);
+}
+
+std::string_view AstImage::node_name(uint32_t node) const noexcept
+{
+    return string_at(node_names_[node]);
+}
+
+ValueKind AstImage::value_kind(uint32_t value) const noexcept
+{
+    return static_cast<ValueKind>(value_kinds_[value]);
+}
+
+std::string_view AstImage::value_string(uint32_t value) const noexcept
+{
+    return string_at(value_data_[value]);
+}
+
+int AstImage::value_number(uint32_t value) const noexcept
+{
+    return static_cast<int>(value_data_[value]);
+}
+
+uint32_t AstImage::list_item(uint32_t value, uint32_t index) const noexcept
+{
+    return list_items_[value_data_[value] + index];
+}
+
+std::string_view AstImage::string_at(uint32_t id) const noexcept
+{
+    return std::string_view(string_bytes_ + string_offsets_[id], string_offsets_[id + 1] - string_offsets_[id]);
+}
+
+Value* AstImage::buildValue(uint32_t value) const
+{
+    switch (value_kind(value)) {
+        case ValueKind::STRING: return new StringValue(value_string(value));
+        case ValueKind::QUOTED_STRING: return new StringValue(value_string(value), true);
+        case ValueKind::NUMBER: return new NumberValue(value_number(value));
+        case ValueKind::BOOLEAN: return new BooleanValue(value_bool(value));
+        case ValueKind::IP_ADDRESS: return new IPAddressValue(value_string(value));
+        case ValueKind::IP_CIDR: return new IPCIDRValue(value_string(value));
+        default: return nullptr;
+    }
+}
+
+SectionStatement* AstImage::to_section(uint32_t node) const
+{
+    BlockStatement* block = new BlockStatement();
+    for (uint32_t child = first_child(node); child != NONE; child = next_sibling(child)) {
+        Statement* statement = nullptr;
+        if (node_kind(child) == NodeKind::SECTION) {
+            statement = to_section(child);
+        } else {
+            Expression* expr = nullptr;
+            uint32_t value = node_value(child);
+            if (value != NONE && value_kind(value) == ValueKind::LIST) {
+                ValueList items;
+                for (uint32_t i = 0; i < list_size(value); i++) {
+                    items.push_back(buildValue(list_item(value, i)));
+                }
+                expr = new ListValue(items);
+            } else if (value != NONE) {
+                expr = buildValue(value);
+            }
+            statement = new PropertyStatement(node_name(child), expr);
+            statement->set_location(node_line(child), node_column(child));
+            statement->set_origin(node_origin(child));
+        }
+        block->add_statement(statement);
+    }
+
+    SectionStatement* section = SectionFactory::create_section(node_name(node), section_type(node), block);
+    section->set_location(node_line(node), node_column(node));
+    section->set_origin(node_origin(node));
+    return section;
+}
+
+ProgramDeclaration* AstImage::to_program() const
+{
+    ProgramDeclaration* program = new ProgramDeclaration();
+    for (uint32_t node = root(); node != NONE; node = next_sibling(node)) {
+        program->add_section(to_section(node));
+    }
+    return program;
+}
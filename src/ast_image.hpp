@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+#include "declaration.hpp"
+#include "flat_ast.hpp"
+
+/*
+ * Binary image of a parsed program
+ *
+ * The image is the columns of a FlatAst written out one after the other.
+ * Nodes (sections and properties) are numbered in pre-order; each node has
+ * a kind, a name, a source position and origin, its first child and its
+ * next sibling. Property values live in their own columns and lists refer
+ * to a run of list items. All names and string values are interned once in
+ * a string table.
+ *
+ *   header | node columns | value columns | list items | string offsets | string bytes
+ *
+ * Every column starts on a 4-byte boundary and integers are stored in the
+ * byte order of the machine that wrote the image, recorded in the header.
+ */
+namespace ast_image {
+
+constexpr char MAGIC[8] = {'N', 'F', 'A', 'S', 'T', 'I', 'M', 'G'};
+constexpr uint32_t VERSION = 3;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Index meaning "no node" or "no value"
+constexpr uint32_t NONE = FlatAst::NONE;
+
+using NodeKind = FlatAst::NodeKind;
+using ValueKind = FlatAst::ValueKind;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t root;              // First top-level section, or NONE
+    uint32_t node_count;
+    uint32_t value_count;
+    uint32_t list_item_count;
+    uint32_t string_count;
+    uint32_t string_bytes;
+};
+
+} // namespace ast_image
+
+/**
+ * @class AstImageWriter
+ * @brief Serialise a flat AST into the binary image format
+ */
+class AstImageWriter {
+public:
+    /**
+     * @brief Write the image of a flat AST to a file
+     * @param ast The AST to serialise
+     * @param path Output file
+     * @return Success flag and error message
+     */
+    static std::tuple<bool, std::string> write(const FlatAst& ast, const std::string& path);
+};
+
+/**
+ * @class AstImage
+ * @brief Read-only view of a binary program image mapped into memory
+ *
+ * Opening an image maps the file and checks every index once; after that
+ * all accessors read the mapped columns directly, so loading performs no
+ * allocation per node and names are returned as views into the mapping.
+ */
+class AstImage {
+public:
+    AstImage() noexcept = default;
+    ~AstImage();
+
+    AstImage(const AstImage&) = delete;
+    AstImage& operator=(const AstImage&) = delete;
+
+    /**
+     * @brief Check whether a file starts with the image magic
+     * @param path File to check
+     * @return True if the file looks like a program image
+     */
+    static bool is_image(const std::string& path) noexcept;
+
+    /**
+     * @brief Map an image file and verify its structure
+     * @param path Image file
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> open(const std::string& path) noexcept;
+
+    uint32_t root() const noexcept { return header_->root; }
+    uint32_t node_count() const noexcept { return header_->node_count; }
+    uint32_t value_count() const noexcept { return header_->value_count; }
+
+    ast_image::NodeKind node_kind(uint32_t node) const noexcept;
+    SectionStatement::SectionType section_type(uint32_t node) const noexcept;
+    std::string_view node_name(uint32_t node) const noexcept;
+    int node_line(uint32_t node) const noexcept { return static_cast<int>(node_lines_[node]); }
+    int node_column(uint32_t node) const noexcept { return static_cast<int>(node_columns_[node]); }
+    uint32_t node_origin(uint32_t node) const noexcept { return node_origins_[node]; }
+    uint32_t first_child(uint32_t node) const noexcept { return node_first_children_[node]; }
+    uint32_t next_sibling(uint32_t node) const noexcept { return node_next_siblings_[node]; }
+    uint32_t node_value(uint32_t node) const noexcept { return node_values_[node]; }
+
+    ast_image::ValueKind value_kind(uint32_t value) const noexcept;
+    std::string_view value_string(uint32_t value) const noexcept;
+    int value_number(uint32_t value) const noexcept;
+    bool value_bool(uint32_t value) const noexcept { return value_data_[value] != 0; }
+    uint32_t list_size(uint32_t value) const noexcept { return value_sizes_[value]; }
+    uint32_t list_item(uint32_t value, uint32_t index) const noexcept;
+
+    std::string_view string_at(uint32_t id) const noexcept;
+
+    /**
+     * @brief Rebuild the AST of the whole image
+     * @return A new program owned by the caller
+     */
+    ProgramDeclaration* to_program() const;
+
+    /**
+     * @brief Rebuild the AST of one section, so a translator can run on it alone
+     * @param node The section node
+     * @return A new section owned by the caller
+     */
+    SectionStatement* to_section(uint32_t node) const;
+
+private:
+    std::tuple<bool, std::string> mapColumns() noexcept;
+    std::tuple<bool, std::string> checkIndices() const noexcept;
+    Value* buildValue(uint32_t value) const;
+    void close() noexcept;
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+
+    const ast_image::Header* header_ = nullptr;
+    const uint8_t* node_kinds_ = nullptr;
+    const uint8_t* node_section_types_ = nullptr;
+    const uint32_t* node_names_ = nullptr;
+    const uint32_t* node_lines_ = nullptr;
+    const uint32_t* node_columns_ = nullptr;
+    const uint32_t* node_origins_ = nullptr;
+    const uint32_t* node_first_children_ = nullptr;
+    const uint32_t* node_next_siblings_ = nullptr;
+    const uint32_t* node_values_ = nullptr;
+    const uint8_t* value_kinds_ = nullptr;
+    const uint32_t* value_data_ = nullptr;
+    const uint32_t* value_sizes_ = nullptr;
+    const uint32_t* list_items_ = nullptr;
+    const uint32_t* string_offsets_ = nullptr;
+    const char* string_bytes_ = nullptr;
+};
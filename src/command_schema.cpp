@@ -0,0 +1,175 @@
+#include "command_schema.hpp"
+#include "property_schema.hpp"
+
+namespace {
+
+bool is_yes(std::string_view value) noexcept {
+    return value == "yes" || value == "true";
+}
+
+bool is_no(std::string_view value) noexcept {
+    return value == "no" || value == "false";
+}
+
+// Connection states are written as a list, a bracketed string such as
+// ["established", "related"] or a plain comma separated string; RouterOS
+// wants them comma separated without quotes, braces or spaces
+std::string normalize_states(std::string_view value) {
+    if (value.size() >= 2 && value.front() == '[' && value.back() == ']') {
+        value = value.substr(1, value.size() - 2);
+    }
+
+    std::string states;
+    bool separator = false;
+    for (char c : value) {
+        if (c == '{' || c == '}' || c == '"') {
+            continue;
+        }
+        if (c == ' ' || c == ',') {
+            separator = !states.empty();
+            continue;
+        }
+        if (separator) {
+            states += ',';
+            separator = false;
+        }
+        states += c;
+    }
+    return states;
+}
+
+} // namespace
+
+RouterOSCommand::RouterOSCommand(const CommandSchema& schema)
+    : schema_(schema), values_(schema.parameter_count)
+{
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        values_[i] = std::string(schema_.parameters[i].default_value);
+    }
+}
+
+bool RouterOSCommand::set_property(std::string_view property, const Expression* value) {
+    std::string_view key = PropertySchema::routeros_name(property);
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        if (!schema_.parameters[i].key.empty() && schema_.parameters[i].key == key) {
+            assign(i, value ? expression_text(value) : std::string());
+            return true;
+        }
+    }
+    return false;
+}
+
+void RouterOSCommand::set_properties(const BlockStatement* block) {
+    if (!block) {
+        return;
+    }
+    for (const auto* stmt : block->get_statements()) {
+        if (const auto* prop = dynamic_cast<const PropertyStatement*>(stmt)) {
+            set_property(prop->get_name(), prop->get_value());
+        }
+    }
+}
+
+void RouterOSCommand::set(std::string_view parameter, std::string value) {
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        if (schema_.parameters[i].name == parameter) {
+            assign(i, std::move(value));
+            return;
+        }
+    }
+}
+
+const std::string& RouterOSCommand::get(std::string_view parameter) const noexcept {
+    static const std::string empty;
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        if (schema_.parameters[i].name == parameter) {
+            return values_[i];
+        }
+    }
+    return empty;
+}
+
+void RouterOSCommand::assign(size_t index, std::string value) {
+    switch (schema_.parameters[index].format) {
+        case CommandParameter::Format::NEGATED:
+            // Only a clear yes or no changes the parameter
+            if (is_yes(value)) {
+                values_[index] = "no";
+            } else if (is_no(value)) {
+                values_[index] = "yes";
+            }
+            break;
+        case CommandParameter::Format::STATES:
+            values_[index] = normalize_states(value);
+            break;
+        default:
+            values_[index] = std::move(value);
+            break;
+    }
+}
+
+bool RouterOSCommand::skipped(const CommandParameter& parameter) const noexcept {
+    return !parameter.unless_parameter.empty() && get(parameter.unless_parameter) == parameter.unless_value;
+}
+
+bool RouterOSCommand::emit(std::string& out) const {
+    bool any_value = false;
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        if (values_[i].empty()) {
+            if (schema_.parameters[i].presence == CommandParameter::Presence::REQUIRED) {
+                return false;
+            }
+        } else {
+            any_value = true;
+        }
+    }
+    if (!any_value && !schema_.emit_without_parameters) {
+        return false;
+    }
+
+    out += schema_.menu;
+    out += ' ';
+    out += schema_.verb;
+    for (size_t i = 0; i < schema_.parameter_count; ++i) {
+        const CommandParameter& parameter = schema_.parameters[i];
+        const std::string& value = values_[i];
+
+        switch (parameter.format) {
+            case CommandParameter::Format::SWITCH:
+                if (is_yes(value)) {
+                    out += ' ';
+                    out += parameter.name;
+                    out += "=yes";
+                }
+                continue;
+            case CommandParameter::Format::FLAG:
+                if (!is_no(value)) {
+                    out += ' ';
+                    out += parameter.name;
+                }
+                continue;
+            case CommandParameter::Format::POSITIONAL:
+                out += ' ';
+                out += value;
+                continue;
+            default:
+                break;
+        }
+
+        if ((value.empty() && parameter.presence == CommandParameter::Presence::OPTIONAL) || skipped(parameter)) {
+            continue;
+        }
+        out += ' ';
+        out += parameter.name;
+        out += '=';
+        if (parameter.format == CommandParameter::Format::QUOTED) {
+            out += '"';
+            out += value;
+            out += '"';
+        } else {
+            out += value;
+        }
+    }
+    out += '\n';
+    return true;
+}
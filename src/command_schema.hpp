@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "expression.hpp"
+#include "statement.hpp"
+
+/**
+ * @brief One parameter of a RouterOS command
+ *
+ * Parameters are filled from DSL properties whose name, after
+ * PropertySchema::routeros_name() resolves aliases, equals the key, or
+ * directly by the translator (rule names, list names, ...). They are
+ * written in the order they are listed in the command.
+ */
+struct CommandParameter {
+    enum class Format {
+        VALUE,      // name=value
+        QUOTED,     // name="value"
+        SWITCH,     // name=yes when the value is yes or true, nothing otherwise
+        NEGATED,    // yes/true is stored as no and no/false as yes; anything else is ignored
+        FLAG,       // the bare name unless the value is no or false
+        STATES,     // name=a,b,c from a list or a bracketed string of states
+        POSITIONAL  // the value alone, e.g. the item a "set" command changes
+    };
+
+    enum class Presence {
+        OPTIONAL,   // Written only when not empty
+        ALWAYS,     // Written even when empty
+        REQUIRED    // The command is skipped when this is empty
+    };
+
+    std::string_view key;           // Canonical DSL property, or empty if only the translator sets it
+    std::string_view name;          // RouterOS parameter
+    Format format = Format::VALUE;
+    Presence presence = Presence::OPTIONAL;
+    std::string_view default_value = {};
+    std::string_view unless_parameter = {}; // Skip this parameter when that one...
+    std::string_view unless_value = {};     // ...holds this value
+};
+
+/**
+ * @brief A RouterOS command: menu, verb and its parameters in output order
+ */
+struct CommandSchema {
+    std::string_view menu;
+    std::string_view verb;
+    const CommandParameter* parameters;
+    size_t parameter_count;
+    bool emit_without_parameters = true; // false: skip the command if every parameter is empty
+
+    template <size_t N>
+    constexpr CommandSchema(std::string_view menu, std::string_view verb, const CommandParameter (&parameters)[N],
+                            bool emit_without_parameters = true) noexcept
+        : menu(menu), verb(verb), parameters(parameters), parameter_count(N),
+          emit_without_parameters(emit_without_parameters)
+    {
+    }
+};
+
+/**
+ * @class RouterOSCommand
+ * @brief Generic emitter that fills one command from DSL properties and writes it
+ *
+ * Dispatching a property is a lookup in the command's parameter table, so
+ * translators only pick the schema and add what the DSL does not spell as a
+ * property, such as the name of the rule section.
+ */
+class RouterOSCommand {
+public:
+    explicit RouterOSCommand(const CommandSchema& schema);
+
+    /**
+     * @brief Fill the parameter a DSL property maps to
+     * @param property The DSL property name; aliases are resolved through PropertySchema
+     * @param value The property value, or nullptr for a property without one
+     * @return False if the command has no parameter for the property
+     */
+    bool set_property(std::string_view property, const Expression* value);
+
+    /**
+     * @brief Fill every parameter that the properties of a block map to
+     * @param block The block holding the properties; nested sections are ignored
+     */
+    void set_properties(const BlockStatement* block);
+
+    /**
+     * @brief Fill a parameter by its RouterOS name
+     * @param parameter The RouterOS parameter
+     * @param value The DSL value, before the parameter's format is applied
+     */
+    void set(std::string_view parameter, std::string value);
+
+    /**
+     * @brief Current value of a parameter
+     * @return The value, or an empty string for unknown parameters
+     */
+    const std::string& get(std::string_view parameter) const noexcept;
+
+    /**
+     * @brief Append the command line to a script unless a required parameter is missing
+     * @param out The script being built
+     * @return True if a line was written
+     */
+    bool emit(std::string& out) const;
+
+private:
+    void assign(size_t index, std::string value);
+    bool skipped(const CommandParameter& parameter) const noexcept;
+
+    const CommandSchema& schema_;
+    std::vector<std::string> values_;
+};
+
+/**
+ * @brief Commands generated by the IP, routing and firewall translators
+ */
+namespace routeros_commands {
+
+inline constexpr CommandParameter IP_ADDRESS_PARAMETERS[] = {
+    {"", "address", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"", "interface", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+};
+inline constexpr CommandSchema IP_ADDRESS{"/ip address", "add", IP_ADDRESS_PARAMETERS};
+
+inline constexpr CommandParameter IP_ROUTE_PARAMETERS[] = {
+    {"", "dst-address", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"gateway", "gateway", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"distance", "distance"},
+};
+inline constexpr CommandSchema IP_ROUTE{"/ip route", "add", IP_ROUTE_PARAMETERS};
+
+inline constexpr CommandParameter IP_FIREWALL_RULE_PARAMETERS[] = {
+    {"", "chain", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"action", "action", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"protocol", "protocol"},
+    {"dst-port", "dst-port"},
+    {"dst-address", "dst-address"},
+    {"src-address", "src-address"},
+    {"out-interface", "out-interface"},
+    {"in-interface", "in-interface"},
+};
+inline constexpr CommandSchema IP_FIREWALL_FILTER{"/ip firewall filter", "add", IP_FIREWALL_RULE_PARAMETERS};
+inline constexpr CommandSchema IP_FIREWALL_NAT{"/ip firewall nat", "add", IP_FIREWALL_RULE_PARAMETERS};
+
+inline constexpr CommandParameter DHCP_SERVER_PARAMETERS[] = {
+    {"", "name", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"interface", "interface", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"address-pool", "address-pool"},
+    {"lease-time", "lease-time"},
+};
+inline constexpr CommandSchema DHCP_SERVER{"/ip dhcp-server", "add", DHCP_SERVER_PARAMETERS};
+
+inline constexpr CommandParameter DHCP_CLIENT_PARAMETERS[] = {
+    {"", "interface", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"", "disabled", CommandParameter::Format::NEGATED, CommandParameter::Presence::ALWAYS, "no"},
+};
+inline constexpr CommandSchema DHCP_CLIENT{"/ip dhcp-client", "add", DHCP_CLIENT_PARAMETERS};
+
+inline constexpr CommandParameter DNS_PARAMETERS[] = {
+    {"servers", "servers"},
+    {"allow-remote-requests", "allow-remote-requests"},
+};
+inline constexpr CommandSchema DNS{"/ip dns", "set", DNS_PARAMETERS, false};
+
+inline constexpr CommandParameter ARP_PARAMETERS[] = {
+    {"", "address", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"mac-address", "mac-address", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"interface", "interface", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+};
+inline constexpr CommandSchema ARP{"/ip arp", "add", ARP_PARAMETERS};
+
+inline constexpr CommandParameter STATIC_ROUTE_PARAMETERS[] = {
+    {"dst-address", "dst-address", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"gateway", "gateway", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"distance", "distance"},
+    {"routing-table", "routing-table"},
+    {"check-gateway", "check-gateway"},
+    {"scope", "scope"},
+    {"target-scope", "target-scope"},
+    {"suppress-hw-offload", "suppress-hw-offload", CommandParameter::Format::SWITCH},
+};
+inline constexpr CommandSchema STATIC_ROUTE{"/ip route", "add", STATIC_ROUTE_PARAMETERS};
+
+inline constexpr CommandParameter ROUTING_TABLE_PARAMETERS[] = {
+    {"", "name", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"fib", "fib", CommandParameter::Format::FLAG, CommandParameter::Presence::OPTIONAL, "yes"},
+};
+inline constexpr CommandSchema ROUTING_TABLE{"/routing table", "add", ROUTING_TABLE_PARAMETERS};
+
+inline constexpr CommandParameter ROUTING_RULE_PARAMETERS[] = {
+    {"src-address", "src-address"},
+    {"dst-address", "dst-address"},
+    {"interface", "interface"},
+    {"action", "action"},
+    {"routing-table", "table"},
+};
+inline constexpr CommandSchema ROUTING_RULE{"/routing rule", "add", ROUTING_RULE_PARAMETERS};
+
+inline constexpr CommandParameter ROUTING_FILTER_RULE_PARAMETERS[] = {
+    {"", "chain", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"", "rule", CommandParameter::Format::QUOTED, CommandParameter::Presence::ALWAYS},
+};
+inline constexpr CommandSchema ROUTING_FILTER_RULE{"/routing/filter/rule", "add", ROUTING_FILTER_RULE_PARAMETERS};
+
+inline constexpr CommandParameter FILTER_RULE_PARAMETERS[] = {
+    {"chain", "chain", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS, "forward"},
+    {"action", "action", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"connection-state", "connection-state", CommandParameter::Format::STATES},
+    {"protocol", "protocol"},
+    {"src-address", "src-address"},
+    {"dst-address", "dst-address"},
+    {"src-port", "src-port"},
+    {"dst-port", "dst-port"},
+    {"in-interface", "in-interface"},
+    {"out-interface", "out-interface"},
+    {"comment", "comment", CommandParameter::Format::QUOTED},
+};
+inline constexpr CommandSchema FILTER_RULE{"/ip firewall filter", "add", FILTER_RULE_PARAMETERS};
+
+inline constexpr CommandParameter NAT_RULE_PARAMETERS[] = {
+    {"chain", "chain", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS, "srcnat"},
+    {"action", "action", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"protocol", "protocol"},
+    {"src-address", "src-address"},
+    {"dst-address", "dst-address"},
+    {"src-port", "src-port"},
+    {"dst-port", "dst-port"},
+    {"in-interface", "in-interface"},
+    {"out-interface", "out-interface"},
+    // Masquerade takes the address of the out interface
+    {"to-addresses", "to-addresses", CommandParameter::Format::VALUE, CommandParameter::Presence::OPTIONAL, {},
+     "action", "masquerade"},
+    {"to-ports", "to-ports"},
+    {"comment", "comment", CommandParameter::Format::QUOTED},
+};
+inline constexpr CommandSchema NAT_RULE{"/ip firewall nat", "add", NAT_RULE_PARAMETERS};
+
+inline constexpr CommandParameter RAW_RULE_PARAMETERS[] = {
+    {"chain", "chain", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS, "prerouting"},
+    {"action", "action", CommandParameter::Format::VALUE, CommandParameter::Presence::REQUIRED},
+    {"protocol", "protocol"},
+    {"src-address", "src-address"},
+    {"dst-address", "dst-address"},
+    {"comment", "comment", CommandParameter::Format::QUOTED},
+};
+inline constexpr CommandSchema RAW_RULE{"/ip firewall raw", "add", RAW_RULE_PARAMETERS};
+
+inline constexpr CommandParameter ADDRESS_LIST_ENTRY_PARAMETERS[] = {
+    {"", "list", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"", "address", CommandParameter::Format::VALUE, CommandParameter::Presence::ALWAYS},
+    {"", "comment", CommandParameter::Format::QUOTED},
+};
+inline constexpr CommandSchema ADDRESS_LIST_ENTRY{"/ip firewall address-list", "add", ADDRESS_LIST_ENTRY_PARAMETERS};
+
+inline constexpr CommandParameter SERVICE_PORT_PARAMETERS[] = {
+    {"", "", CommandParameter::Format::POSITIONAL, CommandParameter::Presence::ALWAYS},
+    {"", "disabled", CommandParameter::Format::NEGATED, CommandParameter::Presence::REQUIRED},
+};
+inline constexpr CommandSchema SERVICE_PORT{"/ip firewall service-port", "set", SERVICE_PORT_PARAMETERS};
+
+} // namespace routeros_commands
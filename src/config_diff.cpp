@@ -0,0 +1,512 @@
+#include "config_diff.hpp"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include "command_schema.hpp"
+#include "property_schema.hpp"
+
+namespace {
+
+using NodeId = FlatAst::NodeId;
+using ValueId = FlatAst::ValueId;
+using NodeKind = FlatAst::NodeKind;
+using ValueKind = FlatAst::ValueKind;
+
+// Position that has no partner in the other program
+constexpr uint32_t UNPAIRED = FlatAst::NONE;
+
+// Subsections of the routing section that are not routes
+constexpr std::string_view ROUTING_SUBSECTIONS[] = {"table", "tables", "rule", "rules", "filter"};
+
+// Firewall tables whose rules are evaluated in order
+constexpr std::string_view RULE_TABLES[] = {"filter", "nat", "raw", "mangle"};
+
+// Commands whose chain parameter gives the chain of rules that set none
+const CommandSchema* const RULE_COMMANDS[] = {
+    &routeros_commands::FILTER_RULE,
+    &routeros_commands::NAT_RULE,
+    &routeros_commands::RAW_RULE,
+};
+
+template <typename Range>
+bool contains(const Range& range, std::string_view word) noexcept {
+    return std::find(std::begin(range), std::end(range), word) != std::end(range);
+}
+
+// splitmix64 finalizer, so sums of child hashes stay well distributed
+uint64_t mix(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash_text(std::string_view text) noexcept {
+    return mix(std::hash<std::string_view>()(text));
+}
+
+std::string join(const std::string& path, std::string_view name) {
+    return path.empty() ? std::string(name) : path + "/" + std::string(name);
+}
+
+// Properties are compared under their RouterOS name, so aliases match
+std::string_view canonical_name(std::string_view name) noexcept {
+    return PropertySchema::routeros_name(name);
+}
+
+// A value as the translators would write it, with list order ignored
+std::string canonical_value(const FlatAst& ast, std::string_view name, ValueId value) {
+    if (value == FlatAst::NONE) {
+        return "";
+    }
+    switch (ast.value_kind(value)) {
+        case ValueKind::STRING:
+        case ValueKind::QUOTED_STRING: {
+            std::string_view text = ast.symbol_name(ast.value_data(value));
+            // admin_state spells the disabled parameter the other way round
+            if (name == "admin_state" && (text == "enabled" || text == "disabled")) {
+                return text == "enabled" ? "no" : "yes";
+            }
+            if (text == "true" || text == "false") {
+                return text == "true" ? "yes" : "no";
+            }
+            return std::string(text);
+        }
+        case ValueKind::BOOLEAN:
+            return ast.value_data(value) ? "yes" : "no";
+        case ValueKind::LIST: {
+            std::vector<std::string> items;
+            for (uint32_t i = 0; i < ast.list_size(value); i++) {
+                items.push_back(canonical_value(ast, "", ast.list_item(value, i)));
+            }
+            std::sort(items.begin(), items.end());
+            std::string text;
+            for (const std::string& item : items) {
+                text += text.empty() ? "" : ",";
+                text += item;
+            }
+            return text;
+        }
+        default:
+            return ast.value_text(value);
+    }
+}
+
+// A value the way it is written in the DSL
+std::string display_value(const FlatAst& ast, ValueId value) {
+    if (value == FlatAst::NONE) {
+        return "";
+    }
+    switch (ast.value_kind(value)) {
+        case ValueKind::QUOTED_STRING:
+            return "\"" + std::string(ast.symbol_name(ast.value_data(value))) + "\"";
+        case ValueKind::LIST: {
+            std::string text = "[";
+            for (uint32_t i = 0; i < ast.list_size(value); i++) {
+                text += i > 0 ? ", " : "";
+                text += display_value(ast, ast.list_item(value, i));
+            }
+            return text + "]";
+        }
+        default:
+            return ast.value_text(value);
+    }
+}
+
+// Canonical value of the first property of a section with a RouterOS name
+std::string property_value(const FlatAst& ast, NodeId section, std::string_view routeros_name) {
+    for (NodeId prop = ast.first_child(section); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+        if (ast.kind(prop) == NodeKind::PROPERTY && canonical_name(ast.name(prop)) == routeros_name) {
+            return canonical_value(ast, ast.name(prop), ast.value(prop));
+        }
+    }
+    return "";
+}
+
+std::string default_chain(std::string_view table) {
+    for (const CommandSchema* schema : RULE_COMMANDS) {
+        std::string_view menu = schema->menu;
+        if (menu.size() <= table.size() || menu.substr(menu.size() - table.size()) != table) {
+            continue;
+        }
+        for (size_t i = 0; i < schema->parameter_count; i++) {
+            if (schema->parameters[i].name == "chain") {
+                return std::string(schema->parameters[i].default_value);
+            }
+        }
+    }
+    return "";
+}
+
+} // namespace
+
+ConfigDiff::ConfigDiff(const FlatAst& before, const FlatAst& after)
+    : before_{before, std::vector<uint64_t>(before.node_count())},
+      after_{after, std::vector<uint64_t>(after.node_count())}
+{
+}
+
+const std::vector<ConfigDiff::Change>& ConfigDiff::compare() {
+    changes_.clear();
+    hashChildren(before_, before_.ast.root(), "");
+    hashChildren(after_, after_.ast.root(), "");
+    compareSections({}, {}, "");
+    return changes_;
+}
+
+void ConfigDiff::print(FILE* out, const std::string& before_name, const std::string& after_name) const {
+    for (const Change& change : changes_) {
+        const std::string& file = change.kind == ChangeKind::REMOVED ? before_name : after_name;
+        fprintf(out, "%s:%d:%d: ", file.c_str(), change.line, change.column);
+        const char* path = change.path.c_str();
+        const char* property = change.property.c_str();
+        switch (change.kind) {
+            case ChangeKind::ADDED:
+            case ChangeKind::REMOVED: {
+                const char* verb = change.kind == ChangeKind::ADDED ? "added" : "removed";
+                if (change.property.empty()) {
+                    fprintf(out, "%s %s\n", verb, path);
+                } else {
+                    const std::string& value = change.kind == ChangeKind::ADDED ? change.after : change.before;
+                    fprintf(out, "%s %s %s = %s\n", verb, path, property, value.c_str());
+                }
+                break;
+            }
+            case ChangeKind::CHANGED:
+                fprintf(out, "changed %s %s: %s -> %s\n", path, property, change.before.c_str(), change.after.c_str());
+                break;
+            case ChangeKind::MOVED:
+                if (change.property.empty()) {
+                    fprintf(out, "moved %s: position %s -> %s\n", path, change.before.c_str(), change.after.c_str());
+                } else {
+                    fprintf(out, "moved %s in chain %s: position %s -> %s\n", path, property, change.before.c_str(),
+                            change.after.c_str());
+                }
+                break;
+            case ChangeKind::RENAMED:
+                fprintf(out, "renamed %s: %s -> %s\n", path, change.before.c_str(), change.after.c_str());
+                break;
+        }
+    }
+}
+
+size_t ConfigDiff::count(ChangeKind kind) const noexcept {
+    return static_cast<size_t>(std::count_if(changes_.begin(), changes_.end(),
+                                             [kind](const Change& change) { return change.kind == kind; }));
+}
+
+ConfigDiff::Order ConfigDiff::childOrder(const std::string& path) {
+    if (path == "routing") {
+        return Order::ROUTES;
+    }
+    if (path == "routing/rule" || path == "routing/rules") {
+        return Order::RULES;
+    }
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos || !contains(RULE_TABLES, std::string_view(path).substr(slash + 1))) {
+        return Order::UNORDERED;
+    }
+    // filter, nat, raw and mangle of the firewall section or of the IP firewall subsection
+    std::string_view parent = std::string_view(path).substr(0, slash);
+    size_t parent_slash = parent.rfind('/');
+    return parent.substr(parent_slash == std::string_view::npos ? 0 : parent_slash + 1) == "firewall"
+               ? Order::RULES : Order::UNORDERED;
+}
+
+// Hash a list of siblings, recording the content hash of every section on
+// the way. Siblings are summed where their order does not matter and chained
+// where it does, so equal hashes mean nothing to report.
+uint64_t ConfigDiff::hashChildren(Side& side, NodeId first, const std::string& path) {
+    const FlatAst& ast = side.ast;
+    bool ordered = childOrder(path) == Order::RULES;
+    uint64_t hash = 0;
+    for (NodeId node = first; node != FlatAst::NONE; node = ast.next_sibling(node)) {
+        std::string_view name = ast.name(node);
+        uint64_t node_hash;
+        if (ast.kind(node) == NodeKind::PROPERTY) {
+            node_hash = mix(hash_text(canonical_name(name)) * 31 +
+                            hash_text(canonical_value(ast, name, ast.value(node))));
+        } else {
+            side.hashes[node] = hashChildren(side, ast.first_child(node), join(path, name));
+            node_hash = mix(hash_text(name) * 31 + side.hashes[node]);
+        }
+        hash = ordered ? mix(hash + node_hash) : hash + node_hash;
+    }
+    return hash;
+}
+
+std::vector<NodeId> ConfigDiff::children(const Side& side, const Parts& parts) const {
+    std::vector<NodeId> nodes;
+    if (parts.empty()) {
+        for (NodeId node = side.ast.root(); node != FlatAst::NONE; node = side.ast.next_sibling(node)) {
+            nodes.push_back(node);
+        }
+        return nodes;
+    }
+    for (NodeId part : parts) {
+        for (NodeId node = side.ast.first_child(part); node != FlatAst::NONE; node = side.ast.next_sibling(node)) {
+            nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+// What a subsection is matched by: routes by what they route, anything else by name
+std::string ConfigDiff::key(const Side& side, NodeId section, Order order) const {
+    std::string_view name = side.ast.name(section);
+    if (order != Order::ROUTES || contains(ROUTING_SUBSECTIONS, name)) {
+        return std::string(name);
+    }
+    std::string destination = property_value(side.ast, section, "dst-address");
+    if (destination.empty()) {
+        return std::string(name);
+    }
+    std::string table = property_value(side.ast, section, "routing-table");
+    std::string distance = property_value(side.ast, section, "distance");
+    // Starts with a character no section name has
+    return "\t" + (table.empty() ? std::string("main") : table) + " " + destination + " " +
+           (distance.empty() ? std::string("1") : distance);
+}
+
+void ConfigDiff::compareSections(const Parts& before, const Parts& after, const std::string& path) {
+    Order order = childOrder(path);
+    std::vector<NodeId> before_children = children(before_, before);
+    std::vector<NodeId> after_children = children(after_, after);
+    if (order == Order::RULES) {
+        compareRules(before_children, after_children, path);
+        return;
+    }
+    compareProperties(before_children, after_children, path);
+
+    std::unordered_map<std::string, Parts> before_sections;
+    for (NodeId node : before_children) {
+        if (before_.ast.kind(node) == NodeKind::SECTION) {
+            before_sections[key(before_, node, order)].push_back(node);
+        }
+    }
+    std::vector<Parts> after_sections;
+    std::vector<std::string> after_keys;
+    std::unordered_map<std::string, size_t> after_index;
+    for (NodeId node : after_children) {
+        if (after_.ast.kind(node) != NodeKind::SECTION) {
+            continue;
+        }
+        std::string section_key = key(after_, node, order);
+        auto [it, added] = after_index.try_emplace(section_key, after_sections.size());
+        if (added) {
+            after_sections.emplace_back();
+            after_keys.push_back(std::move(section_key));
+        }
+        after_sections[it->second].push_back(node);
+    }
+
+    for (size_t i = 0; i < after_sections.size(); i++) {
+        const Parts& parts = after_sections[i];
+        std::string child_path = join(path, after_.ast.name(parts.front()));
+        auto it = before_sections.find(after_keys[i]);
+        if (it == before_sections.end()) {
+            add(ChangeKind::ADDED, after_, parts.front(), std::move(child_path));
+            continue;
+        }
+        const Parts& old_parts = it->second;
+        bool same = old_parts.size() == 1 && parts.size() == 1 &&
+                    before_.hashes[old_parts.front()] == after_.hashes[parts.front()];
+        if (!same) {
+            compareSections(old_parts, parts, child_path);
+        }
+        before_sections.erase(it);
+    }
+
+    for (NodeId node : before_children) {
+        if (before_.ast.kind(node) != NodeKind::SECTION) {
+            continue;
+        }
+        auto it = before_sections.find(key(before_, node, order));
+        if (it != before_sections.end() && it->second.front() == node) {
+            add(ChangeKind::REMOVED, before_, node, join(path, before_.ast.name(node)));
+        }
+    }
+}
+
+// Compare the properties among two lists of children; a property set twice
+// counts with its last value, as in the translators
+void ConfigDiff::compareProperties(const std::vector<NodeId>& before, const std::vector<NodeId>& after,
+                                   const std::string& path) {
+    const FlatAst& old_ast = before_.ast;
+    const FlatAst& new_ast = after_.ast;
+    std::unordered_map<std::string_view, NodeId> before_props;
+    for (NodeId node : before) {
+        if (old_ast.kind(node) == NodeKind::PROPERTY) {
+            before_props[canonical_name(old_ast.name(node))] = node;
+        }
+    }
+    std::unordered_map<std::string_view, NodeId> after_props;
+    for (NodeId node : after) {
+        if (new_ast.kind(node) == NodeKind::PROPERTY) {
+            after_props[canonical_name(new_ast.name(node))] = node;
+        }
+    }
+
+    for (NodeId node : after) {
+        if (new_ast.kind(node) != NodeKind::PROPERTY) {
+            continue;
+        }
+        std::string_view name = new_ast.name(node);
+        std::string_view canonical = canonical_name(name);
+        if (after_props[canonical] != node) {
+            continue;
+        }
+        auto it = before_props.find(canonical);
+        if (it == before_props.end()) {
+            add(ChangeKind::ADDED, after_, node, path, std::string(name), "", display_value(new_ast, new_ast.value(node)));
+            continue;
+        }
+        NodeId old_node = it->second;
+        before_props.erase(it);
+        if (canonical_value(old_ast, old_ast.name(old_node), old_ast.value(old_node)) !=
+            canonical_value(new_ast, name, new_ast.value(node))) {
+            add(ChangeKind::CHANGED, after_, node, path, std::string(name),
+                display_value(old_ast, old_ast.value(old_node)), display_value(new_ast, new_ast.value(node)));
+        }
+    }
+
+    for (NodeId node : before) {
+        if (old_ast.kind(node) != NodeKind::PROPERTY) {
+            continue;
+        }
+        auto it = before_props.find(canonical_name(old_ast.name(node)));
+        if (it != before_props.end() && it->second == node) {
+            add(ChangeKind::REMOVED, before_, node, path, std::string(old_ast.name(node)),
+                display_value(old_ast, old_ast.value(node)));
+        }
+    }
+}
+
+// Split the rules of a table into chains, which are compared independently
+void ConfigDiff::compareRules(const std::vector<NodeId>& before, const std::vector<NodeId>& after,
+                              const std::string& path) {
+    compareProperties(before, after, path);
+
+    std::string fallback = default_chain(std::string_view(path).substr(path.rfind('/') + 1));
+    std::vector<std::string> chains;
+    std::unordered_map<std::string, std::pair<std::vector<NodeId>, std::vector<NodeId>>> rules;
+    auto collect = [&](const Side& side, const std::vector<NodeId>& nodes, bool old) {
+        for (NodeId node : nodes) {
+            if (side.ast.kind(node) != NodeKind::SECTION) {
+                continue;
+            }
+            std::string chain = property_value(side.ast, node, "chain");
+            auto [it, added] = rules.try_emplace(chain.empty() ? fallback : chain);
+            if (added) {
+                chains.push_back(it->first);
+            }
+            (old ? it->second.first : it->second.second).push_back(node);
+        }
+    };
+    collect(after_, after, false);
+    collect(before_, before, true);
+
+    for (const std::string& chain : chains) {
+        const auto& [old_rules, new_rules] = rules[chain];
+        compareChain(old_rules, new_rules, path, chain);
+    }
+}
+
+void ConfigDiff::compareChain(const std::vector<NodeId>& before, const std::vector<NodeId>& after,
+                              const std::string& path, const std::string& chain) {
+    const FlatAst& old_ast = before_.ast;
+    const FlatAst& new_ast = after_.ast;
+    std::vector<uint32_t> new_of(before.size(), UNPAIRED);
+    std::vector<uint32_t> old_of(after.size(), UNPAIRED);
+
+    // Pair rules by name first, then renamed rules by their content
+    std::unordered_map<std::string_view, uint32_t> by_name;
+    by_name.reserve(after.size());
+    for (uint32_t j = 0; j < after.size(); j++) {
+        by_name.try_emplace(new_ast.name(after[j]), j);
+    }
+    for (uint32_t i = 0; i < before.size(); i++) {
+        auto it = by_name.find(old_ast.name(before[i]));
+        if (it != by_name.end() && old_of[it->second] == UNPAIRED) {
+            new_of[i] = it->second;
+            old_of[it->second] = i;
+        }
+    }
+    std::unordered_map<uint64_t, std::vector<uint32_t>> by_content;
+    for (uint32_t j = static_cast<uint32_t>(after.size()); j-- > 0;) {
+        if (old_of[j] == UNPAIRED) {
+            by_content[after_.hashes[after[j]]].push_back(j);
+        }
+    }
+    for (uint32_t i = 0; i < before.size() && !by_content.empty(); i++) {
+        if (new_of[i] != UNPAIRED) {
+            continue;
+        }
+        auto it = by_content.find(before_.hashes[before[i]]);
+        if (it != by_content.end() && !it->second.empty()) {
+            uint32_t j = it->second.back();
+            it->second.pop_back();
+            new_of[i] = j;
+            old_of[j] = i;
+        }
+    }
+
+    // The pairs that kept their relative order are a longest increasing
+    // subsequence of the new positions taken in old order (patience sorting)
+    std::vector<uint32_t> paired;
+    for (uint32_t i = 0; i < before.size(); i++) {
+        if (new_of[i] != UNPAIRED) {
+            paired.push_back(i);
+        }
+    }
+    std::vector<uint32_t> tails;
+    std::vector<uint32_t> previous(paired.size(), UNPAIRED);
+    for (uint32_t s = 0; s < paired.size(); s++) {
+        uint32_t position = new_of[paired[s]];
+        auto it = std::lower_bound(tails.begin(), tails.end(), position,
+                                   [&](uint32_t tail, uint32_t value) { return new_of[paired[tail]] < value; });
+        if (it != tails.begin()) {
+            previous[s] = *(it - 1);
+        }
+        if (it == tails.end()) {
+            tails.push_back(s);
+        } else {
+            *it = s;
+        }
+    }
+    std::vector<bool> kept(before.size(), false);
+    for (uint32_t s = tails.empty() ? UNPAIRED : tails.back(); s != UNPAIRED; s = previous[s]) {
+        kept[paired[s]] = true;
+    }
+
+    for (uint32_t j = 0; j < after.size(); j++) {
+        std::string rule_path = join(path, new_ast.name(after[j]));
+        uint32_t i = old_of[j];
+        if (i == UNPAIRED) {
+            add(ChangeKind::ADDED, after_, after[j], std::move(rule_path));
+            continue;
+        }
+        if (old_ast.name(before[i]) != new_ast.name(after[j])) {
+            add(ChangeKind::RENAMED, after_, after[j], rule_path, "", std::string(old_ast.name(before[i])),
+                std::string(new_ast.name(after[j])));
+        }
+        if (!kept[i]) {
+            add(ChangeKind::MOVED, after_, after[j], rule_path, chain, std::to_string(i + 1), std::to_string(j + 1));
+        }
+        if (before_.hashes[before[i]] != after_.hashes[after[j]]) {
+            compareSections({before[i]}, {after[j]}, rule_path);
+        }
+    }
+    for (uint32_t i = 0; i < before.size(); i++) {
+        if (new_of[i] == UNPAIRED) {
+            add(ChangeKind::REMOVED, before_, before[i], join(path, old_ast.name(before[i])));
+        }
+    }
+}
+
+void ConfigDiff::add(ChangeKind kind, const Side& side, NodeId node, std::string path, std::string property,
+                     std::string before, std::string after) {
+    changes_.push_back({kind, std::move(path), std::move(property), std::move(before), std::move(after),
+                        side.ast.line(node), side.ast.column(node)});
+}
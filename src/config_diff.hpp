@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "flat_ast.hpp"
+
+/**
+ * @class ConfigDiff
+ * @brief Semantic differences between two versions of a configuration
+ *
+ * Sections and properties are matched by name, and static routes by table,
+ * destination and distance, so reordering them is not a change and neither
+ * is spelling a property through an alias such as dst for destination.
+ * Firewall rules and routing rules are evaluated in order: within each
+ * chain they are paired by name, or by content when a rule was renamed,
+ * and the pairs that kept their relative order are found as a longest
+ * increasing subsequence of their new positions, which is the longest
+ * common subsequence of the two chains. The other pairs are reported as
+ * moved.
+ *
+ * Every section is hashed over its content first, so unchanged subtrees are
+ * skipped without being walked and comparing programs with hundreds of
+ * thousands of rules stays close to linear.
+ */
+class ConfigDiff {
+public:
+    enum class ChangeKind {
+        ADDED,
+        REMOVED,
+        CHANGED,
+        MOVED,
+        RENAMED
+    };
+
+    struct Change {
+        ChangeKind kind;
+        std::string path;       // Section path such as "firewall/filter/drop_ssh"
+        std::string property;   // DSL property, or the chain of a moved rule; empty for whole sections
+        std::string before;     // Old value, name or position
+        std::string after;      // New value, name or position
+        int line;               // In the old program for removals, in the new one otherwise
+        int column;
+    };
+
+    /**
+     * @param before The old program
+     * @param after The new program; both must outlive the diff
+     */
+    ConfigDiff(const FlatAst& before, const FlatAst& after);
+
+    /**
+     * @brief Compare the programs
+     * @return The changes, in the order of the new program; removals follow
+     *         the entries they were among
+     */
+    const std::vector<Change>& compare();
+
+    /**
+     * @brief Print one line per change, located like diagnostics
+     * @param out Stream to print to
+     * @param before_name File name of the old program
+     * @param after_name File name of the new program
+     */
+    void print(FILE* out, const std::string& before_name, const std::string& after_name) const;
+
+    // Number of changes of a kind found by compare()
+    size_t count(ChangeKind kind) const noexcept;
+
+private:
+    // How the subsections of a section are matched
+    enum class Order : uint8_t {
+        UNORDERED,  // By name
+        ROUTES,     // Routes by table, destination and distance, anything else by name
+        RULES       // In order, chain by chain
+    };
+
+    // Sections of one program that share a key and are compared as one, such
+    // as two top-level firewall sections; empty for the top level itself
+    using Parts = std::vector<FlatAst::NodeId>;
+
+    struct Side {
+        const FlatAst& ast;
+        std::vector<uint64_t> hashes;  // Content hash of every section, without its own name
+    };
+
+    static Order childOrder(const std::string& path);
+
+    uint64_t hashChildren(Side& side, FlatAst::NodeId first, const std::string& path);
+    std::vector<FlatAst::NodeId> children(const Side& side, const Parts& parts) const;
+    std::string key(const Side& side, FlatAst::NodeId section, Order order) const;
+
+    void compareSections(const Parts& before, const Parts& after, const std::string& path);
+    void compareProperties(const std::vector<FlatAst::NodeId>& before, const std::vector<FlatAst::NodeId>& after,
+                           const std::string& path);
+    void compareRules(const std::vector<FlatAst::NodeId>& before, const std::vector<FlatAst::NodeId>& after,
+                      const std::string& path);
+    void compareChain(const std::vector<FlatAst::NodeId>& before, const std::vector<FlatAst::NodeId>& after,
+                      const std::string& path, const std::string& chain);
+
+    void add(ChangeKind kind, const Side& side, FlatAst::NodeId node, std::string path, std::string property = "",
+             std::string before = "", std::string after = "");
+
+    Side before_;
+    Side after_;
+    std::vector<Change> changes_;
+};
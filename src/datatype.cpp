@@ -1,4 +1,6 @@
 #include "datatype.hpp"
+#include <mutex>
+#include <unordered_map>
 
 // Datatype implementation
 Datatype::Datatype(Type type_value) noexcept : type(type_value) {}
@@ -8,7 +10,7 @@ Datatype::Type Datatype::get_type() const noexcept
     return type; 
 }
 
-std::string Datatype::type_name() const 
+std::string_view Datatype::type_name() const noexcept
 {
     switch (type) {
         case Type::STRING: return "string";
@@ -26,9 +28,14 @@ std::string Datatype::type_name() const
     }
 }
 
+void Datatype::destroy() noexcept
+{
+    // Datatypes are shared and live as long as the program
+}
+
 std::string Datatype::to_string() const 
 {
-    return type_name();
+    return std::string(type_name());
 }
 
 std::string Datatype::to_mikrotik(const std::string& ident) const 
@@ -40,11 +47,6 @@ std::string Datatype::to_mikrotik(const std::string& ident) const
 // BasicDatatype implementation
 BasicDatatype::BasicDatatype(Type type_value) noexcept : Datatype(type_value) {}
 
-void BasicDatatype::destroy() noexcept 
-{
-    // No dynamic memory to clean up
-}
-
 std::string BasicDatatype::to_mikrotik(const std::string& ident) const 
 {
     // Return empty string by default
@@ -54,6 +56,12 @@ std::string BasicDatatype::to_mikrotik(const std::string& ident) const
 // StringDatatype implementation
 StringDatatype::StringDatatype() noexcept : BasicDatatype(Type::STRING) {}
 
+const StringDatatype* StringDatatype::instance() noexcept
+{
+    static const StringDatatype datatype;
+    return &datatype;
+}
+
 std::string StringDatatype::to_mikrotik(const std::string& ident) const 
 {
     // In MikroTik scripting, strings are enclosed in double quotes
@@ -63,6 +71,12 @@ std::string StringDatatype::to_mikrotik(const std::string& ident) const
 // NumberDatatype implementation
 NumberDatatype::NumberDatatype() noexcept : BasicDatatype(Type::NUMBER) {}
 
+const NumberDatatype* NumberDatatype::instance() noexcept
+{
+    static const NumberDatatype datatype;
+    return &datatype;
+}
+
 std::string NumberDatatype::to_mikrotik(const std::string& ident) const 
 {
     // Numbers in MikroTik are represented directly
@@ -72,6 +86,12 @@ std::string NumberDatatype::to_mikrotik(const std::string& ident) const
 // BooleanDatatype implementation
 BooleanDatatype::BooleanDatatype() noexcept : BasicDatatype(Type::BOOLEAN) {}
 
+const BooleanDatatype* BooleanDatatype::instance() noexcept
+{
+    static const BooleanDatatype datatype;
+    return &datatype;
+}
+
 std::string BooleanDatatype::to_mikrotik(const std::string& ident) const 
 {
     // Booleans in MikroTik are represented as true/false
@@ -81,6 +101,12 @@ std::string BooleanDatatype::to_mikrotik(const std::string& ident) const
 // IPAddressDatatype implementation
 IPAddressDatatype::IPAddressDatatype() noexcept : BasicDatatype(Type::IP_ADDRESS) {}
 
+const IPAddressDatatype* IPAddressDatatype::instance() noexcept
+{
+    static const IPAddressDatatype datatype;
+    return &datatype;
+}
+
 std::string IPAddressDatatype::to_mikrotik(const std::string& ident) const 
 {
     // IP addresses are represented as strings in MikroTik
@@ -90,6 +116,12 @@ std::string IPAddressDatatype::to_mikrotik(const std::string& ident) const
 // IPCIDRDatatype implementation
 IPCIDRDatatype::IPCIDRDatatype() noexcept : BasicDatatype(Type::IP_CIDR) {}
 
+const IPCIDRDatatype* IPCIDRDatatype::instance() noexcept
+{
+    static const IPCIDRDatatype datatype;
+    return &datatype;
+}
+
 std::string IPCIDRDatatype::to_mikrotik(const std::string& ident) const 
 {
     // CIDR notation in MikroTik is represented as strings
@@ -99,7 +131,14 @@ std::string IPCIDRDatatype::to_mikrotik(const std::string& ident) const
 // ConfigSectionDatatype implementation
 ConfigSectionDatatype::ConfigSectionDatatype() noexcept : BasicDatatype(Type::SECTION) {}
 
-std::string ConfigSectionDatatype::type_name() const {
+const ConfigSectionDatatype* ConfigSectionDatatype::instance() noexcept
+{
+    static const ConfigSectionDatatype datatype;
+    return &datatype;
+}
+
+std::string_view ConfigSectionDatatype::type_name() const noexcept
+{
     return "ConfigSection";
 }
 
@@ -112,7 +151,14 @@ std::string ConfigSectionDatatype::to_mikrotik(const std::string& ident) const
 // InterfaceDatatype implementation
 InterfaceDatatype::InterfaceDatatype() noexcept : BasicDatatype(Type::SECTION) {}
 
-std::string InterfaceDatatype::type_name() const {
+const InterfaceDatatype* InterfaceDatatype::instance() noexcept
+{
+    static const InterfaceDatatype datatype;
+    return &datatype;
+}
+
+std::string_view InterfaceDatatype::type_name() const noexcept
+{
     return "Interface";
 }
 
@@ -123,19 +169,24 @@ std::string InterfaceDatatype::to_mikrotik(const std::string& ident) const
 }
 
 // ListDatatype implementation
-ListDatatype::ListDatatype(Datatype* element_type) noexcept 
+ListDatatype::ListDatatype(const Datatype* element_type) noexcept 
     : Datatype(Type::LIST), element_type(element_type) {}
 
-void ListDatatype::destroy() noexcept 
+const ListDatatype* ListDatatype::of(const Datatype* element_type)
 {
-    if (element_type) {
-        element_type->destroy();
-        delete element_type;
-        element_type = nullptr;
+    // Element types are interned too, so the element pointer identifies the list type
+    static std::mutex mutex;
+    static std::unordered_map<const Datatype*, const ListDatatype*> lists;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const ListDatatype*& list = lists[element_type];
+    if (!list) {
+        list = new ListDatatype(element_type);
     }
+    return list;
 }
 
-Datatype* ListDatatype::get_element_type() const noexcept 
+const Datatype* ListDatatype::get_element_type() const noexcept 
 {
     return element_type;
 }
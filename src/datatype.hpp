@@ -3,6 +3,13 @@
 #include "ast_node_interface.hpp"
 
 // Base class for all data types
+//
+// Datatypes are immutable and interned: every basic type has a single
+// instance returned by instance(), and list types are hash-consed by
+// ListDatatype::of(), so two descriptors are equal exactly when their
+// pointers are. Nothing ever owns a datatype; destroy() does nothing and
+// the destructors are not accessible, so a descriptor cannot be freed by
+// mistake.
 class Datatype : public ASTNodeInterface
 {
 public:
@@ -21,93 +28,133 @@ public:
         LIST      // For lists of values
     };
 
-    Datatype(Type type_value) noexcept;
+    Datatype(const Datatype&) = delete;
+    Datatype& operator=(const Datatype&) = delete;
+
     Type get_type() const noexcept;
-    
+
     // Returns a string representation of the type
-    virtual std::string type_name() const;
+    virtual std::string_view type_name() const noexcept;
+    void destroy() noexcept final;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
 
 protected:
-    Type type;
+    Datatype(Type type_value) noexcept;
+    ~Datatype() noexcept override = default;
+
+    const Type type;
 };
 
 // Basic types used in the DSL
 class BasicDatatype : public Datatype
 {
 public:
-    BasicDatatype(Type type_value) noexcept;
-    void destroy() noexcept override;
     std::string to_mikrotik(const std::string& ident) const override;
+
+protected:
+    BasicDatatype(Type type_value) noexcept;
 };
 
 // String type (for names, descriptions, etc.)
-class StringDatatype : public BasicDatatype
+class StringDatatype final : public BasicDatatype
 {
 public:
-    StringDatatype() noexcept;
+    static const StringDatatype* instance() noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    StringDatatype() noexcept;
+    ~StringDatatype() noexcept override = default;
 };
 
 // Number type (for port numbers, VLAN IDs, etc.)
-class NumberDatatype : public BasicDatatype
+class NumberDatatype final : public BasicDatatype
 {
 public:
-    NumberDatatype() noexcept;
+    static const NumberDatatype* instance() noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    NumberDatatype() noexcept;
+    ~NumberDatatype() noexcept override = default;
 };
 
 // Boolean type (for enabled/disabled states)
-class BooleanDatatype : public BasicDatatype
+class BooleanDatatype final : public BasicDatatype
 {
 public:
-    BooleanDatatype() noexcept;
+    static const BooleanDatatype* instance() noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    BooleanDatatype() noexcept;
+    ~BooleanDatatype() noexcept override = default;
 };
 
 // Network address types
-class IPAddressDatatype : public BasicDatatype
+class IPAddressDatatype final : public BasicDatatype
 {
 public:
-    IPAddressDatatype() noexcept;
+    static const IPAddressDatatype* instance() noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    IPAddressDatatype() noexcept;
+    ~IPAddressDatatype() noexcept override = default;
 };
 
-class IPCIDRDatatype : public BasicDatatype
+class IPCIDRDatatype final : public BasicDatatype
 {
 public:
-    IPCIDRDatatype() noexcept;
+    static const IPCIDRDatatype* instance() noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    IPCIDRDatatype() noexcept;
+    ~IPCIDRDatatype() noexcept override = default;
 };
 
 // Config section type (for device, interfaces, firewall sections)
-class ConfigSectionDatatype : public BasicDatatype
+class ConfigSectionDatatype final : public BasicDatatype
 {
 public:
-    ConfigSectionDatatype() noexcept;
-    std::string type_name() const override;
+    static const ConfigSectionDatatype* instance() noexcept;
+    std::string_view type_name() const noexcept override;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    ConfigSectionDatatype() noexcept;
+    ~ConfigSectionDatatype() noexcept override = default;
 };
 
 // Interface type (for network interfaces)
-class InterfaceDatatype : public BasicDatatype
+class InterfaceDatatype final : public BasicDatatype
 {
 public:
-    InterfaceDatatype() noexcept;
-    std::string type_name() const override;
+    static const InterfaceDatatype* instance() noexcept;
+    std::string_view type_name() const noexcept override;
     std::string to_mikrotik(const std::string& ident) const override;
+
+private:
+    InterfaceDatatype() noexcept;
+    ~InterfaceDatatype() noexcept override = default;
 };
 
 // List type (for arrays of values)
-class ListDatatype : public Datatype
+class ListDatatype final : public Datatype
 {
 public:
-    ListDatatype(Datatype* element_type) noexcept;
-    void destroy() noexcept override;
-    Datatype* get_element_type() const noexcept;
+    // The unique list type with this element type. The first request for a
+    // given element type creates it; later ones only look it up.
+    static const ListDatatype* of(const Datatype* element_type);
+
+    const Datatype* get_element_type() const noexcept;
     std::string to_mikrotik(const std::string& ident) const override;
 
 private:
-    Datatype* element_type; // Type of elements in the list
-}; 
\ No newline at end of file
+    ListDatatype(const Datatype* element_type) noexcept;
+    ~ListDatatype() noexcept override = default;
+
+    const Datatype* const element_type; // Type of elements in the list
+};
@@ -172,19 +172,11 @@ std::string ConfigDeclaration::to_mikrotik(const std::string& ident) const
                     const std::string& prop_name = prop_stmt->get_name();
                     if (prop_name == "vendor") {
                         if (prop_stmt->get_value()) {
-                            vendor_value = prop_stmt->get_value()->to_mikrotik("");
-                            // Remove quotes if present
-                            if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                                vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                            }
+                            vendor_value = expression_text(prop_stmt->get_value());
                         }
                     } else if (prop_name == "model") {
                         if (prop_stmt->get_value()) {
-                            model_value = prop_stmt->get_value()->to_mikrotik("");
-                            // Remove quotes if present
-                            if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                                model_value = model_value.substr(1, model_value.size() - 2);
-                            }
+                            model_value = expression_text(prop_stmt->get_value());
                         }
                     }
                 } else {
@@ -198,25 +190,10 @@ std::string ConfigDeclaration::to_mikrotik(const std::string& ident) const
         if (!vendor_value.empty() || !model_value.empty()) {
             std::string device_name;
             if (!vendor_value.empty() && !model_value.empty()) {
-                // Remove quotes if present in both values
-                if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                    vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                }
-                if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                    model_value = model_value.substr(1, model_value.size() - 2);
-                }
                 device_name = vendor_value + "_" + model_value;
             } else if (!vendor_value.empty()) {
-                // Remove quotes if present
-                if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                    vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                }
                 device_name = vendor_value;
             } else {
-                // Remove quotes if present
-                if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                    model_value = model_value.substr(1, model_value.size() - 2);
-                }
                 device_name = model_value;
             }
             
@@ -341,12 +318,16 @@ void ProgramDeclaration::add_section(SectionStatement* section) noexcept
         
         
         sections.push_back(section);
+        if (!shared.empty()) {
+            shared.push_back(false);
+        }
         
         // Set parent for any sub-sections in the block
-        if (section->get_block()) {
-            for (auto* stmt : section->get_block()->get_statements()) {
-                if (auto* sub_section = dynamic_cast<SectionStatement*>(stmt)) {
-
+        if (const BlockStatement* block = section->get_block()) {
+            const StatementList& statements = block->get_statements();
+            for (size_t i = 0; i < statements.size(); i++) {
+                // Borrowed subsections already belong to the section they were parsed in
+                if (auto* sub_section = dynamic_cast<SectionStatement*>(statements[i]); sub_section && !block->is_shared(i)) {
                     sub_section->set_parent(section);
                 }
             }
@@ -354,20 +335,38 @@ void ProgramDeclaration::add_section(SectionStatement* section) noexcept
     }
 }
 
+void ProgramDeclaration::add_shared_section(SectionStatement* section) noexcept
+{
+    if (section) {
+        shared.resize(sections.size(), false);
+        sections.push_back(section);
+        shared.push_back(true);
+    }
+}
+
 const std::vector<SectionStatement*>& ProgramDeclaration::get_sections() const noexcept 
 {
     return sections;
 }
 
+std::vector<SectionStatement*> ProgramDeclaration::release_sections() noexcept
+{
+    std::vector<SectionStatement*> released;
+    released.swap(sections);
+    shared.clear();
+    return released;
+}
+
 void ProgramDeclaration::destroy() noexcept 
 {
-    for (auto* section : sections) {
-        if (section) {
-            section->destroy();
-            delete section;
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (sections[i] && !(i < shared.size() && shared[i])) {
+            sections[i]->destroy();
+            delete sections[i];
         }
     }
     sections.clear();
+    shared.clear();
 }
 
 std::string ProgramDeclaration::to_string() const 
@@ -53,11 +53,20 @@ public:
     // Add a section to this program
     void add_section(SectionStatement* section) noexcept;
     
+    // Add a section owned elsewhere, such as an included module; it is
+    // neither modified nor freed by this program
+    void add_shared_section(SectionStatement* section) noexcept;
+    
     const std::vector<SectionStatement*>& get_sections() const noexcept;
+    
+    // Give up ownership of all sections, leaving this program empty
+    std::vector<SectionStatement*> release_sections() noexcept;
+    
     void destroy() noexcept override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
 private:
     std::vector<SectionStatement*> sections;
+    std::vector<bool> shared;   // Empty until the first shared section is added
 }; 
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "diagnostics.hpp"
+#include "statement.hpp"
+#include <algorithm>
+
+void Diagnostics::report(Severity severity, int line, int column, std::string message)
+{
+    if (severity == Severity::ERROR) {
+        error_count_++;
+    }
+    diagnostics_.push_back({severity, line, column, std::move(message)});
+}
+
+void Diagnostics::error(const Statement* where, std::string message)
+{
+    report(Severity::ERROR, where ? where->get_line() : 0, where ? where->get_column() : 0, std::move(message));
+}
+
+void Diagnostics::warning(const Statement* where, std::string message)
+{
+    report(Severity::WARNING, where ? where->get_line() : 0, where ? where->get_column() : 0, std::move(message));
+}
+
+void Diagnostics::merge(Diagnostics&& other)
+{
+    diagnostics_.insert(diagnostics_.end(),
+                        std::make_move_iterator(other.diagnostics_.begin()),
+                        std::make_move_iterator(other.diagnostics_.end()));
+    error_count_ += other.error_count_;
+    other.diagnostics_.clear();
+    other.error_count_ = 0;
+}
+
+void Diagnostics::sort()
+{
+    std::stable_sort(diagnostics_.begin(), diagnostics_.end(),
+        [](const Diagnostic& a, const Diagnostic& b) {
+            // Unknown locations (line 0) sort after every located diagnostic
+            if ((a.line == 0) != (b.line == 0)) {
+                return b.line == 0;
+            }
+            if (a.line != b.line) {
+                return a.line < b.line;
+            }
+            return a.column < b.column;
+        });
+}
+
+void Diagnostics::print(FILE* out, const std::string& file, size_t max_errors) const
+{
+    size_t errors_printed = 0;
+    for (const Diagnostic& diagnostic : diagnostics_) {
+        if (diagnostic.severity == Severity::ERROR) {
+            if (max_errors > 0 && errors_printed == max_errors) {
+                fprintf(out, "%s: too many errors emitted, stopping now (%zu more not shown)\n",
+                        file.c_str(), error_count_ - errors_printed);
+                return;
+            }
+            errors_printed++;
+        }
+
+        std::string location = file;
+        if (diagnostic.line > 0) {
+            location += ":" + std::to_string(diagnostic.line);
+            if (diagnostic.column > 0) {
+                location += ":" + std::to_string(diagnostic.column);
+            }
+        }
+        fprintf(out, "%s: %s: %s\n", location.c_str(),
+                severity_to_string(diagnostic.severity).c_str(), diagnostic.message.c_str());
+    }
+}
+
+size_t Diagnostics::error_count() const noexcept
+{
+    return error_count_;
+}
+
+size_t Diagnostics::warning_count() const noexcept
+{
+    return diagnostics_.size() - error_count_;
+}
+
+bool Diagnostics::has_errors() const noexcept
+{
+    return error_count_ > 0;
+}
+
+bool Diagnostics::empty() const noexcept
+{
+    return diagnostics_.empty();
+}
+
+const std::vector<Diagnostics::Diagnostic>& Diagnostics::get_diagnostics() const noexcept
+{
+    return diagnostics_;
+}
+
+std::string Diagnostics::severity_to_string(Severity severity)
+{
+    switch (severity) {
+        case Severity::WARNING: return "warning";
+        case Severity::ERROR: return "error";
+        default: return "note";
+    }
+}
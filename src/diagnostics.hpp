@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+class Statement;
+
+/**
+ * @class Diagnostics
+ * @brief Collects every error and warning of a compilation with its source location
+ *
+ * Validators report into a Diagnostics sink instead of stopping at the first
+ * problem, so a single compile pass surfaces everything. Sinks filled on
+ * different threads are merged and sorted by location before printing, which
+ * keeps the output identical regardless of the order the work finished in.
+ */
+class Diagnostics {
+public:
+    enum class Severity {
+        WARNING,
+        ERROR
+    };
+
+    struct Diagnostic {
+        Severity severity;
+        int line;      // 0 if unknown
+        int column;    // 0 if unknown
+        std::string message;
+    };
+
+    /**
+     * @brief Record a diagnostic at an explicit source location
+     */
+    void report(Severity severity, int line, int column, std::string message);
+
+    /**
+     * @brief Record an error at the location of a statement
+     * @param where The offending statement, or nullptr if it has no location
+     * @param message Description of the problem
+     */
+    void error(const Statement* where, std::string message);
+
+    /**
+     * @brief Record a warning at the location of a statement
+     * @param where The offending statement, or nullptr if it has no location
+     * @param message Description of the problem
+     */
+    void warning(const Statement* where, std::string message);
+
+    /**
+     * @brief Move all diagnostics of another sink into this one
+     */
+    void merge(Diagnostics&& other);
+
+    /**
+     * @brief Stable sort by line and column; diagnostics without a location go last
+     */
+    void sort();
+
+    /**
+     * @brief Print diagnostics as "file:line:column: severity: message"
+     * @param out Output stream
+     * @param file File name used as location prefix
+     * @param max_errors Stop after this many errors (0 means no limit)
+     */
+    void print(FILE* out, const std::string& file, size_t max_errors = 0) const;
+
+    size_t error_count() const noexcept;
+    size_t warning_count() const noexcept;
+    bool has_errors() const noexcept;
+    bool empty() const noexcept;
+
+    const std::vector<Diagnostic>& get_diagnostics() const noexcept;
+
+    static std::string severity_to_string(Severity severity);
+
+private:
+    std::vector<Diagnostic> diagnostics_;
+    size_t error_count_ = 0;
+};
+
+// Independent unit of validation work reporting into its own sink
+using ValidationTask = std::function<void(Diagnostics&)>;
@@ -21,17 +21,27 @@ std::string Value::to_mikrotik(const std::string& ident) const
 }
 
 // StringValue implementation
-StringValue::StringValue(std::string_view str_value) noexcept 
-    : Value(ValueType::STRING), str_value(str_value) {}
+StringValue::StringValue(std::string_view str_value, bool quoted) noexcept 
+    : Value(ValueType::STRING), str_value(str_value), quoted(quoted) {}
 
 const std::string& StringValue::get_value() const noexcept 
 {
     return str_value;
 }
 
-Datatype* StringValue::get_type() const 
+std::string_view StringValue::get_view() const noexcept
 {
-    return new StringDatatype();
+    return str_value;
+}
+
+bool StringValue::is_quoted() const noexcept
+{
+    return quoted;
+}
+
+const Datatype* StringValue::get_type() const 
+{
+    return StringDatatype::instance();
 }
 
 std::string StringValue::to_string() const 
@@ -41,8 +51,8 @@ std::string StringValue::to_string() const
 
 std::string StringValue::to_mikrotik(const std::string& ident) const
 {
-    // Return the string value without quotes (quotes will be added where needed)
-    return str_value;
+    // Quoted literals keep their quotes; bare words are written as they are
+    return quoted ? "\"" + str_value + "\"" : str_value;
 }
 
 // NumberValue implementation
@@ -54,9 +64,9 @@ int NumberValue::get_value() const noexcept
     return num_value;
 }
 
-Datatype* NumberValue::get_type() const 
+const Datatype* NumberValue::get_type() const 
 {
-    return new NumberDatatype();
+    return NumberDatatype::instance();
 }
 
 std::string NumberValue::to_string() const 
@@ -79,9 +89,9 @@ bool BooleanValue::get_value() const noexcept
     return bool_value;
 }
 
-Datatype* BooleanValue::get_type() const 
+const Datatype* BooleanValue::get_type() const 
 {
-    return new BooleanDatatype();
+    return BooleanDatatype::instance();
 }
 
 std::string BooleanValue::to_string() const 
@@ -104,9 +114,14 @@ const std::string& IPAddressValue::get_value() const noexcept
     return ip_value;
 }
 
-Datatype* IPAddressValue::get_type() const 
+std::string_view IPAddressValue::get_view() const noexcept
 {
-    return new IPAddressDatatype();
+    return ip_value;
+}
+
+const Datatype* IPAddressValue::get_type() const 
+{
+    return IPAddressDatatype::instance();
 }
 
 std::string IPAddressValue::to_string() const 
@@ -129,9 +144,14 @@ const std::string& IPCIDRValue::get_value() const noexcept
     return cidr_value;
 }
 
-Datatype* IPCIDRValue::get_type() const 
+std::string_view IPCIDRValue::get_view() const noexcept
+{
+    return cidr_value;
+}
+
+const Datatype* IPCIDRValue::get_type() const 
 {
-    return new IPCIDRDatatype();
+    return IPCIDRDatatype::instance();
 }
 
 std::string IPCIDRValue::to_string() const 
@@ -146,7 +166,7 @@ std::string IPCIDRValue::to_mikrotik(const std::string& ident) const
 }
 
 // ListValue implementation
-ListValue::ListValue(const ValueList& values, Datatype* element_type) noexcept 
+ListValue::ListValue(const ValueList& values, const Datatype* element_type) noexcept 
     : values(values), element_type(element_type) {}
 
 const ValueList& ListValue::get_values() const noexcept 
@@ -154,6 +174,11 @@ const ValueList& ListValue::get_values() const noexcept
     return values;
 }
 
+void ListValue::add_value(Value* value) noexcept
+{
+    values.push_back(value);
+}
+
 void ListValue::destroy() noexcept 
 {
     for (auto* value : values) {
@@ -163,28 +188,20 @@ void ListValue::destroy() noexcept
         }
     }
     values.clear();
-    
-    if (element_type) {
-        element_type->destroy();
-        delete element_type;
-        element_type = nullptr;
-    }
 }
 
-Datatype* ListValue::get_type() const 
+const Datatype* ListValue::get_type() const 
 {
     // If we have an element type, use it; otherwise try to determine from first element
     if (element_type) {
-        return new ListDatatype(element_type->get_type() == Datatype::Type::LIST 
-            ? new ListDatatype(static_cast<ListDatatype*>(element_type)->get_element_type())
-            : element_type);
+        return ListDatatype::of(element_type);
     }
     else if (!values.empty() && values[0]) {
-        return new ListDatatype(values[0]->get_type());
+        return ListDatatype::of(values[0]->get_type());
     }
     
     // Default to list of strings if we can't determine
-    return new ListDatatype(new StringDatatype());
+    return ListDatatype::of(StringDatatype::instance());
 }
 
 std::string ListValue::to_string() const 
@@ -247,11 +264,11 @@ void IdentifierExpression::destroy() noexcept
     // No dynamic memory to clean up
 }
 
-Datatype* IdentifierExpression::get_type() const 
+const Datatype* IdentifierExpression::get_type() const 
 {
     // This would typically be resolved during semantic analysis
     // Default to string type for now
-    return new StringDatatype();
+    return StringDatatype::instance();
 }
 
 std::string IdentifierExpression::to_string() const 
@@ -265,6 +282,36 @@ std::string IdentifierExpression::to_mikrotik(const std::string& ident) const
     return "$" + name;
 }
 
+// ParameterExpression implementation
+ParameterExpression::ParameterExpression(std::string_view name) noexcept 
+    : name(name) {}
+
+const std::string& ParameterExpression::get_name() const noexcept 
+{
+    return name;
+}
+
+void ParameterExpression::destroy() noexcept 
+{
+    // No dynamic memory to clean up
+}
+
+const Datatype* ParameterExpression::get_type() const 
+{
+    // Only known once the argument is substituted
+    return StringDatatype::instance();
+}
+
+std::string ParameterExpression::to_string() const 
+{
+    return "$" + name;
+}
+
+std::string ParameterExpression::to_mikrotik(const std::string& ident) const
+{
+    return "$" + name;
+}
+
 // PropertyReference implementation
 PropertyReference::PropertyReference(Expression* base, std::string_view property_name) noexcept 
     : base(base), property_name(property_name) {}
@@ -288,11 +335,11 @@ void PropertyReference::destroy() noexcept
     }
 }
 
-Datatype* PropertyReference::get_type() const 
+const Datatype* PropertyReference::get_type() const 
 {
     // This would typically be resolved during semantic analysis
     // Default to string type for now
-    return new StringDatatype();
+    return StringDatatype::instance();
 }
 
 std::string PropertyReference::to_string() const 
@@ -307,4 +354,45 @@ std::string PropertyReference::to_mikrotik(const std::string& ident) const
         return "(" + base->to_mikrotik("") + "->" + property_name + ")";
     }
     return "$" + property_name;
-} 
\ No newline at end of file
+}
+
+std::string expression_text(const Expression* expr)
+{
+    if (!expr) {
+        return "";
+    }
+
+    std::string text;
+    append_expression_text(text, expr);
+    return text;
+}
+
+std::string_view expression_view(const Expression* expr) noexcept
+{
+    if (const auto* str_val = dynamic_cast<const StringValue*>(expr)) {
+        return str_val->get_view();
+    }
+    if (const auto* ip_val = dynamic_cast<const IPAddressValue*>(expr)) {
+        return ip_val->get_view();
+    }
+    if (const auto* cidr_val = dynamic_cast<const IPCIDRValue*>(expr)) {
+        return cidr_val->get_view();
+    }
+    if (const auto* ident = dynamic_cast<const IdentifierExpression*>(expr)) {
+        return ident->get_name();
+    }
+    return {};
+}
+
+void append_expression_text(std::string& out, const Expression* expr)
+{
+    if (!expr) {
+        return;
+    }
+    if (dynamic_cast<const StringValue*>(expr) || dynamic_cast<const IPAddressValue*>(expr) ||
+        dynamic_cast<const IPCIDRValue*>(expr) || dynamic_cast<const IdentifierExpression*>(expr)) {
+        out.append(expression_view(expr));
+        return;
+    }
+    out += expr->to_mikrotik("");
+}
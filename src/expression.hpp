@@ -7,8 +7,8 @@
 class Expression : public ASTNodeInterface
 {
 public:
-    // Get the data type of this expression
-    virtual Datatype* get_type() const = 0;
+    // Get the data type of this expression; datatypes are shared, never free them
+    virtual const Datatype* get_type() const = 0;
 };
 
 // Base class for values (literals)
@@ -38,18 +38,24 @@ protected:
 };
 
 // String literal value
+//
+// The lexer strips the quotes of string literals, so the value always holds
+// the bare contents; quoted records whether the source wrote them.
 class StringValue : public Value
 {
 public:
-    StringValue(std::string_view str_value) noexcept;
+    StringValue(std::string_view str_value, bool quoted = false) noexcept;
     
     const std::string& get_value() const noexcept;
-    Datatype* get_type() const override;
+    std::string_view get_view() const noexcept;
+    bool is_quoted() const noexcept;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
 private:
     std::string str_value;
+    bool quoted;
 };
 
 // Numeric literal value
@@ -59,7 +65,7 @@ public:
     NumberValue(int num_value) noexcept;
     
     int get_value() const noexcept;
-    Datatype* get_type() const override;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
@@ -74,7 +80,7 @@ public:
     BooleanValue(bool bool_value) noexcept;
     
     bool get_value() const noexcept;
-    Datatype* get_type() const override;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
@@ -89,7 +95,8 @@ public:
     IPAddressValue(std::string_view ip_value) noexcept;
     
     const std::string& get_value() const noexcept;
-    Datatype* get_type() const override;
+    std::string_view get_view() const noexcept;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
@@ -104,7 +111,8 @@ public:
     IPCIDRValue(std::string_view cidr_value) noexcept;
     
     const std::string& get_value() const noexcept;
-    Datatype* get_type() const override;
+    std::string_view get_view() const noexcept;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
@@ -116,17 +124,18 @@ private:
 class ListValue : public Expression
 {
 public:
-    ListValue(const ValueList& values, Datatype* element_type = nullptr) noexcept;
+    ListValue(const ValueList& values, const Datatype* element_type = nullptr) noexcept;
     
     const ValueList& get_values() const noexcept;
+    void add_value(Value* value) noexcept;
     void destroy() noexcept override;
-    Datatype* get_type() const override;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
 private:
     ValueList values;
-    Datatype* element_type;
+    const Datatype* element_type;
 };
 
 // Identifier reference
@@ -137,7 +146,24 @@ public:
     
     const std::string& get_name() const noexcept;
     void destroy() noexcept override;
-    Datatype* get_type() const override;
+    const Datatype* get_type() const override;
+    std::string to_string() const override;
+    std::string to_mikrotik(const std::string& ident) const override;
+    
+private:
+    std::string name;
+};
+
+// Reference to a template or loop parameter ($name). Expanding the template
+// or loop replaces it with the argument, so none reaches validation.
+class ParameterExpression : public Expression
+{
+public:
+    ParameterExpression(std::string_view name) noexcept;
+    
+    const std::string& get_name() const noexcept;
+    void destroy() noexcept override;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
@@ -154,11 +180,21 @@ public:
     const std::string& get_property_name() const noexcept;
     Expression* get_base() const noexcept;
     void destroy() noexcept override;
-    Datatype* get_type() const override;
+    const Datatype* get_type() const override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
 private:
     Expression* base;
     std::string property_name;
-}; 
\ No newline at end of file
+};
+
+// Textual value of a literal expression, without surrounding quotes
+std::string expression_text(const Expression* expr);
+
+// The same text as a view into the expression for strings, identifiers and
+// addresses, which need no copy; empty for every other expression
+std::string_view expression_view(const Expression* expr) noexcept;
+
+// Append expression_text(expr) to out, copying string contents directly
+void append_expression_text(std::string& out, const Expression* expr);
@@ -0,0 +1,786 @@
+#include "firewall_simulator.hpp"
+#include <algorithm>
+#include "command_schema.hpp"
+#include "ipv4_prefix.hpp"
+#include "property_schema.hpp"
+
+namespace {
+
+using NodeId = FlatAst::NodeId;
+using NodeKind = FlatAst::NodeKind;
+using Field = PacketClassifier::Field;
+using Range = PacketClassifier::Range;
+using State = PacketTrace::State;
+
+// Largest value of each field; interfaces are numbered from 1, 0 being any other
+constexpr uint32_t FIELD_MAXIMUM[PacketClassifier::FIELD_COUNT] = {
+    0xFFFFFFFF, 0xFFFFFFFF, 255, 65535, 65535, 0xFFFF, 0xFFFF, static_cast<uint32_t>(State::UNTRACKED),
+};
+
+// Rule properties that match packets, by RouterOS name
+constexpr std::pair<std::string_view, Field> MATCHERS[] = {
+    {"src-address", PacketClassifier::SRC_ADDRESS},
+    {"dst-address", PacketClassifier::DST_ADDRESS},
+    {"protocol", PacketClassifier::PROTOCOL},
+    {"src-port", PacketClassifier::SRC_PORT},
+    {"dst-port", PacketClassifier::DST_PORT},
+    {"in-interface", PacketClassifier::IN_INTERFACE},
+    {"out-interface", PacketClassifier::OUT_INTERFACE},
+    {"connection-state", PacketClassifier::CONNECTION_STATE},
+};
+
+// Rule properties that do not match packets
+constexpr std::string_view NON_MATCHERS[] = {"chain", "action", "comment", "to-addresses", "to-ports"};
+
+// Actions that count a hit and let the chain go on
+constexpr std::string_view PASSTHROUGH_ACTIONS[] = {
+    "log", "passthrough", "add-src-to-address-list", "add-dst-to-address-list", "fasttrack-connection", "jump",
+};
+
+// Command of a firewall table, whose chain parameter gives the default chain
+const CommandSchema* rule_command(std::string_view table) noexcept {
+    if (table == "filter") {
+        return &routeros_commands::FILTER_RULE;
+    }
+    if (table == "nat") {
+        return &routeros_commands::NAT_RULE;
+    }
+    if (table == "raw") {
+        return &routeros_commands::RAW_RULE;
+    }
+    return nullptr;
+}
+
+std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && text.back() == ' ') {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Items of a value: those of a list, or the comma separated parts of anything else
+std::vector<std::string> value_items(const FlatAst& ast, FlatAst::ValueId value) {
+    std::vector<std::string> items;
+    if (value == FlatAst::NONE) {
+        return items;
+    }
+    if (ast.value_kind(value) == FlatAst::ValueKind::LIST) {
+        for (uint32_t i = 0; i < ast.list_size(value); i++) {
+            items.push_back(ast.value_text(ast.list_item(value, i)));
+        }
+        return items;
+    }
+    return MatchParser::split_items(ast.value_text(value));
+}
+
+bool parse_number(std::string_view text, uint32_t maximum, uint32_t& number) noexcept {
+    if (text.empty() || text.size() > 10) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (value > maximum) {
+        return false;
+    }
+    number = static_cast<uint32_t>(value);
+    return true;
+}
+
+// "a.b.c.d", "a.b.c.d/len" or "a.b.c.d-e.f.g.h"
+bool parse_address_range(std::string_view text, Range& range) noexcept {
+    size_t dash = text.find('-');
+    if (dash != std::string_view::npos) {
+        return parse_ipv4_address(text.substr(0, dash), range.low) &&
+               parse_ipv4_address(text.substr(dash + 1), range.high) && range.low <= range.high;
+    }
+    IPv4Prefix prefix;
+    if (!IPv4Prefix::parse(text, prefix)) {
+        return false;
+    }
+    range = {prefix.address, prefix.address | ~IPv4Prefix::mask_for(prefix.length)};
+    return true;
+}
+
+// "n" or "n-m"
+bool parse_number_range(std::string_view text, uint32_t maximum, Range& range) noexcept {
+    size_t dash = text.find('-');
+    if (dash == std::string_view::npos) {
+        if (!parse_number(text, maximum, range.low)) {
+            return false;
+        }
+        range.high = range.low;
+        return true;
+    }
+    return parse_number(text.substr(0, dash), maximum, range.low) &&
+           parse_number(text.substr(dash + 1), maximum, range.high) && range.low <= range.high;
+}
+
+// Sort and merge ranges, so complements and lookups see disjoint ones
+void normalize(std::vector<Range>& ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.low < b.low; });
+    size_t count = 0;
+    for (const Range& range : ranges) {
+        if (count > 0 && (ranges[count - 1].high == UINT32_MAX || range.low <= ranges[count - 1].high + 1)) {
+            ranges[count - 1].high = std::max(ranges[count - 1].high, range.high);
+        } else {
+            ranges[count++] = range;
+        }
+    }
+    ranges.resize(count);
+}
+
+// Mix of the five-tuple of a flow
+template <typename Key>
+size_t flow_hash(const Key& key) noexcept {
+    uint64_t hash = (static_cast<uint64_t>(key.src_address) << 32 | key.dst_address) * 0x9e3779b97f4a7c15ULL;
+    hash ^= (static_cast<uint64_t>(key.src_port) << 24 | static_cast<uint64_t>(key.dst_port) << 8 | key.protocol) *
+            0xc2b2ae3d27d4eb4fULL;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+std::vector<Range> complement(const std::vector<Range>& ranges, uint32_t maximum) {
+    std::vector<Range> result;
+    uint64_t next = 0;
+    for (const Range& range : ranges) {
+        if (range.low > next) {
+            result.push_back({static_cast<uint32_t>(next), range.low - 1});
+        }
+        next = static_cast<uint64_t>(range.high) + 1;
+    }
+    if (next <= maximum) {
+        result.push_back({static_cast<uint32_t>(next), maximum});
+    }
+    return result;
+}
+
+} // namespace
+
+PacketClassifier::PacketClassifier(std::vector<Match> rules)
+    : rules_(std::move(rules)), words_((rules_.size() + 63) / 64)
+{
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+        if (std::any_of(rules_.begin(), rules_.end(), [field](const Match& rule) { return !rule[field].empty(); })) {
+            fields_.push_back(field);
+        }
+    }
+
+    // Elementary intervals start at 0 and wherever a range starts or ends
+    size_t bytes = 0;
+    for (uint8_t field : fields_) {
+        std::vector<uint32_t>& starts = tables_[field].starts;
+        starts.push_back(0);
+        for (const Match& rule : rules_) {
+            for (const Range& range : rule[field]) {
+                starts.push_back(range.low);
+                if (range.high < UINT32_MAX) {
+                    starts.push_back(range.high + 1);
+                }
+            }
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+        bytes += starts.size() * words_ * sizeof(uint64_t);
+    }
+    if (bytes > MAX_TABLE_BYTES) {
+        for (FieldTable& table : tables_) {
+            table = FieldTable();
+        }
+        return;
+    }
+    // The field cut into the most intervals tends to clear the most bits, so it is ANDed first
+    std::stable_sort(fields_.begin(), fields_.end(), [this](uint8_t a, uint8_t b) {
+        return tables_[a].starts.size() > tables_[b].starts.size();
+    });
+
+    for (uint8_t field : fields_) {
+        FieldTable& table = tables_[field];
+        // Rules without ranges in the field are in every vector
+        std::vector<uint64_t> any(words_, 0);
+        for (size_t rule = 0; rule < rules_.size(); rule++) {
+            if (rules_[rule][field].empty()) {
+                any[rule / 64] |= 1ULL << (rule % 64);
+            }
+        }
+        table.rows.resize(table.starts.size() * words_);
+        for (size_t interval = 0; interval < table.starts.size(); interval++) {
+            std::copy(any.begin(), any.end(), table.rows.begin() + interval * words_);
+        }
+        for (size_t rule = 0; rule < rules_.size(); rule++) {
+            for (const Range& range : rules_[rule][field]) {
+                auto first = std::lower_bound(table.starts.begin(), table.starts.end(), range.low);
+                auto last = range.high == UINT32_MAX
+                                ? table.starts.end()
+                                : std::lower_bound(first, table.starts.end(), range.high + 1);
+                for (auto interval = first; interval != last; ++interval) {
+                    table.rows[(interval - table.starts.begin()) * words_ + rule / 64] |= 1ULL << (rule % 64);
+                }
+            }
+        }
+    }
+    compiled_ = true;
+}
+
+uint32_t PacketClassifier::classify(const Key& key, uint32_t from) const noexcept {
+    if (!compiled_) {
+        return classify_linear(key, from);
+    }
+    const uint64_t* rows[FIELD_COUNT];
+    size_t count = 0;
+    for (uint8_t field : fields_) {
+        const FieldTable& table = tables_[field];
+        size_t interval = std::upper_bound(table.starts.begin(), table.starts.end(), key[field]) -
+                          table.starts.begin() - 1;
+        rows[count++] = table.rows.data() + interval * words_;
+    }
+    for (size_t word = from / 64; word < words_; word++) {
+        uint64_t bits = word == from / 64 ? ~0ULL << (from % 64) : ~0ULL;
+        for (size_t i = 0; i < count && bits != 0; i++) {
+            bits &= rows[i][word];
+        }
+        if (bits != 0) {
+            // With no field constrained, the bits past the last rule are set too
+            uint32_t rule = static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits));
+            return rule < rules_.size() ? rule : NO_MATCH;
+        }
+    }
+    return NO_MATCH;
+}
+
+uint32_t PacketClassifier::classify_linear(const Key& key, uint32_t from) const noexcept {
+    for (size_t rule = from; rule < rules_.size(); rule++) {
+        if (matches(rules_[rule], key)) {
+            return static_cast<uint32_t>(rule);
+        }
+    }
+    return NO_MATCH;
+}
+
+bool PacketClassifier::matches(const Match& rule, const Key& key) noexcept {
+    for (size_t field = 0; field < FIELD_COUNT; field++) {
+        const std::vector<Range>& ranges = rule[field];
+        if (!ranges.empty() && std::none_of(ranges.begin(), ranges.end(), [&](const Range& range) {
+                return key[field] >= range.low && key[field] <= range.high;
+            })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FirewallSimulator::FlowKey::operator==(const FlowKey& other) const noexcept {
+    return src_address == other.src_address && dst_address == other.dst_address && src_port == other.src_port &&
+           dst_port == other.dst_port && protocol == other.protocol;
+}
+
+MatchParser::Outcome MatchParser::parse(std::string_view name, std::vector<std::string> items,
+                                        PacketClassifier::Match& match, std::string& invalid) {
+    if (std::find(std::begin(NON_MATCHERS), std::end(NON_MATCHERS), name) != std::end(NON_MATCHERS)) {
+        return Outcome::NOT_A_MATCHER;
+    }
+    auto matcher = std::find_if(std::begin(MATCHERS), std::end(MATCHERS),
+                                [name](const auto& entry) { return entry.first == name; });
+    if (matcher == std::end(MATCHERS)) {
+        return Outcome::NOT_SIMULATED;
+    }
+
+    Field field = matcher->second;
+    bool negated = !items.empty() && !items.front().empty() && items.front().front() == '!';
+    if (negated) {
+        items.front().erase(0, 1);
+    }
+    std::vector<Range> ranges;
+    for (const std::string& item : items) {
+        Range range{0, 0};
+        bool valid = false;
+        switch (field) {
+            case PacketClassifier::SRC_ADDRESS:
+            case PacketClassifier::DST_ADDRESS:
+                valid = parse_address_range(item, range);
+                break;
+            case PacketClassifier::PROTOCOL: {
+                int protocol = PacketTrace::protocol_number(item);
+                valid = protocol >= 0;
+                range = {static_cast<uint32_t>(protocol), static_cast<uint32_t>(protocol)};
+                break;
+            }
+            case PacketClassifier::SRC_PORT:
+            case PacketClassifier::DST_PORT:
+                valid = parse_number_range(item, FIELD_MAXIMUM[field], range);
+                break;
+            case PacketClassifier::IN_INTERFACE:
+            case PacketClassifier::OUT_INTERFACE: {
+                uint32_t id = addInterface(item);
+                valid = id != 0;
+                range = {id, id};
+                break;
+            }
+            case PacketClassifier::CONNECTION_STATE: {
+                State state = PacketTrace::state_for(item);
+                valid = state != State::TRACK;
+                range = {static_cast<uint32_t>(state), static_cast<uint32_t>(state)};
+                break;
+            }
+            default:
+                break;
+        }
+        if (!valid) {
+            invalid = item;
+            return Outcome::INVALID_VALUE;
+        }
+        ranges.push_back(range);
+    }
+    normalize(ranges);
+    if (negated) {
+        ranges = complement(ranges, FIELD_MAXIMUM[field]);
+    }
+    if (ranges.empty()) {
+        return Outcome::NO_PACKET;
+    }
+    match[field] = std::move(ranges);
+    return Outcome::MATCHED;
+}
+
+uint32_t MatchParser::interface_id(std::string_view name) const noexcept {
+    auto it = interface_ids_.find(std::string(name));
+    return it != interface_ids_.end() ? it->second : 0;
+}
+
+std::vector<std::string> MatchParser::split_items(std::string_view text) {
+    std::vector<std::string> items;
+    for (size_t start = 0; start <= text.size();) {
+        size_t comma = std::min(text.find(',', start), text.size());
+        std::string_view item = trim(text.substr(start, comma - start));
+        if (!item.empty()) {
+            items.emplace_back(item);
+        }
+        start = comma + 1;
+    }
+    return items;
+}
+
+uint32_t MatchParser::addInterface(std::string_view name) {
+    auto [it, added] = interface_ids_.try_emplace(std::string(name), static_cast<uint32_t>(interface_ids_.size() + 1));
+    // Ids past the field are rejected by the caller
+    return it->second <= FIELD_MAXIMUM[PacketClassifier::IN_INTERFACE] ? it->second : 0;
+}
+
+FirewallSimulator::FirewallSimulator(const FlatAst& ast, Diagnostics& diagnostics) {
+    std::vector<std::vector<PacketClassifier::Match>> matches;
+    for (NodeId section = ast.root(); section != FlatAst::NONE; section = ast.next_sibling(section)) {
+        if (ast.kind(section) != NodeKind::SECTION) {
+            continue;
+        }
+        if (ast.section_type(section) == SectionStatement::SectionType::IP) {
+            addLocalAddresses(ast, section);
+            // Rules of the IP section are named by their chain
+            for (NodeId child = ast.first_child(section); child != FlatAst::NONE; child = ast.next_sibling(child)) {
+                if (ast.kind(child) != NodeKind::SECTION || ast.name(child) != "firewall") {
+                    continue;
+                }
+                for (NodeId table = ast.first_child(child); table != FlatAst::NONE; table = ast.next_sibling(table)) {
+                    std::string_view name = ast.name(table);
+                    if (ast.kind(table) == NodeKind::SECTION && (name == "filter" || name == "nat")) {
+                        addRules(ast, table, true, matches, diagnostics);
+                    }
+                }
+            }
+        } else if (ast.section_type(section) == SectionStatement::SectionType::FIREWALL) {
+            for (NodeId table = ast.first_child(section); table != FlatAst::NONE; table = ast.next_sibling(table)) {
+                if (ast.kind(table) == NodeKind::SECTION && rule_command(ast.name(table))) {
+                    addRules(ast, table, false, matches, diagnostics);
+                }
+            }
+        }
+    }
+
+    for (auto& chain_matches : matches) {
+        classifiers_.emplace_back(std::move(chain_matches));
+    }
+    raw_prerouting_ = findChain("raw", "prerouting");
+    raw_output_ = findChain("raw", "output");
+    dstnat_ = findChain("nat", "dstnat");
+    srcnat_ = findChain("nat", "srcnat");
+    input_ = findChain("filter", "input");
+    forward_ = findChain("filter", "forward");
+    output_ = findChain("filter", "output");
+}
+
+void FirewallSimulator::addRules(const FlatAst& ast, NodeId table, bool named_by_chain,
+                                 std::vector<std::vector<PacketClassifier::Match>>& matches,
+                                 Diagnostics& diagnostics) {
+    std::string table_name(ast.name(table));
+    std::string_view default_chain = rule_command(table_name)->parameters[0].default_value;
+    for (NodeId node = ast.first_child(table); node != FlatAst::NONE; node = ast.next_sibling(node)) {
+        if (ast.kind(node) != NodeKind::SECTION) {
+            continue;
+        }
+        std::string name(ast.name(node));
+        Rule rule{table_name, named_by_chain ? name : std::string(default_chain), name, "", ast.line(node),
+                  ast.column(node)};
+        PacketClassifier::Match match;
+        for (NodeId property = ast.first_child(node); property != FlatAst::NONE;
+             property = ast.next_sibling(property)) {
+            if (ast.kind(property) != NodeKind::PROPERTY) {
+                continue;
+            }
+            std::string_view name = PropertySchema::routeros_name(ast.name(property));
+            if (name == "chain" || name == "action") {
+                std::string value = ast.value(property) != FlatAst::NONE ? ast.value_text(ast.value(property)) : "";
+                (name == "chain" ? rule.chain : rule.action) = value;
+            } else {
+                rule.simulated = parseMatch(ast, property, match, diagnostics) && rule.simulated;
+            }
+        }
+
+        int chain = findChain(table_name, rule.chain);
+        if (chain < 0) {
+            chain = static_cast<int>(chains_.size());
+            chains_.push_back({table_name, rule.chain, {}});
+            classified_.emplace_back();
+            matches.emplace_back();
+        }
+        uint32_t index = static_cast<uint32_t>(rules_.size());
+        chains_[chain].rules.push_back(index);
+        if (rule.simulated) {
+            classified_[chain].push_back(index);
+            matches[chain].push_back(std::move(match));
+        }
+        actions_.push_back(parseAction(ast, node, rule, diagnostics));
+        rules_.push_back(std::move(rule));
+    }
+}
+
+// Host addresses of the IP section are the router's own; a subsection is named by its interface
+void FirewallSimulator::addLocalAddresses(const FlatAst& ast, NodeId section) {
+    for (NodeId child = ast.first_child(section); child != FlatAst::NONE; child = ast.next_sibling(child)) {
+        if (ast.kind(child) == NodeKind::SECTION && ast.name(child) != "firewall") {
+            addLocalAddresses(ast, child);
+        } else if (ast.name(child) == "address") {
+            for (const std::string& item : value_items(ast, ast.value(child))) {
+                uint32_t address = 0;
+                if (parse_ipv4_address(std::string_view(item).substr(0, item.find('/')), address)) {
+                    local_addresses_.insert(address);
+                    interface_addresses_.try_emplace(std::string(ast.name(section)), address);
+                }
+            }
+        }
+    }
+}
+
+bool FirewallSimulator::parseMatch(const FlatAst& ast, NodeId property, PacketClassifier::Match& match,
+                                   Diagnostics& diagnostics) {
+    std::string name(PropertySchema::routeros_name(ast.name(property)));
+    std::string invalid;
+    switch (match_parser_.parse(name, value_items(ast, ast.value(property)), match, invalid)) {
+        case MatchParser::Outcome::MATCHED:
+        case MatchParser::Outcome::NOT_A_MATCHER:
+            return true;
+        case MatchParser::Outcome::NOT_SIMULATED:
+            diagnostics.report(Diagnostics::Severity::WARNING, ast.line(property), ast.column(property),
+                               "'" + name + "' is not simulated; it matches any packet");
+            return true;
+        case MatchParser::Outcome::INVALID_VALUE:
+            diagnostics.report(Diagnostics::Severity::WARNING, ast.line(property), ast.column(property),
+                               name + " value '" + invalid + "' cannot be simulated; the rule never matches");
+            return false;
+        case MatchParser::Outcome::NO_PACKET:
+            diagnostics.report(Diagnostics::Severity::WARNING, ast.line(property), ast.column(property),
+                               name + " matches no packet; the rule never matches");
+            return false;
+    }
+    return false;
+}
+
+FirewallSimulator::Action FirewallSimulator::parseAction(const FlatAst& ast, NodeId node, const Rule& rule,
+                                                         Diagnostics& diagnostics) const {
+    Action action{ActionKind::ACCEPT};
+    const std::string& name = rule.action;
+    bool translates = false;
+    // A missing action accepts, as in RouterOS; return ends a built-in chain like its end does
+    if (name.empty() || name == "accept" || name == "return") {
+        action.kind = ActionKind::ACCEPT;
+    } else if (name == "drop" || name == "reject" || name == "tarpit") {
+        action.kind = ActionKind::DROP;
+    } else if (std::find(std::begin(PASSTHROUGH_ACTIONS), std::end(PASSTHROUGH_ACTIONS), name) !=
+               std::end(PASSTHROUGH_ACTIONS)) {
+        action.kind = ActionKind::PASSTHROUGH;
+        if (name == "jump") {
+            diagnostics.report(Diagnostics::Severity::WARNING, rule.line, rule.column,
+                               "Jump targets are not simulated; rule '" + rule.name + "' passes packets on");
+        }
+    } else if (name == "notrack") {
+        action.kind = ActionKind::NOTRACK;
+    } else if (name == "dst-nat" || (name == "netmap" && rule.chain == "dstnat")) {
+        action.kind = ActionKind::DST_NAT;
+        translates = true;
+    } else if (name == "redirect") {
+        action.kind = ActionKind::REDIRECT;
+        translates = true;
+    } else if (name == "masquerade" || name == "src-nat" || name == "same" || name == "netmap") {
+        // Without to-addresses, the source becomes the address of the out-interface
+        action.kind = ActionKind::SRC_NAT;
+        translates = true;
+    } else {
+        action.kind = ActionKind::PASSTHROUGH;
+        diagnostics.report(Diagnostics::Severity::WARNING, rule.line, rule.column,
+                           "Action '" + name + "' is not simulated; rule '" + rule.name + "' passes packets on");
+    }
+    if (!translates) {
+        return action;
+    }
+
+    // Translations go to the first address and port of their ranges
+    for (NodeId property = ast.first_child(node); property != FlatAst::NONE; property = ast.next_sibling(property)) {
+        if (ast.kind(property) != NodeKind::PROPERTY || ast.value(property) == FlatAst::NONE) {
+            continue;
+        }
+        std::string_view name = PropertySchema::routeros_name(ast.name(property));
+        std::vector<std::string> items = value_items(ast, ast.value(property));
+        Range range{0, 0};
+        if (name == "to-addresses" && !items.empty() && parse_address_range(items.front(), range)) {
+            action.has_address = true;
+            action.address = range.low;
+        } else if (name == "to-ports" && !items.empty() && parse_number_range(items.front(), 65535, range)) {
+            action.has_port = true;
+            action.port = static_cast<uint16_t>(range.low);
+        }
+    }
+    return action;
+}
+
+int FirewallSimulator::findChain(std::string_view table, std::string_view name) const noexcept {
+    for (size_t i = 0; i < chains_.size(); i++) {
+        if (chains_[i].table == table && chains_[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+const FirewallSimulator::Connection* FirewallSimulator::findConnection(const FlowKey& key) const noexcept {
+    if (connections_.empty()) {
+        return nullptr;
+    }
+    size_t mask = connections_.size() - 1;
+    for (size_t slot = flow_hash(key) & mask;; slot = (slot + 1) & mask) {
+        const Connection& connection = connections_[slot];
+        if (connection.flow == EMPTY_SLOT) {
+            return nullptr;
+        }
+        if (connection.key == key) {
+            return &connection;
+        }
+    }
+}
+
+void FirewallSimulator::addConnection(const FlowKey& key, uint32_t flow, bool reply) {
+    if ((connection_count_ + 1) * 2 > connections_.size()) {
+        std::vector<Connection> old = std::move(connections_);
+        connections_.assign(std::max(MIN_CONNECTION_SLOTS, old.size() * 2), Connection());
+        connection_count_ = 0;
+        for (const Connection& connection : old) {
+            if (connection.flow != EMPTY_SLOT) {
+                addConnection(connection.key, connection.flow, connection.reply);
+            }
+        }
+    }
+    size_t mask = connections_.size() - 1;
+    for (size_t slot = flow_hash(key) & mask;; slot = (slot + 1) & mask) {
+        Connection& connection = connections_[slot];
+        if (connection.flow == EMPTY_SLOT) {
+            connection = {key, flow, reply};
+            connection_count_++;
+            return;
+        }
+        if (connection.key == key) {
+            return;
+        }
+    }
+}
+
+void FirewallSimulator::simulate(const PacketTrace& trace, const PacketHandler& on_packet) {
+    for (Rule& rule : rules_) {
+        rule.hits = 0;
+    }
+    accepted_ = 0;
+    dropped_ = 0;
+    flows_.clear();
+    connections_.clear();
+    connection_count_ = 0;
+
+    // Interfaces of the trace that no rule names match as "any other"
+    std::vector<uint32_t> interface_ids;
+    std::vector<uint32_t> interface_addresses;
+    for (const std::string& name : trace.interfaces()) {
+        interface_ids.push_back(match_parser_.interface_id(name));
+        auto it = interface_addresses_.find(name);
+        interface_addresses.push_back(it != interface_addresses_.end() ? it->second : 0);
+    }
+
+    const std::vector<PacketTrace::Packet>& packets = trace.packets();
+    for (size_t i = 0; i < packets.size(); i++) {
+        Result result = process(packets[i], interface_ids, interface_addresses);
+        (result.accepted ? accepted_ : dropped_)++;
+        if (on_packet) {
+            on_packet(i, result);
+        }
+    }
+}
+
+const FirewallSimulator::Action* FirewallSimulator::runChain(int chain, Step step, const PacketClassifier::Key& key,
+                                                             Result& result) {
+    if (chain < 0) {
+        return nullptr;
+    }
+    result.chains[step] = chain;
+    const PacketClassifier& classifier = classifiers_[chain];
+    const std::vector<uint32_t>& classified = classified_[chain];
+    for (uint32_t from = 0;;) {
+        uint32_t index = linear_ ? classifier.classify_linear(key, from) : classifier.classify(key, from);
+        if (index == PacketClassifier::NO_MATCH) {
+            return nullptr;
+        }
+        uint32_t rule = classified[index];
+        rules_[rule].hits++;
+        const Action& action = actions_[rule];
+        if (action.kind != ActionKind::PASSTHROUGH) {
+            result.rules[step] = rule;
+            return &action;
+        }
+        from = index + 1;
+    }
+}
+
+FirewallSimulator::Result FirewallSimulator::process(const PacketTrace::Packet& packet,
+                                                     const std::vector<uint32_t>& interface_ids,
+                                                     const std::vector<uint32_t>& interface_addresses) {
+    Result result;
+    result.chains.fill(-1);
+    result.rules.fill(NO_RULE);
+    result.accepted = false;
+
+    PacketClassifier::Key key;
+    key[PacketClassifier::SRC_ADDRESS] = packet.src_address;
+    key[PacketClassifier::DST_ADDRESS] = packet.dst_address;
+    key[PacketClassifier::PROTOCOL] = packet.protocol;
+    key[PacketClassifier::SRC_PORT] = packet.src_port;
+    key[PacketClassifier::DST_PORT] = packet.dst_port;
+    key[PacketClassifier::IN_INTERFACE] = interface_ids[packet.in_interface];
+    key[PacketClassifier::OUT_INTERFACE] = interface_ids[packet.out_interface];
+    bool from_router = packet.in_interface == 0 && local_addresses_.count(packet.src_address) > 0;
+
+    // Connection state from the trace, or from the connection table
+    FlowKey wire{packet.src_address, packet.dst_address, packet.src_port, packet.dst_port, packet.protocol};
+    bool tracked = packet.state == State::TRACK;
+    State state = packet.state;
+    Flow* flow = nullptr;
+    bool reply = false;
+    if (tracked) {
+        if (const Connection* connection = findConnection(wire)) {
+            flow = &flows_[connection->flow];
+            reply = connection->reply;
+            flow->replied = flow->replied || reply;
+        }
+        state = flow && flow->replied ? State::ESTABLISHED : State::NEW;
+    }
+    key[PacketClassifier::CONNECTION_STATE] = static_cast<uint32_t>(state);
+
+    const Action* action = runChain(from_router ? raw_output_ : raw_prerouting_, RAW, key, result);
+    if (action && action->kind == ActionKind::DROP) {
+        return result;
+    }
+    if (action && action->kind == ActionKind::NOTRACK) {
+        tracked = false;
+        flow = nullptr;
+        state = State::UNTRACKED;
+        key[PacketClassifier::CONNECTION_STATE] = static_cast<uint32_t>(state);
+    }
+
+    // NAT sees the first packet of a connection; the others follow its translation
+    bool first = state == State::NEW && !flow;
+    Action translation{ActionKind::ACCEPT};
+    if (first && !from_router) {
+        action = runChain(dstnat_, DSTNAT, key, result);
+        if (action && action->kind == ActionKind::DROP) {
+            return result;
+        }
+        if (action) {
+            translation = *action;
+        }
+    } else if (flow && !reply) {
+        translation = flow->translation;
+    } else if (flow && flow->source_translated) {
+        // Replies to a source NAT go back to the original source before the filter sees them
+        key[PacketClassifier::DST_ADDRESS] = flow->src_address;
+        key[PacketClassifier::DST_PORT] = flow->src_port;
+    }
+    bool to_router = translation.kind == ActionKind::REDIRECT;
+    if ((translation.kind == ActionKind::DST_NAT || to_router) && translation.has_address) {
+        key[PacketClassifier::DST_ADDRESS] = translation.address;
+    }
+    if ((translation.kind == ActionKind::DST_NAT || to_router) && translation.has_port) {
+        key[PacketClassifier::DST_PORT] = translation.port;
+    }
+
+    bool input = !from_router && (to_router || local_addresses_.count(key[PacketClassifier::DST_ADDRESS]) > 0);
+    action = runChain(from_router ? output_ : input ? input_ : forward_, FILTER, key, result);
+    if (action && action->kind == ActionKind::DROP) {
+        return result;
+    }
+    uint32_t src_address = packet.src_address;
+    uint16_t src_port = packet.src_port;
+    if (first && !input) {
+        action = runChain(srcnat_, SRCNAT, key, result);
+        if (action && action->kind == ActionKind::DROP) {
+            return result;
+        }
+        if (action && action->kind == ActionKind::SRC_NAT) {
+            uint32_t address = action->has_address ? action->address : interface_addresses[packet.out_interface];
+            src_address = address != 0 ? address : src_address;
+            src_port = action->has_port ? action->port : src_port;
+        }
+    }
+    result.accepted = true;
+
+    // Accepted first packets open a connection; replies come back to the translated
+    // destination, from the translated source. Ports are not reassigned, so two
+    // flows translated to the same address and port share their replies.
+    if (tracked && !flow) {
+        uint32_t index = static_cast<uint32_t>(flows_.size());
+        bool source_translated = src_address != packet.src_address || src_port != packet.src_port;
+        flows_.push_back({false, to_router, translation, source_translated, packet.src_address, packet.src_port});
+        addConnection(wire, index, false);
+        FlowKey back{key[PacketClassifier::DST_ADDRESS], src_address,
+                     static_cast<uint16_t>(key[PacketClassifier::DST_PORT]), src_port, packet.protocol};
+        addConnection(back, index, true);
+    }
+    return result;
+}
+
+bool FirewallSimulator::is_terminating(std::string_view action) noexcept {
+    return std::find(std::begin(PASSTHROUGH_ACTIONS), std::end(PASSTHROUGH_ACTIONS), action) ==
+           std::end(PASSTHROUGH_ACTIONS);
+}
+
+void FirewallSimulator::print_hits(FILE* out) const {
+    size_t packets = accepted_ + dropped_;
+    fprintf(out, "%12s %8s  %-6s %-12s %s\n", "hits", "share", "table", "chain", "rule");
+    for (const Chain& chain : chains_) {
+        for (uint32_t index : chain.rules) {
+            const Rule& rule = rules_[index];
+            double share = packets > 0 ? 100.0 * static_cast<double>(rule.hits) / static_cast<double>(packets) : 0.0;
+            const char* note = !rule.simulated ? "  (not simulated)" : rule.hits == 0 ? "  (never matched)" : "";
+            fprintf(out, "%12llu %7.2f%%  %-6s %-12s %s%s\n", static_cast<unsigned long long>(rule.hits), share,
+                    chain.table.c_str(), chain.name.c_str(), rule.name.c_str(), note);
+        }
+    }
+    fprintf(out, "%zu packet(s): %zu accepted, %zu dropped\n", packets, accepted_, dropped_);
+}
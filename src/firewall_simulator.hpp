@@ -0,0 +1,307 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "diagnostics.hpp"
+#include "flat_ast.hpp"
+#include "packet_trace.hpp"
+
+/**
+ * @class PacketClassifier
+ * @brief First matching rule of an ordered list, found with bit vectors
+ *
+ * Every rule matches a set of value ranges in each header field. The ranges
+ * of all rules cut each field into elementary intervals, and each interval
+ * keeps a bit vector of the rules that match it. Classifying a packet is one
+ * binary search per field and an AND of the vectors, word by word, until the
+ * first set bit: the first matching rule. Fields no rule constrains are left
+ * out, so a chain matching on two fields costs two lookups whatever its size.
+ *
+ * A chain whose vectors would exceed MAX_TABLE_BYTES is left uncompiled and
+ * tests its rules one by one instead.
+ */
+class PacketClassifier {
+public:
+    enum Field : uint8_t {
+        SRC_ADDRESS,
+        DST_ADDRESS,
+        PROTOCOL,
+        SRC_PORT,
+        DST_PORT,
+        IN_INTERFACE,
+        OUT_INTERFACE,
+        CONNECTION_STATE,
+        FIELD_COUNT
+    };
+
+    // Inclusive range of field values
+    struct Range {
+        uint32_t low;
+        uint32_t high;
+    };
+
+    // Ranges a rule matches in each field; an empty list matches any value
+    using Match = std::array<std::vector<Range>, FIELD_COUNT>;
+    using Key = std::array<uint32_t, FIELD_COUNT>;
+
+    static constexpr uint32_t NO_MATCH = 0xFFFFFFFF;
+    static constexpr size_t MAX_TABLE_BYTES = 256 * 1024 * 1024;
+
+    explicit PacketClassifier(std::vector<Match> rules);
+
+    /**
+     * @brief Find the first rule at or after a position that matches a packet
+     * @param key Field values of the packet
+     * @param from Index of the first rule to consider
+     * @return Index of the rule, or NO_MATCH
+     */
+    uint32_t classify(const Key& key, uint32_t from = 0) const noexcept;
+
+    // Same as classify(), testing every rule in turn
+    uint32_t classify_linear(const Key& key, uint32_t from = 0) const noexcept;
+
+    bool is_compiled() const noexcept { return compiled_; }
+    size_t size() const noexcept { return rules_.size(); }
+
+private:
+    struct FieldTable {
+        std::vector<uint32_t> starts;  // First value of each elementary interval
+        std::vector<uint64_t> rows;    // One bit vector of words_ words per interval
+    };
+
+    static bool matches(const Match& rule, const Key& key) noexcept;
+
+    std::vector<Match> rules_;
+    size_t words_;
+    std::vector<uint8_t> fields_;      // Fields some rule constrains
+    FieldTable tables_[FIELD_COUNT];
+    bool compiled_ = false;
+};
+
+/**
+ * @class MatchParser
+ * @brief Ranges of header values that the properties of firewall rules match
+ *
+ * Interfaces are numbered from 1 as the parser meets them, 0 standing for
+ * every other interface, so the matches built by one parser can be compared
+ * with each other and with packets.
+ */
+class MatchParser {
+public:
+    enum class Outcome : uint8_t {
+        MATCHED,        // The ranges of the property were added to the match
+        NOT_A_MATCHER,  // The property names the chain, the action or its parameters
+        NOT_SIMULATED,  // The property matches on something else; the match is left unchanged
+        INVALID_VALUE,  // An item of the value cannot be parsed
+        NO_PACKET       // The value leaves no packet to match
+    };
+
+    /**
+     * @brief Add the ranges of one rule property to a match
+     * @param name RouterOS name of the property
+     * @param items Items of its value; a '!' before the first negates them all
+     * @param match Match of the rule
+     * @param invalid Set to the item that could not be parsed for INVALID_VALUE
+     */
+    Outcome parse(std::string_view name, std::vector<std::string> items, PacketClassifier::Match& match,
+                  std::string& invalid);
+
+    // Id of an interface the rules named, or 0
+    uint32_t interface_id(std::string_view name) const noexcept;
+
+    // Trimmed comma separated items of a value
+    static std::vector<std::string> split_items(std::string_view text);
+
+private:
+    uint32_t addInterface(std::string_view name);
+
+    std::unordered_map<std::string, uint32_t> interface_ids_;
+};
+
+/**
+ * @class FirewallSimulator
+ * @brief Run packets through the filter, NAT and raw rules of a program
+ *
+ * Packets follow a simplified RouterOS packet flow: raw prerouting, NAT
+ * dstnat, then filter input when they are addressed to the router (an
+ * address of the IP section, or a redirect) or forward otherwise, then NAT
+ * srcnat. Packets from a router address without an in-interface take raw
+ * output, filter output and srcnat instead. Each chain stops at its first
+ * terminating rule; log, passthrough and the address-list actions count a
+ * hit and go on, and a chain without a verdict accepts.
+ *
+ * Connections are tracked as RouterOS does: a packet is new until its
+ * connection has seen a reply, established after, and untracked after a
+ * raw notrack rule. Only the first packet of a connection goes through
+ * NAT, and the later ones of the same direction are translated like it.
+ * Trace rows that give a connection state are taken as they are.
+ *
+ * Each chain is compiled into a PacketClassifier, so the cost per packet
+ * grows with the number of header fields the rules test rather than with
+ * the number of rules.
+ */
+class FirewallSimulator {
+public:
+    // Chains a packet goes through, in order
+    enum Step : uint8_t {
+        RAW,
+        DSTNAT,
+        FILTER,
+        SRCNAT,
+        STEP_COUNT
+    };
+
+    static constexpr uint32_t NO_RULE = PacketClassifier::NO_MATCH;
+
+    struct Rule {
+        std::string table;     // filter, nat or raw
+        std::string chain;
+        std::string name;
+        std::string action;
+        int line;
+        int column;
+        uint64_t hits = 0;     // Packets the rule matched, terminating or not
+        bool simulated = true; // False if a matcher could not be evaluated; the rule never matches
+    };
+
+    struct Chain {
+        std::string table;
+        std::string name;
+        std::vector<uint32_t> rules;   // Indexes into rules(), in order
+    };
+
+    struct Result {
+        std::array<int, STEP_COUNT> chains;          // Index into chains(), or -1 if the step was skipped
+        std::array<uint32_t, STEP_COUNT> rules;      // Rule that decided the step, or NO_RULE
+        bool accepted;
+    };
+
+    using PacketHandler = std::function<void(size_t index, const Result& result)>;
+
+    /**
+     * @param ast The program; rules the simulator cannot evaluate are reported
+     * @param diagnostics Sink for warnings about such rules, at the offending property
+     */
+    FirewallSimulator(const FlatAst& ast, Diagnostics& diagnostics);
+
+    // Test rules one by one instead of through the classifiers, to compare the two
+    void set_linear(bool linear) noexcept { linear_ = linear; }
+
+    /**
+     * @brief Run a trace from an empty connection table, replacing earlier hit counts
+     * @param trace The packets and the names of their interfaces
+     * @param on_packet Called with the result of each packet, if set
+     */
+    void simulate(const PacketTrace& trace, const PacketHandler& on_packet = {});
+
+    /**
+     * @brief Print the hit count of every rule, chain by chain, and the verdict totals
+     */
+    void print_hits(FILE* out) const;
+
+    // Whether an action ends its chain, as opposed to counting a hit and going on
+    static bool is_terminating(std::string_view action) noexcept;
+
+    const std::vector<Rule>& rules() const noexcept { return rules_; }
+    const std::vector<Chain>& chains() const noexcept { return chains_; }
+    size_t accepted() const noexcept { return accepted_; }
+    size_t dropped() const noexcept { return dropped_; }
+
+private:
+    enum class ActionKind : uint8_t {
+        ACCEPT,
+        DROP,
+        PASSTHROUGH,
+        NOTRACK,
+        DST_NAT,
+        REDIRECT,
+        SRC_NAT
+    };
+
+    struct Action {
+        ActionKind kind;
+        bool has_address = false;
+        bool has_port = false;
+        uint32_t address = 0;
+        uint16_t port = 0;
+    };
+
+    // Connection as seen on the wire in one direction
+    struct FlowKey {
+        uint32_t src_address;
+        uint32_t dst_address;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint8_t protocol;
+
+        bool operator==(const FlowKey& other) const noexcept;
+    };
+
+    struct Flow {
+        bool replied = false;
+        bool to_router = false;
+        Action translation{ActionKind::ACCEPT};   // Destination NAT of the first packet
+        bool source_translated = false;           // Replies then go back to the source below
+        uint32_t src_address = 0;                 // Source of the first packet, before source NAT
+        uint16_t src_port = 0;
+    };
+
+    // Slot of the connection table: a direction of a flow
+    struct Connection {
+        FlowKey key;
+        uint32_t flow = EMPTY_SLOT;
+        bool reply = false;
+    };
+
+    static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+    static constexpr size_t MIN_CONNECTION_SLOTS = 1024;
+
+    void addRules(const FlatAst& ast, FlatAst::NodeId table, bool named_by_chain,
+                  std::vector<std::vector<PacketClassifier::Match>>& matches, Diagnostics& diagnostics);
+    void addLocalAddresses(const FlatAst& ast, FlatAst::NodeId section);
+    bool parseMatch(const FlatAst& ast, FlatAst::NodeId property, PacketClassifier::Match& match,
+                    Diagnostics& diagnostics);
+    Action parseAction(const FlatAst& ast, FlatAst::NodeId node, const Rule& rule, Diagnostics& diagnostics) const;
+    int findChain(std::string_view table, std::string_view name) const noexcept;
+
+    // The connection table is open-addressed with linear probing and kept at
+    // most half full, so tracking millions of flows costs no allocation per flow
+    const Connection* findConnection(const FlowKey& key) const noexcept;
+    void addConnection(const FlowKey& key, uint32_t flow, bool reply);
+
+    // Run one chain; returns the terminating action, or nullptr if the chain ended
+    const Action* runChain(int chain, Step step, const PacketClassifier::Key& key, Result& result);
+    Result process(const PacketTrace::Packet& packet, const std::vector<uint32_t>& interface_ids,
+                   const std::vector<uint32_t>& interface_addresses);
+
+    std::vector<Rule> rules_;
+    std::vector<Action> actions_;
+    std::vector<Chain> chains_;
+    std::vector<PacketClassifier> classifiers_;   // One per chain
+    std::vector<std::vector<uint32_t>> classified_;   // Rule of each classifier entry, per chain
+    MatchParser match_parser_;
+    std::unordered_set<uint32_t> local_addresses_;
+    std::unordered_map<std::string, uint32_t> interface_addresses_;   // First address of each interface, for masquerade
+    int raw_prerouting_ = -1;
+    int raw_output_ = -1;
+    int dstnat_ = -1;
+    int srcnat_ = -1;
+    int input_ = -1;
+    int forward_ = -1;
+    int output_ = -1;
+    bool linear_ = false;
+
+    std::vector<Flow> flows_;
+    std::vector<Connection> connections_;
+    size_t connection_count_ = 0;
+    size_t accepted_ = 0;
+    size_t dropped_ = 0;
+};
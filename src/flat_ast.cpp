@@ -0,0 +1,245 @@
+#include "flat_ast.hpp"
+#include "ast_image.hpp"
+
+FlatAst FlatAst::build(const ProgramDeclaration* program)
+{
+    FlatAst ast;
+    if (program) {
+        for (const SectionStatement* section : program->get_sections()) {
+            if (section) {
+                ast.add_section(section);
+            }
+        }
+    }
+    return ast;
+}
+
+FlatAst FlatAst::from_image(const AstImage& image)
+{
+    // Images store the same columns in the same pre-order; only the string ids are renumbered
+    FlatAst ast;
+    size_t nodes = image.node_count();
+    ast.kinds_.reserve(nodes);
+    for (NodeId node = 0; node < nodes; node++) {
+        ast.kinds_.push_back(static_cast<uint8_t>(image.node_kind(node)));
+        ast.section_types_.push_back(static_cast<uint8_t>(image.section_type(node)));
+        ast.names_.push_back(ast.intern(image.node_name(node)));
+        ast.lines_.push_back(static_cast<uint32_t>(image.node_line(node)));
+        ast.columns_.push_back(static_cast<uint32_t>(image.node_column(node)));
+        ast.origins_.push_back(image.node_origin(node));
+        ast.first_children_.push_back(image.first_child(node));
+        ast.next_siblings_.push_back(image.next_sibling(node));
+        ast.values_.push_back(image.node_value(node));
+    }
+
+    for (ValueId value = 0; value < image.value_count(); value++) {
+        ValueKind kind = static_cast<ValueKind>(image.value_kind(value));
+        uint32_t data = 0;
+        uint32_t size = 0;
+        switch (kind) {
+            case ValueKind::STRING:
+            case ValueKind::QUOTED_STRING:
+            case ValueKind::IP_ADDRESS:
+            case ValueKind::IP_CIDR:
+                data = ast.intern(image.value_string(value));
+                break;
+            case ValueKind::NUMBER:
+                data = static_cast<uint32_t>(image.value_number(value));
+                break;
+            case ValueKind::BOOLEAN:
+                data = image.value_bool(value) ? 1 : 0;
+                break;
+            case ValueKind::LIST:
+                data = static_cast<uint32_t>(ast.list_items_.size());
+                size = image.list_size(value);
+                for (uint32_t i = 0; i < size; i++) {
+                    ast.list_items_.push_back(image.list_item(value, i));
+                }
+                break;
+        }
+        ast.value_kinds_.push_back(static_cast<uint8_t>(kind));
+        ast.value_data_.push_back(data);
+        ast.value_sizes_.push_back(size);
+    }
+
+    ast.root_ = image.root();
+    for (NodeId node = ast.root_; node != NONE; node = ast.next_siblings_[node]) {
+        ast.last_root_ = node;
+    }
+    return ast;
+}
+
+FlatAst::NodeId FlatAst::add_section(const SectionStatement* section)
+{
+    NodeId node = addSectionTree(section);
+    if (last_root_ == NONE) {
+        root_ = node;
+    } else {
+        next_siblings_[last_root_] = node;
+    }
+    last_root_ = node;
+    return node;
+}
+
+FlatAst::Symbol FlatAst::intern(std::string_view text)
+{
+    auto [it, inserted] = symbol_ids_.emplace(std::string(text), static_cast<Symbol>(symbol_count()));
+    if (inserted) {
+        symbol_bytes_.append(text);
+        symbol_offsets_.push_back(static_cast<uint32_t>(symbol_bytes_.size()));
+    }
+    return it->second;
+}
+
+FlatAst::Symbol FlatAst::find_symbol(std::string_view text) const
+{
+    auto it = symbol_ids_.find(std::string(text));
+    return it != symbol_ids_.end() ? it->second : NONE;
+}
+
+std::string_view FlatAst::symbol_name(Symbol symbol) const noexcept
+{
+    return std::string_view(symbol_bytes_).substr(symbol_offsets_[symbol],
+                                                  symbol_offsets_[symbol + 1] - symbol_offsets_[symbol]);
+}
+
+FlatAst::NodeId FlatAst::addNode(NodeKind kind, const Statement* statement, std::string_view name)
+{
+    NodeId node = static_cast<NodeId>(kinds_.size());
+    kinds_.push_back(static_cast<uint8_t>(kind));
+    section_types_.push_back(0);
+    names_.push_back(intern(name));
+    lines_.push_back(static_cast<uint32_t>(statement->get_line()));
+    columns_.push_back(static_cast<uint32_t>(statement->get_column()));
+    origins_.push_back(statement->get_origin());
+    first_children_.push_back(NONE);
+    next_siblings_.push_back(NONE);
+    values_.push_back(NONE);
+    return node;
+}
+
+FlatAst::NodeId FlatAst::addSectionTree(const SectionStatement* section)
+{
+    NodeId node = addNode(NodeKind::SECTION, section, section->get_name());
+    section_types_[node] = static_cast<uint8_t>(section->get_section_type());
+    if (!section->get_block()) {
+        return node;
+    }
+
+    // Children are numbered after their parent, in source order
+    NodeId previous = NONE;
+    for (const Statement* stmt : section->get_block()->get_statements()) {
+        NodeId child = NONE;
+        if (const auto* subsection = dynamic_cast<const SectionStatement*>(stmt)) {
+            child = addSectionTree(subsection);
+        } else if (const auto* prop = dynamic_cast<const PropertyStatement*>(stmt)) {
+            child = addNode(NodeKind::PROPERTY, prop, prop->get_name());
+            if (prop->get_value()) {
+                ValueId value = addValue(prop->get_value());
+                values_[child] = value;
+            }
+        }
+        if (child == NONE) {
+            continue;
+        }
+        if (previous == NONE) {
+            first_children_[node] = child;
+        } else {
+            next_siblings_[previous] = child;
+        }
+        previous = child;
+    }
+    return node;
+}
+
+FlatAst::ValueId FlatAst::addValue(const Expression* expr)
+{
+    ValueId value = static_cast<ValueId>(value_kinds_.size());
+    ValueKind kind = ValueKind::STRING;
+    uint32_t data = 0;
+    if (const auto* list = dynamic_cast<const ListValue*>(expr)) {
+        // Reserve the list's slot first so its items always follow it
+        value_kinds_.push_back(static_cast<uint8_t>(ValueKind::LIST));
+        value_data_.push_back(0);
+        value_sizes_.push_back(0);
+
+        std::vector<ValueId> items;
+        for (const Value* item : list->get_values()) {
+            items.push_back(addValue(item));
+        }
+        value_data_[value] = static_cast<uint32_t>(list_items_.size());
+        value_sizes_[value] = static_cast<uint32_t>(items.size());
+        list_items_.insert(list_items_.end(), items.begin(), items.end());
+        return value;
+    }
+
+    if (const auto* str_val = dynamic_cast<const StringValue*>(expr)) {
+        kind = str_val->is_quoted() ? ValueKind::QUOTED_STRING : ValueKind::STRING;
+        data = intern(str_val->get_view());
+    } else if (const auto* num_val = dynamic_cast<const NumberValue*>(expr)) {
+        kind = ValueKind::NUMBER;
+        data = static_cast<uint32_t>(num_val->get_value());
+    } else if (const auto* bool_val = dynamic_cast<const BooleanValue*>(expr)) {
+        kind = ValueKind::BOOLEAN;
+        data = bool_val->get_value() ? 1 : 0;
+    } else if (const auto* ip_val = dynamic_cast<const IPAddressValue*>(expr)) {
+        kind = ValueKind::IP_ADDRESS;
+        data = intern(ip_val->get_value());
+    } else if (const auto* cidr_val = dynamic_cast<const IPCIDRValue*>(expr)) {
+        kind = ValueKind::IP_CIDR;
+        data = intern(cidr_val->get_value());
+    } else {
+        // The parser builds no other expressions; keep their text so passes still see it
+        data = intern(expression_text(expr));
+    }
+
+    value_kinds_.push_back(static_cast<uint8_t>(kind));
+    value_data_.push_back(data);
+    value_sizes_.push_back(0);
+    return value;
+}
+
+std::string FlatAst::itemText(ValueId value) const
+{
+    // List items are written the way Value::to_mikrotik writes them
+    switch (value_kind(value)) {
+        case ValueKind::IP_ADDRESS:
+        case ValueKind::IP_CIDR:
+        case ValueKind::QUOTED_STRING:
+            return "\"" + std::string(symbol_name(value_data_[value])) + "\"";
+        case ValueKind::STRING:
+            return std::string(symbol_name(value_data_[value]));
+        default:
+            return value_text(value);
+    }
+}
+
+std::string FlatAst::value_text(ValueId value) const
+{
+    if (value == NONE) {
+        return "";
+    }
+
+    switch (value_kind(value)) {
+        case ValueKind::STRING:
+        case ValueKind::QUOTED_STRING:
+        case ValueKind::IP_ADDRESS:
+        case ValueKind::IP_CIDR:
+            return std::string(symbol_name(value_data_[value]));
+        case ValueKind::NUMBER:
+            return std::to_string(static_cast<int>(value_data_[value]));
+        case ValueKind::BOOLEAN:
+            return value_data_[value] ? "true" : "false";
+        case ValueKind::LIST: {
+            std::string text = "{";
+            for (uint32_t i = 0; i < list_size(value); i++) {
+                if (i > 0) {
+                    text += ",";
+                }
+                text += itemText(list_item(value, i));
+            }
+            return text + "}";
+        }
+    }
+    return "";
+}
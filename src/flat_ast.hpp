@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "declaration.hpp"
+#include "statement.hpp"
+
+class AstImage;
+
+// Data-oriented copy of a program's AST. Nodes (sections and properties)
+// are indices into parallel columns instead of heap objects, so a pass that
+// only looks at kinds and names streams through two small arrays rather
+// than chasing Statement pointers and std::string buffers. Children are
+// linked first-child/next-sibling in source order; property values live in
+// their own typed columns and every name and string is interned once.
+class FlatAst
+{
+public:
+    using NodeId = uint32_t;
+    using ValueId = uint32_t;
+    using Symbol = uint32_t;
+
+    // "No node", "no value" and "no symbol"
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    enum class NodeKind : uint8_t {
+        SECTION,
+        PROPERTY
+    };
+
+    enum class ValueKind : uint8_t {
+        STRING,
+        NUMBER,
+        BOOLEAN,
+        IP_ADDRESS,
+        IP_CIDR,
+        LIST,
+        QUOTED_STRING   // String written in quotes; the quotes are not stored
+    };
+
+    static FlatAst build(const ProgramDeclaration* program);
+    static FlatAst from_image(const AstImage& image);
+
+    // Append a top-level section and everything below it; returns its node
+    NodeId add_section(const SectionStatement* section);
+
+    // First top-level section; the others follow as its siblings
+    NodeId root() const noexcept { return root_; }
+    size_t node_count() const noexcept { return kinds_.size(); }
+    size_t value_count() const noexcept { return value_kinds_.size(); }
+
+    NodeKind kind(NodeId node) const noexcept { return static_cast<NodeKind>(kinds_[node]); }
+    SectionStatement::SectionType section_type(NodeId node) const noexcept
+    {
+        return static_cast<SectionStatement::SectionType>(section_types_[node]);
+    }
+    Symbol name_symbol(NodeId node) const noexcept { return names_[node]; }
+    std::string_view name(NodeId node) const noexcept { return symbol_name(names_[node]); }
+    int line(NodeId node) const noexcept { return static_cast<int>(lines_[node]); }
+    int column(NodeId node) const noexcept { return static_cast<int>(columns_[node]); }
+    uint32_t origin(NodeId node) const noexcept { return origins_[node]; }
+    NodeId first_child(NodeId node) const noexcept { return first_children_[node]; }
+    NodeId next_sibling(NodeId node) const noexcept { return next_siblings_[node]; }
+    ValueId value(NodeId node) const noexcept { return values_[node]; }
+
+    ValueKind value_kind(ValueId value) const noexcept { return static_cast<ValueKind>(value_kinds_[value]); }
+    uint32_t value_data(ValueId value) const noexcept { return value_data_[value]; }
+    uint32_t list_size(ValueId value) const noexcept { return value_sizes_[value]; }
+    ValueId list_item(ValueId value, uint32_t index) const noexcept { return list_items_[value_data_[value] + index]; }
+
+    // Same text expression_text() gives for the value's expression
+    std::string value_text(ValueId value) const;
+
+    std::string_view symbol_name(Symbol symbol) const noexcept;
+    size_t symbol_count() const noexcept { return symbol_offsets_.size() - 1; }
+
+    // Symbol of an interned name, or NONE if no node or value uses it
+    Symbol find_symbol(std::string_view text) const;
+
+private:
+    friend class AstImageWriter;
+
+    Symbol intern(std::string_view text);
+    NodeId addNode(NodeKind kind, const Statement* statement, std::string_view name);
+    NodeId addSectionTree(const SectionStatement* section);
+    ValueId addValue(const Expression* expr);
+    std::string itemText(ValueId value) const;
+
+    std::vector<uint8_t> kinds_;
+    std::vector<uint8_t> section_types_;
+    std::vector<Symbol> names_;
+    std::vector<uint32_t> lines_;
+    std::vector<uint32_t> columns_;
+    std::vector<uint32_t> origins_;
+    std::vector<NodeId> first_children_;
+    std::vector<NodeId> next_siblings_;
+    std::vector<ValueId> values_;
+
+    std::vector<uint8_t> value_kinds_;
+    std::vector<uint32_t> value_data_;   // Symbol, number, boolean or first list item
+    std::vector<uint32_t> value_sizes_;  // Number of list items (lists only)
+    std::vector<ValueId> list_items_;
+
+    std::vector<uint32_t> symbol_offsets_{0};
+    std::string symbol_bytes_;
+    std::unordered_map<std::string, Symbol> symbol_ids_;
+
+    NodeId root_ = NONE;
+    NodeId last_root_ = NONE;
+};
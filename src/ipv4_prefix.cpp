@@ -0,0 +1,102 @@
+#include "ipv4_prefix.hpp"
+
+bool parse_ipv4_address(std::string_view text, uint32_t& result) noexcept
+{
+    uint32_t address = 0;
+    int octets = 0;
+    size_t pos = 0;
+
+    while (octets < 4) {
+        if (pos >= text.size() || text[pos] < '0' || text[pos] > '9') {
+            return false;
+        }
+
+        // Read up to three digits, rejecting leading zeros like "01"
+        uint32_t octet = 0;
+        size_t start = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' && pos - start < 3) {
+            octet = octet * 10 + (text[pos] - '0');
+            pos++;
+        }
+        if (octet > 255 || (pos - start > 1 && text[start] == '0')) {
+            return false;
+        }
+
+        address = (address << 8) | octet;
+        octets++;
+
+        if (octets < 4) {
+            if (pos >= text.size() || text[pos] != '.') {
+                return false;
+            }
+            pos++;
+        }
+    }
+
+    if (pos != text.size()) {
+        return false;
+    }
+
+    result = address;
+    return true;
+}
+
+std::string format_ipv4_address(uint32_t address)
+{
+    return std::to_string((address >> 24) & 0xFF) + "." +
+           std::to_string((address >> 16) & 0xFF) + "." +
+           std::to_string((address >> 8) & 0xFF) + "." +
+           std::to_string(address & 0xFF);
+}
+
+uint32_t IPv4Prefix::mask_for(uint8_t length) noexcept
+{
+    return length == 0 ? 0 : (0xFFFFFFFFu << (32 - length));
+}
+
+bool IPv4Prefix::parse(std::string_view text, IPv4Prefix& result) noexcept
+{
+    size_t slash = text.find('/');
+    uint32_t address = 0;
+    int length = 32;
+
+    if (!parse_ipv4_address(text.substr(0, slash), address)) {
+        return false;
+    }
+
+    if (slash != std::string_view::npos) {
+        std::string_view len_text = text.substr(slash + 1);
+        if (len_text.empty() || len_text.size() > 2) {
+            return false;
+        }
+        length = 0;
+        for (char c : len_text) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            length = length * 10 + (c - '0');
+        }
+        if (length > 32) {
+            return false;
+        }
+    }
+
+    result.length = static_cast<uint8_t>(length);
+    result.address = address & mask_for(result.length);
+    return true;
+}
+
+bool IPv4Prefix::contains(uint32_t host) const noexcept
+{
+    return (host & mask_for(length)) == address;
+}
+
+bool IPv4Prefix::operator==(const IPv4Prefix& other) const noexcept
+{
+    return address == other.address && length == other.length;
+}
+
+std::string IPv4Prefix::to_string() const
+{
+    return format_ipv4_address(address) + "/" + std::to_string(length);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Typed IPv4 network prefix (address + prefix length)
+struct IPv4Prefix
+{
+    uint32_t address = 0; // Host byte order, host bits cleared
+    uint8_t length = 0;   // Prefix length (0-32)
+
+    // Parse "a.b.c.d" (as /32) or "a.b.c.d/len"; host bits are cleared
+    static bool parse(std::string_view text, IPv4Prefix& result) noexcept;
+
+    // Netmask for a prefix length (0 for /0)
+    static uint32_t mask_for(uint8_t length) noexcept;
+
+    bool contains(uint32_t host) const noexcept;
+    bool operator==(const IPv4Prefix& other) const noexcept;
+
+    std::string to_string() const;
+};
+
+// Parse a dotted-quad IPv4 address into host byte order
+bool parse_ipv4_address(std::string_view text, uint32_t& result) noexcept;
+
+// Format an IPv4 address (host byte order) as dotted-quad
+std::string format_ipv4_address(uint32_t address);
@@ -0,0 +1,120 @@
+#include "ipv6_address.hpp"
+
+namespace {
+
+bool is_hex_digit(char c) noexcept
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Number of colon-separated groups in text, or -1 if a group is empty or
+// not 1-4 hex digits. An empty text has no groups.
+int count_groups(std::string_view text) noexcept
+{
+    if (text.empty()) {
+        return 0;
+    }
+
+    int groups = 0;
+    size_t digits = 0;
+    for (char c : text) {
+        if (c == ':') {
+            if (digits == 0) {
+                return -1;
+            }
+            groups++;
+            digits = 0;
+        } else if (is_hex_digit(c) && digits < 4) {
+            digits++;
+        } else {
+            return -1;
+        }
+    }
+    return digits == 0 ? -1 : groups + 1;
+}
+
+// Length of the run of hex digits and colons at the start of text
+size_t address_run(std::string_view text) noexcept
+{
+    size_t length = 0;
+    while (length < text.size() && (is_hex_digit(text[length]) || text[length] == ':')) {
+        length++;
+    }
+    return length;
+}
+
+// Length of the longest prefix of text that is an IPv6 address, 0 if none
+size_t longest_address(std::string_view text) noexcept
+{
+    for (size_t length = address_run(text); length > 0; length--) {
+        if (is_ipv6_address(text.substr(0, length))) {
+            return length;
+        }
+    }
+    return 0;
+}
+
+// Length of the longest prefix of text that is a prefix length 0-128
+// without leading zeros, 0 if none
+size_t longest_prefix_length(std::string_view text) noexcept
+{
+    size_t digits = 0;
+    while (digits < text.size() && digits < 3 && text[digits] >= '0' && text[digits] <= '9') {
+        digits++;
+    }
+    for (; digits > 0; digits--) {
+        if (digits > 1 && text[0] == '0') {
+            continue;
+        }
+        int value = 0;
+        for (size_t i = 0; i < digits; i++) {
+            value = value * 10 + (text[i] - '0');
+        }
+        if (value <= 128) {
+            return digits;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+bool is_ipv6_address(std::string_view text) noexcept
+{
+    size_t gap = text.find("::");
+    if (gap == std::string_view::npos) {
+        return count_groups(text) == 8;
+    }
+    if (text.find("::", gap + 1) != std::string_view::npos) {
+        return false;
+    }
+
+    int head = count_groups(text.substr(0, gap));
+    int tail = count_groups(text.substr(gap + 2));
+    return head >= 0 && tail >= 0 && head + tail <= 7;
+}
+
+IPv6Match match_ipv6(std::string_view text) noexcept
+{
+    size_t address = longest_address(text);
+    if (address == 0) {
+        return {};
+    }
+
+    // A suffix only extends the literal if the address ran right up to it
+    if (address == address_run(text) && address + 1 < text.size()) {
+        std::string_view rest = text.substr(address + 1);
+        if (text[address] == '/') {
+            size_t prefix = longest_prefix_length(rest);
+            if (prefix > 0) {
+                return {IPv6Form::CIDR, address + 1 + prefix};
+            }
+        } else if (text[address] == '-') {
+            size_t last = longest_address(rest);
+            if (last > 0) {
+                return {IPv6Form::RANGE, address + 1 + last};
+            }
+        }
+    }
+    return {IPv6Form::ADDRESS, address};
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Shapes of IPv6 literal the scanner recognizes
+enum class IPv6Form
+{
+    NONE,
+    ADDRESS, // "2001:db8::1"
+    CIDR,    // "2001:db8::/32"
+    RANGE    // "2001:db8::1-2001:db8::ff"
+};
+
+struct IPv6Match
+{
+    IPv6Form form = IPv6Form::NONE;
+    size_t length = 0; // Characters of the input taken by the literal
+};
+
+// Check a complete IPv6 address: eight groups of 1-4 hex digits, or fewer
+// groups with a single "::" standing for the missing ones
+bool is_ipv6_address(std::string_view text) noexcept;
+
+// Find the longest IPv6 address, CIDR or range at the start of text, the
+// way a longest-match scanner rule would. Replaces the IPv6 regexes of the
+// scanner, which dominated the size of its DFA.
+IPv6Match match_ipv6(std::string_view text) noexcept;
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "perfect_hash.hpp"
+#include "declaration.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "parser.tab.h"
+
+// Reserved words of the DSL. The scanner matches every word with a single
+// rule and classifies it here, instead of carrying one DFA path per keyword.
+
+struct Keyword
+{
+    std::string_view name;
+    int token;
+};
+
+inline constexpr Keyword KEYWORD_ENTRIES[] = {
+    {"device", TOKEN_DEVICE},
+    {"vendor", TOKEN_VENDOR},
+    {"model", TOKEN_MODEL},
+    {"hostname", TOKEN_HOSTNAME},
+    {"interfaces", TOKEN_INTERFACES},
+    {"ip", TOKEN_IP},
+    {"routing", TOKEN_ROUTING},
+    {"firewall", TOKEN_FIREWALL},
+    {"system", TOKEN_SYSTEM},
+    {"type", TOKEN_TYPE},
+    {"admin_state", TOKEN_ADMIN_STATE},
+    {"description", TOKEN_DESCRIPTION},
+    {"ethernet", TOKEN_ETHERNET},
+    {"speed", TOKEN_SPEED},
+    {"duplex", TOKEN_DUPLEX},
+    {"vlan", TOKEN_VLAN},
+    {"vlan_id", TOKEN_VLAN_ID},
+    {"interface", TOKEN_INTERFACE},
+    {"address", TOKEN_ADDRESS},
+    {"dhcp", TOKEN_DHCP},
+    {"dhcp_client", TOKEN_DHCP_CLIENT},
+    {"dhcp_server", TOKEN_DHCP_SERVER},
+    {"static_route_default_gw", TOKEN_STATIC_ROUTE_DEFAULT_GW},
+    {"destination", TOKEN_DESTINATION},
+    {"gateway", TOKEN_GATEWAY},
+    {"chain", TOKEN_CHAIN},
+    {"connection_state", TOKEN_CONNECTION_STATE},
+    {"action", TOKEN_ACTION},
+    {"input", TOKEN_INPUT},
+    {"output", TOKEN_OUTPUT},
+    {"forward", TOKEN_FORWARD},
+    {"srcnat", TOKEN_SRCNAT},
+    {"masquerade", TOKEN_MASQUERADE},
+    {"enabled", TOKEN_ENABLED},
+    {"disabled", TOKEN_DISABLED},
+    {"accept", TOKEN_ACCEPT},
+    {"drop", TOKEN_DROP},
+    {"reject", TOKEN_REJECT},
+    {"out_interface", TOKEN_OUT_INTERFACE},
+    {"out-interface", TOKEN_OUT_INTERFACE},
+    {"in_interface", TOKEN_IN_INTERFACE},
+    {"in-interface", TOKEN_IN_INTERFACE},
+    {"src_address", TOKEN_SRC_ADDRESS},
+    {"src-address", TOKEN_SRC_ADDRESS},
+    {"dst_address", TOKEN_DST_ADDRESS},
+    {"dst-address", TOKEN_DST_ADDRESS},
+    {"src_port", TOKEN_SRC_PORT},
+    {"src-port", TOKEN_SRC_PORT},
+    {"dst_port", TOKEN_DST_PORT},
+    {"dst-port", TOKEN_DST_PORT},
+    {"to_addresses", TOKEN_TO_ADDRESSES},
+    {"to-addresses", TOKEN_TO_ADDRESSES},
+    {"to_ports", TOKEN_TO_PORTS},
+    {"to-ports", TOKEN_TO_PORTS},
+    {"mode", TOKEN_MODE},
+    {"slaves", TOKEN_SLAVES},
+    {"protocol", TOKEN_PROTOCOL},
+    {"distance", TOKEN_DISTANCE},
+    {"mtu", TOKEN_MTU},
+    {"template", TOKEN_TEMPLATE},
+    {"use", TOKEN_USE},
+    {"for", TOKEN_FOR},
+    {"in", TOKEN_IN},
+    {"include", TOKEN_INCLUDE},
+    {"true", TOKEN_BOOL},
+    {"false", TOKEN_BOOL},
+};
+
+inline constexpr auto KEYWORDS = make_perfect_hash<32, 128>(KEYWORD_ENTRIES);
+static_assert(KEYWORDS.complete, "keywords have duplicates or no perfect hash was found");
+
+// Token for a word: its keyword token, or TOKEN_IDENTIFIER for any other word
+constexpr int keyword_token(std::string_view word) noexcept
+{
+    int index = KEYWORDS.index_of(word);
+    return index >= 0 ? KEYWORDS.entries[index].token : TOKEN_IDENTIFIER;
+}
+
+struct WordMatch
+{
+    int token;
+    size_t length; // Characters of the word the token takes
+};
+
+// Classify a word matched by the scanner. Words may only contain a hyphen
+// when it belongs to a keyword such as "dst-port": otherwise the longest
+// keyword at the start of the word is taken, or the word ends at the hyphen.
+constexpr WordMatch match_word(std::string_view word) noexcept
+{
+    int token = keyword_token(word);
+    size_t hyphen = word.find('-');
+    if (token != TOKEN_IDENTIFIER || hyphen == std::string_view::npos) {
+        return {token, word.size()};
+    }
+    for (size_t length = word.size() - 1; length > hyphen + 1; length--) {
+        token = keyword_token(word.substr(0, length));
+        if (token != TOKEN_IDENTIFIER) {
+            return {token, length};
+        }
+    }
+    return {keyword_token(word.substr(0, hyphen)), hyphen};
+}
+
+static_assert(keyword_token("device") == TOKEN_DEVICE, "keyword lookup is broken");
+static_assert(keyword_token("dst-port") == TOKEN_DST_PORT, "keyword lookup is broken");
+static_assert(keyword_token("ether1") == TOKEN_IDENTIFIER, "keyword lookup is broken");
+static_assert(match_word("dst-port1").length == 8, "keyword lookup is broken");
+static_assert(match_word("dhcp-server").token == TOKEN_DHCP, "keyword lookup is broken");
@@ -0,0 +1,147 @@
+#include "line_scanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool is_indent_char(char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+size_t scalar_indent(std::string_view text, size_t pos) noexcept
+{
+    size_t start = pos;
+    while (pos < text.size() && is_indent_char(text[pos])) {
+        pos++;
+    }
+    return pos - start;
+}
+
+LineInfo make_line(std::string_view text, size_t offset, size_t indent) noexcept
+{
+    size_t first = offset + indent;
+    bool blank = first >= text.size() || text[first] == '\n' || text[first] == '#';
+    return {static_cast<uint32_t>(offset), static_cast<uint32_t>(indent), blank};
+}
+
+template <typename OnNewline>
+void scalar_newlines(std::string_view text, size_t pos, OnNewline on_newline)
+{
+    while (pos < text.size()) {
+        const void* found = memchr(text.data() + pos, '\n', text.size() - pos);
+        if (!found) {
+            return;
+        }
+        pos = static_cast<const char*>(found) - text.data();
+        on_newline(pos);
+        pos++;
+    }
+}
+
+#if defined(__SSE2__)
+
+// Leading whitespace length, 16 bytes per step; most indents fit in one
+size_t vector_indent(std::string_view text, size_t pos) noexcept
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+
+    size_t start = pos;
+    while (pos + 16 <= text.size()) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        __m128i whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                                                       _mm_cmpeq_epi8(chunk, tab)),
+                                          _mm_cmpeq_epi8(chunk, carriage_return));
+        unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFFu;
+        if (other != 0) {
+            return pos - start + __builtin_ctz(other);
+        }
+        pos += 16;
+    }
+    return pos - start + scalar_indent(text, pos);
+}
+
+// Report every newline position, comparing 32 (AVX2) or 16 (SSE2) bytes at once
+template <typename OnNewline>
+void vector_newlines(std::string_view text, OnNewline on_newline)
+{
+    size_t pos = 0;
+#if defined(__AVX2__)
+    const __m256i newline_x32 = _mm256_set1_epi8('\n');
+    for (; pos + 32 <= text.size(); pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + pos));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline_x32)));
+        while (mask != 0) {
+            on_newline(pos + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= text.size(); pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        while (mask != 0) {
+            on_newline(pos + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    scalar_newlines(text, pos, on_newline);
+}
+
+#endif
+
+} // namespace
+
+LineTable LineTable::build(std::string_view text)
+{
+#if defined(__SSE2__)
+    LineTable table;
+    // Typical DSL lines are 20-40 bytes long
+    table.lines_.reserve(text.size() / 24 + 1);
+
+    table.lines_.push_back(make_line(text, 0, vector_indent(text, 0)));
+    vector_newlines(text, [&](size_t newline) {
+        table.lines_.push_back(make_line(text, newline + 1, vector_indent(text, newline + 1)));
+    });
+    return table;
+#else
+    return build_scalar(text);
+#endif
+}
+
+LineTable LineTable::build_scalar(std::string_view text)
+{
+    LineTable table;
+    table.lines_.reserve(text.size() / 24 + 1);
+
+    table.lines_.push_back(make_line(text, 0, scalar_indent(text, 0)));
+    scalar_newlines(text, 0, [&](size_t newline) {
+        table.lines_.push_back(make_line(text, newline + 1, scalar_indent(text, newline + 1)));
+    });
+    return table;
+}
+
+size_t LineTable::find(size_t offset, size_t hint) const noexcept
+{
+    if (lines_.empty()) {
+        return 0;
+    }
+    if (hint >= lines_.size() || lines_[hint].offset > offset) {
+        // Looking backwards: fall back to a binary search
+        auto after = std::upper_bound(lines_.begin(), lines_.end(), offset,
+            [](size_t value, const LineInfo& line) { return value < line.offset; });
+        return static_cast<size_t>(after - lines_.begin()) - 1;
+    }
+    while (hint + 1 < lines_.size() && lines_[hint + 1].offset <= offset) {
+        hint++;
+    }
+    return hint;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// One physical line of the input
+struct LineInfo
+{
+    uint32_t offset; // Byte offset of the first character
+    uint32_t indent; // Leading spaces, tabs and carriage returns
+    bool blank;      // Nothing but whitespace and possibly a comment
+};
+
+// Every line of an input with its indentation, found in one pass before
+// lexing. Newlines and leading whitespace are located 16 or 32 bytes at a
+// time with SSE2/AVX2 when the compiler targets them, so the scanner can
+// look indentation up instead of matching it character by character.
+class LineTable
+{
+public:
+    static LineTable build(std::string_view text);
+
+    // Same table without vector instructions; used where SSE2 is unavailable
+    static LineTable build_scalar(std::string_view text);
+
+    // Index of the line containing a byte offset; the search walks forward
+    // from `hint`, so scanning the input in order costs O(1) per lookup
+    size_t find(size_t offset, size_t hint = 0) const noexcept;
+
+    const LineInfo& operator[](size_t index) const noexcept { return lines_[index]; }
+    size_t size() const noexcept { return lines_.size(); }
+    const std::vector<LineInfo>& get_lines() const noexcept { return lines_; }
+
+private:
+    std::vector<LineInfo> lines_;
+};
@@ -3,151 +3,1474 @@
 #include <string.h>
 #include <iostream>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <chrono>
+#include <algorithm>
 #include <string>
+#include <sstream>
+#include <string_view>
 #include <vector>
 #include "datatype.hpp"
 #include "declaration.hpp"
 #include "expression.hpp"
 #include "statement.hpp"
 #include "specialized_sections.hpp"
+#include "route_checker.hpp"
+#include "semantic_validator.hpp"
+#include "symbol_table.hpp"
+#include "diagnostics.hpp"
+#include "thread_pool.hpp"
+#include "scanner.hpp"
+#include "parse_driver.hpp"
+#include "ast_image.hpp"
+#include "module_cache.hpp"
+#include "routeros_script.hpp"
+#include "script_writer.hpp"
+#include "rsc_importer.hpp"
+#include "config_diff.hpp"
+#include "firewall_simulator.hpp"
+#include "packet_trace.hpp"
+#include "rule_reorder.hpp"
+#include "route_simulator.hpp"
 
-extern FILE* yyin;
-extern int yyparse();
-extern int line_number;
-extern int yydebug;
-extern ProgramDeclaration* parser_result;
+// Default cap on printed errors; warnings are always printed
+constexpr size_t DEFAULT_MAX_ERRORS = 100;
+
+// Thread counts measured by --bench-validate and --bench-parse
+const size_t BENCH_THREAD_COUNTS[] = {1, 2, 4, 8, 16};
+constexpr int BENCH_RUNS = 5;
+
+// Formats and levels measured by --bench-output
+struct BenchCompression {
+    ScriptWriter::Compression compression;
+    const char* name;
+    int level;
+};
+const BenchCompression BENCH_COMPRESSIONS[] = {
+    {ScriptWriter::Compression::NONE, "none", 0},
+    {ScriptWriter::Compression::GZIP, "gzip", 1},
+    {ScriptWriter::Compression::GZIP, "gzip", 6},
+    {ScriptWriter::Compression::GZIP, "gzip", 9},
+    {ScriptWriter::Compression::ZSTD, "zstd", 1},
+    {ScriptWriter::Compression::ZSTD, "zstd", 3},
+    {ScriptWriter::Compression::ZSTD, "zstd", 19},
+};
+
+struct CompilerOptions {
+    const char* input_file = nullptr;
+    const char* output_file = nullptr;
+    const char* batch_file = nullptr;  // List of inputs to compile in one process
+    size_t max_errors = DEFAULT_MAX_ERRORS;
+    size_t threads = 0;           // 0 = one per hardware thread
+    bool bench_validate = false;
+    bool bench_lex = false;
+    bool parallel_parse = false;
+    bool bench_parse = false;
+    bool stream = false;
+    bool emit_ast = false;
+    bool bench_ast = false;
+    bool loops = false;           // Write runs of similar commands as :foreach loops
+    bool group_menus = false;     // Write commands of one menu under a single menu line
+    ScriptWriter::Compression compression = ScriptWriter::Compression::NONE;
+    int compression_level = 0;    // 0 = default level of the compression
+    bool bench_output = false;
+    bool import_rsc = false;      // Read the input as a RouterOS export and write DSL text
+    bool bench_import = false;
+    const char* diff_file = nullptr;   // New version of input_file to compare it with
+    const char* trace_file = nullptr;  // Packets to run through the firewall of input_file
+    bool bench_simulate = false;
+    const char* counters_file = nullptr;   // Packet counters to reorder firewall rules by
+    const char* routes_file = nullptr;     // Destinations to look up in the routes of input_file
+    std::vector<std::string> down_interfaces;   // Interfaces --routes takes down
+    bool bench_routes = false;
+};
 
 void usage(char* argv[]) {
-    printf("Usage: %s input_file [output_file]\n", argv[0]);
+    printf("Usage: %s input_file [output_file] [options]\n", argv[0]);
     printf("       If output_file is not specified, it will be input_file.rsc\n");
+    printf("       input_file may also be an AST image written by --emit-ast\n");
+    printf("       %s --import-rsc export_file [output_file] [--emit-ast] [--compress FORMAT]\n", argv[0]);
+    printf("       %s --batch list_file [options]\n", argv[0]);
+    printf("       %s old_file --diff new_file\n", argv[0]);
+    printf("       %s input_file --simulate trace_file [matches_file]\n", argv[0]);
+    printf("       %s input_file --routes query_file [results_file] [--link-down IFACE]\n", argv[0]);
+    printf("Options:\n");
+    printf("  --max-errors N   Stop printing after N errors (0 = no limit, default %zu)\n", DEFAULT_MAX_ERRORS);
+    printf("  --threads N      Validate with N threads (default: one per hardware thread)\n");
+    printf("  --parallel-parse Parse top-level sections in parallel on the same threads\n");
+    printf("  --stream         Compile one top-level section at a time to bound memory use\n");
+    printf("  --loops          Write runs of commands that differ in one value as :foreach loops\n");
+    printf("  --group-menus    Sort commands by menu and write each menu once before its commands\n");
+    printf("  --compress FORMAT Compress the script while writing it: none, gzip or zstd\n");
+    printf("  --compress-level N Compression level (gzip 1-9, zstd 1-19)\n");
+    printf("  --emit-ast       Write a binary AST image (default input_file.ast) instead of a script\n");
+    printf("  --import-rsc     Read input_file as a RouterOS /export script and write it as DSL text\n");
+    printf("                   (default input_file.dsl), or as an AST image with --emit-ast\n");
+    printf("  --batch FILE     Compile every \"input_file [output_file]\" line of FILE, parsing shared\n");
+    printf("                   included modules only once\n");
+    printf("  --diff FILE      Report the semantic differences from input_file to FILE, which may be DSL\n");
+    printf("                   text, AST images or RouterOS exports, and exit 1 if there are any\n");
+    printf("  --simulate FILE  Run the packets of a CSV, pcap or pcapng trace through the firewall rules,\n");
+    printf("                   print the hits of every rule and write each packet's matches to output_file\n");
+    printf("  --counters FILE  Reorder the rules of each firewall chain by the packet counters in FILE,\n");
+    printf("                   where the reordering provably keeps every verdict\n");
+    printf("  --routes FILE    Look up the next hop of every \"destination [source [in-interface]]\" line of\n");
+    printf("                   FILE, print the hits of every route and write each result to output_file\n");
+    printf("  --link-down IFACE Take interfaces down for --routes (comma separated, repeatable) and\n");
+    printf("                   report the destinations whose next hop changes\n");
+    printf("  --bench-validate Time semantic validation with 1 to 16 threads and exit\n");
+    printf("  --bench-lex      Time the scanner alone over the input and exit\n");
+    printf("  --bench-parse    Time sequential and parallel parsing with 1 to 16 threads and exit\n");
+    printf("  --bench-ast      Time a walk over the object AST and the flat AST and exit\n");
+    printf("  --bench-output   Time writing the script uncompressed and compressed at several levels and exit\n");
+    printf("  --bench-import   Time importing input_file as a RouterOS export and exit\n");
+    printf("  --bench-simulate Time --simulate with rule-by-rule matching and with the classifiers and exit\n");
+    printf("  --bench-routes   Time --routes with a binary trie and with the compressed trie and exit\n");
     exit(1);
 }
 
-// Perform semantic analysis on the AST
-bool validate_semantics(ProgramDeclaration* program) {
-    bool valid = true;
-    std::vector<std::string> validation_errors;
+CompilerOptions parse_options(int argc, char* argv[]) {
+    CompilerOptions options;
     
-    // Option to disable validation during debugging
-    bool skip_validation = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-errors") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            char* end = nullptr;
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0) {
+                usage(argv);
+            }
+            options.max_errors = static_cast<size_t>(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            char* end = nullptr;
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 1) {
+                usage(argv);
+            }
+            options.threads = static_cast<size_t>(value);
+        } else if (strcmp(argv[i], "--bench-validate") == 0) {
+            options.bench_validate = true;
+        } else if (strcmp(argv[i], "--bench-lex") == 0) {
+            options.bench_lex = true;
+        } else if (strcmp(argv[i], "--parallel-parse") == 0) {
+            options.parallel_parse = true;
+        } else if (strcmp(argv[i], "--bench-parse") == 0) {
+            options.bench_parse = true;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            options.stream = true;
+        } else if (strcmp(argv[i], "--emit-ast") == 0) {
+            options.emit_ast = true;
+        } else if (strcmp(argv[i], "--bench-ast") == 0) {
+            options.bench_ast = true;
+        } else if (strcmp(argv[i], "--loops") == 0) {
+            options.loops = true;
+        } else if (strcmp(argv[i], "--group-menus") == 0) {
+            options.group_menus = true;
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            auto [known, error] = ScriptWriter::parse_compression(argv[++i], options.compression);
+            if (!known) {
+                printf("Error: %s\n", error.c_str());
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--compress-level") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            char* end = nullptr;
+            long value = strtol(argv[++i], &end, 10);
+            // The range depends on --compress, which may come later
+            if (*end != '\0' || value < 1 || value > 100) {
+                usage(argv);
+            }
+            options.compression_level = static_cast<int>(value);
+        } else if (strcmp(argv[i], "--bench-output") == 0) {
+            options.bench_output = true;
+        } else if (strcmp(argv[i], "--import-rsc") == 0) {
+            options.import_rsc = true;
+        } else if (strcmp(argv[i], "--bench-import") == 0) {
+            options.bench_import = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            options.batch_file = argv[++i];
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            options.diff_file = argv[++i];
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            options.trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            options.counters_file = argv[++i];
+        } else if (strcmp(argv[i], "--bench-simulate") == 0) {
+            options.bench_simulate = true;
+        } else if (strcmp(argv[i], "--routes") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            options.routes_file = argv[++i];
+        } else if (strcmp(argv[i], "--link-down") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv);
+            }
+            std::stringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) {
+                    options.down_interfaces.push_back(name);
+                }
+            }
+        } else if (strcmp(argv[i], "--bench-routes") == 0) {
+            options.bench_routes = true;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            usage(argv);
+        } else if (!options.input_file) {
+            options.input_file = argv[i];
+        } else if (!options.output_file) {
+            options.output_file = argv[i];
+        } else {
+            usage(argv);
+        }
+    }
     
-    // Check if there's an environment variable to skip validation
+    if (options.compression_level > 0) {
+        auto [valid, error] = ScriptWriter::check_level(options.compression, options.compression_level);
+        if (!valid) {
+            printf("Error: %s\n", error.c_str());
+            exit(1);
+        }
+    }
+
+    if (options.batch_file) {
+        // Benchmarks measure a single input
+        if (options.input_file || options.bench_validate || options.bench_lex || options.bench_parse ||
+            options.bench_ast || options.bench_output || options.import_rsc || options.bench_import ||
+            options.diff_file || options.trace_file || options.bench_simulate || options.counters_file ||
+            options.routes_file || !options.down_interfaces.empty() || options.bench_routes) {
+            usage(argv);
+        }
+    } else if (!options.input_file || (options.bench_simulate && !options.trace_file) ||
+               ((options.bench_routes || !options.down_interfaces.empty()) && !options.routes_file)) {
+        usage(argv);
+    }
+    return options;
+}
+
+// Queue the validation tasks of one top-level section on the pool
+void submit_validation_tasks(const FlatAst& flat, FlatAst::NodeId section, ThreadPool& pool,
+                             std::vector<std::future<Diagnostics>>& results) {
+    const SectionValidator* validator = SectionValidator::for_section(flat.section_type(section));
+    if (!validator) {
+        return;
+    }
+    for (ValidationTask& task : validator->tasks(flat, section)) {
+        results.push_back(pool.submit([&flat, section, task = std::move(task)]() {
+            Diagnostics task_diagnostics;
+            try {
+                task(task_diagnostics);
+            } catch (const std::exception& e) {
+                task_diagnostics.report(Diagnostics::Severity::ERROR, flat.line(section), flat.column(section),
+                    "Exception in section '" + std::string(flat.name(section)) + "': " + e.what());
+            } catch (...) {
+                task_diagnostics.report(Diagnostics::Severity::ERROR, flat.line(section), flat.column(section),
+                    "Unknown error in section '" + std::string(flat.name(section)) + "'");
+            }
+            return task_diagnostics;
+        }));
+    }
+}
+
+// Run the validation tasks of every section on the pool. Results are merged in
+// task order, so the diagnostics do not depend on the number of threads.
+Diagnostics validate_sections(const FlatAst& flat, ThreadPool& pool) {
+    std::vector<std::future<Diagnostics>> results;
+    for (FlatAst::NodeId section = flat.root(); section != FlatAst::NONE; section = flat.next_sibling(section)) {
+        submit_validation_tasks(flat, section, pool, results);
+    }
+    
+    Diagnostics merged;
+    for (auto& result : results) {
+        merged.merge(result.get());
+    }
+    return merged;
+}
+
+// Check if there's an environment variable to skip validation
+bool validation_skipped() {
     const char* skip_env = getenv("SKIP_VALIDATION");
     if (skip_env && (strcmp(skip_env, "1") == 0 || strcmp(skip_env, "true") == 0)) {
         printf("Warning: Skipping semantic validation due to SKIP_VALIDATION environment variable\n");
         return true;
     }
+    return false;
+}
+
+// Perform semantic analysis on the AST, reporting every problem into diagnostics
+bool validate_semantics(const FlatAst& flat, const SymbolTable& symbols, Diagnostics& diagnostics, ThreadPool& pool) {
+    if (validation_skipped()) {
+        return true;
+    }
     
-    // Validate each section in the program
-    for (const auto* section : program->get_sections()) {
-        // Check if this is a specialized section
-        const SpecializedSection* specialized = dynamic_cast<const SpecializedSection*>(section);
-        if (specialized) {
-            try {
-                // Call the validate method
-                auto [is_valid, error_message] = specialized->validate();
-                if (!is_valid) {
-                    valid = false;
-                    validation_errors.push_back("Error in section '" + specialized->get_name() + "': " + error_message);
-                }
-            } catch (const std::exception& e) {
-                valid = false;
-                validation_errors.push_back("Exception in section '" + specialized->get_name() + "': " + e.what());
-            } catch (...) {
-                valid = false;
-                validation_errors.push_back("Unknown error in section '" + specialized->get_name() + "'");
+    size_t errors_before = diagnostics.error_count();
+    diagnostics.merge(validate_sections(flat, pool));
+    
+    // Cross-section references: every interface, address-list and routing table must be declared
+    symbols.validate(diagnostics);
+    
+    // Cross-section route table checks only produce warnings
+    RouteTableChecker route_checker;
+    route_checker.check(flat, diagnostics);
+    
+    return diagnostics.error_count() == errors_before;
+}
+
+bool same_diagnostics(const Diagnostics& a, const Diagnostics& b) {
+    const auto& lhs = a.get_diagnostics();
+    const auto& rhs = b.get_diagnostics();
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+            [](const Diagnostics::Diagnostic& x, const Diagnostics::Diagnostic& y) {
+                return x.severity == y.severity && x.line == y.line &&
+                       x.column == y.column && x.message == y.message;
+            });
+}
+
+// Time section validation for each thread count and check the results never change
+void bench_validate(const FlatAst& flat) {
+    size_t section_count = 0;
+    size_t task_count = 0;
+    for (FlatAst::NodeId section = flat.root(); section != FlatAst::NONE; section = flat.next_sibling(section)) {
+        section_count++;
+        if (const SectionValidator* validator = SectionValidator::for_section(flat.section_type(section))) {
+            task_count += validator->tasks(flat, section).size();
+        }
+    }
+    printf("Validation benchmark: %zu sections, %zu tasks, best of %d runs\n",
+           section_count, task_count, BENCH_RUNS);
+    printf("%8s %12s %9s %s\n", "threads", "time (ms)", "speedup", "diagnostics");
+    
+    Diagnostics reference;
+    double baseline_ms = 0;
+    for (size_t threads : BENCH_THREAD_COUNTS) {
+        ThreadPool pool(threads);
+        double best_ms = 0;
+        Diagnostics result;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            result = validate_sections(flat, pool);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
             }
         }
+        
+        if (threads == BENCH_THREAD_COUNTS[0]) {
+            reference = result;
+            baseline_ms = best_ms;
+        }
+        printf("%8zu %12.3f %8.2fx %zu (%s)\n", threads, best_ms,
+               best_ms > 0 ? baseline_ms / best_ms : 0.0, result.get_diagnostics().size(),
+               same_diagnostics(result, reference) ? "identical" : "MISMATCH");
     }
+}
+
+// Time one scanner pass over the input without parsing it
+void bench_lex(const std::string& text) {
+    auto start = std::chrono::steady_clock::now();
+    yyscan_t scanner = scanner_create(text);
+    size_t tokens = scan_all_tokens(scanner);
+    scanner_destroy(scanner);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    printf("Scanner benchmark: %zu tokens, %zu bytes in %.3f ms\n",
+           tokens, text.size(), elapsed.count() * 1000);
+    if (elapsed.count() > 0) {
+        printf("%.0f tokens/s, %.1f MB/s\n",
+               tokens / elapsed.count(), text.size() / elapsed.count() / 1e6);
+    }
+}
+
+// Time a sequential parse against parallel parses and check they build the same sections
+void bench_parse(const std::string& text) {
+    printf("Parse benchmark: %zu bytes, %zu chunks of top-level sections, best of %d runs\n",
+           text.size(), split_top_level_sections(text, 0).size(), BENCH_RUNS);
+    printf("%8s %12s %9s %s\n", "threads", "time (ms)", "speedup", "sections");
     
-    // Display validation errors if any
-    if (!valid) {
-        printf("Semantic validation failed with the following errors:\n");
-        for (const auto& error : validation_errors) {
-            printf("- %s\n", error.c_str());
+    double baseline_ms = 0;
+    size_t reference_sections = 0;
+    for (size_t threads : BENCH_THREAD_COUNTS) {
+        ThreadPool pool(threads);
+        double best_ms = 0;
+        size_t sections = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            Diagnostics diagnostics;
+            auto start = std::chrono::steady_clock::now();
+            ProgramDeclaration* program = threads == 1 ? parse_text(text, 1, diagnostics)
+                                                       : parse_text_parallel(text, pool, diagnostics);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+            
+            sections = program ? program->get_sections().size() : 0;
+            if (program) {
+                program->destroy();
+                delete program;
+            }
         }
+        
+        if (threads == BENCH_THREAD_COUNTS[0]) {
+            reference_sections = sections;
+            baseline_ms = best_ms;
+        }
+        printf("%8zu %12.3f %8.2fx %zu (%s)\n", threads, best_ms,
+               best_ms > 0 ? baseline_ms / best_ms : 0.0, sections,
+               sections == reference_sections ? "identical" : "MISMATCH");
     }
+}
+
+// Visit every section and property below a statement in source order, hashing their names
+void walk_statement(const Statement* stmt, size_t& nodes, size_t& hash) {
+    const SectionStatement* section = dynamic_cast<const SectionStatement*>(stmt);
+    const PropertyStatement* prop = section ? nullptr : dynamic_cast<const PropertyStatement*>(stmt);
+    if (!section && !prop) {
+        return;
+    }
+    nodes++;
+    hash = hash * 31 + std::hash<std::string_view>()(section ? section->get_name() : prop->get_name());
+    if (section && section->get_block()) {
+        for (const Statement* child : section->get_block()->get_statements()) {
+            walk_statement(child, nodes, hash);
+        }
+    }
+}
+
+void walk_flat(const FlatAst& flat, FlatAst::NodeId node, size_t& nodes, size_t& hash) {
+    for (; node != FlatAst::NONE; node = flat.next_sibling(node)) {
+        nodes++;
+        hash = hash * 31 + std::hash<std::string_view>()(flat.name(node));
+        walk_flat(flat, flat.first_child(node), nodes, hash);
+    }
+}
+
+// Time the same whole-tree walk over the object AST and the flat AST
+void bench_ast(ProgramDeclaration* program, const FlatAst& flat) {
+    printf("AST walk benchmark: %zu nodes, %zu values, %zu distinct names, best of %d runs\n",
+           flat.node_count(), flat.value_count(), flat.symbol_count(), BENCH_RUNS);
+    printf("%8s %12s %12s %s\n", "layout", "time (ms)", "ns/node", "nodes");
     
-    return valid;
+    size_t reference_nodes = 0;
+    size_t reference_hash = 0;
+    for (int layout = 0; layout < 2; layout++) {
+        double best_ms = 0;
+        size_t nodes = 0;
+        size_t hash = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            nodes = 0;
+            hash = 0;
+            auto start = std::chrono::steady_clock::now();
+            if (layout == 0) {
+                for (const auto* section : program->get_sections()) {
+                    walk_statement(section, nodes, hash);
+                }
+            } else {
+                walk_flat(flat, flat.root(), nodes, hash);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+        }
+        
+        if (layout == 0) {
+            reference_nodes = nodes;
+            reference_hash = hash;
+        }
+        printf("%8s %12.3f %12.2f %zu (%s)\n", layout == 0 ? "object" : "flat", best_ms,
+               nodes > 0 ? best_ms * 1e6 / nodes : 0.0, nodes,
+               nodes == reference_nodes && hash == reference_hash ? "identical" : "MISMATCH");
+    }
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2 || argc > 3) {
-        usage(argv);
+// Generate output filename from input if not provided
+std::string output_filename_for(const CompilerOptions& options, const char* extension = ".rsc") {
+    char output_filename[256];
+    if (options.output_file) {
+        strncpy(output_filename, options.output_file, sizeof(output_filename) - 1);
+        output_filename[sizeof(output_filename) - 1] = '\0';
+    } else {
+        // Create output filename by removing the extension and adding .rsc (or .ast)
+        char input_copy[251];  // 256 - 4 (".rsc") - 1 (null terminator) = 251
+        strncpy(input_copy, options.input_file, sizeof(input_copy) - 1);
+        input_copy[sizeof(input_copy) - 1] = '\0';
+        
+        // Find the last occurrence of '.' to remove the extension
+        char* last_dot = strrchr(input_copy, '.');
+        if (last_dot != NULL) {
+            *last_dot = '\0';  // Remove the extension
+        }
+        
+        // Add the output extension
+        snprintf(output_filename, sizeof(output_filename), "%s%s", input_copy, extension);
     }
+    return output_filename;
+}
 
-    yyin = fopen(argv[1], "r");
+// Name of the script file; a compressed script gets the extension of its
+// format unless the name was given
+std::string script_filename_for(const CompilerOptions& options) {
+    std::string filename = output_filename_for(options);
+    if (!options.output_file) {
+        filename += ScriptWriter::extension(options.compression);
+    }
+    return filename;
+}
 
-    if (!yyin) {
-        printf("Could not open %s\n", argv[1]);
-        exit(1);
+// Apply the optional output passes to a translated script. Loops are found
+// while every command still carries its menu.
+std::string finish_script(std::string script, const CompilerOptions& options) {
+    if (options.group_menus) {
+        script = sort_by_menu(script);
     }
+    if (options.loops) {
+        script = compact_loops(script);
+    }
+    if (options.group_menus) {
+        script = group_menus(script);
+    }
+    return script;
+}
 
+// Directory of an input file, which the modules it includes are relative to
+std::string directory_of(const char* path) {
+    const char* slash = strrchr(path, '/');
+    if (!slash) {
+        return "";
+    }
+    return std::string(path, slash == path ? 1 : slash - path);
+}
 
-    /* Enable parser debugging if needed */
-    // yydebug = 1;
+// Translate one top-level section with the state of the current compilation
+std::string section_script(const SectionStatement* section, const TranslationContext& context,
+                           const CompilerOptions& options) {
+    if (const auto* specialized = dynamic_cast<const SpecializedSection*>(section)) {
+        return finish_script(specialized->translate("    ", context), options);
+    }
+    return finish_script(section->to_mikrotik("    "), options);
+}
+
+// Translate a program section by section into an output file
+std::tuple<bool, std::string> write_script(const ProgramDeclaration* program, const std::string& filename,
+                                           const TranslationContext& context, const CompilerOptions& options) {
+    ScriptWriter writer;
+    auto [opened, error] = writer.open(filename, options.compression, options.compression_level);
+    if (!opened) {
+        return {false, error};
+    }
+    for (const auto* section : program->get_sections()) {
+        auto [written, write_error] = writer.write(section_script(section, context, options));
+        if (!written) {
+            writer.close();
+            remove(filename.c_str());
+            return {false, write_error};
+        }
+    }
+    return writer.close();
+}
+
+// Translate an AST image into an output file. Each top-level section is
+// rebuilt from the mapping only while it is translated, so the object AST of
+// the image never exists as a whole.
+std::tuple<bool, std::string> write_script(const AstImage& image, const std::string& filename,
+                                           const TranslationContext& context, const CompilerOptions& options) {
+    ScriptWriter writer;
+    auto [opened, error] = writer.open(filename, options.compression, options.compression_level);
+    if (!opened) {
+        return {false, error};
+    }
+    for (uint32_t node = image.root(); node != ast_image::NONE; node = image.next_sibling(node)) {
+        SectionStatement* section = image.to_section(node);
+        auto [written, write_error] = writer.write(section_script(section, context, options));
+        section->destroy();
+        delete section;
+        if (!written) {
+            writer.close();
+            remove(filename.c_str());
+            return {false, write_error};
+        }
+    }
+    return writer.close();
+}
+
+// Time writing the translated script in every available format and level.
+// The script is translated once up front, so only writing is measured.
+void bench_output(const ProgramDeclaration* program, const TranslationContext& context,
+                  const CompilerOptions& options) {
+    std::vector<std::string> sections;
+    size_t script_bytes = 0;
+    for (const auto* section : program->get_sections()) {
+        sections.push_back(section_script(section, context, options));
+        script_bytes += sections.back().size();
+    }
+    std::string filename = script_filename_for(options) + ".bench";
     
-    int parse_result = yyparse();
+    printf("Output benchmark: %zu bytes of script, best of %d runs\n", script_bytes, BENCH_RUNS);
+    printf("%8s %6s %12s %10s %12s %8s\n", "format", "level", "time (ms)", "MB/s", "bytes", "ratio");
+    for (const BenchCompression& setting : BENCH_COMPRESSIONS) {
+        if (!ScriptWriter::is_available(setting.compression)) {
+            printf("%8s %6d %12s\n", setting.name, setting.level, "unavailable");
+            continue;
+        }
+        double best_ms = 0;
+        size_t bytes_out = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            ScriptWriter writer;
+            auto start = std::chrono::steady_clock::now();
+            auto [opened, error] = writer.open(filename, setting.compression, setting.level);
+            for (size_t i = 0; opened && i < sections.size(); i++) {
+                writer.write(sections[i]);
+            }
+            auto [closed, close_error] = writer.close();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (!opened || !closed) {
+                printf("Error: %s\n", (opened ? close_error : error).c_str());
+                remove(filename.c_str());
+                return;
+            }
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+            bytes_out = writer.bytes_out();
+        }
+        printf("%8s %6d %12.3f %10.1f %12zu %7.2fx\n", setting.name, setting.level, best_ms,
+               best_ms > 0 ? script_bytes / best_ms / 1e3 : 0.0, bytes_out,
+               bytes_out > 0 ? static_cast<double>(script_bytes) / bytes_out : 0.0);
+    }
+    remove(filename.c_str());
+}
 
-    if (parse_result == 0) {
-  
-        // Generate output filename from input if not provided
-        char output_filename[256];
-        if (argc == 3) {
-            strncpy(output_filename, argv[2], sizeof(output_filename) - 1);
-            output_filename[sizeof(output_filename) - 1] = '\0';
+// Read the --counters file, if any; false once the reason it could not be read is printed
+bool load_counters(const CompilerOptions& options, RuleCounters& counters) {
+    if (!options.counters_file) {
+        return true;
+    }
+    auto [loaded, error] = counters.load(options.counters_file);
+    if (!loaded) {
+        printf("Error: %s\n", error.c_str());
+    }
+    return loaded;
+}
+
+// State translation reads from one compilation; firewall rules are only reordered with --counters
+TranslationContext translation_context(const SymbolTable& symbols, RuleReorder& reorder,
+                                       const CompilerOptions& options) {
+    TranslationContext context;
+    context.symbol_table = &symbols;
+    context.rule_reorder = options.counters_file ? &reorder : nullptr;
+    return context;
+}
+
+void print_rule_reorder(const RuleReorder& reorder, const CompilerOptions& options) {
+    if (options.counters_file) {
+        printf("Rules ordered by the counters of %s:\n", options.counters_file);
+        reorder.print_report(stdout);
+    }
+}
+
+// Validate, translate and write each top-level section as soon as it is parsed,
+// then free it. Cross-section checks run at the end over the symbol table and
+// route summaries, which keep names and positions but no AST. The script goes
+// to a temporary file that only replaces the output once everything passed.
+int compile_streaming(const std::string& text, const CompilerOptions& options, ThreadPool& pool) {
+    RuleCounters counters;
+    if (!load_counters(options, counters)) {
+        return 1;
+    }
+    RuleReorder reorder(counters);
+    
+    std::string output_filename = script_filename_for(options);
+    std::string partial_filename = output_filename + ".partial";
+    ScriptWriter output_file;
+    auto [opened, open_error] = output_file.open(partial_filename, options.compression, options.compression_level);
+    if (!opened) {
+        printf("Error: %s\n", open_error.c_str());
+        return 1;
+    }
+    std::string write_error;
+    
+    bool validate = !validation_skipped();
+    Diagnostics diagnostics;
+    SymbolTable symbols;
+    symbols.clear();
+    TranslationContext context = translation_context(symbols, reorder, options);
+    RouteTableChecker route_checker;
+    
+    Diagnostics syntax_diagnostics;
+    parse_text_streaming(text, syntax_diagnostics, [&](SectionStatement* section) {
+        // The cross-section passes and the validators read the section's flat copy
+        FlatAst flat;
+        FlatAst::NodeId node = flat.add_section(section);
+        symbols.add_section(flat, node);
+        
+        if (validate) {
+            route_checker.add_section(flat, node);
+            std::vector<std::future<Diagnostics>> results;
+            submit_validation_tasks(flat, node, pool, results);
+            for (auto& result : results) {
+                diagnostics.merge(result.get());
+            }
+        }
+        
+        // Nothing is written once an error was found, so stop translating
+        if (!diagnostics.has_errors() && write_error.empty()) {
+            auto [written, error] = output_file.write(section_script(section, context, options));
+            if (!written) {
+                write_error = error;
+            }
+        }
+        symbols.forget_sites();
+    }, directory_of(options.input_file));
+    auto [closed, close_error] = output_file.close();
+    if (write_error.empty() && !closed) {
+        write_error = close_error;
+    }
+    
+    bool syntax_errors = syntax_diagnostics.has_errors();
+    diagnostics.merge(std::move(syntax_diagnostics));
+    symbols.resolve();
+    if (validate) {
+        symbols.validate(diagnostics);
+        route_checker.finish(diagnostics);
+    }
+    
+    diagnostics.sort();
+    diagnostics.print(stdout, options.input_file, options.max_errors);
+    
+    if (diagnostics.has_errors()) {
+        remove(partial_filename.c_str());
+        if (syntax_errors) {
+            printf("Parse failed! The input contains syntax errors.\n");
         } else {
-            // Create output filename by removing the extension and adding .rsc
-            char input_copy[251];  // 256 - 4 (".rsc") - 1 (null terminator) = 251
-            strncpy(input_copy, argv[1], sizeof(input_copy) - 1);
-            input_copy[sizeof(input_copy) - 1] = '\0';
-            
-            // Find the last occurrence of '.' to remove the extension
-            char* last_dot = strrchr(input_copy, '.');
-            if (last_dot != NULL) {
-                *last_dot = '\0';  // Remove the extension
+            printf("Compilation aborted due to %zu semantic error(s).\n", diagnostics.error_count());
+        }
+        return 1;
+    }
+    if (!write_error.empty()) {
+        remove(partial_filename.c_str());
+        printf("Error: %s\n", write_error.c_str());
+        return 1;
+    }
+    if (rename(partial_filename.c_str(), output_filename.c_str()) != 0) {
+        printf("Error: Could not write output file %s\n", output_filename.c_str());
+        return 1;
+    }
+    printf("RouterOS script successfully written to %s\n", output_filename.c_str());
+    print_rule_reorder(reorder, options);
+    return 0;
+}
+
+// Serialise a parsed program so later runs can skip the parser
+int emit_ast(bool parsed, const FlatAst& flat, Diagnostics& diagnostics, const CompilerOptions& options) {
+    diagnostics.sort();
+    diagnostics.print(stdout, options.input_file, options.max_errors);
+    if (!parsed || diagnostics.has_errors()) {
+        printf("Parse failed! The input contains syntax errors.\n");
+        return 1;
+    }
+    
+    std::string output_filename = output_filename_for(options, ".ast");
+    auto [written, error] = AstImageWriter::write(flat, output_filename);
+    if (!written) {
+        printf("Error: %s\n", error.c_str());
+        return 1;
+    }
+    printf("AST image successfully written to %s\n", output_filename.c_str());
+    return 0;
+}
+
+// Import a RouterOS export section by section as the importer hands the
+// sections over, writing DSL text or, with --emit-ast, an AST image
+int import_rsc(const CompilerOptions& options) {
+    std::string output_filename = output_filename_for(options, options.emit_ast ? ".ast" : ".dsl");
+    if (!options.emit_ast && !options.output_file) {
+        output_filename += ScriptWriter::extension(options.compression);
+    }
+    ScriptWriter writer;
+    if (!options.emit_ast) {
+        auto [opened, error] = writer.open(output_filename, options.compression, options.compression_level);
+        if (!opened) {
+            printf("Error: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    
+    FlatAst flat;
+    std::string text;
+    std::string write_error;
+    size_t commented = 0;
+    Diagnostics diagnostics;
+    RscImporter::Statistics statistics;
+    auto [imported, error] = RscImporter::import_file(options.input_file, diagnostics, [&](SectionStatement* section) {
+        if (options.emit_ast) {
+            flat.add_section(section);
+            return;
+        }
+        text.clear();
+        commented += append_dsl_section(section, text);
+        if (write_error.empty()) {
+            auto [written, section_error] = writer.write(text);
+            if (!written) {
+                write_error = section_error;
             }
-            
-            // Add .rsc extension
-            snprintf(output_filename, sizeof(output_filename), "%s.rsc", input_copy);
+        }
+    }, &statistics);
+    auto [closed, close_error] = writer.close();
+    if (imported && write_error.empty() && !closed) {
+        write_error = close_error;
+    }
+    if (imported && write_error.empty() && options.emit_ast) {
+        std::tie(closed, write_error) = AstImageWriter::write(flat, output_filename);
+    }
+    
+    diagnostics.sort();
+    diagnostics.print(stdout, options.input_file, options.max_errors);
+    if (!imported || !write_error.empty()) {
+        if (!options.emit_ast) {
+            remove(output_filename.c_str());
+        }
+        printf("Error: %s\n", (imported ? write_error : error).c_str());
+        return 1;
+    }
+    
+    printf("Imported %zu of %zu commands from %zu lines into %zu sections, %zu skipped\n",
+           statistics.imported, statistics.commands, statistics.lines, statistics.sections, statistics.skipped);
+    if (commented > 0) {
+        printf("Warning: %zu statement(s) the DSL cannot spell were written as comments; "
+               "use --emit-ast to keep them\n", commented);
+    }
+    printf("%s successfully written to %s\n", options.emit_ast ? "AST image" : "DSL program",
+           output_filename.c_str());
+    return 0;
+}
+
+// Time importing an export on its own, with DSL text generation and with a
+// flat AST built from the sections, reading the file again on every run
+void bench_import(const CompilerOptions& options) {
+    const char* stages[] = {"ast", "ast+dsl", "ast+flat"};
+    printf("Import benchmark: best of %d runs\n", BENCH_RUNS);
+    printf("%9s %12s %10s %14s %s\n", "stage", "time (ms)", "MB/s", "commands/s", "sections");
+    
+    for (int stage = 0; stage < 3; stage++) {
+        double best_ms = 0;
+        RscImporter::Statistics statistics;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            Diagnostics diagnostics;
+            FlatAst flat;
+            std::string text;
+            auto start = std::chrono::steady_clock::now();
+            auto [imported, error] = RscImporter::import_file(options.input_file, diagnostics,
+                [&](SectionStatement* section) {
+                    if (stage == 1) {
+                        text.clear();
+                        append_dsl_section(section, text);
+                    } else if (stage == 2) {
+                        flat.add_section(section);
+                    }
+                }, &statistics);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (!imported) {
+                printf("Error: %s\n", error.c_str());
+                return;
+            }
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+        }
+        printf("%9s %12.3f %10.1f %14.0f %zu\n", stages[stage], best_ms,
+               best_ms > 0 ? statistics.bytes / best_ms / 1e3 : 0.0,
+               best_ms > 0 ? statistics.commands / best_ms * 1e3 : 0.0, statistics.sections);
+    }
+}
+
+bool read_file(const char* path, std::string& text) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Parse, validate and translate one input that has already been read. An
+// input that is an AST image is mapped instead of parsed: validation and the
+// cross-section passes run on its flat columns, and its sections are only
+// rebuilt as objects one at a time for the translators.
+int compile_file(const CompilerOptions& options, const std::string& text, bool from_image, ThreadPool& pool) {
+    if (options.stream) {
+        return compile_streaming(text, options, pool);
+    }
+    RuleCounters counters;
+    if (!load_counters(options, counters)) {
+        return 1;
+    }
+    RuleReorder reorder(counters);
+    
+    Diagnostics diagnostics;
+    ProgramDeclaration* program = nullptr;
+    FlatAst flat;
+    AstImage image;
+    if (from_image) {
+        auto [opened, error] = image.open(options.input_file);
+        if (!opened) {
+            printf("Error: %s\n", error.c_str());
+            return 1;
+        }
+        flat = FlatAst::from_image(image);
+        // These benchmarks measure the object AST itself
+        if (options.bench_ast || options.bench_output) {
+            program = image.to_program();
+        }
+    } else {
+        std::string directory = directory_of(options.input_file);
+        program = options.parallel_parse ? parse_text_parallel(text, pool, diagnostics, directory)
+                                         : parse_text(text, 1, diagnostics, directory);
+        // Cross-section passes, validation and images work on the flat columns
+        flat = FlatAst::build(program);
+    }
+    bool parsed = program || from_image;
+    
+    if (options.emit_ast) {
+        if (program) {
+            program->destroy();
+            delete program;
+        }
+        return emit_ast(parsed, flat, diagnostics, options);
+    }
+    
+    // Syntax errors the parser recovered from still fail the compilation
+    int parse_result = diagnostics.has_errors() ? 1 : 0;
+
+    // Validate whatever was parsed so one pass reports syntax and semantic errors together
+    bool valid = false;
+    SymbolTable symbols;
+    TranslationContext context = translation_context(symbols, reorder, options);
+    if (parsed) {
+        // Resolve cross-section references once for validation and translation
+        symbols.build(flat);
+        
+        if (options.bench_validate || options.bench_ast || options.bench_output) {
+            if (options.bench_validate) {
+                bench_validate(flat);
+            } else if (options.bench_ast) {
+                bench_ast(program, flat);
+            } else {
+                bench_output(program, context, options);
+            }
+            if (program) {
+                program->destroy();
+                delete program;
+            }
+            return 0;
         }
         
+        valid = validate_semantics(flat, symbols, diagnostics, pool);
+    }
+    
+    diagnostics.sort();
+    diagnostics.print(stdout, options.input_file, options.max_errors);
+
+    if (parse_result == 0) {
+  
+        std::string output_filename = script_filename_for(options);
+        
         // Check if the AST was successfully built
-        if (parser_result) {
-            // Perform semantic validation before generating code
-            if (validate_semantics(parser_result)) {
-                // Validation passed, generate code
-               
-                // Open output file for writing
-                std::ofstream output_file(output_filename);
-                if (output_file.is_open()) {
-                    // Get the translated script as a string
-                    std::string routeros_script = parser_result->to_mikrotik("");
-                    
-                    // Write to the output file
-                    output_file << routeros_script;
-                    output_file.close();
-                    
-                    printf("RouterOS script successfully written to %s\n", output_filename);
+        if (parsed) {
+            if (valid) {
+                // Validation passed, generate code one section at a time, so
+                // compressed output never exists uncompressed as a whole
+                auto [written, error] = from_image ? write_script(image, output_filename, context, options)
+                                                   : write_script(program, output_filename, context, options);
+                if (written) {
+                    printf("RouterOS script successfully written to %s\n", output_filename.c_str());
+                    print_rule_reorder(reorder, options);
                 } else {
-                    printf("Error: Could not open output file %s\n", output_filename);
+                    printf("Error: %s\n", error.c_str());
+                    parse_result = 1;
                 }
             } else {
-                printf("Compilation aborted due to semantic errors.\n");
+                printf("Compilation aborted due to %zu semantic error(s).\n", diagnostics.error_count());
+                if (program) {
+                    program->destroy();
+                    delete program;
+                }
                 return 1;
             }
             
             // Clean up resources
-            parser_result->destroy();
-            delete parser_result;
+            if (program) {
+                program->destroy();
+                delete program;
+            }
         } else {
             printf("Error: Failed to build AST during parsing.\n");
         }
     } else {
         printf("Parse failed! The input contains syntax errors.\n");
+        if (program) {
+            program->destroy();
+            delete program;
+        }
     }
 
-    fclose(yyin);
-    
     return parse_result;
-} 
\ No newline at end of file
+}
+
+// Load one side of --diff: an AST image, a RouterOS export or DSL text
+bool load_program(const char* path, FlatAst& flat, const CompilerOptions& options) {
+    if (AstImage::is_image(path)) {
+        AstImage image;
+        auto [opened, error] = image.open(path);
+        if (!opened) {
+            printf("Error: %s\n", error.c_str());
+            return false;
+        }
+        flat = FlatAst::from_image(image);
+        return true;
+    }
+    
+    Diagnostics diagnostics;
+    std::string_view name(path);
+    if (name.size() > 4 && name.substr(name.size() - 4) == ".rsc") {
+        auto [imported, error] = RscImporter::import_file(path, diagnostics, [&](SectionStatement* section) {
+            flat.add_section(section);
+        });
+        if (!imported) {
+            printf("Error: %s\n", error.c_str());
+            return false;
+        }
+    } else {
+        std::string text;
+        if (!read_file(path, text)) {
+            printf("Could not open %s\n", path);
+            return false;
+        }
+        ProgramDeclaration* program = parse_text(text, 1, diagnostics, directory_of(path));
+        if (program) {
+            flat = FlatAst::build(program);
+            program->destroy();
+            delete program;
+        }
+    }
+    
+    diagnostics.sort();
+    diagnostics.print(stdout, path, options.max_errors);
+    if (diagnostics.has_errors()) {
+        printf("Parse failed! %s contains syntax errors.\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Report what changed from input_file to the --diff file; exits like diff(1)
+// with 0 for no differences, 1 for differences and 2 for trouble
+int diff_programs(const CompilerOptions& options) {
+    FlatAst before;
+    FlatAst after;
+    if (!load_program(options.input_file, before, options) || !load_program(options.diff_file, after, options)) {
+        return 2;
+    }
+    
+    ConfigDiff diff(before, after);
+    if (diff.compare().empty()) {
+        printf("No semantic differences\n");
+        return 0;
+    }
+    diff.print(stdout, options.input_file, options.diff_file);
+    using Kind = ConfigDiff::ChangeKind;
+    printf("%zu added, %zu removed, %zu changed, %zu moved, %zu renamed\n", diff.count(Kind::ADDED),
+           diff.count(Kind::REMOVED), diff.count(Kind::CHANGED), diff.count(Kind::MOVED), diff.count(Kind::RENAMED));
+    return 1;
+}
+
+// Time a trace through the firewall testing rules one by one and through the
+// bit-vector classifiers
+void bench_simulate(FirewallSimulator& simulator, const PacketTrace& trace) {
+    size_t packets = trace.packets().size();
+    printf("Simulation benchmark: %zu packets, %zu rules, best of %d runs\n", packets, simulator.rules().size(),
+           BENCH_RUNS);
+    printf("%12s %12s %10s\n", "matcher", "time (ms)", "Mpps");
+    for (bool linear : {true, false}) {
+        simulator.set_linear(linear);
+        double best_ms = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            simulator.simulate(trace);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+        }
+        printf("%12s %12.3f %10.2f\n", linear ? "linear" : "bit-vector", best_ms,
+               best_ms > 0 ? packets / best_ms / 1e3 : 0.0);
+    }
+}
+
+// Run a packet trace through the firewall of the input and print the hits
+// of every rule; with an output file, also write the rule each packet
+// matched in every chain it went through
+int simulate_firewall(const CompilerOptions& options) {
+    FlatAst flat;
+    if (!load_program(options.input_file, flat, options)) {
+        return 1;
+    }
+    Diagnostics diagnostics;
+    FirewallSimulator simulator(flat, diagnostics);
+    diagnostics.sort();
+    diagnostics.print(stdout, options.input_file, options.max_errors);
+    
+    PacketTrace trace;
+    auto [loaded, error] = trace.load(options.trace_file);
+    if (!loaded) {
+        printf("Error: %s\n", error.c_str());
+        return 1;
+    }
+    if (options.bench_simulate) {
+        bench_simulate(simulator, trace);
+        return 0;
+    }
+    
+    FILE* out = nullptr;
+    if (options.output_file) {
+        out = fopen(options.output_file, "w");
+        if (!out) {
+            printf("Could not open %s\n", options.output_file);
+            return 1;
+        }
+        fputs("packet,raw,dstnat,filter,srcnat,verdict\n", out);
+    }
+    // Empty for a chain the packet did not go through, "-" if no rule decided it
+    std::string line;
+    auto write_packet = [&](size_t index, const FirewallSimulator::Result& result) {
+        line = std::to_string(index + 1);
+        for (size_t step = 0; step < FirewallSimulator::STEP_COUNT; step++) {
+            line += ',';
+            if (result.chains[step] >= 0) {
+                line += result.rules[step] == FirewallSimulator::NO_RULE ? "-"
+                                                                         : simulator.rules()[result.rules[step]].name;
+            }
+        }
+        line += result.accepted ? ",accept\n" : ",drop\n";
+        fwrite(line.data(), 1, line.size(), out);
+    };
+    
+    auto start = std::chrono::steady_clock::now();
+    if (out) {
+        simulator.simulate(trace, write_packet);
+    } else {
+        simulator.simulate(trace);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (out && (ferror(out) || fclose(out) != 0)) {
+        printf("Error: could not write %s\n", options.output_file);
+        return 1;
+    }
+    
+    simulator.print_hits(stdout);
+    size_t packets = trace.packets().size();
+    printf("Simulated %zu packet(s) in %.3f ms (%.2f Mpps)\n", packets, elapsed.count(),
+           elapsed.count() > 0 ? packets / elapsed.count() / 1e3 : 0.0);
+    if (trace.skipped() > 0) {
+        printf("Skipped %zu frame(s) without IPv4\n", trace.skipped());
+    }
+    if (out) {
+        printf("Matches written to %s\n", options.output_file);
+    }
+    return 0;
+}
+
+// Time route lookups walking a binary trie bit by bit and through the
+// compressed trie. The sum of the routes found over all runs is printed,
+// which keeps the lookups from being optimized away and shows that both
+// tries agree.
+void bench_routes(const RouteSimulator& simulator, const std::vector<RouteSimulator::Query>& queries) {
+    printf("Route lookup benchmark: %zu lookups, %zu routes, best of %d runs\n", queries.size(),
+           simulator.routes().size(), BENCH_RUNS);
+    printf("%12s %12s %16s %20s\n", "trie", "time (ms)", "M lookups/s", "checksum");
+    for (bool binary : {true, false}) {
+        double best_ms = 0;
+        uint64_t checksum = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            for (const RouteSimulator::Query& query : queries) {
+                checksum += binary ? simulator.lookup_binary(query).route : simulator.lookup(query).route;
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (run == 0 || elapsed.count() < best_ms) {
+                best_ms = elapsed.count();
+            }
+        }
+        printf("%12s %12.3f %16.2f %20llu\n", binary ? "binary" : "compressed", best_ms,
+               best_ms > 0 ? queries.size() / best_ms / 1e3 : 0.0, static_cast<unsigned long long>(checksum));
+    }
+}
+
+// Route of a lookup result, as "name via gateway (interface)"
+std::string describe_route(const RouteSimulator& simulator, const RouteSimulator::Result& result) {
+    if (result.route == RouteSimulator::NO_ROUTE) {
+        return result.rule == RouteSimulator::NO_ROUTE ? "no route"
+                                                       : "no route (rule " + simulator.rules()[result.rule].name + ")";
+    }
+    const RouteSimulator::Route& route = simulator.routes()[result.route];
+    return route.name + (route.gateway.empty() ? " connected" : " via " + route.gateway) +
+           " (" + route.interface + ")";
+}
+
+// Look up the next hop of every destination of a query file in the routes
+// of the input and print the hits of every route; with an output file, also
+// write each result. With interfaces taken down, compare the results with
+// those of the intact network.
+int simulate_routes(const CompilerOptions& options) {
+    FlatAst flat;
+    if (!load_program(options.input_file, flat, options)) {
+        return 1;
+    }
+    RouteSimulator intact(flat, {});
+    for (const std::string& name : options.down_interfaces) {
+        if (!intact.has_interface(name)) {
+            printf("Error: no address or route of %s uses interface %s\n", options.input_file, name.c_str());
+            return 1;
+        }
+    }
+    
+    std::vector<RouteSimulator::Query> queries;
+    auto [loaded, error] = intact.load_queries(options.routes_file, queries);
+    if (!loaded) {
+        printf("Error: %s\n", error.c_str());
+        return 1;
+    }
+    if (options.bench_routes) {
+        bench_routes(intact, queries);
+        return 0;
+    }
+    
+    std::unique_ptr<RouteSimulator> failed;
+    if (!options.down_interfaces.empty()) {
+        failed = std::make_unique<RouteSimulator>(flat, options.down_interfaces);
+    }
+    const RouteSimulator& simulator = failed ? *failed : intact;
+    
+    std::vector<RouteSimulator::Result> results(queries.size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        results[i] = simulator.lookup(queries[i]);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    
+    if (options.output_file) {
+        FILE* out = fopen(options.output_file, "w");
+        if (!out) {
+            printf("Could not open %s\n", options.output_file);
+            return 1;
+        }
+        fputs("destination,source,rule,table,route,gateway,interface\n", out);
+        // "-" for no source, no deciding rule or no route; gateway "connected" for a subnet of the router
+        std::string line;
+        for (size_t i = 0; i < queries.size(); i++) {
+            const RouteSimulator::Query& query = queries[i];
+            const RouteSimulator::Result& result = results[i];
+            line = format_ipv4_address(query.destination);
+            line += ',';
+            line += query.has_source ? format_ipv4_address(query.source) : "-";
+            line += ',';
+            line += result.rule == RouteSimulator::NO_ROUTE ? "-" : simulator.rules()[result.rule].name;
+            if (result.route == RouteSimulator::NO_ROUTE) {
+                line += ",-,-,-,-\n";
+            } else {
+                const RouteSimulator::Route& route = simulator.routes()[result.route];
+                line += ',' + route.table + ',' + route.name + ',' +
+                        (route.gateway.empty() ? "connected" : route.gateway) + ',' + route.interface + '\n';
+            }
+            fwrite(line.data(), 1, line.size(), out);
+        }
+        if (ferror(out) || fclose(out) != 0) {
+            printf("Error: could not write %s\n", options.output_file);
+            return 1;
+        }
+    }
+    
+    std::vector<uint64_t> hits(simulator.routes().size());
+    size_t unrouted = 0;
+    for (const RouteSimulator::Result& result : results) {
+        if (result.route == RouteSimulator::NO_ROUTE) {
+            unrouted++;
+        } else {
+            hits[result.route]++;
+        }
+    }
+    printf("%12s %8s  %-10s %-20s %-18s %s\n", "hits", "share", "table", "route", "destination", "gateway");
+    for (size_t i = 0; i < hits.size(); i++) {
+        const RouteSimulator::Route& route = simulator.routes()[i];
+        double share = queries.empty() ? 0.0 : 100.0 * static_cast<double>(hits[i]) / static_cast<double>(queries.size());
+        std::string gateway = route.gateway.empty() ? "connected" : route.gateway;
+        if (route.usable) {
+            gateway += " (" + route.interface + ")";
+        }
+        const char* note = !route.usable ? "  (unusable)" : !route.active ? "  (backup)" : "";
+        printf("%12llu %7.2f%%  %-10s %-20s %-18s %s%s\n", static_cast<unsigned long long>(hits[i]), share,
+               route.table.c_str(), route.name.c_str(), route.destination.to_string().c_str(), gateway.c_str(), note);
+    }
+    printf("%zu destination(s): %zu routed, %zu without a route\n", queries.size(), queries.size() - unrouted,
+           unrouted);
+    printf("Looked up %zu destination(s) in %.3f ms (%.2f M lookups/s)\n", queries.size(), elapsed.count(),
+           elapsed.count() > 0 ? queries.size() / elapsed.count() / 1e3 : 0.0);
+    
+    if (failed) {
+        // Destinations whose route differs from the intact network, a few of each kind shown
+        constexpr size_t MAX_EXAMPLES = 10;
+        size_t rerouted = 0;
+        size_t lost = 0;
+        std::vector<std::string> examples;
+        for (size_t i = 0; i < queries.size(); i++) {
+            RouteSimulator::Result before = intact.lookup(queries[i]);
+            if (before.route == results[i].route) {
+                continue;
+            }
+            if (results[i].route == RouteSimulator::NO_ROUTE) {
+                lost++;
+            } else {
+                rerouted++;
+            }
+            if (examples.size() < MAX_EXAMPLES) {
+                examples.push_back(format_ipv4_address(queries[i].destination) + ": " +
+                                   describe_route(intact, before) + " -> " + describe_route(simulator, results[i]));
+            }
+        }
+        std::string down;
+        for (const std::string& name : options.down_interfaces) {
+            down += (down.empty() ? "" : ", ") + name;
+        }
+        printf("With %s down: %zu destination(s) rerouted, %zu left without a route\n", down.c_str(), rerouted,
+               lost);
+        for (const std::string& example : examples) {
+            printf("  %s\n", example.c_str());
+        }
+    }
+    if (options.output_file) {
+        printf("Results written to %s\n", options.output_file);
+    }
+    return 0;
+}
+
+// Compile every input named in a batch list with one thread pool, so modules
+// included by several inputs are parsed only once. Each non-empty line of the
+// list is "input_file [output_file]"; lines starting with # are skipped.
+int compile_batch(const CompilerOptions& options, ThreadPool& pool) {
+    std::ifstream list(options.batch_file);
+    if (!list) {
+        printf("Could not open %s\n", options.batch_file);
+        return 1;
+    }
+    
+    size_t compiled = 0;
+    size_t failed = 0;
+    std::string line;
+    while (std::getline(list, line)) {
+        std::istringstream fields(line);
+        std::string input_file;
+        std::string output_file;
+        if (!(fields >> input_file) || input_file[0] == '#') {
+            continue;
+        }
+        fields >> output_file;
+        
+        CompilerOptions file_options = options;
+        file_options.input_file = input_file.c_str();
+        file_options.output_file = output_file.empty() ? nullptr : output_file.c_str();
+        printf("== %s\n", input_file.c_str());
+        
+        int result = 1;
+        std::string text;
+        bool from_image = AstImage::is_image(file_options.input_file);
+        if (from_image && file_options.stream) {
+            printf("Error: %s is an AST image; --stream needs DSL text\n", file_options.input_file);
+        } else if (!from_image && !read_file(file_options.input_file, text)) {
+            printf("Could not open %s\n", file_options.input_file);
+        } else {
+            result = compile_file(file_options, text, from_image, pool);
+        }
+        compiled++;
+        failed += result != 0 ? 1 : 0;
+    }
+    
+    printf("Batch: %zu input(s), %zu failed, %zu module(s) parsed\n",
+           compiled, failed, ModuleCache::shared().size());
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    CompilerOptions options = parse_options(argc, argv);
+    if (options.batch_file) {
+        ThreadPool pool(options.threads > 0 ? options.threads : ThreadPool::default_thread_count());
+        return compile_batch(options, pool);
+    }
+
+    // Exports are read in blocks by the importer, never as a whole
+    if (options.bench_import) {
+        bench_import(options);
+        return 0;
+    }
+    if (options.import_rsc) {
+        return import_rsc(options);
+    }
+    if (options.diff_file) {
+        return diff_programs(options);
+    }
+    if (options.trace_file) {
+        return simulate_firewall(options);
+    }
+    if (options.routes_file) {
+        return simulate_routes(options);
+    }
+
+    // Pre-parsed images are mapped directly instead of being read as text
+    bool from_image = AstImage::is_image(options.input_file);
+    if (from_image && (options.bench_lex || options.bench_parse || options.stream)) {
+        printf("Error: %s is an AST image; --bench-lex, --bench-parse and --stream need DSL text\n",
+               options.input_file);
+        exit(1);
+    }
+    
+    std::string text;
+    if (!from_image && !read_file(options.input_file, text)) {
+        printf("Could not open %s\n", options.input_file);
+        exit(1);
+    }
+
+    if (options.bench_lex) {
+        bench_lex(text);
+        return 0;
+    }
+    if (options.bench_parse) {
+        bench_parse(text);
+        return 0;
+    }
+
+    ThreadPool pool(options.threads > 0 ? options.threads : ThreadPool::default_thread_count());
+    return compile_file(options, text, from_image, pool);
+}
@@ -0,0 +1,119 @@
+#include "module_cache.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+namespace {
+
+std::string directory_of(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return "";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// The first error of a module, as the includer reports it
+std::string first_error(const std::string& path, Diagnostics& diagnostics) {
+    diagnostics.sort();
+    for (const auto& diagnostic : diagnostics.get_diagnostics()) {
+        if (diagnostic.severity == Diagnostics::Severity::ERROR) {
+            return "In included module '" + path + "': " + std::to_string(diagnostic.line) + ":" +
+                   std::to_string(diagnostic.column) + ": " + diagnostic.message;
+        }
+    }
+    return "";
+}
+
+// Give the statements parsed from a module an origin of their own, so they
+// are not taken for statements of an includer that start at the same line.
+// Statements that already have one were copied from a template or come from
+// a module this one includes.
+void set_module_origin(Statement* statement, uint32_t origin) {
+    if (statement->get_origin() == 0) {
+        statement->set_origin(origin);
+    }
+    if (const auto* section = dynamic_cast<const SectionStatement*>(statement)) {
+        if (section->get_block()) {
+            for (Statement* child : section->get_block()->get_statements()) {
+                set_module_origin(child, origin);
+            }
+        }
+    }
+}
+
+} // namespace
+
+ModuleCache::~ModuleCache() {
+    // Sections borrowed from other modules are skipped by destroy(), so the order does not matter
+    for (auto& entry : modules_) {
+        if (ProgramDeclaration* program = entry.second->context.program) {
+            program->destroy();
+            delete program;
+        }
+    }
+}
+
+ModuleCache& ModuleCache::shared() {
+    static ModuleCache cache;
+    return cache;
+}
+
+std::tuple<const ModuleCache::Module*, std::string> ModuleCache::load(const std::string& path) {
+    char resolved[PATH_MAX];
+    if (!realpath(path.c_str(), resolved)) {
+        return {nullptr, "Could not open included module '" + path + "'"};
+    }
+    std::string canonical(resolved);
+
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    auto it = modules_.find(canonical);
+    if (it != modules_.end()) {
+        const Module* module = it->second.get();
+        return {module->error.empty() ? module : nullptr, module->error};
+    }
+    if (std::find(loading_.begin(), loading_.end(), canonical) != loading_.end()) {
+        // Not cached: the module may well be includable from elsewhere
+        return {nullptr, "Module '" + path + "' includes itself"};
+    }
+
+    auto module = std::make_unique<Module>();
+    module->path = canonical;
+    module->context.directory = directory_of(canonical);
+    // Devices and pipes such as /dev/zero could be read forever
+    struct stat status;
+    bool found = stat(canonical.c_str(), &status) == 0;
+    std::ifstream input;
+    if (found && S_ISREG(status.st_mode)) {
+        input.open(canonical, std::ios::binary);
+    }
+    if (found && !S_ISREG(status.st_mode)) {
+        module->error = "Included module '" + path + "' is not a regular file";
+    } else if (!input.is_open()) {
+        module->error = "Could not open included module '" + path + "'";
+    } else {
+        module->text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        loading_.push_back(canonical);
+        parse_into(module->text, module->context);
+        loading_.pop_back();
+        module->error = first_error(path, module->context.diagnostics);
+        if (module->context.program) {
+            uint32_t origin = Statement::next_origin();
+            for (SectionStatement* section : module->context.program->get_sections()) {
+                set_module_origin(section, origin);
+            }
+        }
+    }
+
+    Module* loaded = module.get();
+    modules_.emplace(canonical, std::move(module));
+    return {loaded->error.empty() ? loaded : nullptr, loaded->error};
+}
+
+size_t ModuleCache::size() const {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return modules_.size();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "parse_driver.hpp"
+
+/**
+ * @class ModuleCache
+ * @brief Parse every included DSL module once per process and share the result
+ *
+ * A device file includes a module with
+ *
+ *   include "common/firewall_base.dsl"
+ *
+ * The module is parsed the first time any input includes it and kept until
+ * the process exits. Every later include of the same file, from the same or
+ * another input of a batch, borrows the sections and templates of that one
+ * parse instead of reading the file again: the includer's program points at
+ * the module's sections without owning them, and sections the includer
+ * overrides are merged into a new section that borrows the statements it does
+ * not replace. The statements of a module get an origin of their own while it
+ * is loaded, and loaded modules are never changed afterwards.
+ */
+class ModuleCache {
+public:
+    struct Module {
+        std::string path;        // Canonical path of the file
+        std::string text;        // Source text; the module's AST may refer into it
+        ParseContext context;    // Program and templates of the module
+        std::string error;       // Why the module cannot be included, empty if it can
+    };
+
+    ModuleCache() = default;
+    ~ModuleCache();
+
+    ModuleCache(const ModuleCache&) = delete;
+    ModuleCache& operator=(const ModuleCache&) = delete;
+
+    /**
+     * @brief The cache shared by all parses of this process
+     */
+    static ModuleCache& shared();
+
+    /**
+     * @brief Parse a module on first use and return the cached result after that
+     *
+     * Paths naming the same file share one entry. A module that cannot be read,
+     * is not a regular file, has errors or includes itself is remembered as
+     * failed, so it is not parsed again either.
+     *
+     * @param path Path of the module, relative to the working directory
+     * @return The module and an empty string, or nullptr and an error message
+     */
+    std::tuple<const Module*, std::string> load(const std::string& path);
+
+    // Number of modules loaded so far, including failed ones
+    size_t size() const;
+
+private:
+    // Modules include other modules while holding the lock
+    mutable std::recursive_mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Module>> modules_;
+    std::vector<std::string> loading_;    // Modules being parsed, outermost first
+};
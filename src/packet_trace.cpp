@@ -0,0 +1,440 @@
+#include "packet_trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "ipv4_prefix.hpp"
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NANOSECONDS = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+
+// pcapng block types
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr uint32_t PCAPNG_SIMPLE_PACKET = 3;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 6;
+constexpr uint16_t PCAPNG_OPTION_IF_NAME = 2;
+
+// Link types
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr uint32_t LINKTYPE_RAW = 101;
+constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+constexpr uint32_t LINKTYPE_IPV4 = 228;
+constexpr uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+
+constexpr uint8_t PROTOCOL_TCP = 6;
+constexpr uint8_t PROTOCOL_UDP = 17;
+
+struct ProtocolName {
+    std::string_view name;
+    uint8_t number;
+};
+
+// Protocol names RouterOS accepts for the protocol matcher
+constexpr ProtocolName PROTOCOL_NAMES[] = {
+    {"icmp", 1}, {"igmp", 2}, {"ggp", 3}, {"ip-encap", 4}, {"st", 5}, {"tcp", 6}, {"egp", 8},
+    {"pup", 12}, {"udp", 17}, {"hmp", 20}, {"xns-idp", 22}, {"rdp", 27}, {"dccp", 33},
+    {"ipv6-encap", 41}, {"ipv6-route", 43}, {"ipv6-frag", 44}, {"rsvp", 46}, {"gre", 47},
+    {"ipsec-esp", 50}, {"ipsec-ah", 51}, {"icmpv6", 58}, {"ipv6-nonxt", 59}, {"ipv6-opts", 60},
+    {"vmtp", 81}, {"ospf", 89}, {"etherip", 97}, {"encap", 98}, {"pim", 103}, {"vrrp", 112},
+    {"l2tp", 115}, {"sctp", 132}, {"udp-lite", 136},
+};
+
+constexpr std::string_view STATE_NAMES[] = {"new", "established", "related", "invalid", "untracked"};
+
+enum Column {
+    SRC_ADDRESS,
+    DST_ADDRESS,
+    PROTOCOL,
+    SRC_PORT,
+    DST_PORT,
+    IN_INTERFACE,
+    OUT_INTERFACE,
+    CONNECTION_STATE,
+    COLUMN_COUNT
+};
+
+// Column names, with the dash spelling and short forms accepted too
+constexpr std::pair<std::string_view, Column> COLUMN_NAMES[] = {
+    {"src_address", SRC_ADDRESS}, {"src-address", SRC_ADDRESS}, {"src", SRC_ADDRESS},
+    {"dst_address", DST_ADDRESS}, {"dst-address", DST_ADDRESS}, {"dst", DST_ADDRESS},
+    {"protocol", PROTOCOL},
+    {"src_port", SRC_PORT}, {"src-port", SRC_PORT},
+    {"dst_port", DST_PORT}, {"dst-port", DST_PORT},
+    {"in_interface", IN_INTERFACE}, {"in-interface", IN_INTERFACE},
+    {"out_interface", OUT_INTERFACE}, {"out-interface", OUT_INTERFACE},
+    {"connection_state", CONNECTION_STATE}, {"connection-state", CONNECTION_STATE}, {"state", CONNECTION_STATE},
+};
+
+std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        text = text.substr(1, text.size() - 2);
+    }
+    return text;
+}
+
+bool parse_port(std::string_view text, uint16_t& port) noexcept {
+    if (text.empty() || text.size() > 5) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (value > 65535) {
+        return false;
+    }
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+uint16_t load16(const uint8_t* data, bool swap) noexcept {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return swap ? static_cast<uint16_t>((value >> 8) | (value << 8)) : value;
+}
+
+uint32_t load32(const uint8_t* data, bool swap) noexcept {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return swap ? __builtin_bswap32(value) : value;
+}
+
+// Network byte order fields of the frames themselves
+uint16_t network16(const uint8_t* data) noexcept {
+    return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t network32(const uint8_t* data) noexcept {
+    return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 |
+           static_cast<uint32_t>(data[2]) << 8 | data[3];
+}
+
+bool read_bytes(std::istream& input, void* data, size_t length) {
+    input.read(static_cast<char*>(data), static_cast<std::streamsize>(length));
+    return static_cast<size_t>(input.gcount()) == length;
+}
+
+} // namespace
+
+PacketTrace::PacketTrace()
+    : interfaces_{""}
+{
+}
+
+int PacketTrace::protocol_number(std::string_view name) noexcept {
+    for (const ProtocolName& protocol : PROTOCOL_NAMES) {
+        if (protocol.name == name) {
+            return protocol.number;
+        }
+    }
+    uint16_t number = 0;
+    return parse_port(name, number) && number <= 255 ? number : -1;
+}
+
+PacketTrace::State PacketTrace::state_for(std::string_view name) noexcept {
+    for (size_t i = 0; i < std::size(STATE_NAMES); i++) {
+        if (STATE_NAMES[i] == name) {
+            return static_cast<State>(i);
+        }
+    }
+    return State::TRACK;
+}
+
+std::tuple<bool, std::string> PacketTrace::load(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return {false, "Could not open " + path};
+    }
+    uint8_t magic[4] = {};
+    input.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    size_t read = static_cast<size_t>(input.gcount());
+    input.clear();
+    input.seekg(0);
+
+    uint32_t native = load32(magic, false);
+    uint32_t swapped = load32(magic, true);
+    if (read == sizeof(magic) && native == PCAPNG_SECTION_HEADER) {
+        return loadPcapng(input, path);
+    }
+    if (read == sizeof(magic) && (native == PCAP_MAGIC || native == PCAP_MAGIC_NANOSECONDS ||
+                                  swapped == PCAP_MAGIC || swapped == PCAP_MAGIC_NANOSECONDS)) {
+        return loadPcap(input, path);
+    }
+    return loadCsv(input, path);
+}
+
+std::tuple<bool, std::string> PacketTrace::loadCsv(std::istream& input, const std::string& path) {
+    int columns[COLUMN_COUNT];
+    std::fill(std::begin(columns), std::end(columns), -1);
+    bool header = false;
+    std::vector<std::string_view> fields;
+    std::string line;
+    for (int line_number = 1; std::getline(input, line); line_number++) {
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+        fields.clear();
+        for (size_t start = 0;;) {
+            size_t comma = text.find(',', start);
+            fields.push_back(trim(text.substr(start, comma == std::string_view::npos ? comma : comma - start)));
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+        auto location = [&]() { return path + ":" + std::to_string(line_number) + ": "; };
+
+        if (!header) {
+            for (size_t i = 0; i < fields.size(); i++) {
+                for (const auto& [name, column] : COLUMN_NAMES) {
+                    if (fields[i] == name) {
+                        columns[column] = static_cast<int>(i);
+                    }
+                }
+            }
+            if (columns[SRC_ADDRESS] < 0 || columns[DST_ADDRESS] < 0) {
+                return {false, location() + "the header row must name src_address and dst_address columns"};
+            }
+            header = true;
+            continue;
+        }
+
+        auto field = [&](Column column) {
+            return columns[column] >= 0 && static_cast<size_t>(columns[column]) < fields.size()
+                       ? fields[columns[column]] : std::string_view();
+        };
+        Packet packet{};
+        packet.state = State::TRACK;
+        if (!parse_ipv4_address(field(SRC_ADDRESS), packet.src_address)) {
+            return {false, location() + "invalid source address '" + std::string(field(SRC_ADDRESS)) + "'"};
+        }
+        if (!parse_ipv4_address(field(DST_ADDRESS), packet.dst_address)) {
+            return {false, location() + "invalid destination address '" + std::string(field(DST_ADDRESS)) + "'"};
+        }
+        if (!field(PROTOCOL).empty()) {
+            int protocol = protocol_number(field(PROTOCOL));
+            if (protocol < 0) {
+                return {false, location() + "unknown protocol '" + std::string(field(PROTOCOL)) + "'"};
+            }
+            packet.protocol = static_cast<uint8_t>(protocol);
+        }
+        if ((!field(SRC_PORT).empty() && !parse_port(field(SRC_PORT), packet.src_port)) ||
+            (!field(DST_PORT).empty() && !parse_port(field(DST_PORT), packet.dst_port))) {
+            return {false, location() + "invalid port"};
+        }
+        if (!field(CONNECTION_STATE).empty()) {
+            packet.state = state_for(field(CONNECTION_STATE));
+            if (packet.state == State::TRACK) {
+                return {false, location() + "unknown connection state '" + std::string(field(CONNECTION_STATE)) + "'"};
+            }
+        }
+        packet.in_interface = intern(field(IN_INTERFACE));
+        packet.out_interface = intern(field(OUT_INTERFACE));
+        packets_.push_back(packet);
+    }
+    if (!header) {
+        return {false, path + ": empty trace"};
+    }
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> PacketTrace::loadPcap(std::istream& input, const std::string& path) {
+    uint8_t header[24];
+    if (!read_bytes(input, header, sizeof(header))) {
+        return {false, path + ": truncated pcap header"};
+    }
+    uint32_t magic = load32(header, false);
+    bool swap = magic != PCAP_MAGIC && magic != PCAP_MAGIC_NANOSECONDS;
+    uint32_t link_type = load32(header + 20, swap) & 0x0fffffff;
+
+    std::vector<uint8_t> frame;
+    uint8_t record[16];
+    for (size_t index = 0; read_bytes(input, record, sizeof(record)); index++) {
+        uint32_t captured = load32(record + 8, swap);
+        if (captured > MAX_FRAME_SIZE) {
+            return {false, path + ": packet " + std::to_string(index + 1) + " claims " + std::to_string(captured) +
+                           " captured bytes; the capture is corrupt"};
+        }
+        frame.resize(captured);
+        if (!read_bytes(input, frame.data(), captured)) {
+            return {false, path + ": packet " + std::to_string(index + 1) + " is truncated"};
+        }
+        addFrame(link_type, frame.data(), captured, 0);
+    }
+    if (input.gcount() > 0) {
+        return {false, path + ": the last packet record is truncated"};
+    }
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> PacketTrace::loadPcapng(std::istream& input, const std::string& path) {
+    struct Interface {
+        uint32_t link_type;
+        uint32_t snap_length;
+        uint16_t name;
+    };
+    std::vector<Interface> interfaces;
+    std::vector<uint8_t> block;
+    bool swap = false;
+    uint8_t head[8];
+    for (size_t index = 0; read_bytes(input, head, sizeof(head)); index++) {
+        uint32_t type = load32(head, false);
+        if (type == PCAPNG_SECTION_HEADER) {
+            // Every section starts over with its own byte order and interfaces
+            uint8_t order[4];
+            if (!read_bytes(input, order, sizeof(order))) {
+                break;
+            }
+            swap = load32(order, false) != PCAPNG_BYTE_ORDER_MAGIC;
+            if (load32(order, swap) != PCAPNG_BYTE_ORDER_MAGIC) {
+                return {false, path + ": bad pcapng byte-order magic"};
+            }
+            interfaces.clear();
+            uint32_t length = load32(head + 4, swap);
+            if (length < 16 || length % 4 != 0 || length > MAX_FRAME_SIZE) {
+                return {false, path + ": bad pcapng section header length"};
+            }
+            block.resize(length - 12);
+            if (!read_bytes(input, block.data(), block.size())) {
+                return {false, path + ": truncated pcapng section header"};
+            }
+            continue;
+        }
+        type = load32(head, swap);
+        uint32_t length = load32(head + 4, swap);
+        if (length < 12 || length % 4 != 0 || length > MAX_FRAME_SIZE + 64) {
+            return {false, path + ": block " + std::to_string(index + 1) + " has a bad length; the capture is corrupt"};
+        }
+        // Body and trailing length
+        block.resize(length - 8);
+        if (!read_bytes(input, block.data(), block.size())) {
+            return {false, path + ": block " + std::to_string(index + 1) + " is truncated"};
+        }
+        const uint8_t* body = block.data();
+        size_t body_length = block.size() - 4;
+
+        if (type == PCAPNG_INTERFACE_DESCRIPTION && body_length >= 8) {
+            Interface interface{load16(body, swap), load32(body + 4, swap), 0};
+            for (size_t option = 8; option + 4 <= body_length;) {
+                uint16_t code = load16(body + option, swap);
+                uint16_t option_length = load16(body + option + 2, swap);
+                if (code == 0 || option + 4 + option_length > body_length) {
+                    break;
+                }
+                if (code == PCAPNG_OPTION_IF_NAME) {
+                    std::string_view name(reinterpret_cast<const char*>(body + option + 4), option_length);
+                    interface.name = intern(name.substr(0, name.find('\0')));
+                }
+                option += 4 + ((option_length + 3u) & ~3u);
+            }
+            interfaces.push_back(interface);
+        } else if (type == PCAPNG_ENHANCED_PACKET && body_length >= 20) {
+            uint32_t id = load32(body, swap);
+            uint32_t captured = load32(body + 12, swap);
+            if (id >= interfaces.size() || captured > body_length - 20) {
+                return {false, path + ": block " + std::to_string(index + 1) + " refers to a missing interface "
+                               "or overruns its block"};
+            }
+            addFrame(interfaces[id].link_type, body + 20, captured, interfaces[id].name);
+        } else if (type == PCAPNG_SIMPLE_PACKET && body_length >= 4 && !interfaces.empty()) {
+            uint32_t captured = load32(body, swap);
+            if (interfaces[0].snap_length > 0 && captured > interfaces[0].snap_length) {
+                captured = interfaces[0].snap_length;
+            }
+            if (captured > body_length - 4) {
+                captured = static_cast<uint32_t>(body_length - 4);
+            }
+            addFrame(interfaces[0].link_type, body + 4, captured, interfaces[0].name);
+        }
+    }
+    if (input.gcount() > 0) {
+        return {false, path + ": the last block is truncated"};
+    }
+    return {true, ""};
+}
+
+void PacketTrace::addFrame(uint32_t link_type, const uint8_t* data, size_t length, uint16_t interface) {
+    // Find the IPv4 header behind the link layer
+    size_t offset = 0;
+    uint16_t ethertype = 0;
+    switch (link_type) {
+        case LINKTYPE_ETHERNET:
+            offset = 14;
+            if (length >= offset) {
+                ethertype = network16(data + 12);
+                while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) && length >= offset + 4) {
+                    ethertype = network16(data + offset + 2);
+                    offset += 4;
+                }
+            }
+            break;
+        case LINKTYPE_LINUX_SLL:
+            offset = 16;
+            ethertype = length >= offset ? network16(data + 14) : 0;
+            break;
+        case LINKTYPE_LINUX_SLL2:
+            offset = 20;
+            ethertype = length >= offset ? network16(data) : 0;
+            break;
+        case LINKTYPE_RAW:
+        case LINKTYPE_IPV4:
+            ethertype = ETHERTYPE_IPV4;
+            break;
+        default:
+            break;
+    }
+    if (ethertype != ETHERTYPE_IPV4 || length < offset + 20 || (data[offset] >> 4) != 4) {
+        skipped_++;
+        return;
+    }
+
+    const uint8_t* ip = data + offset;
+    size_t header_length = (ip[0] & 0x0f) * 4u;
+    Packet packet{};
+    packet.protocol = ip[9];
+    packet.src_address = network32(ip + 12);
+    packet.dst_address = network32(ip + 16);
+    packet.state = State::TRACK;
+    packet.in_interface = interface;
+    // Only the first fragment carries the ports
+    bool first_fragment = (network16(ip + 6) & 0x1fff) == 0;
+    if ((packet.protocol == PROTOCOL_TCP || packet.protocol == PROTOCOL_UDP) && first_fragment &&
+        header_length >= 20 && length >= offset + header_length + 4) {
+        packet.src_port = network16(ip + header_length);
+        packet.dst_port = network16(ip + header_length + 2);
+    }
+    packets_.push_back(packet);
+}
+
+uint16_t PacketTrace::intern(std::string_view name) {
+    auto found = interface_ids_.find(std::string(name));
+    if (found != interface_ids_.end()) {
+        return found->second;
+    }
+    // Names past the id space are treated like no interface
+    if (name.empty() || interfaces_.size() > UINT16_MAX) {
+        return 0;
+    }
+    auto [it, added] = interface_ids_.try_emplace(std::string(name), static_cast<uint16_t>(interfaces_.size()));
+    if (added) {
+        interfaces_.emplace_back(name);
+    }
+    return it->second;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class PacketTrace
+ * @brief IPv4 packet headers read from a CSV trace or a packet capture
+ *
+ * A CSV trace starts with a header row naming its columns, in any order:
+ * src_address and dst_address are required; protocol, src_port, dst_port,
+ * in_interface, out_interface and connection_state are optional, and other
+ * columns are ignored. Rows without a connection state leave it to the
+ * simulator to track connections.
+ *
+ * Captures may be classic pcap files, in either byte order and with micro-
+ * or nanosecond timestamps, or pcapng files, whose interface names become
+ * the in-interface of the packets captured on them. Ethernet (with VLAN
+ * tags), Linux cooked and raw IP link types are decoded; frames that do not
+ * carry IPv4 are counted and skipped. Only the headers are kept, so a trace
+ * of millions of packets takes a few dozen bytes per packet.
+ */
+class PacketTrace {
+public:
+    enum class State : uint8_t {
+        NEW,
+        ESTABLISHED,
+        RELATED,
+        INVALID,
+        UNTRACKED,
+        TRACK      // Not given by the trace; found by tracking connections
+    };
+
+    struct Packet {
+        uint32_t src_address;     // Host byte order
+        uint32_t dst_address;
+        uint16_t src_port;        // 0 unless TCP or UDP
+        uint16_t dst_port;
+        uint8_t protocol;
+        State state;
+        uint16_t in_interface;    // Index into interfaces(); 0 is none
+        uint16_t out_interface;
+    };
+
+    // Largest captured frame accepted, to reject corrupt capture files early
+    static constexpr uint32_t MAX_FRAME_SIZE = 256 * 1024;
+
+    PacketTrace();
+
+    /**
+     * @brief Read a trace, telling captures from CSV by their first bytes
+     * @param path The trace file
+     * @return Success flag and error message, located at the offending line for CSV
+     */
+    std::tuple<bool, std::string> load(const std::string& path);
+
+    const std::vector<Packet>& packets() const noexcept { return packets_; }
+
+    // Interface names the packets refer to; the first is the empty name
+    const std::vector<std::string>& interfaces() const noexcept { return interfaces_; }
+
+    // Frames that were not IPv4
+    size_t skipped() const noexcept { return skipped_; }
+
+    // Protocol number for a name such as "tcp" or a number, or -1
+    static int protocol_number(std::string_view name) noexcept;
+
+    // Connection state for a name such as "established", or TRACK if unknown
+    static State state_for(std::string_view name) noexcept;
+
+private:
+    std::tuple<bool, std::string> loadCsv(std::istream& input, const std::string& path);
+    std::tuple<bool, std::string> loadPcap(std::istream& input, const std::string& path);
+    std::tuple<bool, std::string> loadPcapng(std::istream& input, const std::string& path);
+
+    // Decode one frame of a link type and add its packet
+    void addFrame(uint32_t link_type, const uint8_t* data, size_t length, uint16_t interface);
+    uint16_t intern(std::string_view name);
+
+    std::vector<Packet> packets_;
+    std::vector<std::string> interfaces_;
+    std::unordered_map<std::string, uint16_t> interface_ids_;
+    size_t skipped_ = 0;
+};
@@ -0,0 +1,301 @@
+#include "parse_driver.hpp"
+#include "line_scanner.hpp"
+#include "module_cache.hpp"
+#include "section_factory.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <future>
+#include <unordered_map>
+
+namespace {
+
+// Chunks smaller than this are not worth a task of their own
+constexpr size_t MIN_PARALLEL_CHUNK = 64 * 1024;
+
+// Aim for a few chunks per thread so uneven sections still balance
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+struct ChunkResult {
+    ProgramDeclaration* program = nullptr;
+    Diagnostics diagnostics;
+};
+
+void delete_program(ProgramDeclaration* program) {
+    if (program) {
+        program->destroy();
+        delete program;
+    }
+}
+
+// Whether a top-level line starts a template definition or an include, which
+// later sections depend on
+bool needs_whole_input(std::string_view text) {
+    auto starts_construct = [text](size_t offset) {
+        std::string_view line = text.substr(offset);
+        return line.substr(0, 9) == "template " || line.substr(0, 8) == "include ";
+    };
+    if (starts_construct(0)) {
+        return true;
+    }
+    for (size_t line = text.find('\n'); line != std::string_view::npos; line = text.find('\n', line + 1)) {
+        if (starts_construct(line + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Build the section an input gets by overriding an included one: properties
+// it sets replace the included ones in place, subsections of the same name
+// are merged the same way and everything new is appended. Included statements
+// are borrowed, not copied; the input's section is consumed.
+SectionStatement* overlay_section(const SectionStatement* included, SectionStatement* local)
+{
+    StatementList own = local->get_block() ? local->get_block()->release_statements() : StatementList();
+    std::unordered_map<std::string_view, size_t> own_properties;
+    std::unordered_map<std::string_view, size_t> own_sections;
+    for (size_t i = own.size(); i-- > 0;) {
+        if (const auto* prop = dynamic_cast<const PropertyStatement*>(own[i])) {
+            own_properties[prop->get_name()] = i;
+        } else if (const auto* section = dynamic_cast<const SectionStatement*>(own[i])) {
+            own_sections[section->get_name()] = i;
+        }
+    }
+
+    std::vector<bool> used(own.size(), false);
+    BlockStatement* block = new BlockStatement();
+    if (included->get_block()) {
+        for (Statement* statement : included->get_block()->get_statements()) {
+            if (const auto* prop = dynamic_cast<const PropertyStatement*>(statement)) {
+                auto it = own_properties.find(prop->get_name());
+                if (it != own_properties.end() && !used[it->second]) {
+                    used[it->second] = true;
+                    block->add_statement(own[it->second]);
+                    continue;
+                }
+            } else if (const auto* section = dynamic_cast<const SectionStatement*>(statement)) {
+                auto it = own_sections.find(section->get_name());
+                if (it != own_sections.end() && !used[it->second]) {
+                    used[it->second] = true;
+                    block->add_statement(overlay_section(section, static_cast<SectionStatement*>(own[it->second])));
+                    continue;
+                }
+            }
+            block->add_shared_statement(statement);
+        }
+    }
+    for (size_t i = 0; i < own.size(); i++) {
+        if (!used[i]) {
+            block->add_statement(own[i]);
+        }
+    }
+
+    SectionStatement* merged = SectionFactory::create_section(local->get_name(), local->get_section_type(), block);
+    merged->set_location(local->get_line(), local->get_column());
+    merged->set_origin(local->get_origin());
+    local->destroy();
+    delete local;
+    return merged;
+}
+
+} // namespace
+
+void ParseContext::add_section(SectionStatement* section)
+{
+    if (!section) {
+        return;
+    }
+    if (has_parameters) {
+        TemplateExpander::check_bound(section, diagnostics);
+    }
+
+    // The last included section of the same name is the one this section overrides
+    auto overridden = pending_includes_.end();
+    for (auto it = pending_includes_.begin(); it != pending_includes_.end(); ++it) {
+        if ((*it)->get_name() == section->get_name()) {
+            overridden = it;
+        }
+    }
+    if (overridden != pending_includes_.end()) {
+        for (auto it = pending_includes_.begin(); it != overridden; ++it) {
+            if ((*it)->get_name() == section->get_name()) {
+                addShared(*it);
+            }
+        }
+        section = overlay_section(*overridden, section);
+        std::string_view name = section->get_name();
+        pending_includes_.erase(std::remove_if(pending_includes_.begin(), overridden + 1,
+                                               [name](const SectionStatement* pending) {
+                                                   return pending->get_name() == name;
+                                               }),
+                                overridden + 1);
+    }
+
+    program->add_section(section);
+    if (on_section) {
+        on_section(section);
+        program->destroy();
+    }
+}
+
+void ParseContext::include(std::string_view path, int line, int column)
+{
+    if (!program) {
+        program = new ProgramDeclaration();
+    }
+    std::string resolved(path);
+    if (!directory.empty() && path.substr(0, 1) != "/") {
+        resolved = directory + "/" + resolved;
+    }
+
+    auto [module, error] = ModuleCache::shared().load(resolved);
+    if (!module) {
+        diagnostics.report(Diagnostics::Severity::ERROR, line, column, error);
+        return;
+    }
+    templates.import(module->context.templates);
+    if (!module->context.program) {
+        return;
+    }
+    for (SectionStatement* section : module->context.program->get_sections()) {
+        if (overriddenAfter(section->get_name(), line)) {
+            pending_includes_.push_back(section);
+        } else {
+            addShared(section);
+        }
+    }
+}
+
+void ParseContext::finish()
+{
+    // Overriding sections that never arrived, e.g. after a syntax error
+    for (SectionStatement* section : pending_includes_) {
+        addShared(section);
+    }
+    pending_includes_.clear();
+}
+
+void ParseContext::addShared(SectionStatement* section)
+{
+    program->add_shared_section(section);
+    if (on_section) {
+        on_section(section);
+        program->destroy();
+    }
+}
+
+bool ParseContext::overriddenAfter(std::string_view name, int line)
+{
+    if (!names_scanned_) {
+        // Top-level sections start in column 0 with their name and a colon
+        LineTable lines = LineTable::build(text);
+        for (size_t index = 0; index < lines.size(); index++) {
+            const LineInfo& info = lines[index];
+            if (info.blank || info.indent != 0) {
+                continue;
+            }
+            size_t end = info.offset;
+            while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_')) {
+                end++;
+            }
+            if (end > info.offset && end < text.size() && text[end] == ':') {
+                top_level_names_.emplace_back(first_line + static_cast<int>(index),
+                                              text.substr(info.offset, end - info.offset));
+            }
+        }
+        names_scanned_ = true;
+    }
+    for (const auto& [section_line, section_name] : top_level_names_) {
+        if (section_line > line && section_name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<SourceChunk> split_top_level_sections(std::string_view text, size_t min_chunk_size)
+{
+    std::vector<SourceChunk> chunks;
+    if (text.empty()) {
+        return chunks;
+    }
+
+    LineTable lines = LineTable::build(text);
+    SourceChunk current{0, 0, 1};
+    size_t quotes_before = 0;   // Quotes between the chunk start and scanned_to
+    size_t scanned_to = 0;
+
+    for (size_t index = 1; index < lines.size(); index++) {
+        const LineInfo& line = lines[index];
+        if (line.blank || line.indent != 0 || line.offset - current.offset < min_chunk_size) {
+            continue;
+        }
+
+        // An odd number of quotes means the line is inside a string
+        quotes_before += std::count(text.begin() + scanned_to, text.begin() + line.offset, '"');
+        scanned_to = line.offset;
+        if (quotes_before % 2 != 0) {
+            continue;
+        }
+
+        current.length = line.offset - current.offset;
+        chunks.push_back(current);
+        current = {line.offset, 0, static_cast<int>(index) + 1};
+        quotes_before = 0;
+    }
+
+    current.length = text.size() - current.offset;
+    chunks.push_back(current);
+    return chunks;
+}
+
+ProgramDeclaration* parse_text_parallel(std::string_view text, ThreadPool& pool, Diagnostics& diagnostics,
+                                        std::string_view directory)
+{
+    size_t min_chunk_size = std::max(MIN_PARALLEL_CHUNK, text.size() / (pool.size() * CHUNKS_PER_THREAD));
+    std::vector<SourceChunk> chunks = split_top_level_sections(text, min_chunk_size);
+    if (chunks.size() <= 1 || needs_whole_input(text)) {
+        return parse_text(text, 1, diagnostics, directory);
+    }
+
+    std::vector<std::future<ChunkResult>> pending;
+    pending.reserve(chunks.size());
+    for (const SourceChunk& chunk : chunks) {
+        pending.push_back(pool.submit([text, chunk] {
+            ChunkResult result;
+            result.program = parse_text(text.substr(chunk.offset, chunk.length), chunk.first_line,
+                                        result.diagnostics);
+            return result;
+        }));
+    }
+
+    std::vector<ChunkResult> results;
+    results.reserve(pending.size());
+    bool clean = true;
+    for (auto& future : pending) {
+        results.push_back(future.get());
+        clean = clean && results.back().program && !results.back().diagnostics.has_errors();
+    }
+
+    if (!clean) {
+        // Error recovery depends on what came before, so report errors as a single parse would
+        for (ChunkResult& result : results) {
+            delete_program(result.program);
+        }
+        return parse_text(text, 1, diagnostics, directory);
+    }
+
+    // Stitch the sections together in source order
+    ProgramDeclaration* program = results.front().program;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (i > 0) {
+            for (SectionStatement* section : results[i].program->release_sections()) {
+                program->add_section(section);
+            }
+            delete results[i].program;
+        }
+        diagnostics.merge(std::move(results[i].diagnostics));
+    }
+    return program;
+}
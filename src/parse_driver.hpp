@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "declaration.hpp"
+#include "diagnostics.hpp"
+#include "template_expander.hpp"
+
+class ThreadPool;
+
+// Receives each top-level section as soon as the parser has reduced it
+using SectionHandler = std::function<void(SectionStatement*)>;
+
+// Result of one parser instance; the grammar actions build into it
+struct ParseContext
+{
+    ProgramDeclaration* program = nullptr;
+    Diagnostics diagnostics;
+    SectionHandler on_section;       // When set, sections are handed over and freed instead of kept
+    TemplateExpander templates;      // Templates defined so far, in source order
+    bool has_parameters = false;     // A parameter was parsed, so sections must be checked for unbound ones
+    std::string directory;           // Included paths are relative to this; empty for the working directory
+    std::string_view text;           // The input being parsed
+    int first_line = 1;
+
+    // Called by the grammar for every parsed top-level section
+    void add_section(SectionStatement* section);
+
+    // Called by the grammar for `include "path"`; adds the module's sections
+    void include(std::string_view path, int line, int column);
+
+    // Called once the whole input is parsed
+    void finish();
+
+private:
+    void addShared(SectionStatement* section);
+    bool overriddenAfter(std::string_view name, int line);
+
+    // Included sections held back because a later section of the input has the same name
+    std::vector<SectionStatement*> pending_includes_;
+    // Line and name of every top-level section of the input, found on the first include
+    std::vector<std::pair<int, std::string_view>> top_level_names_;
+    bool names_scanned_ = false;
+};
+
+/**
+ * @brief Parse DSL text into a context the caller keeps
+ *
+ * Used for included modules, whose program and templates outlive the parse.
+ * Included paths are resolved against context.directory.
+ */
+void parse_into(std::string_view text, ParseContext& context);
+
+// A run of whole top-level sections within an input
+struct SourceChunk
+{
+    size_t offset;
+    size_t length;
+    int first_line;
+};
+
+/**
+ * @brief Parse DSL text with a fresh reentrant scanner and parser
+ * @param text The text to parse
+ * @param first_line Line number of the first line of text, for diagnostics
+ * @param diagnostics Sink receiving the syntax errors
+ * @param directory Directory included paths are relative to
+ * @return The parsed program, or nullptr if nothing could be parsed
+ */
+ProgramDeclaration* parse_text(std::string_view text, int first_line, Diagnostics& diagnostics,
+                               std::string_view directory = {});
+
+/**
+ * @brief Parse DSL text one top-level section at a time
+ *
+ * Each section is passed to on_section right after it is parsed, with its
+ * subsections' parents set as in a full program, and freed when the handler
+ * returns, so at most one section's AST is alive at a time.
+ *
+ * @param text The text to parse
+ * @param diagnostics Sink receiving the syntax errors
+ * @param on_section Handler called once per section, in source order
+ * @param directory Directory included paths are relative to
+ */
+void parse_text_streaming(std::string_view text, Diagnostics& diagnostics, const SectionHandler& on_section,
+                          std::string_view directory = {});
+
+/**
+ * @brief Split an input into chunks of whole top-level sections
+ *
+ * A chunk may only start at a line in column 0 outside any string. Sections
+ * are grouped so that no chunk is much smaller than min_chunk_size bytes.
+ */
+std::vector<SourceChunk> split_top_level_sections(std::string_view text, size_t min_chunk_size);
+
+/**
+ * @brief Parse the top-level sections of an input in parallel
+ *
+ * Each chunk is parsed by its own parser on the pool and the sections are
+ * stitched together in source order. If any chunk has a syntax error the
+ * input is parsed again as a whole, so diagnostics match a sequential parse.
+ * Inputs that define templates or include modules are parsed as a whole too,
+ * since a template can be used and an included section overridden in any
+ * later chunk.
+ */
+ProgramDeclaration* parse_text_parallel(std::string_view text, ThreadPool& pool, Diagnostics& diagnostics,
+                                        std::string_view directory = {});
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Compile-time perfect hash tables over string keys (hash-and-displace).
+// Keys are spread over buckets by a first hash; each bucket then gets the
+// smallest displacement seed that sends all of its keys to free slots. The
+// search runs during constant evaluation, so a lookup at run time is two
+// hashes of the key and a single slot probe with one string comparison.
+
+constexpr uint32_t perfect_hash_fnv1a(std::string_view key, uint32_t seed) noexcept
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char c : key) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Entry is any literal type with a std::string_view member called `name`
+template <typename Entry, size_t N, size_t Buckets, size_t Slots>
+struct PerfectHashTable
+{
+    static_assert(Slots >= N, "a perfect hash table needs at least one slot per key");
+    static_assert((Slots & (Slots - 1)) == 0, "slot count must be a power of two");
+
+    std::array<Entry, N> entries{};
+    std::array<uint32_t, Buckets> displacement{};
+    std::array<int16_t, Slots> slots{};
+    bool complete = false; // false if keys are duplicated or no displacement was found
+
+    // Position of the key in entries, or -1. Constant evaluation can test
+    // an index where some compilers refuse to compare an element pointer.
+    constexpr int index_of(std::string_view key) const noexcept
+    {
+        uint32_t bucket = perfect_hash_fnv1a(key, 0) % Buckets;
+        uint32_t slot = perfect_hash_fnv1a(key, displacement[bucket]) & (Slots - 1);
+        int16_t index = slots[slot];
+        return (index >= 0 && entries[index].name == key) ? index : -1;
+    }
+
+    constexpr const Entry* find(std::string_view key) const noexcept
+    {
+        int index = index_of(key);
+        return index >= 0 ? &entries[index] : nullptr;
+    }
+
+    constexpr size_t size() const noexcept { return N; }
+};
+
+template <size_t Buckets, size_t Slots, typename Entry, size_t N>
+constexpr PerfectHashTable<Entry, N, Buckets, Slots> make_perfect_hash(const Entry (&entries)[N])
+{
+    constexpr uint32_t MAX_DISPLACEMENT = 4096;
+
+    PerfectHashTable<Entry, N, Buckets, Slots> table{};
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (entries[i].name == entries[j].name) {
+                return table;
+            }
+        }
+        table.entries[i] = entries[i];
+    }
+    for (size_t slot = 0; slot < Slots; slot++) {
+        table.slots[slot] = -1;
+    }
+
+    std::array<size_t, N> bucket_of{};
+    std::array<size_t, Buckets> bucket_size{};
+    for (size_t i = 0; i < N; i++) {
+        bucket_of[i] = perfect_hash_fnv1a(entries[i].name, 0) % Buckets;
+        bucket_size[bucket_of[i]]++;
+    }
+
+    // Place the largest buckets first while the table is still empty
+    std::array<size_t, Buckets> order{};
+    for (size_t b = 0; b < Buckets; b++) {
+        order[b] = b;
+    }
+    for (size_t i = 1; i < Buckets; i++) {
+        for (size_t j = i; j > 0 && bucket_size[order[j]] > bucket_size[order[j - 1]]; j--) {
+            size_t swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    for (size_t k = 0; k < Buckets && bucket_size[order[k]] > 0; k++) {
+        size_t bucket = order[k];
+        bool placed = false;
+        for (uint32_t seed = 1; seed < MAX_DISPLACEMENT && !placed; seed++) {
+            std::array<bool, Slots> claimed{};
+            bool fits = true;
+            for (size_t i = 0; i < N && fits; i++) {
+                if (bucket_of[i] != bucket) {
+                    continue;
+                }
+                uint32_t slot = perfect_hash_fnv1a(entries[i].name, seed) & (Slots - 1);
+                fits = table.slots[slot] < 0 && !claimed[slot];
+                claimed[slot] = true;
+            }
+            if (!fits) {
+                continue;
+            }
+
+            for (size_t i = 0; i < N; i++) {
+                if (bucket_of[i] == bucket) {
+                    table.slots[perfect_hash_fnv1a(entries[i].name, seed) & (Slots - 1)] = static_cast<int16_t>(i);
+                }
+            }
+            table.displacement[bucket] = seed;
+            placed = true;
+        }
+        if (!placed) {
+            return table;
+        }
+    }
+
+    table.complete = true;
+    return table;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ipv4_prefix.hpp"
+
+// Binary trie keyed by IPv4 prefixes, supporting exact and longest-prefix-match lookups.
+// Nodes live in one contiguous vector and are addressed by index, so building a trie
+// from hundreds of thousands of routes costs a handful of reallocations.
+template <typename T>
+class PrefixTrie
+{
+public:
+    PrefixTrie() : nodes(1) {}
+
+    // Return the value stored at the exact prefix, creating a default one if absent
+    T& insert(const IPv4Prefix& prefix)
+    {
+        int node = 0;
+        for (uint8_t depth = 0; depth < prefix.length; depth++) {
+            int bit = (prefix.address >> (31 - depth)) & 1;
+            if (nodes[node].child[bit] < 0) {
+                nodes[node].child[bit] = static_cast<int>(nodes.size());
+                nodes.emplace_back();
+            }
+            node = nodes[node].child[bit];
+        }
+
+        if (nodes[node].value < 0) {
+            nodes[node].value = static_cast<int>(values.size());
+            values.emplace_back();
+            prefixes.push_back(prefix);
+        }
+        return values[nodes[node].value];
+    }
+
+    // Value stored at exactly this prefix, or nullptr
+    const T* find(const IPv4Prefix& prefix) const noexcept
+    {
+        int node = 0;
+        for (uint8_t depth = 0; depth < prefix.length && node >= 0; depth++) {
+            node = nodes[node].child[(prefix.address >> (31 - depth)) & 1];
+        }
+        return (node >= 0 && nodes[node].value >= 0) ? &values[nodes[node].value] : nullptr;
+    }
+
+    // Value of the longest prefix containing the address, or nullptr
+    const T* longest_match(uint32_t address, IPv4Prefix* matched = nullptr) const noexcept
+    {
+        int node = 0;
+        int best = -1;
+        for (int depth = 0; node >= 0; depth++) {
+            if (nodes[node].value >= 0) {
+                best = nodes[node].value;
+            }
+            if (depth == 32) {
+                break;
+            }
+            node = nodes[node].child[(address >> (31 - depth)) & 1];
+        }
+
+        if (best < 0) {
+            return nullptr;
+        }
+        if (matched) {
+            *matched = prefixes[best];
+        }
+        return &values[best];
+    }
+
+    // Whether longer prefixes stored below this one together contain every address in it.
+    // The walk stops at the first stored prefix on each path, so checking every stored
+    // prefix visits each node about once.
+    bool covered_by_longer(const IPv4Prefix& prefix) const noexcept
+    {
+        int node = 0;
+        for (uint8_t depth = 0; depth < prefix.length && node >= 0; depth++) {
+            node = nodes[node].child[(prefix.address >> (31 - depth)) & 1];
+        }
+        return node >= 0 && children_cover(node, prefix.length);
+    }
+
+    // Stored values and their prefixes, in insertion order
+    const std::vector<T>& get_values() const noexcept { return values; }
+    const std::vector<IPv4Prefix>& get_prefixes() const noexcept { return prefixes; }
+    size_t node_count() const noexcept { return nodes.size(); }
+
+private:
+    struct Node
+    {
+        int child[2] = {-1, -1};
+        int value = -1;
+    };
+
+    // Whether both halves of a node are stored or covered in turn
+    bool children_cover(int node, int depth) const noexcept
+    {
+        if (depth == 32) {
+            return false;
+        }
+        for (int child : nodes[node].child) {
+            if (child < 0 || (nodes[child].value < 0 && !children_cover(child, depth + 1))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<Node> nodes;
+    std::vector<T> values;
+    std::vector<IPv4Prefix> prefixes;
+};
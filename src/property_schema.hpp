@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "perfect_hash.hpp"
+
+/**
+ * @class PropertySchema
+ * @brief Compile-time registry of the words the DSL accepts in each context
+ *
+ * Every property name, subsection name and enumerated value known to the
+ * validators is listed once with the contexts it is valid in and the name
+ * RouterOS uses for it. The table is a perfect hash built during constant
+ * evaluation, so checking a word is one hash probe and no validator has to
+ * build its own sets.
+ */
+class PropertySchema {
+public:
+    // Contexts a word is valid in; an entry may belong to several
+    enum Context : uint32_t {
+        DEVICE_PROPERTY           = 1u << 0,
+        INTERFACE_COMMON          = 1u << 1,
+        INTERFACE_VLAN            = 1u << 2,
+        INTERFACE_BONDING         = 1u << 3,
+        INTERFACE_BRIDGE          = 1u << 4,
+        INTERFACE_ETHERNET        = 1u << 5,
+        IP_SUBSECTION             = 1u << 6,
+        IP_DIRECT_PROPERTY        = 1u << 7,
+        IP_INTERFACE_PROPERTY     = 1u << 8,
+        ROUTING_TOP_PROPERTY      = 1u << 9,
+        ROUTE_PROPERTY            = 1u << 10,
+        ROUTING_SUBSECTION        = 1u << 11,
+        FIREWALL_SUBSECTION       = 1u << 12,
+        FIREWALL_RULE_PROPERTY    = 1u << 13,
+        CONNECTION_STATE_PROPERTY = 1u << 14,
+        NAT_PROPERTY              = 1u << 15,
+        FILTER_CHAIN              = 1u << 16,
+        NAT_CHAIN                 = 1u << 17,
+        FILTER_ACTION             = 1u << 18,
+        NAT_ACTION                = 1u << 19,
+        CONNECTION_STATE          = 1u << 20
+    };
+
+    struct Entry {
+        std::string_view name;          // Spelling used in the DSL
+        std::string_view routeros_name; // Spelling used in RouterOS commands
+        uint32_t contexts;
+    };
+
+    /**
+     * @brief Look up a DSL word
+     * @return The schema entry, or nullptr if the word is not known in any context
+     */
+    static constexpr const Entry* find(std::string_view name) noexcept;
+
+    /**
+     * @brief Check whether a word is valid in any of the given contexts
+     * @param contexts Bitwise OR of Context values
+     * @param name The DSL word
+     */
+    static constexpr bool allows(uint32_t contexts, std::string_view name) noexcept;
+
+    /**
+     * @brief RouterOS spelling of a DSL word (e.g. "src_address" -> "src-address")
+     * @return The RouterOS name, or the word itself if it is not in the schema
+     */
+    static constexpr std::string_view routeros_name(std::string_view name) noexcept;
+};
+
+inline constexpr PropertySchema::Entry PROPERTY_SCHEMA_ENTRIES[] = {
+    // Device
+    {"vendor", "vendor", PropertySchema::DEVICE_PROPERTY},
+    {"model", "model", PropertySchema::DEVICE_PROPERTY},
+    {"hostname", "name", PropertySchema::DEVICE_PROPERTY},
+
+    // Interfaces
+    {"type", "type", PropertySchema::INTERFACE_COMMON},
+    {"mtu", "mtu", PropertySchema::INTERFACE_COMMON},
+    {"disabled", "disabled", PropertySchema::INTERFACE_COMMON},
+    {"admin_state", "disabled", PropertySchema::INTERFACE_COMMON},
+    {"mac_address", "mac-address", PropertySchema::INTERFACE_COMMON},
+    {"mac", "mac-address", PropertySchema::INTERFACE_COMMON},
+    {"comment", "comment", PropertySchema::INTERFACE_COMMON | PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"description", "comment", PropertySchema::INTERFACE_COMMON},
+    {"lists", "list", PropertySchema::INTERFACE_COMMON},
+    {"arp", "arp", PropertySchema::INTERFACE_COMMON | PropertySchema::IP_SUBSECTION},
+    {"vlan_id", "vlan-id", PropertySchema::INTERFACE_VLAN},
+    {"interface", "interface", PropertySchema::INTERFACE_VLAN},
+    {"mode", "mode", PropertySchema::INTERFACE_BONDING},
+    {"slaves", "slaves", PropertySchema::INTERFACE_BONDING},
+    {"protocol-mode", "protocol-mode", PropertySchema::INTERFACE_BRIDGE},
+    {"fast-forward", "fast-forward", PropertySchema::INTERFACE_BRIDGE},
+    {"ports", "ports", PropertySchema::INTERFACE_BRIDGE},
+    {"advertise", "advertise", PropertySchema::INTERFACE_ETHERNET},
+    {"auto-negotiation", "auto-negotiation", PropertySchema::INTERFACE_ETHERNET},
+    {"speed", "speed", PropertySchema::INTERFACE_ETHERNET},
+    {"duplex", "full-duplex", PropertySchema::INTERFACE_ETHERNET},
+
+    // IP
+    {"address", "address", PropertySchema::IP_SUBSECTION | PropertySchema::IP_INTERFACE_PROPERTY},
+    {"route", "route", PropertySchema::IP_SUBSECTION},
+    {"firewall", "firewall", PropertySchema::IP_SUBSECTION},
+    {"dhcp-server", "dhcp-server", PropertySchema::IP_SUBSECTION},
+    {"dhcp-client", "dhcp-client", PropertySchema::IP_SUBSECTION},
+    {"dns", "dns", PropertySchema::IP_SUBSECTION},
+    {"service", "service", PropertySchema::IP_SUBSECTION},
+    {"neighbor", "neighbor", PropertySchema::IP_SUBSECTION},
+    {"proxy", "proxy", PropertySchema::IP_SUBSECTION},
+    {"dns-server", "servers", PropertySchema::IP_DIRECT_PROPERTY},
+    {"allow-remote-requests", "allow-remote-requests", PropertySchema::IP_DIRECT_PROPERTY},
+
+    // Routing
+    {"static_route_default_gw", "gateway", PropertySchema::ROUTING_TOP_PROPERTY},
+    {"src", "pref-src", PropertySchema::ROUTE_PROPERTY},
+    {"destination", "dst-address", PropertySchema::ROUTE_PROPERTY},
+    {"dst", "dst-address", PropertySchema::ROUTE_PROPERTY},
+    {"gateway", "gateway", PropertySchema::ROUTE_PROPERTY},
+    {"gw", "gateway", PropertySchema::ROUTE_PROPERTY},
+    {"distance", "distance", PropertySchema::ROUTE_PROPERTY},
+    {"routing-table", "routing-table", PropertySchema::ROUTE_PROPERTY},
+    {"table", "routing-table", PropertySchema::ROUTE_PROPERTY | PropertySchema::ROUTING_SUBSECTION},
+    {"check-gateway", "check-gateway", PropertySchema::ROUTE_PROPERTY},
+    {"scope", "scope", PropertySchema::ROUTE_PROPERTY},
+    {"target-scope", "target-scope", PropertySchema::ROUTE_PROPERTY},
+    {"suppress-hw-offload", "suppress-hw-offload", PropertySchema::ROUTE_PROPERTY},
+    {"tables", "table", PropertySchema::ROUTING_SUBSECTION},
+    {"rule", "rule", PropertySchema::ROUTING_SUBSECTION},
+    {"rules", "rule", PropertySchema::ROUTING_SUBSECTION},
+    {"filter", "filter", PropertySchema::ROUTING_SUBSECTION | PropertySchema::FIREWALL_SUBSECTION},
+
+    // Firewall subsections
+    {"nat", "nat", PropertySchema::FIREWALL_SUBSECTION},
+    {"mangle", "mangle", PropertySchema::FIREWALL_SUBSECTION},
+    {"raw", "raw", PropertySchema::FIREWALL_SUBSECTION},
+    {"address-list", "address-list", PropertySchema::FIREWALL_SUBSECTION},
+    {"service-port", "service-port", PropertySchema::FIREWALL_SUBSECTION},
+    {"layer7-protocol", "layer7-protocol", PropertySchema::FIREWALL_SUBSECTION},
+
+    // Firewall rule properties
+    {"chain", "chain", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"action", "action", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"protocol", "protocol", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"src-address", "src-address", PropertySchema::FIREWALL_RULE_PROPERTY | PropertySchema::ROUTE_PROPERTY},
+    {"src_address", "src-address", PropertySchema::FIREWALL_RULE_PROPERTY | PropertySchema::ROUTE_PROPERTY},
+    {"dst-address", "dst-address", PropertySchema::FIREWALL_RULE_PROPERTY | PropertySchema::ROUTE_PROPERTY},
+    {"dst_address", "dst-address", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"src-port", "src-port", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"src_port", "src-port", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"dst-port", "dst-port", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"dst_port", "dst-port", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"in-interface", "in-interface", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"in_interface", "in-interface", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"out-interface", "out-interface", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"out_interface", "out-interface", PropertySchema::FIREWALL_RULE_PROPERTY},
+    {"connection-state", "connection-state", PropertySchema::CONNECTION_STATE_PROPERTY},
+    {"connection_state", "connection-state", PropertySchema::CONNECTION_STATE_PROPERTY},
+    {"to-addresses", "to-addresses", PropertySchema::NAT_PROPERTY},
+    {"to_addresses", "to-addresses", PropertySchema::NAT_PROPERTY},
+    {"to-ports", "to-ports", PropertySchema::NAT_PROPERTY},
+    {"to_ports", "to-ports", PropertySchema::NAT_PROPERTY},
+
+    // Chains
+    {"input", "input", PropertySchema::FILTER_CHAIN},
+    {"forward", "forward", PropertySchema::FILTER_CHAIN},
+    {"output", "output", PropertySchema::FILTER_CHAIN},
+    {"srcnat", "srcnat", PropertySchema::NAT_CHAIN},
+    {"dstnat", "dstnat", PropertySchema::NAT_CHAIN},
+    {"prerouting", "prerouting", PropertySchema::NAT_CHAIN},
+    {"postrouting", "postrouting", PropertySchema::NAT_CHAIN},
+
+    // Actions
+    {"accept", "accept", PropertySchema::FILTER_ACTION | PropertySchema::NAT_ACTION},
+    {"drop", "drop", PropertySchema::FILTER_ACTION | PropertySchema::NAT_ACTION},
+    {"reject", "reject", PropertySchema::FILTER_ACTION},
+    {"log", "log", PropertySchema::FILTER_ACTION},
+    {"tarpit", "tarpit", PropertySchema::FILTER_ACTION},
+    {"jump", "jump", PropertySchema::FILTER_ACTION},
+    {"fasttrack-connection", "fasttrack-connection", PropertySchema::FILTER_ACTION},
+    {"add-src-to-address-list", "add-src-to-address-list", PropertySchema::FILTER_ACTION},
+    {"add-dst-to-address-list", "add-dst-to-address-list", PropertySchema::FILTER_ACTION},
+    {"masquerade", "masquerade", PropertySchema::NAT_ACTION},
+    {"redirect", "redirect", PropertySchema::NAT_ACTION},
+    {"dst-nat", "dst-nat", PropertySchema::NAT_ACTION},
+    {"src-nat", "src-nat", PropertySchema::NAT_ACTION},
+    {"same", "same", PropertySchema::NAT_ACTION},
+    {"netmap", "netmap", PropertySchema::NAT_ACTION},
+
+    // Connection states
+    {"established", "established", PropertySchema::CONNECTION_STATE},
+    {"related", "related", PropertySchema::CONNECTION_STATE},
+    {"new", "new", PropertySchema::CONNECTION_STATE},
+    {"invalid", "invalid", PropertySchema::CONNECTION_STATE},
+};
+
+inline constexpr auto PROPERTY_SCHEMA = make_perfect_hash<64, 256>(PROPERTY_SCHEMA_ENTRIES);
+static_assert(PROPERTY_SCHEMA.complete, "property schema has duplicate names or no perfect hash was found");
+
+constexpr const PropertySchema::Entry* PropertySchema::find(std::string_view name) noexcept
+{
+    return PROPERTY_SCHEMA.find(name);
+}
+
+constexpr bool PropertySchema::allows(uint32_t contexts, std::string_view name) noexcept
+{
+    int index = PROPERTY_SCHEMA.index_of(name);
+    return index >= 0 && (PROPERTY_SCHEMA.entries[index].contexts & contexts) != 0;
+}
+
+constexpr std::string_view PropertySchema::routeros_name(std::string_view name) noexcept
+{
+    int index = PROPERTY_SCHEMA.index_of(name);
+    return index >= 0 ? PROPERTY_SCHEMA.entries[index].routeros_name : name;
+}
+
+static_assert(PropertySchema::allows(PropertySchema::FILTER_CHAIN, "forward"));
+static_assert(!PropertySchema::allows(PropertySchema::FILTER_CHAIN, "srcnat"));
+static_assert(PropertySchema::routeros_name("in_interface") == "in-interface");
@@ -0,0 +1,285 @@
+#include "route_checker.hpp"
+#include "prefix_trie.hpp"
+#include <charconv>
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+// RouterOS default administrative distance for static routes
+constexpr int DEFAULT_DISTANCE = 1;
+
+} // namespace
+
+int RouteTableChecker::distance_value(const FlatAst& ast, FlatAst::NodeId property)
+{
+    FlatAst::ValueId value = ast.value(property);
+    if (ast.value_kind(value) == FlatAst::ValueKind::NUMBER) {
+        return static_cast<int>(ast.value_data(value));
+    }
+    std::string text = ast.value_text(value);
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return DEFAULT_DISTANCE;
+    }
+    int distance = DEFAULT_DISTANCE;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), distance);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        problems_.report(Diagnostics::Severity::WARNING, ast.line(property), ast.column(property),
+                         "Distance " + text + " is out of range; the route is checked with distance " +
+                         std::to_string(DEFAULT_DISTANCE));
+        return DEFAULT_DISTANCE;
+    }
+    return distance;
+}
+
+void RouteTableChecker::add_route(const FlatAst& ast, FlatAst::NodeId site, std::string name, std::string table,
+                                 const std::string& destination, std::string gateway, int distance)
+{
+    IPv4Prefix prefix;
+    if (gateway.empty() || !IPv4Prefix::parse(destination, prefix)) {
+        // Malformed routes are reported by the section validators
+        return;
+    }
+    routes_.push_back({std::move(name), table.empty() ? "main" : std::move(table),
+                       prefix, std::move(gateway), distance, ast.line(site), ast.column(site)});
+}
+
+void RouteTableChecker::collect_routing_section(const FlatAst& ast, FlatAst::NodeId section)
+{
+    static const std::set<std::string, std::less<>> non_route_subsections = {
+        "table", "tables", "rule", "rules", "filter"
+    };
+
+    for (FlatAst::NodeId node = ast.first_child(section); node != FlatAst::NONE; node = ast.next_sibling(node)) {
+        if (ast.kind(node) == FlatAst::NodeKind::PROPERTY) {
+            if (ast.name(node) == "static_route_default_gw") {
+                add_route(ast, node, std::string(ast.name(node)), "", "0.0.0.0/0",
+                         ast.value_text(ast.value(node)), DEFAULT_DISTANCE);
+            }
+            continue;
+        }
+
+        if (non_route_subsections.count(ast.name(node))) {
+            continue;
+        }
+
+        std::string destination, gateway, table;
+        int distance = DEFAULT_DISTANCE;
+        for (FlatAst::NodeId prop = ast.first_child(node); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+            FlatAst::ValueId value = ast.value(prop);
+            if (ast.kind(prop) != FlatAst::NodeKind::PROPERTY || value == FlatAst::NONE) {
+                continue;
+            }
+
+            std::string_view prop_name = ast.name(prop);
+            if (prop_name == "destination" || prop_name == "dst-address" || prop_name == "dst") {
+                destination = ast.value_text(value);
+            } else if (prop_name == "gateway" || prop_name == "gw") {
+                gateway = ast.value_text(value);
+            } else if (prop_name == "distance") {
+                distance = distance_value(ast, prop);
+            } else if (prop_name == "routing-table" || prop_name == "table") {
+                table = ast.value_text(value);
+            }
+        }
+        add_route(ast, node, std::string(ast.name(node)), table, destination, gateway, distance);
+    }
+}
+
+void RouteTableChecker::collect_ip_section(const FlatAst& ast, FlatAst::NodeId section)
+{
+    static const std::set<std::string, std::less<>> non_interface_subsections = {
+        "address", "route", "routes", "firewall", "dhcp-server", "dhcp-client",
+        "dns", "arp", "service", "neighbor", "proxy"
+    };
+
+    for (FlatAst::NodeId subsection = ast.first_child(section); subsection != FlatAst::NONE;
+         subsection = ast.next_sibling(subsection)) {
+        if (ast.kind(subsection) != FlatAst::NodeKind::SECTION) {
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(subsection);
+        if (subsection_name == "route" || subsection_name == "routes") {
+            for (FlatAst::NodeId route = ast.first_child(subsection); route != FlatAst::NONE;
+                 route = ast.next_sibling(route)) {
+                if (ast.kind(route) == FlatAst::NodeKind::PROPERTY) {
+                    if (ast.name(route) == "default") {
+                        add_route(ast, route, "default", "", "0.0.0.0/0", ast.value_text(ast.value(route)),
+                                 DEFAULT_DISTANCE);
+                    }
+                    continue;
+                }
+
+                std::string gateway;
+                int distance = DEFAULT_DISTANCE;
+                for (FlatAst::NodeId detail = ast.first_child(route); detail != FlatAst::NONE;
+                     detail = ast.next_sibling(detail)) {
+                    FlatAst::ValueId value = ast.value(detail);
+                    if (ast.kind(detail) != FlatAst::NodeKind::PROPERTY || value == FlatAst::NONE) {
+                        continue;
+                    }
+                    if (ast.name(detail) == "gateway") {
+                        gateway = ast.value_text(value);
+                    } else if (ast.name(detail) == "distance") {
+                        distance = distance_value(ast, detail);
+                    }
+                }
+                // IP route entries are named by their destination network
+                std::string route_name(ast.name(route));
+                add_route(ast, route, route_name, "", route_name, gateway, distance);
+            }
+        } else if (!non_interface_subsections.count(subsection_name)) {
+            // Interface subsection: each address defines a connected subnet
+            for (FlatAst::NodeId prop = ast.first_child(subsection); prop != FlatAst::NONE;
+                 prop = ast.next_sibling(prop)) {
+                IPv4Prefix prefix;
+                if (ast.kind(prop) == FlatAst::NodeKind::PROPERTY && ast.name(prop) == "address" &&
+                    IPv4Prefix::parse(ast.value_text(ast.value(prop)), prefix)) {
+                    connected_.push_back({std::string(subsection_name), prefix});
+                }
+            }
+        }
+    }
+}
+
+void RouteTableChecker::check(const ProgramDeclaration* program, Diagnostics& diagnostics)
+{
+    check(FlatAst::build(program), diagnostics);
+}
+
+void RouteTableChecker::check(const FlatAst& ast, Diagnostics& diagnostics)
+{
+    routes_.clear();
+    connected_.clear();
+    problems_ = Diagnostics();
+
+    for (FlatAst::NodeId section = ast.root(); section != FlatAst::NONE; section = ast.next_sibling(section)) {
+        add_section(ast, section);
+    }
+    finish(diagnostics);
+}
+
+void RouteTableChecker::add_section(const FlatAst& ast, FlatAst::NodeId section)
+{
+    if (ast.section_type(section) == SectionStatement::SectionType::ROUTING) {
+        collect_routing_section(ast, section);
+    } else if (ast.section_type(section) == SectionStatement::SectionType::IP) {
+        collect_ip_section(ast, section);
+    }
+}
+
+void RouteTableChecker::finish(Diagnostics& diagnostics)
+{
+    diagnostics.merge(std::move(problems_));
+    problems_ = Diagnostics();
+
+    // Connected subnets: the first interface to claim a subnet owns it
+    PrefixTrie<int> connected_trie;
+    for (size_t i = 0; i < connected_.size(); i++) {
+        int& owner = connected_trie.insert(connected_[i].prefix);
+        if (owner == 0) {
+            owner = static_cast<int>(i) + 1;
+        }
+    }
+
+    // Resolve each gateway to the network it leaves through
+    std::vector<std::string> egress(routes_.size());
+    for (size_t i = 0; i < routes_.size(); i++) {
+        const Route& route = routes_[i];
+        uint32_t gateway_address;
+        if (!parse_ipv4_address(route.gateway, gateway_address)) {
+            // Interface gateway: the interface itself is the egress
+            egress[i] = "if:" + route.gateway;
+            continue;
+        }
+
+        const int* owner = connected_trie.longest_match(gateway_address);
+        if (!owner) {
+            diagnostics.report(Diagnostics::Severity::WARNING, route.line, route.column,
+                               "Gateway " + route.gateway + " of route '" + route.name + "' (" +
+                               route.destination.to_string() + ") is not reachable from any connected subnet");
+            continue;
+        }
+        egress[i] = "net:" + std::to_string(*owner - 1);
+    }
+
+    // One longest-prefix-match trie per routing table, grouping routes by destination
+    std::unordered_map<std::string, PrefixTrie<std::vector<size_t>>> tables;
+    for (size_t i = 0; i < routes_.size(); i++) {
+        tables[routes_[i].table].insert(routes_[i].destination).push_back(i);
+    }
+
+    // Routes that can carry traffic, to find routes whose whole range they take over
+    std::unordered_map<std::string, PrefixTrie<char>> usable;
+    for (size_t i = 0; i < routes_.size(); i++) {
+        if (!egress[i].empty()) {
+            usable[routes_[i].table].insert(routes_[i].destination);
+        }
+    }
+
+    std::vector<std::string> route_warnings(routes_.size());
+    for (const auto& [table_name, trie] : tables) {
+        for (const std::vector<size_t>& group : trie.get_values()) {
+            if (group.size() < 2) {
+                continue;
+            }
+
+            std::unordered_map<std::string, size_t> seen;
+            std::unordered_map<std::string, size_t> best_by_egress;
+            for (size_t index : group) {
+                const Route& route = routes_[index];
+                std::string key = route.gateway + "|" + std::to_string(route.distance);
+                auto [it, inserted] = seen.emplace(key, index);
+                if (!inserted) {
+                    route_warnings[index] = "Route '" + route.name + "' duplicates route '" +
+                        routes_[it->second].name + "' (" + route.destination.to_string() +
+                        " via " + route.gateway + ")";
+                    continue;
+                }
+
+                if (egress[index].empty()) {
+                    continue;
+                }
+                auto best = best_by_egress.find(egress[index]);
+                if (best == best_by_egress.end() || route.distance < routes_[best->second].distance) {
+                    best_by_egress[egress[index]] = index;
+                }
+            }
+
+            for (size_t index : group) {
+                auto best = egress[index].empty() ? best_by_egress.end() : best_by_egress.find(egress[index]);
+                if (!route_warnings[index].empty() || best == best_by_egress.end()) {
+                    continue;
+                }
+                const Route& route = routes_[index];
+                const Route& winner = routes_[best->second];
+                if (winner.distance < route.distance) {
+                    route_warnings[index] = "Route '" + route.name + "' (" + route.destination.to_string() +
+                        ", distance " + std::to_string(route.distance) + ") is overridden by route '" +
+                        winner.name + "' (distance " + std::to_string(winner.distance) +
+                        ") through the same next-hop network and can never become active";
+                }
+            }
+        }
+    }
+
+    // Longest prefix match prefers the more specific routes whatever their distance
+    for (size_t i = 0; i < routes_.size(); i++) {
+        auto table = usable.find(routes_[i].table);
+        if (route_warnings[i].empty() && table != usable.end() &&
+            table->second.covered_by_longer(routes_[i].destination)) {
+            route_warnings[i] = "Route '" + routes_[i].name + "' (" + routes_[i].destination.to_string() +
+                ") is covered entirely by more specific routes and can never be selected";
+        }
+    }
+
+    for (size_t i = 0; i < routes_.size(); i++) {
+        if (!route_warnings[i].empty()) {
+            diagnostics.report(Diagnostics::Severity::WARNING, routes_[i].line, routes_[i].column, route_warnings[i]);
+        }
+    }
+
+    routes_.clear();
+    connected_.clear();
+}
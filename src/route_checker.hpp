@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "declaration.hpp"
+#include "ipv4_prefix.hpp"
+#include "diagnostics.hpp"
+#include "flat_ast.hpp"
+
+/**
+ * @class RouteTableChecker
+ * @brief Cross-section consistency checks for static routes
+ *
+ * Builds longest-prefix-match tries from every route in the routing and
+ * IP sections and from the connected subnets of the IP section addresses,
+ * then reports duplicate routes, routes that can never become active
+ * because a lower-distance route leaves through the same next-hop network
+ * or because more specific routes cover their whole range, and gateways
+ * that no connected subnet can reach.
+ *
+ * Only a summary of each route is kept, so sections can be added one at a
+ * time with add_section() and freed before finish() runs the checks.
+ */
+class RouteTableChecker {
+public:
+    /**
+     * @brief Run all route table checks over a parsed program
+     * @param program The program to check
+     * @param diagnostics Sink receiving one warning per problem, at the offending route
+     */
+    void check(const ProgramDeclaration* program, Diagnostics& diagnostics);
+
+    /**
+     * @brief Run all route table checks over a flat program
+     * @param ast The program to check
+     * @param diagnostics Sink receiving one warning per problem, at the offending route
+     */
+    void check(const FlatAst& ast, Diagnostics& diagnostics);
+
+    /**
+     * @brief Collect the routes and connected subnets of one top-level section
+     * @param ast The flat program holding the section; it is not referenced after this call
+     * @param section The section node
+     */
+    void add_section(const FlatAst& ast, FlatAst::NodeId section);
+
+    /**
+     * @brief Run the checks over every section added so far and forget them
+     * @param diagnostics Sink receiving one warning per problem, at the offending route
+     */
+    void finish(Diagnostics& diagnostics);
+
+private:
+    struct Route {
+        std::string name;
+        std::string table;
+        IPv4Prefix destination;
+        std::string gateway;
+        int distance;
+        int line;
+        int column;
+    };
+
+    struct ConnectedSubnet {
+        std::string interface_name;
+        IPv4Prefix prefix;
+    };
+
+    /**
+     * @brief Collect static routes declared in a routing section
+     * @param ast The flat program
+     * @param section The routing section node
+     */
+    void collect_routing_section(const FlatAst& ast, FlatAst::NodeId section);
+
+    /**
+     * @brief Collect connected subnets and routes declared in an IP section
+     * @param ast The flat program
+     * @param section The IP section node
+     */
+    void collect_ip_section(const FlatAst& ast, FlatAst::NodeId section);
+
+    /**
+     * @brief Record a route if its destination is a valid IPv4 prefix
+     */
+    void add_route(const FlatAst& ast, FlatAst::NodeId site, std::string name, std::string table,
+                  const std::string& destination, std::string gateway, int distance);
+
+    /**
+     * @brief Distance set by a route property; one that does not fit an int is reported and taken as the default
+     */
+    int distance_value(const FlatAst& ast, FlatAst::NodeId property);
+
+    std::vector<Route> routes_;
+    std::vector<ConnectedSubnet> connected_;
+    Diagnostics problems_;   // Found while collecting, reported by finish()
+};
@@ -0,0 +1,507 @@
+#include "route_simulator.hpp"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include "property_schema.hpp"
+
+namespace {
+
+using NodeId = FlatAst::NodeId;
+using NodeKind = FlatAst::NodeKind;
+
+// RouterOS default administrative distance for static routes
+constexpr int DEFAULT_DISTANCE = 1;
+
+// Bits resolved by the direct table of a RouteLookup
+constexpr unsigned DIRECT_BITS = 16;
+
+int distance_value(const FlatAst& ast, FlatAst::ValueId value)
+{
+    if (ast.value_kind(value) == FlatAst::ValueKind::NUMBER) {
+        return static_cast<int>(ast.value_data(value));
+    }
+    std::string text = ast.value_text(value);
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return DEFAULT_DISTANCE;
+    }
+    return std::stoi(text);
+}
+
+std::string_view trim(std::string_view text) noexcept
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Fields of a query line, separated by commas, spaces or tabs
+std::vector<std::string_view> split_fields(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    for (size_t i = 0; i <= line.size(); i++) {
+        if (i == line.size() || line[i] == ',' || line[i] == ' ' || line[i] == '\t') {
+            std::string_view field = trim(line.substr(start, i - start));
+            if (!field.empty()) {
+                fields.push_back(field);
+            }
+            start = i + 1;
+        }
+    }
+    return fields;
+}
+
+} // namespace
+
+RouteLookup::RouteLookup() : direct_(1u << DIRECT_BITS, LEAF | NO_VALUE) {}
+
+RouteLookup::RouteLookup(const std::vector<Entry>& entries)
+{
+    std::vector<BuildNode> trie(1);
+    for (const Entry& entry : entries) {
+        int node = 0;
+        for (unsigned depth = 0; depth < entry.prefix.length; depth++) {
+            int bit = (entry.prefix.address >> (31 - depth)) & 1;
+            if (trie[node].child[bit] < 0) {
+                trie[node].child[bit] = static_cast<int>(trie.size());
+                trie.emplace_back();
+            }
+            node = trie[node].child[bit];
+        }
+        trie[node].value = entry.value;
+    }
+
+    direct_.resize(1u << DIRECT_BITS);
+    fillDirect(trie, 0, 0, 0, NO_VALUE);
+}
+
+void RouteLookup::fillDirect(const std::vector<BuildNode>& trie, int node, unsigned depth, uint32_t bits,
+                             uint32_t best)
+{
+    if (node >= 0 && trie[node].value != NO_VALUE) {
+        best = trie[node].value;
+    }
+    uint32_t first = bits << (DIRECT_BITS - depth);
+    if (node < 0 || (trie[node].child[0] < 0 && trie[node].child[1] < 0)) {
+        // Every address below takes the best prefix so far (leaf pushing)
+        std::fill(direct_.begin() + first, direct_.begin() + first + (1u << (DIRECT_BITS - depth)), LEAF | best);
+        return;
+    }
+    if (depth == DIRECT_BITS) {
+        uint32_t index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        direct_[first] = index;
+        buildNode(trie, node, depth, best, index);
+        return;
+    }
+    fillDirect(trie, trie[node].child[0], depth + 1, bits << 1, best);
+    fillDirect(trie, trie[node].child[1], depth + 1, bits << 1 | 1, best);
+}
+
+void RouteLookup::buildNode(const std::vector<BuildNode>& trie, int node, unsigned depth, uint32_t best,
+                            uint32_t index)
+{
+    // Follow each slot down the binary trie to a subtree that goes deeper, or to a leaf
+    int subtrees[FANOUT];
+    uint32_t values[FANOUT];
+    Node built{0, 0, 0, static_cast<uint32_t>(leaves_.size())};
+    for (unsigned slot = 0; slot < FANOUT; slot++) {
+        int current = node;
+        uint32_t value = best;
+        for (unsigned step = 0; step < STRIDE && depth + step < 32 && current >= 0; step++) {
+            current = trie[current].child[(slot >> (STRIDE - 1 - step)) & 1];
+            if (current >= 0 && trie[current].value != NO_VALUE) {
+                value = trie[current].value;
+            }
+        }
+        values[slot] = value;
+        subtrees[slot] = -1;
+        if (current >= 0 && depth + STRIDE < 32 && (trie[current].child[0] >= 0 || trie[current].child[1] >= 0)) {
+            subtrees[slot] = current;
+            built.children |= 1ULL << slot;
+            continue;
+        }
+
+        // Runs of equal leaves are stored once; subtrees between them do not break a run
+        if (leaves_.size() == built.leaf_base || leaves_.back() != value) {
+            built.leaf_runs |= 1ULL << slot;
+            leaves_.push_back(value);
+        }
+    }
+
+    // Children of a node are contiguous, so reserve them all before filling any
+    built.child_base = static_cast<uint32_t>(nodes_.size());
+    nodes_.resize(nodes_.size() + __builtin_popcountll(built.children));
+    nodes_[index] = built;
+
+    uint32_t child = built.child_base;
+    for (unsigned slot = 0; slot < FANOUT; slot++) {
+        if (subtrees[slot] >= 0) {
+            buildNode(trie, subtrees[slot], depth + STRIDE, values[slot], child++);
+        }
+    }
+}
+
+RouteSimulator::RouteSimulator(const FlatAst& ast, const std::vector<std::string>& down)
+{
+    tables_.push_back("main");
+    for (NodeId section = ast.root(); section != FlatAst::NONE; section = ast.next_sibling(section)) {
+        if (ast.section_type(section) == SectionStatement::SectionType::ROUTING) {
+            collectRoutingSection(ast, section);
+        } else if (ast.section_type(section) == SectionStatement::SectionType::IP) {
+            collectIPSection(ast, section);
+        }
+    }
+    resolve(down);
+}
+
+uint32_t RouteSimulator::tableId(std::string_view name)
+{
+    if (name.empty()) {
+        return 0;
+    }
+    auto it = std::find(tables_.begin(), tables_.end(), name);
+    if (it != tables_.end()) {
+        return static_cast<uint32_t>(it - tables_.begin());
+    }
+    tables_.emplace_back(name);
+    return static_cast<uint32_t>(tables_.size() - 1);
+}
+
+void RouteSimulator::addRoute(const FlatAst& ast, NodeId site, std::string name, const std::string& table,
+                              std::string_view destination, std::string gateway, int distance)
+{
+    IPv4Prefix prefix;
+    if (gateway.empty() || !IPv4Prefix::parse(destination, prefix)) {
+        // Malformed routes are reported by the section validators
+        return;
+    }
+    routes_.push_back({std::move(name), tables_[tableId(table)], prefix, std::move(gateway), "", distance,
+                       ast.line(site), ast.column(site)});
+}
+
+void RouteSimulator::collectRoutingSection(const FlatAst& ast, NodeId section)
+{
+    for (NodeId node = ast.first_child(section); node != FlatAst::NONE; node = ast.next_sibling(node)) {
+        if (ast.kind(node) == NodeKind::PROPERTY) {
+            if (ast.name(node) == "static_route_default_gw") {
+                addRoute(ast, node, std::string(ast.name(node)), "", "0.0.0.0/0",
+                         ast.value_text(ast.value(node)), DEFAULT_DISTANCE);
+            }
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(node);
+        if (subsection_name == "table" || subsection_name == "tables") {
+            for (NodeId table = ast.first_child(node); table != FlatAst::NONE; table = ast.next_sibling(table)) {
+                if (ast.kind(table) == NodeKind::SECTION) {
+                    tableId(ast.name(table));
+                }
+            }
+            continue;
+        }
+        if (subsection_name == "filter") {
+            continue;
+        }
+
+        if (subsection_name == "rule" || subsection_name == "rules") {
+            for (NodeId entry = ast.first_child(node); entry != FlatAst::NONE; entry = ast.next_sibling(entry)) {
+                if (ast.kind(entry) != NodeKind::SECTION) {
+                    continue;
+                }
+                Rule rule{std::string(ast.name(entry)), {}, {}, 0, RuleAction::LOOKUP, 0, false,
+                          ast.line(entry), ast.column(entry)};
+                bool valid = true;
+                for (NodeId prop = ast.first_child(entry); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                    FlatAst::ValueId value = ast.value(prop);
+                    if (ast.kind(prop) != NodeKind::PROPERTY || value == FlatAst::NONE) {
+                        continue;
+                    }
+                    std::string_view name = PropertySchema::routeros_name(ast.name(prop));
+                    std::string text = ast.value_text(value);
+                    if (name == "src-address") {
+                        valid = valid && IPv4Prefix::parse(text, rule.source);
+                        rule.has_source = true;
+                    } else if (name == "dst-address") {
+                        valid = valid && IPv4Prefix::parse(text, rule.destination);
+                    } else if (name == "interface") {
+                        auto [it, inserted] = interface_ids_.emplace(text, interface_ids_.size() + 1);
+                        rule.interface = it->second;
+                    } else if (name == "routing-table") {
+                        rule.table = tableId(text);
+                    } else if (name == "action") {
+                        if (text == "lookup-only-in-table") {
+                            rule.action = RuleAction::LOOKUP_ONLY_IN_TABLE;
+                        } else if (text == "drop") {
+                            rule.action = RuleAction::DROP;
+                        } else if (text == "unreachable") {
+                            rule.action = RuleAction::UNREACHABLE;
+                        } else if (text != "lookup") {
+                            valid = false;
+                        }
+                    }
+                }
+                // Malformed rules are reported by the section validators and never match
+                if (valid) {
+                    rules_.push_back(std::move(rule));
+                }
+            }
+            continue;
+        }
+
+        std::string destination, gateway, table;
+        int distance = DEFAULT_DISTANCE;
+        for (NodeId prop = ast.first_child(node); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+            FlatAst::ValueId value = ast.value(prop);
+            if (ast.kind(prop) != NodeKind::PROPERTY || value == FlatAst::NONE) {
+                continue;
+            }
+
+            std::string_view name = PropertySchema::routeros_name(ast.name(prop));
+            if (name == "dst-address") {
+                destination = ast.value_text(value);
+            } else if (name == "gateway") {
+                gateway = ast.value_text(value);
+            } else if (name == "distance") {
+                distance = distance_value(ast, value);
+            } else if (name == "routing-table") {
+                table = ast.value_text(value);
+            }
+        }
+        addRoute(ast, node, std::string(subsection_name), table, destination, gateway, distance);
+    }
+}
+
+void RouteSimulator::collectIPSection(const FlatAst& ast, NodeId section)
+{
+    static const std::set<std::string, std::less<>> non_interface_subsections = {
+        "address", "route", "routes", "firewall", "dhcp-server", "dhcp-client",
+        "dns", "arp", "service", "neighbor", "proxy"
+    };
+
+    for (NodeId subsection = ast.first_child(section); subsection != FlatAst::NONE;
+         subsection = ast.next_sibling(subsection)) {
+        if (ast.kind(subsection) != NodeKind::SECTION) {
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(subsection);
+        if (subsection_name == "route" || subsection_name == "routes") {
+            for (NodeId route = ast.first_child(subsection); route != FlatAst::NONE; route = ast.next_sibling(route)) {
+                if (ast.kind(route) == NodeKind::PROPERTY) {
+                    if (ast.name(route) == "default") {
+                        addRoute(ast, route, "default", "", "0.0.0.0/0", ast.value_text(ast.value(route)),
+                                 DEFAULT_DISTANCE);
+                    }
+                    continue;
+                }
+
+                std::string gateway;
+                int distance = DEFAULT_DISTANCE;
+                for (NodeId detail = ast.first_child(route); detail != FlatAst::NONE;
+                     detail = ast.next_sibling(detail)) {
+                    FlatAst::ValueId value = ast.value(detail);
+                    if (ast.kind(detail) != NodeKind::PROPERTY || value == FlatAst::NONE) {
+                        continue;
+                    }
+                    if (ast.name(detail) == "gateway") {
+                        gateway = ast.value_text(value);
+                    } else if (ast.name(detail) == "distance") {
+                        distance = distance_value(ast, value);
+                    }
+                }
+                // IP route entries are named by their destination network
+                std::string route_name(ast.name(route));
+                addRoute(ast, route, route_name, "", route_name, gateway, distance);
+            }
+        } else if (!non_interface_subsections.count(subsection_name)) {
+            // Interface subsection: each address defines a connected subnet
+            for (NodeId prop = ast.first_child(subsection); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                IPv4Prefix prefix;
+                if (ast.kind(prop) == NodeKind::PROPERTY && ast.name(prop) == "address" &&
+                    IPv4Prefix::parse(ast.value_text(ast.value(prop)), prefix)) {
+                    routes_.push_back({std::string(subsection_name), "main", prefix, "",
+                                       std::string(subsection_name), 0, ast.line(prop), ast.column(prop)});
+                }
+            }
+        }
+    }
+}
+
+void RouteSimulator::resolve(const std::vector<std::string>& down)
+{
+    auto is_down = [&down](std::string_view name) {
+        return std::find(down.begin(), down.end(), name) != down.end();
+    };
+
+    // Subnets of the interfaces that are up; the first interface to claim a subnet owns it
+    PrefixTrie<uint32_t> connected;
+    for (uint32_t i = 0; i < routes_.size(); i++) {
+        Route& route = routes_[i];
+        if (!route.gateway.empty()) {
+            continue;
+        }
+        interfaces_.push_back(route.interface);
+        if (is_down(route.interface)) {
+            continue;
+        }
+        route.usable = true;
+        uint32_t& owner = connected.insert(route.destination);
+        if (owner == 0) {
+            owner = i + 1;
+        }
+    }
+
+    // A static route leaves through its first gateway that is an interface
+    // that is up, or an address on a subnet of one
+    for (Route& route : routes_) {
+        if (route.gateway.empty()) {
+            continue;
+        }
+        size_t start = 0;
+        while (start <= route.gateway.size() && !route.usable) {
+            size_t comma = std::min(route.gateway.find(',', start), route.gateway.size());
+            std::string_view gateway = trim(std::string_view(route.gateway).substr(start, comma - start));
+            start = comma + 1;
+
+            uint32_t address;
+            if (!parse_ipv4_address(gateway, address)) {
+                interfaces_.emplace_back(gateway);
+                if (!gateway.empty() && !is_down(gateway)) {
+                    route.interface = std::string(gateway);
+                    route.usable = true;
+                }
+            } else if (const uint32_t* owner = connected.longest_match(address)) {
+                route.interface = routes_[*owner - 1].interface;
+                route.usable = true;
+            }
+        }
+    }
+
+    // The best usable route to each destination of each table
+    std::vector<PrefixTrie<uint32_t>> best(tables_.size());
+    for (uint32_t i = 0; i < routes_.size(); i++) {
+        if (!routes_[i].usable) {
+            continue;
+        }
+        uint32_t table = static_cast<uint32_t>(std::find(tables_.begin(), tables_.end(), routes_[i].table) -
+                                               tables_.begin());
+        uint32_t& winner = best[table].insert(routes_[i].destination);
+        if (winner == 0 || routes_[i].distance < routes_[winner - 1].distance) {
+            winner = i + 1;
+        }
+    }
+
+    for (PrefixTrie<uint32_t>& table : best) {
+        std::vector<RouteLookup::Entry> entries;
+        PrefixTrie<uint32_t> trie;
+        const std::vector<uint32_t>& winners = table.get_values();
+        const std::vector<IPv4Prefix>& prefixes = table.get_prefixes();
+        for (size_t i = 0; i < winners.size(); i++) {
+            routes_[winners[i] - 1].active = true;
+            entries.push_back({prefixes[i], winners[i] - 1});
+            trie.insert(prefixes[i]) = winners[i] - 1;
+        }
+        lookups_.emplace_back(entries);
+        tries_.push_back(std::move(trie));
+    }
+
+    std::sort(interfaces_.begin(), interfaces_.end());
+    interfaces_.erase(std::unique(interfaces_.begin(), interfaces_.end()), interfaces_.end());
+}
+
+template <typename Find>
+RouteSimulator::Result RouteSimulator::decide(const Query& query, Find find) const noexcept
+{
+    for (uint32_t i = 0; i < rules_.size(); i++) {
+        const Rule& rule = rules_[i];
+        if ((rule.has_source && (!query.has_source || !rule.source.contains(query.source))) ||
+            !rule.destination.contains(query.destination) ||
+            (rule.interface != 0 && rule.interface != query.interface)) {
+            continue;
+        }
+        if (rule.action == RuleAction::DROP || rule.action == RuleAction::UNREACHABLE) {
+            return {NO_ROUTE, i};
+        }
+        uint32_t route = find(rule.table, query.destination);
+        if (route == NO_ROUTE && rule.action == RuleAction::LOOKUP && rule.table != 0) {
+            route = find(0, query.destination);
+        }
+        return {route, i};
+    }
+    return {find(0, query.destination), NO_ROUTE};
+}
+
+RouteSimulator::Result RouteSimulator::lookup(const Query& query) const noexcept
+{
+    if (rules_.empty()) {
+        return {lookups_[0].lookup(query.destination), NO_ROUTE};
+    }
+    return decide(query, [this](uint32_t table, uint32_t address) { return lookups_[table].lookup(address); });
+}
+
+RouteSimulator::Result RouteSimulator::lookup_binary(const Query& query) const noexcept
+{
+    return decide(query, [this](uint32_t table, uint32_t address) {
+        const uint32_t* route = tries_[table].longest_match(address);
+        return route ? *route : NO_ROUTE;
+    });
+}
+
+uint32_t RouteSimulator::interface_id(std::string_view name) const noexcept
+{
+    auto it = interface_ids_.find(std::string(name));
+    return it == interface_ids_.end() ? 0 : it->second;
+}
+
+bool RouteSimulator::has_interface(std::string_view name) const noexcept
+{
+    return std::binary_search(interfaces_.begin(), interfaces_.end(), name);
+}
+
+std::tuple<bool, std::string> RouteSimulator::load_queries(const std::string& path,
+                                                           std::vector<Query>& queries) const
+{
+    std::ifstream file(path);
+    if (!file) {
+        return {false, "Cannot open route queries " + path};
+    }
+
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); line_number++) {
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+
+        std::vector<std::string_view> fields = split_fields(text);
+        if (fields.empty()) {
+            continue;
+        }
+        Query query{0, 0, 0, false};
+        std::string_view invalid;
+        if (fields.size() > 3) {
+            invalid = fields[3];
+        } else if (!parse_ipv4_address(fields[0], query.destination)) {
+            invalid = fields[0];
+        } else if (fields.size() > 1 && fields[1] != "-") {
+            query.has_source = parse_ipv4_address(fields[1], query.source);
+            if (!query.has_source) {
+                invalid = fields[1];
+            }
+        }
+        if (!invalid.empty()) {
+            return {false, path + ":" + std::to_string(line_number) + ": Unexpected '" + std::string(invalid) +
+                           "'; expected destination [source [in-interface]]"};
+        }
+        if (fields.size() > 2) {
+            query.interface = interface_id(fields[2]);
+        }
+        queries.push_back(query);
+    }
+    return {true, ""};
+}
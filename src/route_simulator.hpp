@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_ast.hpp"
+#include "ipv4_prefix.hpp"
+#include "prefix_trie.hpp"
+
+/**
+ * @class RouteLookup
+ * @brief Longest-prefix match over IPv4 prefixes in a Poptrie-style compressed trie
+ *
+ * The top 16 bits of an address index a direct table. Below it, each node
+ * covers 6 more bits with two 64-bit maps: one marks the children that are
+ * nodes and the other marks where each run of equal leaves starts. The
+ * children and leaves of a node are stored contiguously, so picking one is
+ * a population count. A lookup reads the direct table and at most three
+ * nodes, whatever the number of prefixes.
+ */
+class RouteLookup {
+public:
+    static constexpr uint32_t NO_VALUE = 0x7FFFFFFF;
+
+    struct Entry {
+        IPv4Prefix prefix;
+        uint32_t value;    // Below NO_VALUE
+    };
+
+    RouteLookup();
+
+    // Later entries for the same prefix replace earlier ones
+    explicit RouteLookup(const std::vector<Entry>& entries);
+
+    // Value of the longest prefix holding the address, or NO_VALUE
+    uint32_t lookup(uint32_t address) const noexcept
+    {
+        uint32_t entry = direct_[address >> 16];
+        if (entry & LEAF) {
+            return entry & ~LEAF;
+        }
+        uint64_t key = static_cast<uint64_t>(address) << 32;
+        for (unsigned offset = 16;; offset += STRIDE) {
+            const Node& node = nodes_[entry];
+            unsigned slot = static_cast<unsigned>(key >> (64 - STRIDE - offset)) & (FANOUT - 1);
+            uint64_t upto = (2ULL << slot) - 1;   // All ones for the last slot
+            if (!(node.children >> slot & 1)) {
+                return leaves_[node.leaf_base + __builtin_popcountll(node.leaf_runs & upto) - 1];
+            }
+            entry = node.child_base + __builtin_popcountll(node.children & upto) - 1;
+        }
+    }
+
+    size_t node_count() const noexcept { return nodes_.size(); }
+    size_t leaf_count() const noexcept { return leaves_.size(); }
+
+private:
+    static constexpr unsigned STRIDE = 6;
+    static constexpr unsigned FANOUT = 1u << STRIDE;
+    static constexpr uint32_t LEAF = 0x80000000;   // Direct entry holding a value rather than a node
+
+    struct Node {
+        uint64_t children;    // Slots that continue in a child node
+        uint64_t leaf_runs;   // Slots where a run of equal leaves starts
+        uint32_t child_base;
+        uint32_t leaf_base;
+    };
+
+    // Binary trie the compressed one is built from
+    struct BuildNode {
+        int child[2] = {-1, -1};
+        uint32_t value = NO_VALUE;
+    };
+
+    void fillDirect(const std::vector<BuildNode>& trie, int node, unsigned depth, uint32_t bits, uint32_t best);
+    void buildNode(const std::vector<BuildNode>& trie, int node, unsigned depth, uint32_t best, uint32_t index);
+
+    std::vector<uint32_t> direct_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> leaves_;
+};
+
+/**
+ * @class RouteSimulator
+ * @brief Route lookups over the static routes, connected subnets and routing rules of a program
+ *
+ * Connected subnets come from the addresses of the IP section, in the main
+ * table at distance 0. Static routes come from the routing section and
+ * from IP routes. A static route is usable when one of its gateways is an
+ * interface that is up, or an address inside a connected subnet of such an
+ * interface. Of the usable routes to one destination in one table, the
+ * lowest distance wins, the first declared among equals.
+ *
+ * Routing rules are tried in order. The first that matches the source,
+ * destination and in-interface of a query picks the table, or drops the
+ * query. A lookup action falls back to main when its table has no route;
+ * lookup-only-in-table does not.
+ *
+ * Interfaces can be taken down to see what a failure does: their subnets
+ * disappear, routes through them stop being usable, and backup routes
+ * take over.
+ */
+class RouteSimulator {
+public:
+    static constexpr uint32_t NO_ROUTE = RouteLookup::NO_VALUE;
+
+    struct Route {
+        std::string name;
+        std::string table;
+        IPv4Prefix destination;
+        std::string gateway;      // Empty for a connected subnet
+        std::string interface;    // Interface packets leave through, once usable
+        int distance;
+        int line;
+        int column;
+        bool usable = false;      // Its interface is up
+        bool active = false;      // Usable and the best route to its destination
+    };
+
+    enum class RuleAction : uint8_t {
+        LOOKUP,
+        LOOKUP_ONLY_IN_TABLE,
+        DROP,
+        UNREACHABLE
+    };
+
+    struct Rule {
+        std::string name;
+        IPv4Prefix source;
+        IPv4Prefix destination;   // /0 when the rule does not match on it
+        uint32_t interface;       // 0 when the rule does not match on it
+        RuleAction action;
+        uint32_t table;           // Index into tables()
+        bool has_source;
+        int line;
+        int column;
+    };
+
+    struct Query {
+        uint32_t destination;
+        uint32_t source;
+        uint32_t interface;       // From interface_id(); 0 for none
+        bool has_source;
+    };
+
+    struct Result {
+        uint32_t route;           // Index into routes(), or NO_ROUTE
+        uint32_t rule;            // Index into rules() of the rule that decided, or NO_ROUTE
+    };
+
+    /**
+     * @param ast The program
+     * @param down Interfaces to take down
+     */
+    RouteSimulator(const FlatAst& ast, const std::vector<std::string>& down);
+
+    Result lookup(const Query& query) const noexcept;
+
+    // Same as lookup(), walking a binary trie bit by bit, to compare the two
+    Result lookup_binary(const Query& query) const noexcept;
+
+    /**
+     * @brief Read queries, one "destination [source [in-interface]]" per line
+     * @param path The file; fields may be separated by spaces, tabs or commas
+     * @param queries Receives the queries
+     * @return Success flag and error message, located at the offending line
+     */
+    std::tuple<bool, std::string> load_queries(const std::string& path, std::vector<Query>& queries) const;
+
+    // Id of an interface the routing rules name, or 0
+    uint32_t interface_id(std::string_view name) const noexcept;
+
+    // Whether the program has the interface, through an address or a route gateway
+    bool has_interface(std::string_view name) const noexcept;
+
+    const std::vector<Route>& routes() const noexcept { return routes_; }
+    const std::vector<Rule>& rules() const noexcept { return rules_; }
+    const std::vector<std::string>& tables() const noexcept { return tables_; }
+
+private:
+    void collectRoutingSection(const FlatAst& ast, FlatAst::NodeId section);
+    void collectIPSection(const FlatAst& ast, FlatAst::NodeId section);
+    void addRoute(const FlatAst& ast, FlatAst::NodeId site, std::string name, const std::string& table,
+                  std::string_view destination, std::string gateway, int distance);
+    uint32_t tableId(std::string_view name);
+    void resolve(const std::vector<std::string>& down);
+
+    template <typename Find>
+    Result decide(const Query& query, Find find) const noexcept;
+
+    std::vector<Route> routes_;
+    std::vector<Rule> rules_;
+    std::vector<std::string> tables_;           // main first
+    std::vector<RouteLookup> lookups_;          // One per table
+    std::vector<PrefixTrie<uint32_t>> tries_;   // One per table, for lookup_binary()
+    std::unordered_map<std::string, uint32_t> interface_ids_;
+    std::vector<std::string> interfaces_;       // Every interface named by an address or a gateway
+};
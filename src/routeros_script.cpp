@@ -0,0 +1,466 @@
+#include "routeros_script.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::string_view VERBS[] = {
+    "add", "set", "remove", "unset", "enable", "disable", "comment", "move", "reset", "print", "export",
+};
+
+bool is_blank(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Split a line at blanks outside quotes. Lines using variables, command
+// substitution, arrays or escapes outside strings are not plain commands.
+bool split_tokens(std::string_view line, std::vector<std::string_view>& tokens) {
+    size_t pos = 0;
+    while (pos < line.size()) {
+        if (is_blank(line[pos])) {
+            pos++;
+            continue;
+        }
+        size_t start = pos;
+        bool quoted = false;
+        while (pos < line.size() && (quoted || !is_blank(line[pos]))) {
+            char c = line[pos];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (c == '$' || c == '[') {
+                return false;
+            } else if (quoted && c == '\\') {
+                pos++;
+            } else if (!quoted && std::string_view("]{}();\\").find(c) != std::string_view::npos) {
+                return false;
+            }
+            pos++;
+        }
+        if (quoted) {
+            return false;
+        }
+        tokens.push_back(line.substr(start, std::min(pos, line.size()) - start));
+    }
+    return true;
+}
+
+// Text a value stands for, if it can become an element of a loop array:
+// either fully quoted or free of quotes, and without escapes
+bool loop_value(std::string_view value, std::string_view& content) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        content = value.substr(1, value.size() - 2);
+    } else {
+        content = value;
+    }
+    return content.find_first_of("\"\\") == std::string_view::npos;
+}
+
+int char_class(char c) noexcept {
+    if (c >= '0' && c <= '9') {
+        return 1;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+        return 2;
+    }
+    return 0;
+}
+
+// Whether cutting between two characters splits a number or a word
+bool splits_run(char before, std::string_view after) noexcept {
+    return !after.empty() && char_class(before) != 0 && char_class(before) == char_class(after.front());
+}
+
+bool splits_run(std::string_view before, char after) noexcept {
+    return !before.empty() && char_class(after) != 0 && char_class(after) == char_class(before.back());
+}
+
+// Text around the varying part of a value, e.g. "vlan" around 100 in vlan100
+struct Affixes
+{
+    std::string_view prefix;
+    std::string_view suffix;
+
+    // The varying part of a value, or false if it does not have these affixes
+    bool core(std::string_view content, std::string_view& result) const noexcept {
+        if (content.size() < prefix.size() + suffix.size() || content.substr(0, prefix.size()) != prefix ||
+            content.substr(content.size() - suffix.size()) != suffix) {
+            return false;
+        }
+        result = content.substr(prefix.size(), content.size() - prefix.size() - suffix.size());
+        return true;
+    }
+
+    // Longest affixes two values share that do not cut through a number or word
+    static Affixes common(std::string_view a, std::string_view b) noexcept {
+        size_t prefix = 0;
+        while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix]) {
+            prefix++;
+        }
+        while (prefix > 0 && (splits_run(a[prefix - 1], a.substr(prefix)) ||
+                              splits_run(b[prefix - 1], b.substr(prefix)))) {
+            prefix--;
+        }
+
+        std::string_view rest_a = a.substr(prefix);
+        std::string_view rest_b = b.substr(prefix);
+        size_t suffix = 0;
+        while (suffix < rest_a.size() && suffix < rest_b.size() &&
+               rest_a[rest_a.size() - 1 - suffix] == rest_b[rest_b.size() - 1 - suffix]) {
+            suffix++;
+        }
+        while (suffix > 0 && (splits_run(rest_a.substr(0, rest_a.size() - suffix), rest_a[rest_a.size() - suffix]) ||
+                              splits_run(rest_b.substr(0, rest_b.size() - suffix), rest_b[rest_b.size() - suffix]))) {
+            suffix--;
+        }
+        return {a.substr(0, prefix), rest_a.substr(rest_a.size() - suffix)};
+    }
+};
+
+// A run of commands that can become one loop
+class LoopRun
+{
+public:
+    // Start a run from its first two commands
+    bool start(const ScriptCommand& first, const ScriptCommand& second) {
+        first_ = &first;
+        varying_.clear();
+        affixes_.clear();
+        elements_.clear();
+        if (!sameShape(second)) {
+            return false;
+        }
+        for (size_t i = 0; i < first.arguments.size(); i++) {
+            if (first.arguments[i].value != second.arguments[i].value) {
+                varying_.push_back(i);
+            }
+        }
+        if (varying_.empty()) {
+            return false;
+        }
+
+        for (size_t index : varying_) {
+            std::string_view a;
+            std::string_view b;
+            if (first.arguments[index].name.empty() || !loop_value(first.arguments[index].value, a) ||
+                !loop_value(second.arguments[index].value, b)) {
+                return false;
+            }
+            // A single varying value is used whole
+            affixes_.push_back(varying_.size() == 1 ? Affixes() : Affixes::common(a, b));
+        }
+        return add(first) && add(second);
+    }
+
+    // Add the next command if it differs from the first only in the varying value
+    bool add(const ScriptCommand& command) {
+        if (!sameShape(command)) {
+            return false;
+        }
+        std::string_view element;
+        size_t next = 0;
+        for (size_t i = 0; i < command.arguments.size(); i++) {
+            std::string_view value = command.arguments[i].value;
+            if (next < varying_.size() && varying_[next] == i) {
+                std::string_view content;
+                std::string_view core;
+                if (!loop_value(value, content) || !affixes_[next].core(content, core) ||
+                    (next > 0 && core != element)) {
+                    return false;
+                }
+                element = core;
+                next++;
+            } else if (value != first_->arguments[i].value) {
+                return false;
+            }
+        }
+        elements_.push_back(element);
+        return true;
+    }
+
+    size_t size() const noexcept { return elements_.size(); }
+
+    // Write the loop over elements [begin, end)
+    void emit(size_t begin, size_t end, std::string& out) const {
+        out += ":foreach i in={";
+        for (size_t k = begin; k < end; k++) {
+            if (k > begin) {
+                out += ';';
+            }
+            out += '"';
+            out += elements_[k];
+            out += '"';
+        }
+        out += "} do={";
+        out += first_->menu;
+        out += ' ';
+        out += first_->verb;
+
+        size_t next = 0;
+        for (size_t i = 0; i < first_->arguments.size(); i++) {
+            const ScriptArgument& argument = first_->arguments[i];
+            out += ' ';
+            if (!argument.name.empty()) {
+                out += argument.name;
+                out += '=';
+            }
+            if (next < varying_.size() && varying_[next] == i) {
+                const Affixes& affixes = affixes_[next++];
+                if (affixes.prefix.empty() && affixes.suffix.empty()) {
+                    out += "$i";
+                    continue;
+                }
+                out += '(';
+                if (!affixes.prefix.empty()) {
+                    out += '"';
+                    out += affixes.prefix;
+                    out += "\" . ";
+                }
+                out += "$i";
+                if (!affixes.suffix.empty()) {
+                    out += " . \"";
+                    out += affixes.suffix;
+                    out += '"';
+                }
+                out += ')';
+            } else {
+                out += argument.value;
+            }
+        }
+        out += "}\n";
+    }
+
+private:
+    bool sameShape(const ScriptCommand& command) const noexcept {
+        if (command.menu != first_->menu || command.verb != first_->verb ||
+            command.arguments.size() != first_->arguments.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < command.arguments.size(); i++) {
+            if (command.arguments[i].name != first_->arguments[i].name) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const ScriptCommand* first_ = nullptr;
+    std::vector<size_t> varying_;        // Argument positions that change, in order
+    std::vector<Affixes> affixes_;       // One per varying position
+    std::vector<std::string_view> elements_;
+};
+
+std::vector<std::string_view> split_lines(std::string_view script) {
+    std::vector<std::string_view> lines;
+    for (size_t start = 0; start < script.size();) {
+        size_t end = script.find('\n', start);
+        if (end == std::string_view::npos) {
+            end = script.size();
+        }
+        lines.push_back(script.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+// Arguments whose value names an object other commands may refer to
+bool creates_name(std::string_view argument) noexcept {
+    return argument == "name" || argument == "list";
+}
+
+// Call f(item) for each comma separated item of an argument value
+template <typename F>
+void for_each_item(std::string_view value, F&& f) {
+    std::string_view content;
+    loop_value(value, content);
+    size_t start = 0;
+    while (start <= content.size()) {
+        size_t end = std::min(content.find(',', start), content.size());
+        f(content.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// Order in which sort_by_menu() writes a run of commands
+std::vector<size_t> menu_order(const std::vector<ScriptCommand>& commands) {
+    std::unordered_map<std::string_view, size_t> group_of;
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < commands.size(); i++) {
+        auto [it, inserted] = group_of.emplace(commands[i].menu, groups.size());
+        if (inserted) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(i);
+    }
+
+    std::vector<size_t> order;
+    std::vector<size_t> position(commands.size());
+    order.reserve(commands.size());
+    for (const auto& group : groups) {
+        for (size_t index : group) {
+            position[index] = order.size();
+            order.push_back(index);
+        }
+    }
+
+    // The first command naming an object creates it
+    std::unordered_map<std::string_view, size_t> creator;
+    for (size_t i = 0; i < commands.size(); i++) {
+        for (const ScriptArgument& argument : commands[i].arguments) {
+            if (creates_name(argument.name)) {
+                for_each_item(argument.value, [&](std::string_view name) { creator.emplace(name, i); });
+            }
+        }
+    }
+    for (size_t i = 0; i < commands.size(); i++) {
+        bool moved_ahead = false;
+        for (const ScriptArgument& argument : commands[i].arguments) {
+            for_each_item(argument.value, [&](std::string_view item) {
+                auto it = creator.find(item);
+                moved_ahead = moved_ahead || (it != creator.end() && it->second < i && position[it->second] > position[i]);
+            });
+        }
+        if (moved_ahead) {
+            std::vector<size_t> unchanged(commands.size());
+            for (size_t k = 0; k < unchanged.size(); k++) {
+                unchanged[k] = k;
+            }
+            return unchanged;
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+bool ScriptCommand::parse(std::string_view line, ScriptCommand& command) {
+    std::vector<std::string_view> tokens;
+    if (line.empty() || line.front() != '/' || !split_tokens(line, tokens)) {
+        return false;
+    }
+
+    size_t verb = 0;
+    while (verb < tokens.size() &&
+           std::find(std::begin(VERBS), std::end(VERBS), tokens[verb]) == std::end(VERBS)) {
+        if (tokens[verb].find_first_of("=\"") != std::string_view::npos) {
+            return false;
+        }
+        verb++;
+    }
+    if (verb == 0 || verb == tokens.size()) {
+        return false;
+    }
+
+    command.menu = line.substr(0, tokens[verb - 1].data() + tokens[verb - 1].size() - line.data());
+    command.verb = tokens[verb];
+    command.arguments.clear();
+    for (size_t i = verb + 1; i < tokens.size(); i++) {
+        std::string_view token = tokens[i];
+        size_t equals = token.find('=');
+        if (equals != std::string_view::npos && equals > 0 && token.find('"') > equals) {
+            command.arguments.push_back({token.substr(0, equals), token.substr(equals + 1)});
+        } else {
+            command.arguments.push_back({std::string_view(), token});
+        }
+    }
+    return true;
+}
+
+std::string compact_loops(std::string_view script) {
+    std::vector<std::string_view> lines = split_lines(script);
+
+    std::string out;
+    out.reserve(script.size());
+    auto copy_line = [&](size_t index) {
+        out += lines[index];
+        // Keep a missing final newline missing
+        if (lines[index].data() + lines[index].size() < script.data() + script.size()) {
+            out += '\n';
+        }
+    };
+
+    ScriptCommand first;
+    ScriptCommand next;
+    LoopRun run;
+    size_t i = 0;
+    while (i < lines.size()) {
+        if (i + 1 >= lines.size() || !ScriptCommand::parse(lines[i], first) ||
+            !ScriptCommand::parse(lines[i + 1], next) || !run.start(first, next)) {
+            copy_line(i++);
+            continue;
+        }
+        size_t end = i + run.size();
+        while (end < lines.size() && ScriptCommand::parse(lines[end], next) && run.add(next)) {
+            end++;
+        }
+        if (run.size() < MIN_LOOP_RUN) {
+            copy_line(i++);
+            continue;
+        }
+
+        // Leftovers too short for a loop of their own stay single commands
+        for (size_t begin = 0; begin < run.size(); begin += MAX_LOOP_VALUES) {
+            size_t end = std::min(begin + MAX_LOOP_VALUES, run.size());
+            if (end - begin >= MIN_LOOP_RUN) {
+                run.emit(begin, end, out);
+            } else {
+                for (size_t k = begin; k < end; k++) {
+                    copy_line(i + k);
+                }
+            }
+        }
+        i += run.size();
+    }
+    return out;
+}
+
+std::string sort_by_menu(std::string_view script) {
+    std::string out;
+    out.reserve(script.size());
+    std::vector<std::string_view> run_lines;
+    std::vector<ScriptCommand> run;
+    auto flush = [&]() {
+        for (size_t index : menu_order(run)) {
+            out += run_lines[index];
+            out += '\n';
+        }
+        run_lines.clear();
+        run.clear();
+    };
+
+    ScriptCommand command;
+    for (std::string_view line : split_lines(script)) {
+        if (ScriptCommand::parse(line, command)) {
+            run_lines.push_back(line);
+            run.push_back(std::move(command));
+            continue;
+        }
+        flush();
+        out += line;
+        out += '\n';
+    }
+    flush();
+    return out;
+}
+
+std::string group_menus(std::string_view script) {
+    std::string out;
+    out.reserve(script.size());
+    std::string_view context;
+    ScriptCommand command;
+    for (std::string_view line : split_lines(script)) {
+        if (!ScriptCommand::parse(line, command)) {
+            context = std::string_view();
+            out += line;
+            out += '\n';
+            continue;
+        }
+        if (command.menu != context) {
+            context = command.menu;
+            out += context;
+            out += '\n';
+        }
+        out += line.substr(command.verb.data() - line.data());
+        out += '\n';
+    }
+    return out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One argument of a RouterOS command: name=value, or a bare value such as
+// the item in "set ether1"
+struct ScriptArgument
+{
+    std::string_view name;  // Empty for a positional argument
+    std::string_view value; // As written, including any quotes
+};
+
+// A line of a RouterOS script split into menu, verb and arguments. The views
+// point into the script text.
+struct ScriptCommand
+{
+    std::string_view menu; // "/ip firewall filter"
+    std::string_view verb; // "add"
+    std::vector<ScriptArgument> arguments;
+
+    // Split one line. Comments, blank lines and anything but a plain menu
+    // command (variables, subcommands, arrays) are rejected.
+    static bool parse(std::string_view line, ScriptCommand& command);
+};
+
+// Fewest consecutive commands worth a loop
+constexpr size_t MIN_LOOP_RUN = 4;
+
+// Most values in the array of one loop, so no line grows without bound
+constexpr size_t MAX_LOOP_VALUES = 256;
+
+// Rewrite runs of commands that share menu, verb and arguments except for one
+// varying value as loops over an inline array:
+//
+//   :foreach i in={"10.0.0.1";"10.0.0.2";...} do={/ip firewall address-list add list=blocked address=$i}
+//
+// Several arguments may vary together if they only differ in the same
+// embedded value, as name=vlan100 vlan-id=100 does. Every other line is
+// copied unchanged, so running the result has the same effect.
+std::string compact_loops(std::string_view script);
+
+// Reorder each run of commands between comments so commands of the same menu
+// follow each other, in the order the menus first appear. Commands of one menu
+// keep their order, and a run is left alone if a command would move ahead of
+// the command creating a name it refers to.
+std::string sort_by_menu(std::string_view script);
+
+// Write consecutive commands of one menu under a single menu line:
+//
+//   /ip firewall filter
+//   add chain=input action=accept
+//   add chain=input action=drop
+//
+// Any other line ends the context, so the menu is written again after it.
+std::string group_menus(std::string_view script);
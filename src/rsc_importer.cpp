@@ -0,0 +1,1324 @@
+#include "rsc_importer.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "command_schema.hpp"
+#include "declaration.hpp"
+#include "expression.hpp"
+#include "ipv4_prefix.hpp"
+#include "ipv6_address.hpp"
+#include "keywords.hpp"
+#include "property_schema.hpp"
+#include "section_factory.hpp"
+
+namespace {
+
+using Format = CommandParameter::Format;
+using SectionType = SectionStatement::SectionType;
+
+// What a command becomes in the AST
+enum class Target : uint8_t {
+    IDENTITY,
+    ETHERNET,
+    VLAN,
+    BRIDGE,
+    BONDING,
+    BRIDGE_PORT,
+    LIST_MEMBER,
+    IP_ADDRESS,
+    DHCP_CLIENT,
+    DHCP_SERVER,
+    DNS,
+    ROUTE,
+    ROUTING_TABLE,
+    ROUTING_RULE,
+    FIREWALL_RULE,
+    ADDRESS_LIST
+};
+
+// Commands the device and interface translators write without a schema.
+// Parameters without a key are read by the importer itself.
+constexpr CommandParameter IDENTITY_PARAMETERS[] = {
+    {"name", "name"},
+};
+constexpr CommandSchema IDENTITY{"/system identity", "set", IDENTITY_PARAMETERS};
+
+constexpr CommandParameter ETHERNET_PARAMETERS[] = {
+    {"", "name"},
+    {"mtu", "mtu"},
+    {"disabled", "disabled"},
+    {"mac-address", "mac-address"},
+    {"comment", "comment"},
+    {"advertise", "advertise"},
+    {"arp", "arp"},
+};
+constexpr CommandSchema ETHERNET{"/interface ethernet", "set", ETHERNET_PARAMETERS};
+
+constexpr CommandParameter VLAN_PARAMETERS[] = {
+    {"", "name"},
+    {"vlan-id", "vlan-id"},
+    {"interface", "interface"},
+    {"disabled", "disabled"},
+    {"mtu", "mtu"},
+    {"comment", "comment"},
+};
+constexpr CommandSchema VLAN{"/interface vlan", "add", VLAN_PARAMETERS};
+
+constexpr CommandParameter BRIDGE_PARAMETERS[] = {
+    {"", "name"},
+    {"disabled", "disabled"},
+    {"mtu", "mtu"},
+    {"comment", "comment"},
+    {"protocol-mode", "protocol-mode"},
+    {"fast-forward", "fast-forward"},
+};
+constexpr CommandSchema BRIDGE{"/interface bridge", "add", BRIDGE_PARAMETERS};
+
+constexpr CommandParameter BONDING_PARAMETERS[] = {
+    {"", "name"},
+    {"disabled", "disabled"},
+    {"mtu", "mtu"},
+    {"comment", "comment"},
+    {"mode", "mode"},
+    {"", "slaves"},
+};
+constexpr CommandSchema BONDING{"/interface bonding", "add", BONDING_PARAMETERS};
+
+constexpr CommandParameter BRIDGE_PORT_PARAMETERS[] = {
+    {"", "bridge"},
+    {"", "interface"},
+};
+constexpr CommandSchema BRIDGE_PORT{"/interface bridge port", "add", BRIDGE_PORT_PARAMETERS};
+
+constexpr CommandParameter LIST_MEMBER_PARAMETERS[] = {
+    {"", "list"},
+    {"", "interface"},
+};
+constexpr CommandSchema LIST_MEMBER{"/interface list member", "add", LIST_MEMBER_PARAMETERS};
+
+constexpr uint32_t INTERFACE_CONTEXTS = PropertySchema::INTERFACE_COMMON | PropertySchema::INTERFACE_VLAN |
+                                        PropertySchema::INTERFACE_BONDING | PropertySchema::INTERFACE_BRIDGE |
+                                        PropertySchema::INTERFACE_ETHERNET;
+constexpr uint32_t RULE_CONTEXTS = PropertySchema::FIREWALL_RULE_PROPERTY |
+                                   PropertySchema::CONNECTION_STATE_PROPERTY | PropertySchema::NAT_PROPERTY;
+
+// Verbs of RouterOS menus; any other word after a menu path is part of the path
+constexpr std::string_view VERBS[] = {
+    "add", "set", "remove", "enable", "disable", "unset", "move", "comment", "reset", "print", "edit", "export",
+    "find",
+};
+
+// Parameters RouterOS derives from others, which the translators never write
+constexpr std::pair<std::string_view, std::string_view> DERIVED_PARAMETERS[] = {
+    {"/ip address", "network"},
+};
+
+// Words the grammar's property_name rule accepts as keywords, each standing for itself
+constexpr std::string_view PROPERTY_KEYWORDS[] = {
+    "vendor", "model", "hostname", "type", "admin_state", "address", "static_route_default_gw", "chain",
+    "connection_state", "action", "speed", "duplex", "vlan_id", "interface", "destination", "gateway",
+    "out_interface", "in_interface", "src_address", "dst_address", "src_port", "dst_port", "to_addresses",
+    "to_ports", "mode", "slaves", "protocol", "distance", "mtu",
+};
+
+// Parameters naming an interface, which the symbol table checks
+constexpr std::string_view INTERFACE_PARAMETERS[] = {"interface", "in-interface", "out-interface"};
+
+// Subsections a generated route name must not take, since the routing translator reads them differently
+constexpr std::string_view ROUTING_SUBSECTIONS[] = {"table", "tables", "rule", "rules", "filter"};
+
+template <typename Range>
+bool contains(const Range& range, std::string_view word) noexcept {
+    for (std::string_view entry : range) {
+        if (entry == word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_yes(std::string_view value) noexcept {
+    return value == "yes" || value == "true";
+}
+
+// A word of the grammar: a letter, then letters, digits and underscores
+bool is_word(std::string_view name) noexcept {
+    if (name.empty() || !isalpha(static_cast<unsigned char>(name[0]))) {
+        return false;
+    }
+    for (char c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool spells_property(std::string_view name) noexcept {
+    return is_word(name) && (keyword_token(name) == TOKEN_IDENTIFIER || contains(PROPERTY_KEYWORDS, name));
+}
+
+bool spells_section(std::string_view name) noexcept {
+    if (!is_word(name)) {
+        return false;
+    }
+    switch (keyword_token(name)) {
+        case TOKEN_IDENTIFIER:
+        case TOKEN_ETHERNET:
+        case TOKEN_VLAN:
+        case TOKEN_IP:
+        case TOKEN_DHCP:
+        case TOKEN_DHCP_SERVER:
+        case TOKEN_DHCP_CLIENT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// DSL property for a RouterOS parameter key in some contexts: the first schema
+// word the grammar can spell, else the first schema word, else the key itself
+std::string_view dsl_property(std::string_view key, uint32_t contexts) {
+    std::string_view fallback;
+    for (const PropertySchema::Entry& entry : PROPERTY_SCHEMA_ENTRIES) {
+        if ((entry.contexts & contexts) == 0 || entry.routeros_name != key) {
+            continue;
+        }
+        if (spells_property(entry.name)) {
+            return entry.name;
+        }
+        if (fallback.empty()) {
+            fallback = entry.name;
+        }
+    }
+    if (PropertySchema::routeros_name(key) == key && (fallback.empty() || spells_property(key))) {
+        return key;
+    }
+    return fallback.empty() ? key : fallback;
+}
+
+int hex_digit(char c) noexcept {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string decode_value(std::string_view raw);
+
+// Elements of a RouterOS array such as {"established";"related"}, each
+// decoded and joined with commas the way a list parameter is written
+std::string decode_array(std::string_view raw) {
+    std::string values;
+    size_t start = 1;
+    bool quoted = false;
+    for (size_t i = 1; i < raw.size(); i++) {
+        if (raw[i] == '\\') {
+            i++;
+        } else if (raw[i] == '"') {
+            quoted = !quoted;
+        } else if (!quoted && (raw[i] == ',' || raw[i] == ';' || i + 1 == raw.size())) {
+            std::string value = decode_value(raw.substr(start, i - start));
+            if (!value.empty()) {
+                values += values.empty() ? "" : ",";
+                values += value;
+            }
+            start = i + 1;
+        }
+    }
+    return values;
+}
+
+// Contents of a RouterOS value, without quotes and with escapes resolved
+std::string decode_value(std::string_view raw) {
+    if (raw.size() >= 2 && raw.front() == '{' && raw.back() == '}') {
+        return decode_array(raw);
+    }
+    if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"') {
+        raw = raw.substr(1, raw.size() - 2);
+    }
+    if (raw.find('\\') == std::string_view::npos) {
+        return std::string(raw);
+    }
+
+    std::string value;
+    value.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+        if (raw[i] != '\\' || i + 1 == raw.size()) {
+            value += raw[i];
+            continue;
+        }
+        char next = raw[++i];
+        // Exports write bytes outside ASCII as two upper case hex digits
+        if (i + 1 < raw.size() && hex_digit(next) >= 0 && hex_digit(raw[i + 1]) >= 0) {
+            value += static_cast<char>(hex_digit(next) * 16 + hex_digit(raw[i + 1]));
+            i++;
+            continue;
+        }
+        switch (next) {
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'a': value += '\a'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'v': value += '\v'; break;
+            case '_': value += ' '; break;
+            default: value += next; break; // \\ \" \$ \? and anything else stand for themselves
+        }
+    }
+    return value;
+}
+
+// A value typed the way the scanner types the same literal
+Value* typed_value(const std::string& text) {
+    if (text.find('/') != std::string::npos) {
+        IPv4Prefix prefix;
+        if (IPv4Prefix::parse(text, prefix)) {
+            return new IPCIDRValue(text);
+        }
+    } else {
+        uint32_t address = 0;
+        if (parse_ipv4_address(text, address)) {
+            return new IPAddressValue(text);
+        }
+    }
+
+    IPv6Match ipv6 = match_ipv6(text);
+    if (ipv6.form != IPv6Form::NONE && ipv6.length == text.size()) {
+        return new StringValue(text);
+    }
+
+    // Numbers the scanner would read back unchanged
+    if (!text.empty() && text.size() <= 9 && (text[0] != '0' || text.size() == 1) &&
+        text.find_first_not_of("0123456789") == std::string::npos) {
+        return new NumberValue(atoi(text.c_str()));
+    }
+    return new StringValue(text, true);
+}
+
+// A list of quoted names from a comma separated value
+ListValue* name_list(std::string_view values) {
+    ValueList names;
+    size_t start = 0;
+    while (start <= values.size()) {
+        size_t comma = values.find(',', start);
+        if (comma == std::string_view::npos) {
+            comma = values.size();
+        }
+        if (comma > start) {
+            names.push_back(new StringValue(values.substr(start, comma - start), true));
+        }
+        start = comma + 1;
+    }
+    return new ListValue(names);
+}
+
+PropertyStatement* property(std::string_view name, Expression* value, int line, int column) {
+    auto* statement = new PropertyStatement(name, value);
+    statement->set_location(line, column);
+    return statement;
+}
+
+// Name of a rule or route taken from its comment, made into a word of the grammar
+std::string name_from_comment(std::string_view comment, std::string_view kind) {
+    std::string name;
+    for (char c : comment) {
+        if (isalnum(static_cast<unsigned char>(c))) {
+            name += c;
+        } else if (!name.empty() && name.back() != '_') {
+            name += '_';
+        }
+    }
+    while (!name.empty() && name.back() == '_') {
+        name.pop_back();
+    }
+    if (name.empty()) {
+        return name;
+    }
+    if (!isalpha(static_cast<unsigned char>(name[0]))) {
+        name = std::string(kind) + "_" + name;
+    } else if (keyword_token(name) != TOKEN_IDENTIFIER) {
+        name += "_" + std::string(kind);
+    }
+    return name;
+}
+
+struct Word {
+    std::string_view text;
+    int column;
+};
+
+// Characters that end a word or change how the rest of it is read
+constexpr auto WORD_BREAKS = [] {
+    std::array<bool, 256> breaks{};
+    for (char c : std::string_view(" \t\"[]{}\\")) {
+        breaks[static_cast<unsigned char>(c)] = true;
+    }
+    return breaks;
+}();
+
+// Split a line at blanks outside quotes, [ ... ] groups and { ... } arrays; false if one is left open
+bool split_words(std::string_view line, std::vector<Word>& words) {
+    words.clear();
+    size_t i = 0;
+    while (i < line.size()) {
+        if (line[i] == ' ' || line[i] == '\t') {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        bool quoted = false;
+        int depth = 0;
+        for (; i < line.size(); i++) {
+            while (i < line.size() && !WORD_BREAKS[static_cast<unsigned char>(line[i])]) {
+                i++;
+            }
+            if (i == line.size()) {
+                break;
+            }
+            char c = line[i];
+            if (c == '\\') {
+                i++;
+            } else if (c == '"') {
+                quoted = !quoted;
+            } else if (!quoted && (c == '[' || c == '{')) {
+                depth++;
+            } else if (!quoted && (c == ']' || c == '}')) {
+                depth--;
+            } else if (!quoted && depth <= 0 && (c == ' ' || c == '\t')) {
+                break;
+            }
+        }
+        if (quoted || depth > 0) {
+            return false;
+        }
+        i = std::min(i, line.size());
+        words.push_back({line.substr(start, i - start), static_cast<int>(start) + 1});
+    }
+    return true;
+}
+
+// Append one word of a menu path, so "/ip/firewall" and "/ip firewall" give the same menu
+void append_menu(std::string& menu, std::string_view word) {
+    size_t start = 0;
+    while (start < word.size()) {
+        size_t slash = word.find('/', start);
+        if (slash == std::string_view::npos) {
+            slash = word.size();
+        }
+        if (slash > start) {
+            menu += menu.empty() ? "/" : " ";
+            menu += word.substr(start, slash - start);
+        }
+        start = slash + 1;
+    }
+}
+
+bool is_menu_word(std::string_view word) noexcept {
+    return word.find('=') == std::string_view::npos && word.front() != '[' && word.front() != '"' &&
+           !contains(VERBS, word);
+}
+
+// The item a "[ find ... ]" selects: its default name, else its name
+std::string find_item(std::string_view query) {
+    std::vector<Word> words;
+    split_words(query.substr(1, query.size() - 2), words);
+    std::string name;
+    for (const Word& word : words) {
+        if (word.text.substr(0, 13) == "default-name=") {
+            return decode_value(word.text.substr(13));
+        }
+        if (word.text.substr(0, 5) == "name=") {
+            name = decode_value(word.text.substr(5));
+        }
+    }
+    return name;
+}
+
+namespace commands = routeros_commands;
+
+struct MenuEntry {
+    const CommandSchema& schema;
+    Target target;
+    uint32_t contexts;  // Contexts the DSL properties of the parameters are looked up in
+};
+
+const MenuEntry MENU_ENTRIES[] = {
+    {IDENTITY, Target::IDENTITY, PropertySchema::DEVICE_PROPERTY},
+    {ETHERNET, Target::ETHERNET, INTERFACE_CONTEXTS},
+    {VLAN, Target::VLAN, INTERFACE_CONTEXTS},
+    {BRIDGE, Target::BRIDGE, INTERFACE_CONTEXTS},
+    {BONDING, Target::BONDING, INTERFACE_CONTEXTS},
+    {BRIDGE_PORT, Target::BRIDGE_PORT, 0},
+    {LIST_MEMBER, Target::LIST_MEMBER, 0},
+    {commands::IP_ADDRESS, Target::IP_ADDRESS, 0},
+    {commands::DHCP_CLIENT, Target::DHCP_CLIENT, 0},
+    {commands::DHCP_SERVER, Target::DHCP_SERVER, 0},
+    {commands::DNS, Target::DNS, PropertySchema::IP_DIRECT_PROPERTY},
+    {commands::STATIC_ROUTE, Target::ROUTE, PropertySchema::ROUTE_PROPERTY},
+    {commands::ROUTING_TABLE, Target::ROUTING_TABLE, 0},
+    {commands::ROUTING_RULE, Target::ROUTING_RULE, PropertySchema::ROUTE_PROPERTY},
+    {commands::FILTER_RULE, Target::FIREWALL_RULE, RULE_CONTEXTS},
+    {commands::NAT_RULE, Target::FIREWALL_RULE, RULE_CONTEXTS},
+    {commands::RAW_RULE, Target::FIREWALL_RULE, RULE_CONTEXTS},
+    {commands::ADDRESS_LIST_ENTRY, Target::ADDRESS_LIST, 0},
+};
+
+const char* interface_type(Target target) noexcept {
+    switch (target) {
+        case Target::ETHERNET: return "ethernet";
+        case Target::VLAN: return "vlan";
+        case Target::BRIDGE: return "bridge";
+        case Target::BONDING: return "bonding";
+        default: return "";
+    }
+}
+
+} // namespace
+
+struct RscImporter::MenuMapping {
+    const CommandSchema& schema;
+    Target target;
+    std::vector<std::string_view> properties;  // DSL property of each parameter, empty for those read directly
+};
+
+const RscImporter::MenuMapping* RscImporter::findMapping(std::string_view menu, std::string_view verb) {
+    static const std::vector<MenuMapping> mappings = [] {
+        std::vector<MenuMapping> table;
+        for (const MenuEntry& entry : MENU_ENTRIES) {
+            std::vector<std::string_view> properties;
+            for (size_t i = 0; i < entry.schema.parameter_count; i++) {
+                std::string_view key = entry.schema.parameters[i].key;
+                properties.push_back(key.empty() ? key : dsl_property(key, entry.contexts));
+            }
+            table.push_back({entry.schema, entry.target, std::move(properties)});
+        }
+        return table;
+    }();
+    for (const MenuMapping& mapping : mappings) {
+        if (mapping.schema.menu == menu && mapping.schema.verb == verb) {
+            return &mapping;
+        }
+    }
+    return nullptr;
+}
+
+// One command line split into menu, verb and arguments. The views point into
+// the line, which lives until the command is imported.
+struct RscImporter::Command {
+    struct Argument {
+        std::string_view name;
+        std::string_view value;  // As written
+        int column;
+        bool used;               // Already read by the importer
+    };
+
+    std::string inline_menu;     // Menu written on the command line itself
+    std::string_view menu;
+    std::string_view verb;
+    std::string item;            // What a set command changes: a name, a number or a [ find ] match
+    std::vector<Argument> arguments;
+    std::vector<std::string_view> flags;  // Bare words such as "fib"
+    std::vector<Word> words;
+
+    Argument* find(std::string_view name) noexcept {
+        for (Argument& argument : arguments) {
+            if (argument.name == name) {
+                return &argument;
+            }
+        }
+        return nullptr;
+    }
+
+    // Decoded value of a parameter, marking it read; empty if it is missing
+    std::string take(std::string_view name) {
+        Argument* argument = find(name);
+        if (!argument) {
+            return "";
+        }
+        argument->used = true;
+        return decode_value(argument->value);
+    }
+
+    int column(std::string_view name) noexcept {
+        Argument* argument = find(name);
+        return argument ? argument->column : 1;
+    }
+};
+
+RscImporter::RscImporter(Diagnostics& diagnostics, SectionHandler on_section)
+    : diagnostics_(diagnostics), on_section_(std::move(on_section)), command_(std::make_unique<Command>())
+{
+}
+
+RscImporter::~RscImporter() {
+    if (open_) {
+        open_->destroy();
+        delete open_;
+    }
+    for (SectionStatement* section : held_) {
+        section->destroy();
+        delete section;
+    }
+}
+
+void RscImporter::feed(std::string_view text) {
+    statistics_.bytes += text.size();
+    size_t start = 0;
+    for (;;) {
+        size_t newline = text.find('\n', start);
+        if (newline == std::string_view::npos) {
+            partial_.append(text.substr(start));
+            return;
+        }
+        std::string_view line = text.substr(start, newline - start);
+        if (partial_.empty()) {
+            takeLine(line);
+        } else {
+            partial_.append(line);
+            takeLine(partial_);
+            partial_.clear();
+        }
+        start = newline + 1;
+    }
+}
+
+void RscImporter::finish() {
+    if (!partial_.empty()) {
+        std::string last = std::move(partial_);
+        partial_.clear();
+        takeLine(last);
+    }
+    if (logical_line_ != 0) {
+        // The export ended in a continued line
+        importLine(logical_, logical_line_);
+        logical_line_ = 0;
+        logical_.clear();
+    }
+    flush();
+    release();
+
+    for (const auto& [reason, seen] : notes_) {
+        std::string message = reason;
+        if (seen.second > 1) {
+            message += " (" + std::to_string(seen.second) + " times)";
+        }
+        diagnostics_.report(Diagnostics::Severity::WARNING, seen.first, 1, std::move(message));
+    }
+    notes_.clear();
+}
+
+// Join continued lines, then import each complete line. A backslash ending a
+// line continues it and the indentation of the next line is dropped, also
+// inside quoted strings, which exports break the same way.
+void RscImporter::takeLine(std::string_view line) {
+    line_number_++;
+    statistics_.lines++;
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    size_t backslashes = 0;
+    while (backslashes < line.size() && line[line.size() - 1 - backslashes] == '\\') {
+        backslashes++;
+    }
+    bool continued = backslashes % 2 == 1;
+    if (continued) {
+        line.remove_suffix(1);
+    }
+
+    if (logical_line_ == 0) {
+        if (!continued) {
+            importLine(line, line_number_);
+            return;
+        }
+        logical_line_ = line_number_;
+        logical_.assign(line);
+        return;
+    }
+    size_t indent = line.find_first_not_of(" \t");
+    line.remove_prefix(indent == std::string_view::npos ? line.size() : indent);
+    logical_.append(line);
+    if (!continued) {
+        importLine(logical_, logical_line_);
+        logical_line_ = 0;
+        logical_.clear();
+    }
+}
+
+void RscImporter::importLine(std::string_view line, int line_number) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos || line[start] == '#') {
+        return;
+    }
+
+    Command& command = *command_;
+    if (!split_words(line, command.words)) {
+        statistics_.commands++;
+        statistics_.skipped++;
+        diagnostics_.report(Diagnostics::Severity::WARNING, line_number, static_cast<int>(start) + 1,
+                            "Unterminated quote or bracket; the command was skipped");
+        return;
+    }
+    const std::vector<Word>& words = command.words;
+    if (words[0].text.front() == ':') {
+        statistics_.commands++;
+        statistics_.skipped++;
+        note("Scripting commands such as " + std::string(words[0].text) + " were skipped", line_number);
+        return;
+    }
+
+    size_t next = 0;
+    command.menu = menu_;
+    if (words[0].text.front() == '/') {
+        command.inline_menu.clear();
+        append_menu(command.inline_menu, words[0].text);
+        for (next = 1; next < words.size() && is_menu_word(words[next].text); next++) {
+            append_menu(command.inline_menu, words[next].text);
+        }
+        if (command.inline_menu.empty()) {
+            command.inline_menu = "/";
+        }
+        if (next == words.size()) {
+            // A menu on its own line is the context of the commands that follow
+            menu_ = command.inline_menu;
+            return;
+        }
+        command.menu = command.inline_menu;
+    }
+
+    statistics_.commands++;
+    command.verb = words[next++].text;
+    command.item.clear();
+    command.arguments.clear();
+    command.flags.clear();
+    bool has_item = command.verb == "add";
+    for (; next < words.size(); next++) {
+        std::string_view word = words[next].text;
+        size_t equals = word.find('=');
+        if (word.front() == '[') {
+            command.item = find_item(word);
+            has_item = true;
+        } else if (equals != std::string_view::npos && equals > 0 && word.front() != '"') {
+            command.arguments.push_back({word.substr(0, equals), word.substr(equals + 1), words[next].column, false});
+        } else if (!has_item) {
+            command.item = decode_value(word);
+            has_item = true;
+        } else {
+            command.flags.push_back(word);
+        }
+    }
+
+    const MenuMapping* mapping = findMapping(command.menu, command.verb);
+    if (!mapping) {
+        statistics_.skipped++;
+        note("Commands '" + std::string(command.menu) + " " + std::string(command.verb) +
+             "' have no DSL equivalent and were skipped", line_number);
+        return;
+    }
+    importCommand(*mapping, line_number);
+}
+
+void RscImporter::importCommand(const MenuMapping& mapping, int line_number) {
+    Command& command = *command_;
+    std::string_view command_name = mapping.schema.menu;
+
+    // A disabled entry would come back enabled where the DSL cannot say otherwise
+    if (const Command::Argument* disabled = command.find("disabled");
+        disabled && is_yes(disabled->value)) {
+        bool expressible = false;
+        for (size_t i = 0; i < mapping.schema.parameter_count; i++) {
+            expressible = expressible || mapping.schema.parameters[i].name == "disabled";
+        }
+        if (!expressible) {
+            statistics_.skipped++;
+            note("Disabled entries of '" + std::string(command_name) + "' were skipped", line_number);
+            return;
+        }
+    }
+
+    auto required = [&](const std::string& value, std::string_view parameter) {
+        if (value.empty()) {
+            note("Commands '" + std::string(command_name) + " " + std::string(command.verb) + "' without " +
+                 std::string(parameter) + " were skipped", line_number);
+            statistics_.skipped++;
+        }
+        return !value.empty();
+    };
+
+    switch (mapping.target) {
+        case Target::IDENTITY: {
+            SectionStatement* device = topLevel(SectionType::DEVICE, line_number);
+            BlockStatement* block = device->get_block();
+            if (block->get_statements().empty()) {
+                // The identity is all an export says about the device
+                block->add_statement(property("vendor", new StringValue("", true), line_number, 1));
+                block->add_statement(property("model", new StringValue("", true), line_number, 1));
+            }
+            addProperties(mapping, device, line_number);
+            break;
+        }
+        case Target::ETHERNET:
+        case Target::VLAN:
+        case Target::BRIDGE:
+        case Target::BONDING: {
+            std::string name = command.take("name");
+            if (name.empty()) {
+                name = command.item;
+            }
+            if (!required(name, "a name")) {
+                return;
+            }
+            SectionStatement* interface = configure(name, line_number);
+            BlockStatement* block = interface->get_block();
+            if (block->get_statements().empty()) {
+                block->add_statement(property("type", new StringValue(interface_type(mapping.target), true),
+                                              line_number, 1));
+            }
+            if (mapping.target == Target::BONDING) {
+                int column = command.column("slaves");
+                std::string slaves = command.take("slaves");
+                if (!slaves.empty()) {
+                    reference(slaves, line_number);
+                    block->add_statement(property("slaves", name_list(slaves), line_number, column));
+                } else {
+                    // RouterOS and the DSL both need at least one, so the import will not validate
+                    diagnostics_.report(Diagnostics::Severity::WARNING, line_number, column,
+                                        "Bonding interface '" + name + "' has no slaves");
+                }
+            }
+            addProperties(mapping, interface, line_number);
+            break;
+        }
+        case Target::BRIDGE_PORT:
+        case Target::LIST_MEMBER: {
+            bool port = mapping.target == Target::BRIDGE_PORT;
+            int column = command.column("interface");
+            std::string owner = command.take(port ? "bridge" : "list");
+            std::string interface = command.take("interface");
+            if (!required(owner, port ? "a bridge" : "a list") || !required(interface, "an interface")) {
+                return;
+            }
+            topLevel(SectionType::INTERFACES, line_number);
+            reference(interface, line_number);
+            Members& members = port ? bridge_ports_[owner] : interface_lists_[interface];
+            if (members.values.empty()) {
+                members.line = line_number;
+                members.column = column;
+            } else {
+                members.values += ',';
+            }
+            members.values += port ? interface : owner;
+            addProperties(mapping, nullptr, line_number);
+            break;
+        }
+        case Target::IP_ADDRESS: {
+            int column = command.column("address");
+            std::string address = command.take("address");
+            std::string interface = command.take("interface");
+            if (!required(address, "an address") || !required(interface, "an interface")) {
+                return;
+            }
+            reference(interface, line_number);
+            SectionStatement* ip = topLevel(SectionType::IP, line_number);
+            SectionStatement* assignment = child(ip, "ip", interface, line_number);
+            assignment->get_block()->add_statement(property("address", typed_value(address), line_number, column));
+            addProperties(mapping, nullptr, line_number);
+            break;
+        }
+        case Target::DHCP_CLIENT: {
+            int column = command.column("interface");
+            std::string interface = command.take("interface");
+            if (!required(interface, "an interface")) {
+                return;
+            }
+            bool enabled = !is_yes(command.take("disabled"));
+            reference(interface, line_number);
+            SectionStatement* ip = topLevel(SectionType::IP, line_number);
+            SectionStatement* clients = child(ip, "ip", "dhcp-client", line_number);
+            clients->get_block()->add_statement(property(interface, new BooleanValue(enabled), line_number, column));
+            addProperties(mapping, nullptr, line_number);
+            break;
+        }
+        case Target::DHCP_SERVER: {
+            std::string name = command.take("name");
+            if (!required(name, "a name")) {
+                return;
+            }
+            SectionStatement* ip = topLevel(SectionType::IP, line_number);
+            SectionStatement* servers = child(ip, "ip", "dhcp-server", line_number);
+            addProperties(mapping, child(servers, "ip/dhcp-server", name, line_number), line_number);
+            break;
+        }
+        case Target::DNS: {
+            SectionStatement* ip = topLevel(SectionType::IP, line_number);
+            addProperties(mapping, child(ip, "ip", "dns", line_number), line_number);
+            break;
+        }
+        case Target::ROUTE:
+        case Target::ROUTING_RULE: {
+            // Routes and rules are named by their comment, or numbered
+            bool route = mapping.target == Target::ROUTE;
+            SectionStatement* routing = topLevel(SectionType::ROUTING, line_number);
+            SectionStatement* parent = route ? routing : child(routing, "routing", "rule", line_number);
+            std::string path = route ? "routing" : "routing/rule";
+            std::string name = name_from_comment(command.take("comment"), route ? "route" : "rule");
+            if (route && contains(ROUTING_SUBSECTIONS, name)) {
+                name += "_route";
+            }
+            name = uniqueName(path, std::move(name.empty() ? std::string(route ? "route" : "rule") : name));
+            addProperties(mapping, child(parent, path, name, line_number), line_number);
+            break;
+        }
+        case Target::ROUTING_TABLE: {
+            std::string name = command.take("name");
+            if (!required(name, "a name")) {
+                return;
+            }
+            SectionStatement* routing = topLevel(SectionType::ROUTING, line_number);
+            SectionStatement* tables = child(routing, "routing", "table", line_number);
+            addProperties(mapping, child(tables, "routing/table", name, line_number), line_number);
+            break;
+        }
+        case Target::FIREWALL_RULE: {
+            // Dropping a matcher would make the rule match more than it did, so the rule goes instead
+            if (std::string_view matcher = unknownParameter(mapping.schema); !matcher.empty()) {
+                statistics_.skipped++;
+                note("Rules of '" + std::string(command_name) + "' matching on '" + std::string(matcher) +
+                     "', which has no DSL property, were skipped", line_number);
+                return;
+            }
+            // The translator comments a rule with its name unless the rule sets a comment
+            std::string_view table = command_name.substr(command_name.rfind(' ') + 1);
+            std::string path = "firewall/" + std::string(table);
+            int column = command.column("comment");
+            std::string comment = command.take("comment");
+            std::string name = name_from_comment(comment, "rule");
+            name = uniqueName(path, name.empty() ? std::string("rule") : std::move(name));
+
+            SectionStatement* firewall = topLevel(SectionType::FIREWALL, line_number);
+            SectionStatement* rule = child(child(firewall, "firewall", table, line_number), path, name, line_number);
+            addProperties(mapping, rule, line_number);
+            if (comment != name) {
+                rule->get_block()->add_statement(property("comment", new StringValue(comment, true), line_number,
+                                                          column));
+            }
+            break;
+        }
+        case Target::ADDRESS_LIST: {
+            int column = command.column("address");
+            std::string list = command.take("list");
+            std::string address = command.take("address");
+            if (!required(list, "a list") || !required(address, "an address")) {
+                return;
+            }
+            std::string comment = command.take("comment");
+            SectionStatement* firewall = topLevel(SectionType::FIREWALL, line_number);
+            SectionStatement* lists = child(firewall, "firewall", "address-list", line_number);
+            SectionStatement* entries = child(lists, "firewall/address-list", list, line_number);
+            // Quoted values are the comment of the entry; true adds it without one
+            Expression* value = comment.empty() ? static_cast<Expression*>(new BooleanValue(true))
+                                                : new StringValue(comment, true);
+            entries->get_block()->add_statement(property(address, value, line_number, column));
+            addProperties(mapping, nullptr, line_number);
+            break;
+        }
+    }
+    statistics_.imported++;
+    open_entries_++;
+}
+
+// First parameter of the command the schema has no parameter for, leaving out
+// derived ones and disabled=no; empty if there is none
+std::string_view RscImporter::unknownParameter(const CommandSchema& schema) const {
+    for (const Command::Argument& argument : command_->arguments) {
+        bool known = argument.name == "disabled" && !is_yes(argument.value);
+        for (size_t i = 0; !known && i < schema.parameter_count; i++) {
+            known = schema.parameters[i].name == argument.name;
+        }
+        for (const auto& [menu, parameter] : DERIVED_PARAMETERS) {
+            known = known || (menu == schema.menu && parameter == argument.name);
+        }
+        if (!known) {
+            return argument.name;
+        }
+    }
+    return {};
+}
+
+// Add a property for every parameter of the command the mapping has a DSL
+// property for, or only note the parameters without one when section is null
+void RscImporter::addProperties(const MenuMapping& mapping, SectionStatement* section, int line_number) {
+    Command& command = *command_;
+    const CommandSchema& schema = mapping.schema;
+    const std::vector<std::string_view>& properties = mapping.properties;
+
+    for (Command::Argument& argument : command.arguments) {
+        if (argument.used) {
+            continue;
+        }
+        size_t index = 0;
+        while (index < schema.parameter_count && schema.parameters[index].name != argument.name) {
+            index++;
+        }
+        if (index == schema.parameter_count) {
+            bool derived = false;
+            for (const auto& [menu, parameter] : DERIVED_PARAMETERS) {
+                derived = derived || (menu == schema.menu && parameter == argument.name);
+            }
+            // disabled=no is the default of everything
+            if (!derived && !(argument.name == "disabled" && !is_yes(argument.value))) {
+                note("Parameter '" + std::string(argument.name) + "' of '" + std::string(schema.menu) +
+                     "' has no DSL property and was dropped", line_number);
+            }
+            continue;
+        }
+        if (properties[index].empty() || !section) {
+            continue;
+        }
+        // Several states are written as a list, like the DSL spells them
+        std::string value = decode_value(argument.value);
+        if (contains(INTERFACE_PARAMETERS, argument.name)) {
+            reference(value, line_number);
+        }
+        Expression* typed = nullptr;
+        if (properties[index] == "admin_state") {
+            // admin_state spells the disabled parameter the other way round
+            typed = new StringValue(is_yes(value) ? "disabled" : "enabled", true);
+        } else if (schema.parameters[index].format == Format::STATES && value.find(',') != std::string::npos) {
+            typed = name_list(value);
+        } else {
+            typed = typed_value(value);
+        }
+        section->get_block()->add_statement(property(properties[index], typed, line_number, argument.column));
+    }
+
+    // Flags are written bare when set, so an added entry without one has it off
+    for (size_t i = 0; section && i < schema.parameter_count; i++) {
+        const CommandParameter& parameter = schema.parameters[i];
+        if (parameter.format != Format::FLAG || properties[i].empty()) {
+            continue;
+        }
+        bool set = contains(command.flags, parameter.name);
+        if (set || command.verb == "add") {
+            section->get_block()->add_statement(
+                property(properties[i], new StringValue(set ? "yes" : "no", true), line_number, 1));
+        }
+    }
+}
+
+void RscImporter::note(std::string reason, int line_number) {
+    auto [it, added] = notes_.try_emplace(std::move(reason), line_number, 0);
+    it->second.second++;
+}
+
+// The open top-level section of a type, handing over the open one first if it
+// is of another type or full
+SectionStatement* RscImporter::topLevel(SectionType type, int line_number) {
+    if (open_ && (open_->get_section_type() != type || open_entries_ >= MAX_SECTION_ENTRIES)) {
+        flush();
+    }
+    if (!open_) {
+        open_ = SectionFactory::create_section(SectionStatement::section_type_to_string(type), type,
+                                               new BlockStatement());
+        open_->set_location(line_number, 1);
+    }
+    return open_;
+}
+
+// The subsection of a parent with a name, created at the end of the parent on first use
+SectionStatement* RscImporter::child(SectionStatement* parent, std::string_view path, std::string_view name,
+                                     int line_number) {
+    std::string key;
+    key.reserve(path.size() + 1 + name.size());
+    key.append(path).append(1, '/').append(name);
+    auto [it, added] = children_.try_emplace(std::move(key), nullptr);
+    if (added) {
+        it->second = SectionFactory::create_section(name, SectionType::CUSTOM, new BlockStatement());
+        it->second->set_location(line_number, 1);
+        parent->get_block()->add_statement(it->second);
+    }
+    return it->second;
+}
+
+// A name not yet used below path: "rule" is numbered from 1, any other name
+// gets a number only when it repeats
+std::string RscImporter::uniqueName(std::string_view path, std::string name) {
+    std::string key = std::string(path) + "/" + name;
+    size_t& uses = names_[key];
+    bool numbered = name == "rule" || name == "route";
+    for (;;) {
+        uses++;
+        std::string candidate = numbered ? name + std::to_string(uses)
+                                         : uses == 1 ? name : name + "_" + std::to_string(uses);
+        if (children_.find(std::string(path) + "/" + candidate) == children_.end()) {
+            return candidate;
+        }
+    }
+}
+
+// The section of an interface the export configures, in the open interfaces section
+SectionStatement* RscImporter::configure(std::string_view name, int line_number) {
+    configured_.emplace(name);
+    return child(topLevel(SectionType::INTERFACES, line_number), "interfaces", name, line_number);
+}
+
+// Remember interfaces named by a command; names may be comma separated
+void RscImporter::reference(std::string_view names, int line_number) {
+    size_t start = 0;
+    while (start < names.size()) {
+        size_t comma = std::min(names.find(',', start), names.size());
+        std::string_view name = names.substr(start, comma - start);
+        // "!ether1" matches every other interface and "all" any of them
+        if (!name.empty() && name.front() != '!' && name != "all") {
+            referenced_.try_emplace(std::string(name), line_number);
+        }
+        start = comma + 1;
+    }
+}
+
+// Exports leave out ethernet ports with default settings, so interfaces that
+// are only referenced are added as plain ethernet interfaces, to the first
+// held interfaces section or else to a new one held before all others
+void RscImporter::addReferencedInterfaces() {
+    std::vector<std::pair<int, std::string>> missing;
+    for (const auto& [name, line] : referenced_) {
+        if (configured_.find(name) == configured_.end()) {
+            missing.emplace_back(line, name);
+        }
+    }
+    referenced_.clear();
+    if (missing.empty()) {
+        return;
+    }
+    std::sort(missing.begin(), missing.end());
+    SectionStatement* interfaces = interfaces_;
+    if (!interfaces) {
+        interfaces = SectionFactory::create_section(SectionStatement::section_type_to_string(SectionType::INTERFACES),
+                                                    SectionType::INTERFACES, new BlockStatement());
+        interfaces->set_location(missing.front().first, 1);
+        held_.insert(held_.begin(), interfaces);
+    }
+    for (const auto& [line, name] : missing) {
+        SectionStatement* interface = SectionFactory::create_section(name, SectionType::CUSTOM, new BlockStatement());
+        interface->set_location(line, 1);
+        interface->get_block()->add_statement(property("type", new StringValue("ethernet", true), line, 1));
+        interfaces->get_block()->add_statement(interface);
+        configured_.insert(name);
+    }
+    note("Interfaces the export only references were added as ethernet interfaces", missing.front().first);
+}
+
+// Add the collected bridge ports and interface lists to their interfaces
+void RscImporter::attachMembers() {
+    for (auto& [bridge, ports] : bridge_ports_) {
+        auto it = children_.find("interfaces/" + bridge);
+        if (it == children_.end()) {
+            note("Ports of bridges defined in another part of the export were dropped", ports.line);
+            continue;
+        }
+        it->second->get_block()->add_statement(property("ports", name_list(ports.values), ports.line, ports.column));
+    }
+    for (auto& [interface, lists] : interface_lists_) {
+        // Called while flushing, so the open section must not be replaced
+        SectionStatement* section = child(open_, "interfaces", interface, lists.line);
+        if (section->get_block()->get_statements().empty()) {
+            section->get_block()->add_statement(
+                property("type", new StringValue("ethernet", true), lists.line, 1));
+        }
+        configured_.insert(interface);
+        section->get_block()->add_statement(
+            property("lists", new StringValue(lists.values, true), lists.line, lists.column));
+    }
+    bridge_ports_.clear();
+    interface_lists_.clear();
+}
+
+// Close the open section. It is held back until release(), unless the held
+// sections were already handed over.
+void RscImporter::flush() {
+    if (!open_) {
+        return;
+    }
+    attachMembers();
+    SectionStatement* section = open_;
+    size_t entries = open_entries_;
+    open_ = nullptr;
+    open_entries_ = 0;
+    children_.clear();
+    names_.clear();
+
+    if (released_) {
+        handOver(section);
+        return;
+    }
+    if (!interfaces_ && section->get_section_type() == SectionType::INTERFACES) {
+        interfaces_ = section;
+    }
+    held_.push_back(section);
+    held_entries_ += entries;
+    if (held_entries_ >= MAX_HELD_ENTRIES) {
+        release();
+    }
+}
+
+// Add the interfaces referenced so far and hand the held sections over in
+// order; sections closed after this are handed over at once
+void RscImporter::release() {
+    addReferencedInterfaces();
+    for (SectionStatement* section : held_) {
+        handOver(section);
+    }
+    held_.clear();
+    held_entries_ = 0;
+    interfaces_ = nullptr;
+    released_ = true;
+}
+
+// Hand a section over and free it, as parse_text_streaming does
+void RscImporter::handOver(SectionStatement* section) {
+    ProgramDeclaration program;
+    program.add_section(section);
+    statistics_.sections++;
+    if (on_section_) {
+        on_section_(section);
+    }
+    program.destroy();
+}
+
+std::tuple<bool, std::string> RscImporter::import_file(const std::string& path, Diagnostics& diagnostics,
+                                                       const SectionHandler& on_section, Statistics* statistics) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return {false, "Could not open " + path};
+    }
+    RscImporter importer(diagnostics, on_section);
+    std::vector<char> block(READ_BLOCK_SIZE);
+    size_t read = 0;
+    while ((read = fread(block.data(), 1, block.size(), file)) > 0) {
+        importer.feed(std::string_view(block.data(), read));
+    }
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) {
+        return {false, "Could not read " + path};
+    }
+    importer.finish();
+    if (statistics) {
+        *statistics = importer.statistics();
+    }
+    return {true, ""};
+}
+
+namespace {
+
+// DSL text of a value, or false if a string holds a quote or a line break
+bool append_value(const Expression* value, std::string& out) {
+    if (const auto* string = dynamic_cast<const StringValue*>(value)) {
+        if (!string->is_quoted()) {
+            out += string->get_value();
+            return true;
+        }
+        if (string->get_value().find_first_of("\"\n") != std::string::npos) {
+            return false;
+        }
+        out += '"';
+        out += string->get_value();
+        out += '"';
+        return true;
+    }
+    if (const auto* list = dynamic_cast<const ListValue*>(value)) {
+        out += '[';
+        for (size_t i = 0; i < list->get_values().size(); i++) {
+            if (i > 0) {
+                out += ", ";
+            }
+            if (!append_value(list->get_values()[i], out)) {
+                return false;
+            }
+        }
+        out += ']';
+        return true;
+    }
+    if (!value) {
+        return false;
+    }
+    out += value->to_string();
+    return true;
+}
+
+// What a statement is to the sections around it. Firewall tables hold rules,
+// which are written whole or not at all, so that no rule matches more than it did.
+enum class Nesting : uint8_t {
+    OTHER,
+    TABLE,
+    RULE
+};
+
+// DSL text of a property's value, or false if the grammar cannot read it back
+bool append_property_value(const PropertyStatement* prop, std::string& out) {
+    return spells_property(prop->get_name()) && append_value(prop->get_value(), out);
+}
+
+// Whether every property of a rule but its comment, which matches nothing, can be written
+bool writes_rule(const SectionStatement* section) {
+    std::string value;
+    for (const Statement* child : section->get_block()->get_statements()) {
+        const auto* prop = dynamic_cast<const PropertyStatement*>(child);
+        if (prop && prop->get_name() != "comment" && !append_property_value(prop, value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append a statement and everything below it. Lines the grammar cannot read,
+// and all lines below a section it cannot read, are written after "# ".
+size_t append_statement(const Statement* statement, const std::string& indent, bool commented, Nesting nesting,
+                        std::string& out) {
+    if (const auto* section = dynamic_cast<const SectionStatement*>(statement)) {
+        const BlockStatement* block = section->get_block();
+        bool comment = commented || (!indent.empty() && !spells_section(section->get_name())) ||
+                       (nesting == Nesting::RULE && block && !writes_rule(section));
+        size_t count = comment && !commented ? 1 : 0;
+        out += indent;
+        out += comment ? "# " : "";
+        out += section->get_name();
+        out += ":\n";
+        Nesting nested = Nesting::OTHER;
+        if (indent.empty() && section->get_section_type() == SectionType::FIREWALL) {
+            nested = Nesting::TABLE;
+        } else if (nesting == Nesting::TABLE && section->get_name() != "address-list") {
+            nested = Nesting::RULE;
+        }
+        if (block) {
+            std::string deeper = indent + "    ";
+            for (const Statement* child : block->get_statements()) {
+                count += append_statement(child, deeper, comment, nested, out);
+            }
+        }
+        return count;
+    }
+    if (const auto* prop = dynamic_cast<const PropertyStatement*>(statement)) {
+        std::string value;
+        bool writable = !commented && append_property_value(prop, value);
+        out += indent;
+        out += writable ? "" : "# ";
+        out += prop->get_name();
+        out += " = ";
+        out += writable ? value : prop->get_value() ? prop->get_value()->to_string() : "";
+        out += '\n';
+        return writable || commented ? 0 : 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+size_t append_dsl_section(const SectionStatement* section, std::string& out) {
+    size_t commented = append_statement(section, "", false, Nesting::OTHER, out);
+    out += '\n';
+    return commented;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "diagnostics.hpp"
+#include "parse_driver.hpp"
+#include "statement.hpp"
+
+struct CommandSchema;
+
+/**
+ * @class RscImporter
+ * @brief Read a RouterOS /export script back into the sections the DSL compiles from
+ *
+ * The importer follows the menu context of the export ("/ip firewall filter"
+ * on a line of its own), joins lines continued with a trailing backslash and
+ * maps the add and set commands of every menu the translators write to the
+ * properties they read, so compiling the imported AST gives the commands
+ * again. Values are typed like the scanner types them: valid IPv4 addresses
+ * and prefixes become address values, small integers numbers.
+ *
+ * Input is fed in blocks of any size. A top-level section is closed as soon
+ * as the export moves on to another part of the configuration, or once it
+ * holds MAX_SECTION_ENTRIES commands. Closed sections are held back until
+ * MAX_HELD_ENTRIES commands are held, so that interfaces the export only
+ * references can still join its first interfaces section, then handed to
+ * the handler in order and freed, so exports far larger than memory import
+ * in one pass. Commands of menus without a DSL equivalent are counted and
+ * reported once per menu.
+ */
+class RscImporter {
+public:
+    // Commands collected into one top-level section before it is handed over
+    static constexpr size_t MAX_SECTION_ENTRIES = 4096;
+
+    // Commands in closed sections held back before they are handed over
+    static constexpr size_t MAX_HELD_ENTRIES = 4 * MAX_SECTION_ENTRIES;
+
+    // Bytes read from a file per feed() call
+    static constexpr size_t READ_BLOCK_SIZE = 1024 * 1024;
+
+    struct Statistics {
+        size_t bytes = 0;
+        size_t lines = 0;        // Physical lines, counting continued ones
+        size_t commands = 0;     // Commands seen, menu lines and comments excluded
+        size_t imported = 0;     // Commands turned into DSL statements
+        size_t skipped = 0;      // Commands of unsupported menus or verbs
+        size_t sections = 0;     // Top-level sections handed over
+    };
+
+    /**
+     * @param diagnostics Sink for problems, located at export lines
+     * @param on_section Receives each top-level section; it is freed when the handler returns
+     */
+    RscImporter(Diagnostics& diagnostics, SectionHandler on_section);
+    ~RscImporter();
+
+    RscImporter(const RscImporter&) = delete;
+    RscImporter& operator=(const RscImporter&) = delete;
+
+    /**
+     * @brief Import the next part of the export
+     * @param text Any slice of the input; lines may span calls
+     */
+    void feed(std::string_view text);
+
+    /**
+     * @brief Import the last line and hand over the open section
+     */
+    void finish();
+
+    const Statistics& statistics() const noexcept { return statistics_; }
+
+    /**
+     * @brief Import a whole export file, reading it in READ_BLOCK_SIZE blocks
+     * @param path The .rsc file
+     * @param diagnostics Sink for problems
+     * @param on_section Receives each top-level section, as for the constructor
+     * @param statistics Set to the counts of the import if not null
+     * @return Success flag and error message; import problems go to diagnostics
+     */
+    static std::tuple<bool, std::string> import_file(const std::string& path, Diagnostics& diagnostics,
+                                                     const SectionHandler& on_section,
+                                                     Statistics* statistics = nullptr);
+
+private:
+    struct Command;
+    struct MenuMapping;
+
+    // Entries joined into one property when the section is handed over
+    struct Members {
+        std::string values;  // Comma separated
+        int line = 0;
+        int column = 0;
+    };
+
+    static const MenuMapping* findMapping(std::string_view menu, std::string_view verb);
+
+    void takeLine(std::string_view line);
+    void importLine(std::string_view line, int line_number);
+    void importCommand(const MenuMapping& mapping, int line_number);
+    std::string_view unknownParameter(const CommandSchema& schema) const;
+    void addProperties(const MenuMapping& mapping, SectionStatement* section, int line_number);
+    void note(std::string reason, int line_number);
+
+    SectionStatement* topLevel(SectionStatement::SectionType type, int line_number);
+    SectionStatement* child(SectionStatement* parent, std::string_view path, std::string_view name,
+                            int line_number);
+    std::string uniqueName(std::string_view path, std::string name);
+    SectionStatement* configure(std::string_view name, int line_number);
+    void reference(std::string_view names, int line_number);
+    void addReferencedInterfaces();
+    void attachMembers();
+    void flush();
+    void release();
+    void handOver(SectionStatement* section);
+
+    Diagnostics& diagnostics_;
+    SectionHandler on_section_;
+    Statistics statistics_;
+    std::unique_ptr<Command> command_;   // Reused for every line
+
+    std::string partial_;        // Unterminated last line of the input fed so far
+    std::string logical_;        // Line being joined from continued lines
+    int logical_line_ = 0;       // Export line the joined line started on
+    int line_number_ = 0;
+    std::string menu_;           // Current menu context, such as "/ip firewall filter"
+
+    SectionStatement* open_ = nullptr;
+    size_t open_entries_ = 0;
+    // Closed sections not handed over yet, the first interfaces section among them,
+    // and whether the held sections were handed over before the end of the export
+    std::vector<SectionStatement*> held_;
+    size_t held_entries_ = 0;
+    SectionStatement* interfaces_ = nullptr;
+    bool released_ = false;
+    // Sections below the open one by path, such as "ip/ether1", and the uses of each generated name
+    std::unordered_map<std::string, SectionStatement*> children_;
+    std::unordered_map<std::string, size_t> names_;
+    // Bridge ports by bridge and interface lists by interface
+    std::unordered_map<std::string, Members> bridge_ports_;
+    std::unordered_map<std::string, Members> interface_lists_;
+    // Interfaces the export configures, and those other commands name with the first line naming each
+    std::unordered_set<std::string> configured_;
+    std::unordered_map<std::string, int> referenced_;
+    // Skipped commands and dropped parameters by reason, with the first line and the count
+    std::unordered_map<std::string, std::pair<int, size_t>> notes_;
+};
+
+/**
+ * @brief Append a section as DSL text
+ *
+ * Statements whose names the DSL grammar cannot spell, such as address-list
+ * entries named by an address, are written as comments, and so is all of a
+ * firewall rule with such a property; the AST image written with --emit-ast
+ * keeps them.
+ *
+ * @param section The section to write
+ * @param out The text being built
+ * @return Number of statements written as comments
+ */
+size_t append_dsl_section(const SectionStatement* section, std::string& out);
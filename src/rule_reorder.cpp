@@ -0,0 +1,427 @@
+#include "rule_reorder.hpp"
+#include <algorithm>
+#include <fstream>
+#include <queue>
+#include "firewall_simulator.hpp"
+
+namespace {
+
+using Match = PacketClassifier::Match;
+using Range = PacketClassifier::Range;
+
+// Rule parameters that match packets; every other one sets the action or documents the rule
+constexpr std::string_view MATCHER_PARAMETERS[] = {
+    "src-address", "dst-address", "protocol", "src-port", "dst-port", "in-interface", "out-interface",
+    "connection-state",
+};
+
+// Parameters that must agree for two overlapping rules to act the same
+constexpr std::string_view ACTION_PARAMETERS[] = {"action", "to-addresses", "to-ports"};
+
+std::string_view trim(std::string_view text) noexcept {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::string_view unquote(std::string_view text) noexcept {
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        return text.substr(1, text.size() - 2);
+    }
+    return text;
+}
+
+bool parse_count(std::string_view text, uint64_t& count) noexcept {
+    if (text.empty() || text.size() > 19) {
+        return false;
+    }
+    count = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        count = count * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+// key=value pairs of a terse line; quoted values may hold spaces and \" escapes
+std::unordered_map<std::string, std::string> terse_pairs(std::string_view line) {
+    std::unordered_map<std::string, std::string> pairs;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && line[i] == ' ') {
+            i++;
+        }
+        size_t start = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '=') {
+            i++;
+        }
+        if (i >= line.size() || line[i] != '=') {
+            continue;   // Row number or flags
+        }
+        std::string key(line.substr(start, i - start));
+        std::string value;
+        if (++i < line.size() && line[i] == '"') {
+            for (i++; i < line.size() && line[i] != '"'; i++) {
+                if (line[i] == '\\' && i + 1 < line.size()) {
+                    i++;
+                }
+                value += line[i];
+            }
+            i++;
+        } else {
+            while (i < line.size() && line[i] != ' ') {
+                value += line[i++];
+            }
+        }
+        pairs[key] = std::move(value);
+    }
+    return pairs;
+}
+
+bool ranges_overlap(const std::vector<Range>& a, const std::vector<Range>& b) noexcept {
+    // Both lists are sorted and disjoint
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].high < b[j].low) {
+            i++;
+        } else if (b[j].high < a[i].low) {
+            j++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether some packet matches both rules; an empty list matches any value
+bool overlaps(const Match& a, const Match& b) noexcept {
+    for (size_t field = 0; field < PacketClassifier::FIELD_COUNT; field++) {
+        if (!a[field].empty() && !b[field].empty() && !ranges_overlap(a[field], b[field])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool same_action(const RouterOSCommand& a, const RouterOSCommand& b) noexcept {
+    for (std::string_view parameter : ACTION_PARAMETERS) {
+        if (a.get(parameter) != b.get(parameter)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Expected rules tested per packet, the rules of a chain being in this order
+double expected_tests(const std::vector<size_t>& order, const std::vector<uint64_t>& packets,
+                      const std::vector<bool>& terminating) {
+    double tests = 0;
+    double total = 0;
+    for (size_t position = 0; position < order.size(); position++) {
+        size_t rule = order[position];
+        if (terminating[rule]) {
+            tests += static_cast<double>(packets[rule]) * static_cast<double>(position + 1);
+            total += static_cast<double>(packets[rule]);
+        }
+    }
+    return total > 0 ? tests / total : 0;
+}
+
+} // namespace
+
+std::tuple<bool, std::string> RuleCounters::load(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        return {false, "cannot open counters file " + path};
+    }
+    std::string line;
+    bool first_row = true;
+    std::unordered_map<std::string, int> listed_at;
+    for (int line_number = 1; std::getline(input, line); line_number++) {
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#') {
+            continue;
+        }
+        auto location = [&]() { return path + ":" + std::to_string(line_number) + ": "; };
+
+        std::string comment;
+        std::string_view count_text;
+        std::unordered_map<std::string, std::string> pairs;
+        if (text.find("packets=") != std::string_view::npos) {
+            pairs = terse_pairs(text);
+            auto found = pairs.find("comment");
+            if (found == pairs.end()) {
+                continue;   // A rule without a comment cannot be told apart
+            }
+            comment = found->second;
+            count_text = pairs["packets"];
+        } else {
+            size_t separator = text.find(',') != std::string_view::npos    ? text.rfind(',')
+                               : text.find('\t') != std::string_view::npos ? text.rfind('\t')
+                                                                           : text.rfind(' ');
+            if (separator == std::string_view::npos) {
+                return {false, location() + "expected a rule comment and a packet count"};
+            }
+            comment = unquote(trim(text.substr(0, separator)));
+            count_text = trim(text.substr(separator + 1));
+        }
+
+        uint64_t count = 0;
+        if (!parse_count(count_text, count)) {
+            if (first_row && pairs.empty()) {
+                first_row = false;
+                continue;   // Header row
+            }
+            return {false, location() + "invalid packet count '" + std::string(count_text) + "'"};
+        }
+        first_row = false;
+        if (comment.empty()) {
+            return {false, location() + "a packet count needs the comment of its rule"};
+        }
+        auto [listed, inserted] = listed_at.emplace(comment, line_number);
+        if (!inserted) {
+            return {false, location() + "comment '" + comment + "' is already listed at line " +
+                               std::to_string(listed->second) + "; rules sharing a comment cannot be told apart"};
+        }
+        packets_[comment] = count;
+    }
+    return {true, ""};
+}
+
+const uint64_t* RuleCounters::find(std::string_view comment) const {
+    if (comment.empty()) {
+        return nullptr;
+    }
+    auto it = packets_.find(std::string(comment));
+    return it != packets_.end() ? &it->second : nullptr;
+}
+
+RuleReorder::RuleReorder(const RuleCounters& counters) noexcept
+    : counters_(counters)
+{
+}
+
+std::vector<size_t> RuleReorder::order(std::string_view table, const std::vector<RouterOSCommand>& rules) {
+    std::vector<size_t> result(rules.size());
+    for (size_t i = 0; i < rules.size(); i++) {
+        result[i] = i;
+    }
+
+    // A counter cannot be told apart between rules of the table with the same comment
+    std::unordered_map<std::string_view, size_t> first_with_comment;
+    std::vector<bool> shared(rules.size(), false);
+    for (size_t i = 0; i < rules.size(); i++) {
+        std::string_view comment = rules[i].get("comment");
+        if (rules[i].get("action").empty() || !counters_.find(comment)) {
+            continue;
+        }
+        auto [first, inserted] = first_with_comment.emplace(comment, i);
+        if (!inserted) {
+            if (!shared[first->second]) {
+                shared_comments_.push_back("'" + std::string(comment) + "' in " + std::string(table));
+            }
+            shared[first->second] = true;
+            shared[i] = true;
+        }
+    }
+
+    // Rules without an action are not written, so they belong to no chain
+    std::vector<std::string> names;
+    std::vector<std::vector<size_t>> chains;
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].get("action").empty()) {
+            continue;
+        }
+        const std::string& name = rules[i].get("chain");
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) {
+            names.push_back(name);
+            chains.emplace_back();
+            it = names.end() - 1;
+        }
+        chains[it - names.begin()].push_back(i);
+    }
+
+    for (const std::vector<size_t>& chain : chains) {
+        std::vector<size_t> chain_order = orderChain(table, rules, chain, shared);
+        for (size_t position = 0; position < chain.size(); position++) {
+            result[chain[position]] = chain[chain_order[position]];
+        }
+    }
+    return result;
+}
+
+std::vector<size_t> RuleReorder::orderChain(std::string_view table, const std::vector<RouterOSCommand>& rules,
+                                            const std::vector<size_t>& chain, const std::vector<bool>& shared) {
+    size_t count = chain.size();
+    std::vector<size_t> original(count);
+    for (size_t i = 0; i < count; i++) {
+        original[i] = i;
+    }
+
+    ChainReport report{std::string(table), rules[chain.front()].get("chain"), count, 0, 0, 0, 0, 0};
+    std::vector<uint64_t> packets(count, 0);
+    std::vector<bool> terminating(count);
+    for (size_t i = 0; i < count; i++) {
+        const RouterOSCommand& rule = rules[chain[i]];
+        const uint64_t* counted = shared[chain[i]] ? nullptr : counters_.find(rule.get("comment"));
+        if (counted) {
+            packets[i] = *counted;
+        } else {
+            report.uncounted++;
+        }
+        terminating[i] = FirewallSimulator::is_terminating(rule.get("action"));
+        if (terminating[i]) {
+            report.packets += packets[i];
+        }
+    }
+    report.before = expected_tests(original, packets, terminating);
+    report.after = report.before;
+    if (report.packets == 0 || count > MAX_CHAIN_RULES) {
+        reports_.push_back(std::move(report));
+        return original;
+    }
+
+    // Rules whose values cannot be parsed are ordered against every other rule
+    MatchParser parser;
+    std::vector<Match> matches(count);
+    std::vector<bool> analyzed(count, true);
+    for (size_t i = 0; i < count; i++) {
+        for (std::string_view parameter : MATCHER_PARAMETERS) {
+            const std::string& value = rules[chain[i]].get(parameter);
+            if (value.empty()) {
+                continue;
+            }
+            std::string invalid;
+            MatchParser::Outcome outcome = parser.parse(parameter, MatchParser::split_items(value), matches[i], invalid);
+            if (outcome != MatchParser::Outcome::MATCHED) {
+                analyzed[i] = false;
+            }
+        }
+    }
+
+    // Rule j stays after an earlier rule i that some packet matches too,
+    // unless both end the chain the same way
+    std::vector<std::vector<uint32_t>> later(count);
+    std::vector<uint32_t> waiting(count, 0);
+    for (size_t j = 1; j < count; j++) {
+        const RouterOSCommand& rule = rules[chain[j]];
+        for (size_t i = 0; i < j; i++) {
+            bool dependent = !analyzed[i] || !analyzed[j] ||
+                             (overlaps(matches[i], matches[j]) &&
+                              !(terminating[i] && terminating[j] && same_action(rules[chain[i]], rule)));
+            if (dependent) {
+                later[i].push_back(static_cast<uint32_t>(j));
+                waiting[j]++;
+            }
+        }
+    }
+
+    // A cold rule may hold back hot ones, so besides its own packets a rule is
+    // also ranked by the best average over it and a path of rules it unlocks
+    std::vector<double> own(count);
+    std::vector<double> unlocked(count);
+    std::vector<double> path_packets(count);
+    std::vector<double> path_rules(count);
+    for (size_t i = count; i-- > 0;) {
+        own[i] = static_cast<double>(packets[i]);
+        path_packets[i] = own[i];
+        path_rules[i] = 1;
+        for (uint32_t next : later[i]) {
+            double sum = own[i] + path_packets[next];
+            double rules = 1 + path_rules[next];
+            if (sum * path_rules[i] > path_packets[i] * rules) {
+                path_packets[i] = sum;
+                path_rules[i] = rules;
+            }
+        }
+        unlocked[i] = path_packets[i] / path_rules[i];
+    }
+
+    // Highest ranked ready rule first, the earliest of equal ones
+    auto schedule = [&](const std::vector<double>& rank) {
+        auto lower = [&rank](size_t a, size_t b) { return rank[a] != rank[b] ? rank[a] < rank[b] : a > b; };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(lower)> ready(lower);
+        std::vector<uint32_t> remaining = waiting;
+        for (size_t i = 0; i < count; i++) {
+            if (remaining[i] == 0) {
+                ready.push(i);
+            }
+        }
+        std::vector<size_t> scheduled;
+        scheduled.reserve(count);
+        while (!ready.empty()) {
+            size_t rule = ready.top();
+            ready.pop();
+            scheduled.push_back(rule);
+            for (uint32_t next : later[rule]) {
+                if (--remaining[next] == 0) {
+                    ready.push(next);
+                }
+            }
+        }
+        return scheduled;
+    };
+
+    std::vector<size_t> best = original;
+    for (const std::vector<double>* rank : {&own, &unlocked}) {
+        std::vector<size_t> scheduled = schedule(*rank);
+        double cost = expected_tests(scheduled, packets, terminating);
+        if (cost < report.after) {
+            report.after = cost;
+            best = std::move(scheduled);
+        }
+    }
+    for (size_t position = 0; position < count; position++) {
+        report.moved += best[position] != position ? 1 : 0;
+    }
+    reports_.push_back(std::move(report));
+    return best;
+}
+
+void RuleReorder::print_report(FILE* out) const {
+    double tests_before = 0;
+    double tests_after = 0;
+    uint64_t packets = 0;
+    size_t uncounted = 0;
+    size_t moved = 0;
+    for (const ChainReport& report : reports_) {
+        fprintf(out, "  %s/%s: %zu rule(s), ", report.table.c_str(), report.chain.c_str(), report.rules);
+        if (report.packets == 0) {
+            fprintf(out, "no counted packets, order kept\n");
+        } else if (report.rules > MAX_CHAIN_RULES) {
+            fprintf(out, "too long to reorder, %.2f rules tested per packet\n", report.before);
+        } else if (report.moved == 0) {
+            fprintf(out, "order kept, %.2f rules tested per packet\n", report.before);
+        } else {
+            fprintf(out, "%zu moved, %.2f -> %.2f rules tested per packet\n", report.moved, report.before,
+                    report.after);
+        }
+        tests_before += report.before * static_cast<double>(report.packets);
+        tests_after += report.after * static_cast<double>(report.packets);
+        packets += report.packets;
+        uncounted += report.uncounted;
+        moved += report.moved;
+    }
+    if (packets > 0) {
+        fprintf(out, "Over %llu counted packet(s): %.2f -> %.2f rules tested per packet and chain\n",
+                static_cast<unsigned long long>(packets), tests_before / static_cast<double>(packets),
+                tests_after / static_cast<double>(packets));
+    }
+    if (uncounted > 0) {
+        fprintf(out, "%zu rule(s) have no counter and count as 0 packets\n", uncounted);
+    }
+    for (const std::string& shared : shared_comments_) {
+        fprintf(out, "Rules sharing the comment %s have no counter\n", shared.c_str());
+    }
+    if (moved > 0) {
+        fprintf(out, "The figures after reordering assume every rule keeps its counted packets in the new order\n");
+    }
+}
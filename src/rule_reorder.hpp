@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "command_schema.hpp"
+
+/**
+ * @class RuleCounters
+ * @brief Packet counters of firewall rules, by comment
+ *
+ * Counters are read from the rules RouterOS prints with "print stats terse",
+ * whose lines carry comment= and packets= among their key=value pairs, or
+ * from a plain file of one "comment packets" pair per line, separated by a
+ * comma, a tab or spaces. Lines starting with # are skipped, as is a header
+ * row whose count is not a number. A comment listed twice is an error: the
+ * rules sharing it cannot be told apart, so neither count could be trusted.
+ */
+class RuleCounters {
+public:
+    /**
+     * @brief Read a counters file
+     * @param path The file
+     * @return Success flag and error message, located at the offending line
+     */
+    std::tuple<bool, std::string> load(const std::string& path);
+
+    // Packets counted for a comment, or nullptr if the file does not list it or the comment is empty
+    const uint64_t* find(std::string_view comment) const;
+
+    size_t size() const noexcept { return packets_.size(); }
+
+private:
+    std::unordered_map<std::string, uint64_t> packets_;
+};
+
+/**
+ * @class RuleReorder
+ * @brief Reorder the rules of each firewall chain so the hottest come first
+ *
+ * A rule may only move ahead of an earlier one when no packet can match
+ * both, or when both end the chain with the same action and parameters.
+ * Every packet then still meets the rules it matches in the same order, so
+ * the chain decides as before. Among the rules whose earlier dependencies
+ * are already placed, the one with the most packets goes next.
+ *
+ * The cost of a chain is the number of rules a packet is expected to be
+ * tested against before a terminating rule takes it, weighted by the
+ * counters. A chain keeps its order unless the new one lowers that cost.
+ * Rules whose matchers cannot be analyzed stay behind every rule before
+ * them and ahead of every rule after them. Rules sharing a comment with
+ * another rule of the same table take no counter, since the file cannot
+ * tell their counts apart.
+ *
+ * The cost after reordering is estimated from the same counters, as if
+ * every rule kept its packets in the new order. That is exact for rules no
+ * packet matches twice; of two overlapping rules with the same action,
+ * the one moved first also takes the packets both match.
+ */
+class RuleReorder {
+public:
+    struct ChainReport {
+        std::string table;
+        std::string chain;
+        size_t rules;
+        size_t moved;           // Rules at a new position
+        size_t uncounted;       // Rules without a counter, taken as 0 packets, shared comments included
+        uint64_t packets;       // Packets counted by the terminating rules
+        double before;          // Expected rules tested per packet
+        double after;
+    };
+
+    // Longer chains keep their order; the analysis compares every pair of rules
+    static constexpr size_t MAX_CHAIN_RULES = 5000;
+
+    /**
+     * @param counters Packet counts of the rules; must outlive the reorder
+     */
+    explicit RuleReorder(const RuleCounters& counters) noexcept;
+
+    /**
+     * @brief Order the rules of one firewall table, chain by chain
+     * @param table filter, nat or raw
+     * @param rules Commands of the table, in program order
+     * @return Indexes into rules in the order to emit them; each chain
+     *         takes the positions its rules had
+     */
+    std::vector<size_t> order(std::string_view table, const std::vector<RouterOSCommand>& rules);
+
+    const std::vector<ChainReport>& reports() const noexcept { return reports_; }
+
+    // Print one line per chain and the expected cost over all of them
+    void print_report(FILE* out) const;
+
+private:
+    std::vector<size_t> orderChain(std::string_view table, const std::vector<RouterOSCommand>& rules,
+                                   const std::vector<size_t>& chain, const std::vector<bool>& shared);
+
+    const RuleCounters& counters_;
+    std::vector<ChainReport> reports_;
+    std::vector<std::string> shared_comments_;   // "'comment' in table" of each comment used twice
+};
@@ -1,17 +1,41 @@
 #ifndef SCANNER_HPP
 #define SCANNER_HPP
 
+#include <cstddef>
+#include <string>
+#include <string_view>
 #include <vector>
 
-// Variables from scanner
-extern int line_number;
-extern int column_number;
-extern std::vector<int> indent_stack;
-extern std::vector<int> token_queue;
+#include "line_scanner.hpp"
 
-// Function declarations
-extern int yylex();
-extern int yylex_flex();
-int check_token_queue();
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
 
-#endif /* SCANNER_HPP */ 
\ No newline at end of file
+// State of one scanner instance, kept as flex's "extra" data so that
+// independent scanners can run on different threads
+struct ScannerState
+{
+    std::string input_text;          // Text being scanned, followed by flex's two end-of-buffer bytes
+    LineTable input_lines;
+    int first_line = 1;              // Line number of the first line of input_text
+    int line_number = 1;
+    int column_number = 0;
+    std::vector<int> indent_stack{0}; // Start with indent level 0
+    std::vector<int> token_queue;    // Buffer for INDENT/DEDENT tokens
+    size_t token_queue_head = 0;     // Next token of token_queue to return
+    bool at_line_start = true;
+    bool eof_handled = false;        // Flag to track if we've handled EOF
+    size_t line_cursor = 0;          // Line table entry of the line being scanned
+    size_t scan_offset = 0;          // Input offset just past the current match
+};
+
+// Create a scanner over a chunk of DSL text; first_line numbers its first line
+yyscan_t scanner_create(std::string_view text, int first_line = 1);
+void scanner_destroy(yyscan_t scanner);
+
+// Scan the rest of the input without parsing, to time the scanner alone
+size_t scan_all_tokens(yyscan_t scanner);
+
+#endif /* SCANNER_HPP */
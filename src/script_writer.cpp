@@ -0,0 +1,244 @@
+#include "script_writer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Compressed bytes gathered before each write to the file
+constexpr size_t BLOCK_SIZE = 128 * 1024;
+
+// deflateInit2 window bits that select a gzip header and trailer
+constexpr int GZIP_WINDOW_BITS = 15 + 16;
+constexpr int GZIP_MEMORY_LEVEL = 8;
+
+} // namespace
+
+struct ScriptWriter::Encoder {
+    z_stream gzip{};
+    bool gzip_open = false;
+#ifdef HAVE_ZSTD
+    ZSTD_CStream* zstd = nullptr;
+#endif
+    std::vector<unsigned char> block = std::vector<unsigned char>(BLOCK_SIZE);
+
+    ~Encoder() {
+        if (gzip_open) {
+            deflateEnd(&gzip);
+        }
+#ifdef HAVE_ZSTD
+        ZSTD_freeCStream(zstd);
+#endif
+    }
+};
+
+ScriptWriter::ScriptWriter() noexcept = default;
+
+ScriptWriter::~ScriptWriter() {
+    if (file_) {
+        fclose(file_);
+    }
+}
+
+std::tuple<bool, std::string> ScriptWriter::parse_compression(std::string_view name, Compression& compression) {
+    if (name == "none") {
+        compression = Compression::NONE;
+    } else if (name == "gzip" || name == "gz") {
+        compression = Compression::GZIP;
+    } else if (name == "zstd" || name == "zst") {
+        compression = Compression::ZSTD;
+    } else {
+        return {false, "Unknown compression '" + std::string(name) + "' (expected none, gzip or zstd)"};
+    }
+    if (!is_available(compression)) {
+        return {false, "This build has no " + std::string(name) + " support; rebuild with make ZSTD=1"};
+    }
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> ScriptWriter::check_level(Compression compression, int level) {
+    switch (compression) {
+        case Compression::GZIP:
+            if (level > MAX_GZIP_LEVEL) {
+                return {false, "gzip compression levels are 1 to " + std::to_string(MAX_GZIP_LEVEL)};
+            }
+            return {true, ""};
+        case Compression::ZSTD:
+            if (level > MAX_ZSTD_LEVEL) {
+                return {false, "zstd compression levels are 1 to " + std::to_string(MAX_ZSTD_LEVEL)};
+            }
+            return {true, ""};
+        default:
+            return {false, "--compress-level needs --compress gzip or zstd"};
+    }
+}
+
+bool ScriptWriter::is_available(Compression compression) noexcept {
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return compression != Compression::ZSTD;
+#endif
+}
+
+const char* ScriptWriter::extension(Compression compression) noexcept {
+    switch (compression) {
+        case Compression::GZIP: return ".gz";
+        case Compression::ZSTD: return ".zst";
+        default: return "";
+    }
+}
+
+std::tuple<bool, std::string> ScriptWriter::open(const std::string& path, Compression compression, int level) {
+    if (file_) {
+        return {false, "Output file " + path_ + " is already open"};
+    }
+    if (!is_available(compression)) {
+        return {false, "This build cannot write " + std::string(extension(compression)) + " files"};
+    }
+
+    encoder_.reset();
+    if (compression == Compression::GZIP) {
+        encoder_ = std::make_unique<Encoder>();
+        if (deflateInit2(&encoder_->gzip, level > 0 ? level : DEFAULT_GZIP_LEVEL, Z_DEFLATED, GZIP_WINDOW_BITS,
+                         GZIP_MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+            encoder_.reset();
+            return {false, "Could not start gzip compression at level " + std::to_string(level)};
+        }
+        encoder_->gzip_open = true;
+    }
+#ifdef HAVE_ZSTD
+    if (compression == Compression::ZSTD) {
+        encoder_ = std::make_unique<Encoder>();
+        encoder_->zstd = ZSTD_createCStream();
+        if (!encoder_->zstd || ZSTD_isError(ZSTD_CCtx_setParameter(encoder_->zstd, ZSTD_c_compressionLevel,
+                                                                   level > 0 ? level : DEFAULT_ZSTD_LEVEL))) {
+            encoder_.reset();
+            return {false, "Could not start zstd compression at level " + std::to_string(level)};
+        }
+    }
+#endif
+
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        encoder_.reset();
+        return {false, "Could not open output file " + path};
+    }
+    path_ = path;
+    compression_ = compression;
+    bytes_in_ = 0;
+    bytes_out_ = 0;
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> ScriptWriter::write(std::string_view text) {
+    if (!file_) {
+        return {false, "No output file is open"};
+    }
+    bytes_in_ += text.size();
+    if (compression_ == Compression::NONE) {
+        return writeFile(text.data(), text.size());
+    }
+
+    if (compression_ == Compression::GZIP) {
+        // avail_in is 32 bits wide
+        constexpr size_t MAX_CHUNK = size_t(1) << 30;
+        for (size_t offset = 0; offset < text.size(); offset += MAX_CHUNK) {
+            size_t size = std::min(MAX_CHUNK, text.size() - offset);
+            encoder_->gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data() + offset));
+            encoder_->gzip.avail_in = static_cast<uInt>(size);
+            auto [compressed, error] = drain(false);
+            if (!compressed) {
+                return {false, error};
+            }
+        }
+        return {true, ""};
+    }
+#ifdef HAVE_ZSTD
+    if (compression_ == Compression::ZSTD) {
+        ZSTD_inBuffer input{text.data(), text.size(), 0};
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output{encoder_->block.data(), encoder_->block.size(), 0};
+            size_t result = ZSTD_compressStream2(encoder_->zstd, &output, &input, ZSTD_e_continue);
+            if (ZSTD_isError(result)) {
+                return {false, std::string("zstd compression failed: ") + ZSTD_getErrorName(result)};
+            }
+            auto [written, error] = writeFile(reinterpret_cast<const char*>(encoder_->block.data()), output.pos);
+            if (!written) {
+                return {false, error};
+            }
+        }
+        return {true, ""};
+    }
+#endif
+    return {true, ""};
+}
+
+std::tuple<bool, std::string> ScriptWriter::close() {
+    if (!file_) {
+        return {true, ""};
+    }
+
+    std::tuple<bool, std::string> result{true, ""};
+    if (compression_ == Compression::GZIP) {
+        encoder_->gzip.avail_in = 0;
+        result = drain(true);
+    }
+#ifdef HAVE_ZSTD
+    if (compression_ == Compression::ZSTD) {
+        ZSTD_inBuffer input{nullptr, 0, 0};
+        size_t remaining = 1;
+        while (remaining != 0 && std::get<0>(result)) {
+            ZSTD_outBuffer output{encoder_->block.data(), encoder_->block.size(), 0};
+            remaining = ZSTD_compressStream2(encoder_->zstd, &output, &input, ZSTD_e_end);
+            if (ZSTD_isError(remaining)) {
+                result = {false, std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining)};
+                break;
+            }
+            result = writeFile(reinterpret_cast<const char*>(encoder_->block.data()), output.pos);
+        }
+    }
+#endif
+    encoder_.reset();
+
+    if (fclose(file_) != 0 && std::get<0>(result)) {
+        result = {false, "Could not write output file " + path_ + ": " + strerror(errno)};
+    }
+    file_ = nullptr;
+    return result;
+}
+
+std::tuple<bool, std::string> ScriptWriter::writeFile(const char* data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, file_) != size) {
+        return {false, "Could not write output file " + path_ + ": " + strerror(errno)};
+    }
+    bytes_out_ += size;
+    return {true, ""};
+}
+
+// Run deflate until it has consumed all pending input, or until the stream
+// is complete when finishing
+std::tuple<bool, std::string> ScriptWriter::drain(bool finish) {
+    z_stream& stream = encoder_->gzip;
+    for (;;) {
+        stream.next_out = encoder_->block.data();
+        stream.avail_out = static_cast<uInt>(encoder_->block.size());
+        int status = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (status == Z_STREAM_ERROR) {
+            return {false, "gzip compression failed"};
+        }
+        auto [written, error] = writeFile(reinterpret_cast<const char*>(encoder_->block.data()),
+                                          encoder_->block.size() - stream.avail_out);
+        if (!written) {
+            return {false, error};
+        }
+        if (finish ? status == Z_STREAM_END : stream.avail_out != 0) {
+            return {true, ""};
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+/**
+ * @class ScriptWriter
+ * @brief Write a generated script to a file, optionally compressing it on the fly
+ *
+ * Text passed to write() is compressed in fixed-size blocks and the blocks are
+ * written as they fill, so neither an uncompressed copy of the script nor the
+ * whole compressed file is ever held. gzip output uses zlib and can be read
+ * with gunzip or zcat; zstd output is only available when the compiler was
+ * built with HAVE_ZSTD (make ZSTD=1).
+ */
+class ScriptWriter {
+public:
+    enum class Compression {
+        NONE,
+        GZIP,
+        ZSTD
+    };
+
+    // Level used when none is given
+    static constexpr int DEFAULT_GZIP_LEVEL = 6;
+    static constexpr int DEFAULT_ZSTD_LEVEL = 3;
+
+    // Highest level accepted; zstd's levels above 19 need more memory to read back
+    static constexpr int MAX_GZIP_LEVEL = 9;
+    static constexpr int MAX_ZSTD_LEVEL = 19;
+
+    ScriptWriter() noexcept;
+    ~ScriptWriter();
+
+    ScriptWriter(const ScriptWriter&) = delete;
+    ScriptWriter& operator=(const ScriptWriter&) = delete;
+
+    /**
+     * @brief Map a --compress argument to a compression
+     * @param name "none", "gzip" or "zstd"
+     * @param compression Set to the compression on success
+     * @return Success flag and error message
+     */
+    static std::tuple<bool, std::string> parse_compression(std::string_view name, Compression& compression);
+
+    /**
+     * @brief Check a --compress-level argument against the levels of a compression
+     * @param compression The compression the level is for
+     * @param level The level, 1 or higher
+     * @return Success flag and error message
+     */
+    static std::tuple<bool, std::string> check_level(Compression compression, int level);
+
+    // Whether this build can write the compression
+    static bool is_available(Compression compression) noexcept;
+
+    // File name extension of a compression, such as ".gz"
+    static const char* extension(Compression compression) noexcept;
+
+    /**
+     * @brief Create or truncate the output file
+     * @param path File to write
+     * @param compression How to compress the output
+     * @param level Compression level, or 0 for the default of the compression
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> open(const std::string& path, Compression compression, int level = 0);
+
+    /**
+     * @brief Append script text
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> write(std::string_view text);
+
+    /**
+     * @brief Flush the compressor and close the file
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> close();
+
+    // Bytes of script text written so far, before compression
+    size_t bytes_in() const noexcept { return bytes_in_; }
+
+    // Bytes written to the file so far
+    size_t bytes_out() const noexcept { return bytes_out_; }
+
+private:
+    struct Encoder;
+
+    std::tuple<bool, std::string> writeFile(const char* data, size_t size);
+    std::tuple<bool, std::string> drain(bool finish);
+
+    FILE* file_ = nullptr;
+    std::string path_;
+    Compression compression_ = Compression::NONE;
+    std::unique_ptr<Encoder> encoder_;
+    size_t bytes_in_ = 0;
+    size_t bytes_out_ = 0;
+};
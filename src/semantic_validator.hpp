@@ -6,14 +6,11 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "statement.hpp"
-
-// Forward declarations
-class SectionStatement;
-class BlockStatement;
-class PropertyStatement;
-class Statement;
+#include "diagnostics.hpp"
+#include "flat_ast.hpp"
 
 
 /**
@@ -22,16 +19,49 @@ class Statement;
  * 
  * This abstract class provides common functionality for validating
  * the semantic structure of specialized sections with consistent
- * hierarchy rules.
+ * hierarchy rules. Validators read the flat AST, so a mapped AST image
+ * is validated without rebuilding Statement objects.
  */
 class SectionValidator {
 public:
+    /**
+     * @brief Get the shared validator of a top-level section type
+     * @param type The type of the section
+     * @return The validator, or nullptr for custom sections, which are not validated
+     */
+    static const SectionValidator* for_section(SectionStatement::SectionType type);
+    
     /**
      * @brief Validate the section structure and properties
-     * @param block The block statement containing the section content
-     * @return Tuple of validation result (success/failure) and error message
+     * @param ast The flat AST holding the section
+     * @param section The top-level section node
+     * @return Tuple of validation result (success/failure) and the first error message
+     */
+    std::tuple<bool, std::string> validate(const FlatAst& ast, FlatAst::NodeId section) const;
+    
+    /**
+     * @brief Validate the section structure and properties, reporting every problem
+     * @param ast The flat AST holding the section
+     * @param section The top-level section node
+     * @param diagnostics Sink receiving all errors found
      */
-    std::tuple<bool, std::string> validate(const BlockStatement* block) const;
+    void validate(const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const;
+    
+    /**
+     * @brief Split validation of a section into independent units, one per subsection
+     * @param ast The flat AST holding the section; it must outlive the tasks
+     * @param section The top-level section node
+     * @return Tasks that may run concurrently; running them in order equals validate()
+     */
+    std::vector<ValidationTask> tasks(const FlatAst& ast, FlatAst::NodeId section) const;
+    
+    /**
+     * @brief Check the nesting and properties of a single subsection
+     * @param ast The flat AST holding the subsection
+     * @param subsection The subsection to validate
+     * @param diagnostics Sink receiving all errors found
+     */
+    void validateSubsection(const FlatAst& ast, FlatAst::NodeId subsection, Diagnostics& diagnostics) const;
 
 protected:
     // Types of section nesting allowed
@@ -56,11 +86,12 @@ protected:
     
     /**
      * @brief Validate properties specific to this section type
-     * @param section The section statement to validate
-     * @return Tuple of validation result and error message
+     * @param ast The flat AST holding the subsection
+     * @param section The subsection to validate
+     * @param diagnostics Sink receiving all errors found
      */
-    virtual std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const = 0;
+    virtual void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const = 0;
     
     /**
      * @brief Check if nesting is valid for the given parent and child
@@ -82,11 +113,12 @@ private:
     NestingRule nesting_rule_;
     
     /**
-     * @brief Validate the hierarchical structure of the section
-     * @param block The block statement containing the section content
-     * @return Tuple of validation result and error message
+     * @brief Validate the sections nested inside one subsection
+     * @param ast The flat AST holding the subsection
+     * @param subsection The subsection whose children are checked
+     * @param diagnostics Sink receiving all errors found
      */
-    std::tuple<bool, std::string> validateHierarchy(const BlockStatement* block) const;
+    void validateHierarchy(const FlatAst& ast, FlatAst::NodeId subsection, Diagnostics& diagnostics) const;
 };
 
 class DeviceValidator : public SectionValidator {
@@ -94,8 +126,8 @@ public:
     DeviceValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
 };
 /**
  * @class InterfacesValidator
@@ -106,19 +138,11 @@ public:
     InterfacesValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
         
     bool isValidNesting(const std::string& parent_name, 
                        const std::string& child_name) const override;
-                       
-private:
-    // Define valid properties for different interface types
-    std::set<std::string> common_valid_props_;
-    std::set<std::string> vlan_specific_props_;
-    std::set<std::string> bonding_specific_props_;
-    std::set<std::string> bridge_specific_props_;
-    std::set<std::string> ethernet_specific_props_;
 };
 
 /**
@@ -130,8 +154,8 @@ public:
     IPValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
     
     bool isValidNesting(const std::string& parent_name, 
                        const std::string& child_name) const override;
@@ -146,8 +170,8 @@ public:
     RoutingValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
         
     bool isValidNesting(const std::string& parent_name, 
                        const std::string& child_name) const override;
@@ -162,8 +186,8 @@ public:
     FirewallValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
         
     bool isValidNesting(const std::string& parent_name, 
                        const std::string& child_name) const override;
@@ -178,6 +202,6 @@ public:
     CustomValidator();
     
 protected:
-    std::tuple<bool, std::string> validateProperties(
-        const SectionStatement* section) const override;
+    void validateProperties(
+        const FlatAst& ast, FlatAst::NodeId section, Diagnostics& diagnostics) const override;
 };
\ No newline at end of file
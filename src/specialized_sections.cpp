@@ -1,5 +1,6 @@
 #include "specialized_sections.hpp"
-#include "semantic_validator.hpp"
+#include "command_schema.hpp"
+#include "rule_reorder.hpp"
 #include <sstream>
 #include <algorithm>
 #include <set>
@@ -13,7 +14,11 @@ SpecializedSection::SpecializedSection(std::string_view name) noexcept
 
 std::string SpecializedSection::to_mikrotik(const std::string& ident) const {
     // Common translation logic
-    return translate_section(ident);
+    return translate_section(ident, TranslationContext());
+}
+
+std::string SpecializedSection::translate(const std::string& ident, const TranslationContext& context) const {
+    return translate_section(ident, context);
 }
 
 // DeviceSection implementation
@@ -24,13 +29,7 @@ DeviceSection::DeviceSection(std::string_view name) noexcept
     this->type = SectionType::DEVICE;
 }
 
-std::tuple<bool, std::string> DeviceSection::validate() const noexcept {
-    DeviceValidator validator;
-    return validator.validate(get_block());
-
-}
-
-std::string DeviceSection::translate_section(const std::string& ident) const {
+std::string DeviceSection::translate_section(const std::string& ident, const TranslationContext& context) const {
     std::string result = "# Device Configuration\n";
     
     if (get_block()) {
@@ -50,31 +49,19 @@ std::string DeviceSection::translate_section(const std::string& ident) const {
                 if (name == "vendor" && expr) {
                     const StringValue* value = dynamic_cast<const StringValue*>(expr);
                     if (value) {
-                        // Remove any quotes from the string value
                         vendor = value->get_value();
-                        if (vendor.size() >= 2 && vendor.front() == '"' && vendor.back() == '"') {
-                            vendor = vendor.substr(1, vendor.size() - 2);
-                        }
                     }
                 }
                 else if (name == "model" && expr) {
                     const StringValue* value = dynamic_cast<const StringValue*>(expr);
                     if (value) {
-                        // Remove any quotes from the string value
                         model = value->get_value();
-                        if (model.size() >= 2 && model.front() == '"' && model.back() == '"') {
-                            model = model.substr(1, model.size() - 2);
-                        }
                     }
                 }
                 else if (name == "hostname" && expr) {
                     const StringValue* value = dynamic_cast<const StringValue*>(expr);
                     if (value) {
-                        // Remove any quotes from the string value
                         hostname = value->get_value();
-                        if (hostname.size() >= 2 && hostname.front() == '"' && hostname.back() == '"') {
-                            hostname = hostname.substr(1, hostname.size() - 2);
-                        }
                     }
                 }
             }
@@ -117,14 +104,9 @@ InterfacesSection::InterfacesSection(std::string_view name) noexcept
 
 
 }
-std::tuple<bool, std::string> InterfacesSection::validate() const noexcept {
-    InterfacesValidator validator;
-    return validator.validate(get_block());
-}
-
 
 
-std::string InterfacesSection::translate_section(const std::string& ident) const {
+std::string InterfacesSection::translate_section(const std::string& ident, const TranslationContext& context) const {
     std::string result = "# Interface Configuration\n";
 
     if (get_block()) {
@@ -155,7 +137,7 @@ std::string InterfacesSection::translate_section(const std::string& ident) const
                 }
                 
                 // Process this interface using our helper
-                result += process_interface_section(section, interface_name);
+                result += process_interface_section(section, interface_name, context);
             }
         }
     }
@@ -163,7 +145,8 @@ std::string InterfacesSection::translate_section(const std::string& ident) const
 }
 
 // Add helper method to process a single interface section
-std::string InterfacesSection::process_interface_section(const SectionStatement* section, const std::string& interface_name) const {
+std::string InterfacesSection::process_interface_section(const SectionStatement* section, const std::string& interface_name,
+                                                         const TranslationContext& context) const {
     std::string result = "";
     
     if (!section || !section->get_block()) {
@@ -194,14 +177,16 @@ std::string InterfacesSection::process_interface_section(const SectionStatement*
             std::string value = "";
             if (const StringValue* str_val = dynamic_cast<const StringValue*>(expr)) {
                 value = str_val->get_value();
-                // Remove quotes if present
-                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                    value = value.substr(1, value.size() - 2);
-                }
             } else if (const NumberValue* num_val = dynamic_cast<const NumberValue*>(expr)) {
                 value = std::to_string(num_val->get_value());
             } else if (const BooleanValue* bool_val = dynamic_cast<const BooleanValue*>(expr)) {
                 value = bool_val->get_value() ? "yes" : "no";
+            } else if (context.symbol_table && dynamic_cast<const ListValue*>(expr)) {
+                // Interface lists (bonding slaves, bridge ports) come from the symbol table
+                for (const SymbolTable::Reference* reference : context.symbol_table->references_at(prop)) {
+                    if (!value.empty()) value += ",";
+                    value += reference->name;
+                }
             }
             
             // Store property values
@@ -393,12 +378,8 @@ IPSection::IPSection(std::string_view name) noexcept
     this->type = SectionType::IP;
 }
 
-std::tuple<bool, std::string> IPSection::validate() const noexcept {
-    IPValidator validator;
-    return validator.validate(get_block());
-}
-
-std::string IPSection::translate_section(const std::string& ident) const {
+std::string IPSection::translate_section(const std::string& ident, const TranslationContext& context) const {
+    namespace commands = routeros_commands;
     std::string result = ident + "# IP Configuration: " + get_name() + "\n";
     
     if (get_block()) {
@@ -408,289 +389,107 @@ std::string IPSection::translate_section(const std::string& ident) const {
         for (const auto* stmt : block->get_statements()) {
             // Check if this is a section (interface, route, firewall, etc.)
             if (const auto* subsection = dynamic_cast<const SectionStatement*>(stmt)) {
-                std::string subsection_name = subsection->get_name();
+                const std::string& subsection_name = subsection->get_name();
+                const BlockStatement* subsection_block = subsection->get_block();
+                if (!subsection_block) {
+                    continue;
+                }
                 
                 // Handle different IP subsections based on name
                 if (subsection_name == "route" || subsection_name == "routes") {
-                    // Handle IP routes
-                    if (subsection->get_block()) {
-                        for (const auto* route_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* route_prop = dynamic_cast<const PropertyStatement*>(route_stmt)) {
-                                if (route_prop->get_name() == "default" && route_prop->get_value()) {
-                                    // Default route
-                                    std::string gateway = route_prop->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (gateway.size() >= 2 && gateway.front() == '"' && gateway.back() == '"') {
-                                        gateway = gateway.substr(1, gateway.size() - 2);
-                                    }
-                                    result += "/ip route add dst-address=0.0.0.0/0 gateway=" + gateway + "\n";
-                                }
-                            } else if (const auto* route_section = dynamic_cast<const SectionStatement*>(route_stmt)) {
-                                // Handle specific route entries
-                                std::string dst_address = route_section->get_name();
-                                std::string gateway = "";
-                                std::string distance = "";
-                                
-                                if (route_section->get_block()) {
-                                    for (const auto* route_detail : route_section->get_block()->get_statements()) {
-                                        if (const auto* detail_prop = dynamic_cast<const PropertyStatement*>(route_detail)) {
-                                            if (detail_prop->get_name() == "gateway" && detail_prop->get_value()) {
-                                                gateway = detail_prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (gateway.size() >= 2 && gateway.front() == '"' && gateway.back() == '"') {
-                                                    gateway = gateway.substr(1, gateway.size() - 2);
-                                                }
-                                            } else if (detail_prop->get_name() == "distance" && detail_prop->get_value()) {
-                                                distance = detail_prop->get_value()->to_mikrotik("");
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                if (!gateway.empty()) {
-                                    result += "/ip route add dst-address=" + dst_address;
-                                    result += " gateway=" + gateway;
-                                    if (!distance.empty()) {
-                                        result += " distance=" + distance;
-                                    }
-                                    result += "\n";
-                                }
+                    for (const auto* route_stmt : subsection_block->get_statements()) {
+                        if (const auto* route_prop = dynamic_cast<const PropertyStatement*>(route_stmt)) {
+                            if (route_prop->get_name() == "default" && route_prop->get_value()) {
+                                // Default route
+                                result += "/ip route add dst-address=0.0.0.0/0 gateway=";
+                                append_expression_text(result, route_prop->get_value());
+                                result += "\n";
                             }
+                        } else if (const auto* route_section = dynamic_cast<const SectionStatement*>(route_stmt)) {
+                            // Specific route entries are named by their destination
+                            RouterOSCommand route(commands::IP_ROUTE);
+                            route.set("dst-address", route_section->get_name());
+                            route.set_properties(route_section->get_block());
+                            route.emit(result);
                         }
                     }
                 } else if (subsection_name == "firewall") {
-                    // Handle firewall rules
-                    if (subsection->get_block()) {
-                        for (const auto* fw_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* fw_section = dynamic_cast<const SectionStatement*>(fw_stmt)) {
-                                std::string chain_name = fw_section->get_name();
-                                
-                                // Process filter or nat chains
-                                if (chain_name == "filter" || chain_name == "nat") {
-                                    if (fw_section->get_block()) {
-                                        for (const auto* rule_stmt : fw_section->get_block()->get_statements()) {
-                                            if (const auto* rule_section = dynamic_cast<const SectionStatement*>(rule_stmt)) {
-                                                std::string rule_chain = rule_section->get_name();
-                                                std::string action = "";
-                                                std::string protocol = "";
-                                                std::string dst_port = "";
-                                                std::string dst_address = "";
-                                                std::string src_address = "";
-                                                std::string out_interface = "";
-                                                std::string in_interface = "";
-                                                
-                                                if (rule_section->get_block()) {
-                                                    for (const auto* rule_prop : rule_section->get_block()->get_statements()) {
-                                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(rule_prop)) {
-                                                            std::string prop_name = prop->get_name();
-                                                            std::string value = "";
-                                                            if (prop->get_value()) {
-                                                                value = prop->get_value()->to_mikrotik("");
-                                                                // Remove quotes if present
-                                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                                    value = value.substr(1, value.size() - 2);
-                                                                }
-                                                            }
-                                                            
-                                                            if (prop_name == "action") action = value;
-                                                            else if (prop_name == "protocol") protocol = value;
-                                                            else if (prop_name == "dst-port") dst_port = value;
-                                                            else if (prop_name == "dst-address") dst_address = value;
-                                                            else if (prop_name == "src-address") src_address = value;
-                                                            else if (prop_name == "out-interface") out_interface = value;
-                                                            else if (prop_name == "in-interface") in_interface = value;
-                                                        }
-                                                    }
-                                                }
-                                                
-                                                // Generate firewall rule
-                                                if (!action.empty()) {
-                                                    result += "/ip firewall " + chain_name + " add chain=" + rule_chain;
-                                                    result += " action=" + action;
-                                                    if (!protocol.empty()) result += " protocol=" + protocol;
-                                                    if (!dst_port.empty()) result += " dst-port=" + dst_port;
-                                                    if (!dst_address.empty()) result += " dst-address=" + dst_address;
-                                                    if (!src_address.empty()) result += " src-address=" + src_address;
-                                                    if (!out_interface.empty()) result += " out-interface=" + out_interface;
-                                                    if (!in_interface.empty()) result += " in-interface=" + in_interface;
-                                                    result += "\n";
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
+                    // Rules of the filter and nat chains, named by the chain they go into
+                    for (const auto* fw_stmt : subsection_block->get_statements()) {
+                        const auto* fw_section = dynamic_cast<const SectionStatement*>(fw_stmt);
+                        if (!fw_section || !fw_section->get_block()) {
+                            continue;
+                        }
+                        const CommandSchema* schema = nullptr;
+                        if (fw_section->get_name() == "filter") {
+                            schema = &commands::IP_FIREWALL_FILTER;
+                        } else if (fw_section->get_name() == "nat") {
+                            schema = &commands::IP_FIREWALL_NAT;
+                        } else {
+                            continue;
+                        }
+                        
+                        for (const auto* rule_stmt : fw_section->get_block()->get_statements()) {
+                            if (const auto* rule_section = dynamic_cast<const SectionStatement*>(rule_stmt)) {
+                                RouterOSCommand rule(*schema);
+                                rule.set("chain", rule_section->get_name());
+                                rule.set_properties(rule_section->get_block());
+                                rule.emit(result);
                             }
                         }
                     }
                 } else if (subsection_name == "dhcp-server") {
-                    // Handle DHCP server configuration
-                    if (subsection->get_block()) {
-                        for (const auto* dhcp_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* dhcp_section = dynamic_cast<const SectionStatement*>(dhcp_stmt)) {
-                                std::string dhcp_name = dhcp_section->get_name();
-                                std::string interface = "";
-                                std::string address_pool = "";
-                                std::string lease_time = "";
-                                
-                                if (dhcp_section->get_block()) {
-                                    for (const auto* dhcp_prop : dhcp_section->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(dhcp_prop)) {
-                                            std::string prop_name = prop->get_name();
-                                            std::string value = "";
-                                            if (prop->get_value()) {
-                                                value = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                }
-                                            }
-                                            
-                                            if (prop_name == "interface") interface = value;
-                                            else if (prop_name == "address-pool") address_pool = value;
-                                            else if (prop_name == "lease-time") lease_time = value;
-                                        }
-                                    }
-                                }
-                                
-                                // Generate DHCP server
-                                if (!interface.empty()) {
-                                    result += "/ip dhcp-server add name=" + dhcp_name;
-                                    result += " interface=" + interface;
-                                    if (!address_pool.empty()) result += " address-pool=" + address_pool;
-                                    if (!lease_time.empty()) result += " lease-time=" + lease_time;
-                                    result += "\n";
-                                }
-                            }
+                    for (const auto* dhcp_stmt : subsection_block->get_statements()) {
+                        if (const auto* dhcp_section = dynamic_cast<const SectionStatement*>(dhcp_stmt)) {
+                            RouterOSCommand server(commands::DHCP_SERVER);
+                            server.set("name", dhcp_section->get_name());
+                            server.set_properties(dhcp_section->get_block());
+                            server.emit(result);
                         }
                     }
                 } else if (subsection_name == "dhcp-client") {
-                    // Handle DHCP client configuration
-                    if (subsection->get_block()) {
-                        for (const auto* dhcp_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* dhcp_prop = dynamic_cast<const PropertyStatement*>(dhcp_stmt)) {
-                                std::string interface = dhcp_prop->get_name();
-                                std::string disabled = "no"; // Enable by default
-                                
-                                if (dhcp_prop->get_value()) {
-                                    std::string value = dhcp_prop->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                        value = value.substr(1, value.size() - 2);
-                                    }
-                                    
-                                    if (value == "false" || value == "no") {
-                                        disabled = "yes";
-                                    }
-                                }
-                                
-                                result += "/ip dhcp-client add interface=" + interface;
-                                result += " disabled=" + disabled + "\n";
+                    // One client per interface, enabled unless the value says otherwise
+                    for (const auto* dhcp_stmt : subsection_block->get_statements()) {
+                        if (const auto* dhcp_prop = dynamic_cast<const PropertyStatement*>(dhcp_stmt)) {
+                            RouterOSCommand client(commands::DHCP_CLIENT);
+                            client.set("interface", dhcp_prop->get_name());
+                            if (dhcp_prop->get_value()) {
+                                client.set("disabled", expression_text(dhcp_prop->get_value()));
                             }
+                            client.emit(result);
                         }
                     }
                 } else if (subsection_name == "dns") {
-                    // Handle DNS configuration
-                    std::string servers = "";
-                    std::string allow_remote = "";
-                     
-                    if (subsection->get_block()) {
-                        for (const auto* dns_prop : subsection->get_block()->get_statements()) {
-                            if (const auto* prop = dynamic_cast<const PropertyStatement*>(dns_prop)) {
-                                std::string prop_name = prop->get_name();
-                                std::string value = "";
-                                if (prop->get_value()) {
-                                    value = prop->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                        value = value.substr(1, value.size() - 2);
-                                    }
-                                }
-                                
-                                if (prop_name == "servers") servers = value;
-                                else if (prop_name == "allow-remote-requests") allow_remote = value;
-                            }
-                        }
-                    }
-                    
-                    // Generate DNS configuration
-                    if (!servers.empty() || !allow_remote.empty()) {
-                        result += "/ip dns set";
-                        if (!servers.empty()) result += " servers=" + servers;
-                        if (!allow_remote.empty()) result += " allow-remote-requests=" + allow_remote;
-                        result += "\n";
-                    }
+                    RouterOSCommand dns(commands::DNS);
+                    dns.set_properties(subsection_block);
+                    dns.emit(result);
                 } else {
                     // Process as an interface with IP addresses (default case)
-                    std::string interface_name = subsection_name;
-                    
-                    // Process the IP configuration for this interface
-                    if (subsection->get_block()) {
-                        for (const auto* ip_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* ip_prop = dynamic_cast<const PropertyStatement*>(ip_stmt)) {
-                                if (ip_prop->get_name() == "address" && ip_prop->get_value()) {
-                                    std::string ip_value = ip_prop->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (ip_value.size() >= 2 && ip_value.front() == '"' && ip_value.back() == '"') {
-                                        ip_value = ip_value.substr(1, ip_value.size() - 2);
-                                    }
-                                    
-                                    // Generate /ip address add command
-                                    result += "/ip address add address=" + ip_value + 
-                                              " interface=" + interface_name + "\n";
-                                }
+                    for (const auto* ip_stmt : subsection_block->get_statements()) {
+                        if (const auto* ip_prop = dynamic_cast<const PropertyStatement*>(ip_stmt)) {
+                            if (ip_prop->get_name() == "address" && ip_prop->get_value()) {
+                                RouterOSCommand address(commands::IP_ADDRESS);
+                                address.set("address", expression_text(ip_prop->get_value()));
+                                address.set("interface", subsection_name);
+                                address.emit(result);
                             }
                         }
                     }
                 }
             } else if (const auto* prop_stmt = dynamic_cast<const PropertyStatement*>(stmt)) {
                 // Handle top-level IP properties (direct properties under the ip: section)
-                // This could be for global IP settings or simple configurations
-                std::string prop_name = prop_stmt->get_name();
-                
-                if (prop_name == "arp") {
-                    // Handle static ARP entries
-                    if (prop_stmt->get_value()) {
-                        // Check if this is a section statement containing ARP entries
-                        const SectionStatement* arp_section = dynamic_cast<const SectionStatement*>(prop_stmt->get_value());
-                        if (arp_section && arp_section->get_block()) {
-                            const BlockStatement* arp_block = arp_section->get_block();
-                            for (const auto* arp_stmt : arp_block->get_statements()) {
-                                if (const auto* arp_prop = dynamic_cast<const PropertyStatement*>(arp_stmt)) {
-                                    std::string ip_address = arp_prop->get_name();
-                                    std::string mac_address = "";
-                                    std::string interface = "";
-                                    
-                                    // Handle the ARP entry properties
-                                    if (arp_prop->get_value()) {
-                                        // Try to get MAC and interface from nested section
-                                        const SectionStatement* mac_section = dynamic_cast<const SectionStatement*>(arp_prop->get_value());
-                                        if (mac_section && mac_section->get_block()) {
-                                            for (const auto* mac_stmt : mac_section->get_block()->get_statements()) {
-                                                if (const auto* mac_prop = dynamic_cast<const PropertyStatement*>(mac_stmt)) {
-                                                    if (mac_prop->get_name() == "mac-address" && mac_prop->get_value()) {
-                                                        mac_address = mac_prop->get_value()->to_mikrotik("");
-                                                    } else if (mac_prop->get_name() == "interface" && mac_prop->get_value()) {
-                                                        interface = mac_prop->get_value()->to_mikrotik("");
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                    
-                                    if (!mac_address.empty() && !interface.empty()) {
-                                        // Remove quotes if present
-                                        if (mac_address.size() >= 2 && mac_address.front() == '"' && mac_address.back() == '"') {
-                                            mac_address = mac_address.substr(1, mac_address.size() - 2);
-                                        }
-                                        if (interface.size() >= 2 && interface.front() == '"' && interface.back() == '"') {
-                                            interface = interface.substr(1, interface.size() - 2);
-                                        }
-                                        
-                                        result += "/ip arp add address=" + ip_address;
-                                        result += " mac-address=" + mac_address;
-                                        result += " interface=" + interface + "\n";
-                                    }
+                if (prop_stmt->get_name() == "arp") {
+                    // Static ARP entries are named by their IP address
+                    const auto* arp_section = dynamic_cast<const SectionStatement*>(prop_stmt->get_value());
+                    if (arp_section && arp_section->get_block()) {
+                        for (const auto* arp_stmt : arp_section->get_block()->get_statements()) {
+                            if (const auto* arp_prop = dynamic_cast<const PropertyStatement*>(arp_stmt)) {
+                                RouterOSCommand arp(commands::ARP);
+                                arp.set("address", arp_prop->get_name());
+                                if (const auto* mac_section = dynamic_cast<const SectionStatement*>(arp_prop->get_value())) {
+                                    arp.set_properties(mac_section->get_block());
                                 }
+                                arp.emit(result);
                             }
                         }
                     }
@@ -709,12 +508,8 @@ RoutingSection::RoutingSection(std::string_view name) noexcept
     this->type = SectionType::ROUTING;
 }
 
-std::tuple<bool, std::string> RoutingSection::validate() const noexcept {
-    RoutingValidator validator;
-    return validator.validate(get_block());
-}
-
-std::string RoutingSection::translate_section(const std::string& ident) const {
+std::string RoutingSection::translate_section(const std::string& ident, const TranslationContext& context) const {
+    namespace commands = routeros_commands;
     std::string result = ident + "# Routing Configuration: " + get_name() + "\n";
     
     if (get_block()) {
@@ -724,221 +519,71 @@ std::string RoutingSection::translate_section(const std::string& ident) const {
         for (const auto* stmt : block->get_statements()) {
             // Handle properties vs subsections differently
             if (const auto* prop_stmt = dynamic_cast<const PropertyStatement*>(stmt)) {
-                // Handle properties like default gateway
-                std::string prop_name = prop_stmt->get_name();
-                
-                if (prop_name == "static_route_default_gw" && prop_stmt->get_value()) {
-                    // Default route
-                    std::string gateway = prop_stmt->get_value()->to_mikrotik("");
-                    // Remove quotes if present
-                    if (gateway.size() >= 2 && gateway.front() == '"' && gateway.back() == '"') {
-                        gateway = gateway.substr(1, gateway.size() - 2);
-                    }
-                    
+                if (prop_stmt->get_name() == "static_route_default_gw" && prop_stmt->get_value()) {
                     // Generate default route
-                    result += "/ip route add dst-address=0.0.0.0/0 gateway=" + gateway + "\n";
+                    result += "/ip route add dst-address=0.0.0.0/0 gateway=";
+                    append_expression_text(result, prop_stmt->get_value());
+                    result += "\n";
                 }
-            } else if (const auto* route_section = dynamic_cast<const SectionStatement*>(stmt)) {
-                // Handle named route sections (static_route1, etc.)
-                std::string route_name = route_section->get_name();
-                
-                // Extract route properties
-                std::string destination = "";
-                std::string gateway = "";
-                std::string distance = "";
-                std::string routing_table = "";
-                std::string check_gateway = "";
-                std::string scope = "";
-                std::string target_scope = "";
-                bool suppress_hw_offload = false;
-                
-                if (route_section->get_block()) {
-                    for (const auto* route_prop : route_section->get_block()->get_statements()) {
-                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(route_prop)) {
-                            std::string prop_name = prop->get_name();
-                            std::string value = "";
-                            
-                            if (prop->get_value()) {
-                                value = prop->get_value()->to_mikrotik("");
-                                // Remove quotes if present
-                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                    value = value.substr(1, value.size() - 2);
-                                }
-                            }
-                            
-                            if (prop_name == "destination" || prop_name == "dst-address" || prop_name == "dst") {
-                                destination = value;
-                            } else if (prop_name == "gateway" || prop_name == "gw") {
-                                gateway = value;
-                            } else if (prop_name == "distance") {
-                                distance = value;
-                            } else if (prop_name == "routing-table" || prop_name == "table") {
-                                routing_table = value;
-                            } else if (prop_name == "check-gateway") {
-                                check_gateway = value;
-                            } else if (prop_name == "scope") {
-                                scope = value;
-                            } else if (prop_name == "target-scope") {
-                                target_scope = value;
-                            } else if (prop_name == "suppress-hw-offload") {
-                                suppress_hw_offload = (value == "yes" || value == "true");
-                            }
-                        }
-                    }
+                continue;
+            }
+            
+            const auto* subsection = dynamic_cast<const SectionStatement*>(stmt);
+            if (!subsection) {
+                continue;
+            }
+            const std::string& subsection_name = subsection->get_name();
+            const BlockStatement* subsection_block = subsection->get_block();
+            
+            if (subsection_name == "table" || subsection_name == "tables") {
+                // Routing tables, installed in the FIB unless fib is off
+                if (!subsection_block) {
+                    continue;
                 }
-                
-                // Generate a static route if we have at least a destination and gateway
-                if (!destination.empty() && !gateway.empty()) {
-                    result += "/ip route add dst-address=" + destination;
-                    result += " gateway=" + gateway;
-                    
-                    // Add optional parameters
-                    if (!distance.empty()) {
-                        result += " distance=" + distance;
-                    }
-                    if (!routing_table.empty()) {
-                        result += " routing-table=" + routing_table;
-                    }
-                    if (!check_gateway.empty()) {
-                        result += " check-gateway=" + check_gateway;
+                for (const auto* table_stmt : subsection_block->get_statements()) {
+                    if (const auto* table_section = dynamic_cast<const SectionStatement*>(table_stmt)) {
+                        RouterOSCommand table(commands::ROUTING_TABLE);
+                        table.set("name", table_section->get_name());
+                        table.set_properties(table_section->get_block());
+                        table.emit(result);
                     }
-                    if (!scope.empty()) {
-                        result += " scope=" + scope;
-                    }
-                    if (!target_scope.empty()) {
-                        result += " target-scope=" + target_scope;
-                    }
-                    if (suppress_hw_offload) {
-                        result += " suppress-hw-offload=yes";
-                    }
-                    
-                    result += "\n";
                 }
-            } else if (const auto* subsection = dynamic_cast<const SectionStatement*>(stmt)) {
-                // Handle specific routing subsections like 'table', 'rule', etc.
-                std::string subsection_name = subsection->get_name();
-                
-                if (subsection_name == "table" || subsection_name == "tables") {
-                    // Handle routing tables
-                    if (subsection->get_block()) {
-                        for (const auto* table_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* table_section = dynamic_cast<const SectionStatement*>(table_stmt)) {
-                                std::string table_name = table_section->get_name();
-                                bool fib = true; // Default in RouterOS v7
-                                
-                                if (table_section->get_block()) {
-                                    for (const auto* table_prop : table_section->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(table_prop)) {
-                                            if (prop->get_name() == "fib" && prop->get_value()) {
-                                                std::string value = prop->get_value()->to_mikrotik("");
-                                                if (value == "no" || value == "false") {
-                                                    fib = false;
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                // Generate routing table
-                                result += "/routing table add name=" + table_name;
-                                if (fib) {
-                                    result += " fib";
-                                }
-                                result += "\n";
-                            }
-                        }
+            } else if (subsection_name == "rule" || subsection_name == "rules") {
+                if (!subsection_block) {
+                    continue;
+                }
+                for (const auto* rule_stmt : subsection_block->get_statements()) {
+                    if (const auto* rule_section = dynamic_cast<const SectionStatement*>(rule_stmt)) {
+                        RouterOSCommand rule(commands::ROUTING_RULE);
+                        rule.set_properties(rule_section->get_block());
+                        rule.emit(result);
                     }
-                } else if (subsection_name == "rule" || subsection_name == "rules") {
-                    // Handle routing rules
-                    if (subsection->get_block()) {
-                        for (const auto* rule_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* rule_section = dynamic_cast<const SectionStatement*>(rule_stmt)) {
-                                std::string rule_name = rule_section->get_name();
-                                std::string src_address = "";
-                                std::string dst_address = "";
-                                std::string interface = "";
-                                std::string action = "";
-                                std::string table = "";
-                                
-                                if (rule_section->get_block()) {
-                                    for (const auto* rule_prop : rule_section->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(rule_prop)) {
-                                            std::string prop_name = prop->get_name();
-                                            std::string value = "";
-                                            
-                                            if (prop->get_value()) {
-                                                value = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                }
-                                            }
-                                            
-                                            if (prop_name == "src-address") {
-                                                src_address = value;
-                                            } else if (prop_name == "dst-address") {
-                                                dst_address = value;
-                                            } else if (prop_name == "interface") {
-                                                interface = value;
-                                            } else if (prop_name == "action") {
-                                                action = value;
-                                            } else if (prop_name == "table") {
-                                                table = value;
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                // Generate routing rule
-                                result += "/routing rule add";
-                                if (!src_address.empty()) {
-                                    result += " src-address=" + src_address;
-                                }
-                                if (!dst_address.empty()) {
-                                    result += " dst-address=" + dst_address;
-                                }
-                                if (!interface.empty()) {
-                                    result += " interface=" + interface;
-                                }
-                                if (!action.empty()) {
-                                    result += " action=" + action;
-                                }
-                                if (!table.empty()) {
-                                    result += " table=" + table;
-                                }
-                                result += "\n";
-                            }
-                        }
+                }
+            } else if (subsection_name == "filter") {
+                // Routing filters for v7: one rule per rule property of a chain
+                if (!subsection_block) {
+                    continue;
+                }
+                for (const auto* filter_stmt : subsection_block->get_statements()) {
+                    const auto* filter_section = dynamic_cast<const SectionStatement*>(filter_stmt);
+                    if (!filter_section || !filter_section->get_block()) {
+                        continue;
                     }
-                } else if (subsection_name == "filter") {
-                    // Handle routing filters for v7
-                    if (subsection->get_block()) {
-                        for (const auto* filter_stmt : subsection->get_block()->get_statements()) {
-                            if (const auto* filter_section = dynamic_cast<const SectionStatement*>(filter_stmt)) {
-                                std::string chain_name = filter_section->get_name();
-                                std::string rule = "";
-                                
-                                if (filter_section->get_block()) {
-                                    for (const auto* filter_prop : filter_section->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(filter_prop)) {
-                                            if (prop->get_name() == "rule" && prop->get_value()) {
-                                                rule = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (rule.size() >= 2 && rule.front() == '"' && rule.back() == '"') {
-                                                    rule = rule.substr(1, rule.size() - 2);
-                                                }
-                                                
-                                                // Generate routing filter rule
-                                                result += "/routing/filter/rule add chain=" + chain_name;
-                                                result += " rule=\"" + rule + "\"\n";
-                                            }
-                                        }
-                                    }
-                                }
-                            }
+                    for (const auto* filter_prop : filter_section->get_block()->get_statements()) {
+                        const auto* prop = dynamic_cast<const PropertyStatement*>(filter_prop);
+                        if (prop && prop->get_name() == "rule" && prop->get_value()) {
+                            RouterOSCommand rule(commands::ROUTING_FILTER_RULE);
+                            rule.set("chain", filter_section->get_name());
+                            rule.set("rule", expression_text(prop->get_value()));
+                            rule.emit(result);
                         }
                     }
                 }
+            } else {
+                // Named route sections (static_route1, etc.) need a destination and a gateway
+                RouterOSCommand route(commands::STATIC_ROUTE);
+                route.set_properties(subsection_block);
+                route.emit(result);
             }
         }
     }
@@ -953,12 +598,8 @@ FirewallSection::FirewallSection(std::string_view name) noexcept
     this->type = SectionType::FIREWALL;
 }
 
-std::tuple<bool, std::string> FirewallSection::validate() const noexcept {
-    FirewallValidator validator;
-    return validator.validate(get_block());
-}
-
-std::string FirewallSection::translate_section(const std::string& ident) const {
+std::string FirewallSection::translate_section(const std::string& ident, const TranslationContext& context) const {
+    namespace commands = routeros_commands;
     std::string result = ident + "# Firewall Configuration: " + get_name() + "\n";
     
     if (get_block()) {
@@ -966,384 +607,77 @@ std::string FirewallSection::translate_section(const std::string& ident) const {
         
         // Process each subsection (filter, nat, etc.)
         for (const auto* stmt : block->get_statements()) {
-            if (const auto* section = dynamic_cast<const SectionStatement*>(stmt)) {
-                std::string section_name = section->get_name();
-                
-                // Process filter rules
-                if (section_name == "filter") {
-                    if (section->get_block()) {
-                        for (const auto* rule_stmt : section->get_block()->get_statements()) {
-                            if (const auto* rule = dynamic_cast<const SectionStatement*>(rule_stmt)) {
-                                std::string rule_name = rule->get_name();
-                                std::string chain = "forward"; // Default chain
-                                std::string action = "";
-                                std::string connection_state = "";
-                                std::string protocol = "";
-                                std::string src_address = "";
-                                std::string dst_address = "";
-                                std::string src_port = "";
-                                std::string dst_port = "";
-                                std::string in_interface = "";
-                                std::string out_interface = "";
-                                std::string comment = rule_name;
-                                
-                                // Extract properties for this filter rule
-                                if (rule->get_block()) {
-                                    for (const auto* prop_stmt : rule->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(prop_stmt)) {
-                                            std::string prop_name = prop->get_name();
-                                            std::string value = "";
-                                            
-                                            if (prop->get_value()) {
-                                                value = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                }
-                                            }
-                                            
-                                            if (prop_name == "chain") {
-                                                chain = value;
-                                            } else if (prop_name == "action") {
-                                                action = value;
-                                            } else if (prop_name == "connection_state" || prop_name == "connection-state") {
-                                                // Handle array of states like ["established", "related"]
-                                                if (value.front() == '[' && value.back() == ']') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                    std::string state;
-                                                    std::stringstream ss(value);
-                                                    bool first = true;
-                                                    
-                                                    while (ss >> state) {
-                                                        // Clean up state - remove quotes and commas
-                                                        state.erase(remove(state.begin(), state.end(), '"'), state.end());
-                                                        state.erase(remove(state.begin(), state.end(), ','), state.end());
-                                                        
-                                                        if (!state.empty()) {
-                                                            if (first) {
-                                                                connection_state = state;
-                                                                first = false;
-                                                            } else {
-                                                                connection_state += "," + state;
-                                                            }
-                                                        }
-                                                    }
-                                                } else {
-                                                    connection_state = value;
-                                                }
-                                            } else if (prop_name == "protocol") {
-                                                protocol = value;
-                                            } else if (prop_name == "src_address" || prop_name == "src-address") {
-                                                src_address = value;
-                                            } else if (prop_name == "dst_address" || prop_name == "dst-address") {
-                                                dst_address = value;
-                                            } else if (prop_name == "src_port" || prop_name == "src-port") {
-                                                src_port = value;
-                                            } else if (prop_name == "dst_port" || prop_name == "dst-port") {
-                                                dst_port = value;
-                                            } else if (prop_name == "in_interface" || prop_name == "in-interface") {
-                                                in_interface = value;
-                                            } else if (prop_name == "out_interface" || prop_name == "out-interface") {
-                                                out_interface = value;
-                                            } else if (prop_name == "comment") {
-                                                comment = value;
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                // Generate the filter rule if an action is specified
-                                if (!action.empty()) {
-                                    result += "/ip firewall filter add chain=" + chain + " action=" + action;
-                                    
-                                    // Add optional parameters
-                                    if (!connection_state.empty()) {
-                                        // Clean up connection_state - remove quotes and braces
-                                        std::string clean_conn_state;
-                                        bool in_quote = false;
-                                        
-                                        for (size_t i = 0; i < connection_state.size(); i++) {
-                                            char c = connection_state[i];
-                                            // Skip braces, quotes, and spaces
-                                            if (c == '{' || c == '}' || c == '"' || (c == ' ' && !in_quote)) {
-                                                continue;
-                                            }
-                                            clean_conn_state += c;
-                                        }
-                                        
-                                        result += " connection-state=" + clean_conn_state;
-                                    }
-                                    if (!protocol.empty()) {
-                                        result += " protocol=" + protocol;
-                                    }
-                                    if (!src_address.empty()) {
-                                        result += " src-address=" + src_address;
-                                    }
-                                    if (!dst_address.empty()) {
-                                        result += " dst-address=" + dst_address;
-                                    }
-                                    if (!src_port.empty()) {
-                                        result += " src-port=" + src_port;
-                                    }
-                                    if (!dst_port.empty()) {
-                                        result += " dst-port=" + dst_port;
-                                    }
-                                    if (!in_interface.empty()) {
-                                        result += " in-interface=" + in_interface;
-                                    }
-                                    if (!out_interface.empty()) {
-                                        result += " out-interface=" + out_interface;
-                                    }
-                                    if (!comment.empty()) {
-                                        result += " comment=\"" + comment + "\"";
-                                    }
-                                    
-                                    result += "\n";
-                                }
-                            }
-                        }
+            const auto* section = dynamic_cast<const SectionStatement*>(stmt);
+            if (!section || !section->get_block()) {
+                continue;
+            }
+            const std::string& section_name = section->get_name();
+            
+            // Filter, NAT and raw rules share their shape: a named section of
+            // properties, commented with the rule name unless it sets its own
+            const CommandSchema* rule_schema = nullptr;
+            if (section_name == "filter") {
+                rule_schema = &commands::FILTER_RULE;
+            } else if (section_name == "nat") {
+                rule_schema = &commands::NAT_RULE;
+            } else if (section_name == "raw") {
+                rule_schema = &commands::RAW_RULE;
+            }
+            
+            if (rule_schema) {
+                std::vector<RouterOSCommand> rules;
+                for (const auto* rule_stmt : section->get_block()->get_statements()) {
+                    if (const auto* rule_section = dynamic_cast<const SectionStatement*>(rule_stmt)) {
+                        rules.emplace_back(*rule_schema);
+                        rules.back().set("comment", rule_section->get_name());
+                        rules.back().set_properties(rule_section->get_block());
                     }
                 }
-                // Process NAT rules
-                else if (section_name == "nat") {
-                    if (section->get_block()) {
-                        for (const auto* rule_stmt : section->get_block()->get_statements()) {
-                            if (const auto* rule = dynamic_cast<const SectionStatement*>(rule_stmt)) {
-                                std::string rule_name = rule->get_name();
-                                std::string chain = "srcnat"; // Default chain
-                                std::string action = "";
-                                std::string protocol = "";
-                                std::string src_address = "";
-                                std::string dst_address = "";
-                                std::string src_port = "";
-                                std::string dst_port = "";
-                                std::string in_interface = "";
-                                std::string out_interface = "";
-                                std::string to_addresses = "";
-                                std::string to_ports = "";
-                                std::string comment = rule_name;
-                                
-                                // Extract properties for this NAT rule
-                                if (rule->get_block()) {
-                                    for (const auto* prop_stmt : rule->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(prop_stmt)) {
-                                            std::string prop_name = prop->get_name();
-                                            std::string value = "";
-                                            
-                                            if (prop->get_value()) {
-                                                value = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                }
-                                            }
-                                            
-                                            if (prop_name == "chain") {
-                                                chain = value;
-                                            } else if (prop_name == "action") {
-                                                action = value;
-                                            } else if (prop_name == "protocol") {
-                                                protocol = value;
-                                            } else if (prop_name == "src_address" || prop_name == "src-address") {
-                                                src_address = value;
-                                            } else if (prop_name == "dst_address" || prop_name == "dst-address") {
-                                                dst_address = value;
-                                            } else if (prop_name == "src_port" || prop_name == "src-port") {
-                                                src_port = value;
-                                            } else if (prop_name == "dst_port" || prop_name == "dst-port") {
-                                                dst_port = value;
-                                            } else if (prop_name == "in_interface" || prop_name == "in-interface") {
-                                                in_interface = value;
-                                            } else if (prop_name == "out_interface" || prop_name == "out-interface") {
-                                                out_interface = value;
-                                            } else if (prop_name == "to_addresses" || prop_name == "to-addresses") {
-                                                to_addresses = value;
-                                            } else if (prop_name == "to_ports" || prop_name == "to-ports") {
-                                                to_ports = value;
-                                            } else if (prop_name == "comment") {
-                                                comment = value;
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                // Generate the NAT rule if an action is specified
-                                if (!action.empty()) {
-                                    result += "/ip firewall nat add chain=" + chain + " action=" + action;
-                                    
-                                    // Add optional parameters
-                                    if (!protocol.empty()) {
-                                        result += " protocol=" + protocol;
-                                    }
-                                    if (!src_address.empty()) {
-                                        result += " src-address=" + src_address;
-                                    }
-                                    if (!dst_address.empty()) {
-                                        result += " dst-address=" + dst_address;
-                                    }
-                                    if (!src_port.empty()) {
-                                        result += " src-port=" + src_port;
-                                    }
-                                    if (!dst_port.empty()) {
-                                        result += " dst-port=" + dst_port;
-                                    }
-                                    if (!in_interface.empty()) {
-                                        result += " in-interface=" + in_interface;
-                                    }
-                                    if (!out_interface.empty()) {
-                                        result += " out-interface=" + out_interface;
-                                    }
-                                    if (!to_addresses.empty() && action != "masquerade") {
-                                        result += " to-addresses=" + to_addresses;
-                                    }
-                                    if (!to_ports.empty()) {
-                                        result += " to-ports=" + to_ports;
-                                    }
-                                    if (!comment.empty()) {
-                                        result += " comment=\"" + comment + "\"";
-                                    }
-                                    
-                                    result += "\n";
-                                }
-                            }
-                        }
+                if (context.rule_reorder) {
+                    for (size_t index : context.rule_reorder->order(section_name, rules)) {
+                        rules[index].emit(result);
                     }
-                }
-                // Process address-list rules (for blocking lists, etc.)
-                else if (section_name == "address-list") {
-                    if (section->get_block()) {
-                        for (const auto* list_stmt : section->get_block()->get_statements()) {
-                            if (const auto* list = dynamic_cast<const SectionStatement*>(list_stmt)) {
-                                std::string list_name = list->get_name();
-                                
-                                // Process each address in the list
-                                if (list->get_block()) {
-                                    for (const auto* addr_stmt : list->get_block()->get_statements()) {
-                                        if (const auto* addr_prop = dynamic_cast<const PropertyStatement*>(addr_stmt)) {
-                                            std::string address = addr_prop->get_name();
-                                            std::string comment = "";
-                                            std::string timeout = "";
-                                            
-                                            if (addr_prop->get_value()) {
-                                                // Check if it's a simple string (comment) or a block with properties
-                                                std::string value = addr_prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                    comment = value;
-                                                }
-                                            }
-                                            
-                                            // Generate address-list entry
-                                            result += "/ip firewall address-list add list=" + list_name;
-                                            result += " address=" + address;
-                                            if (!comment.empty()) {
-                                                result += " comment=\"" + comment + "\"";
-                                            }
-                                            if (!timeout.empty()) {
-                                                result += " timeout=" + timeout;
-                                            }
-                                            result += "\n";
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                } else {
+                    for (const auto& rule : rules) {
+                        rule.emit(result);
                     }
                 }
-                // Process service-port rules
-                else if (section_name == "service-port") {
-                    if (section->get_block()) {
-                        for (const auto* service_stmt : section->get_block()->get_statements()) {
-                            if (const auto* service_prop = dynamic_cast<const PropertyStatement*>(service_stmt)) {
-                                std::string service_name = service_prop->get_name();
-                                std::string value = "";
-                                
-                                if (service_prop->get_value()) {
-                                    value = service_prop->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                        value = value.substr(1, value.size() - 2);
-                                    }
-                                }
-                                
-                                // Generate service-port setting
-                                if (value == "yes" || value == "true") {
-                                    result += "/ip firewall service-port set " + service_name + " disabled=no\n";
-                                } else if (value == "no" || value == "false") {
-                                    result += "/ip firewall service-port set " + service_name + " disabled=yes\n";
-                                }
+            }
+            // Process address-list rules (for blocking lists, etc.)
+            else if (section_name == "address-list") {
+                for (const auto* list_stmt : section->get_block()->get_statements()) {
+                    const auto* list = dynamic_cast<const SectionStatement*>(list_stmt);
+                    if (!list || !list->get_block()) {
+                        continue;
+                    }
+                    for (const auto* addr_stmt : list->get_block()->get_statements()) {
+                        if (const auto* addr_prop = dynamic_cast<const PropertyStatement*>(addr_stmt)) {
+                            RouterOSCommand entry(commands::ADDRESS_LIST_ENTRY);
+                            entry.set("list", list->get_name());
+                            entry.set("address", addr_prop->get_name());
+                            
+                            // Values written in quotes are comments; bare words are ignored
+                            const Expression* value = addr_prop->get_value();
+                            const auto* str_val = dynamic_cast<const StringValue*>(value);
+                            if ((str_val && str_val->is_quoted()) || dynamic_cast<const IPAddressValue*>(value) ||
+                                dynamic_cast<const IPCIDRValue*>(value)) {
+                                entry.set("comment", expression_text(value));
                             }
+                            entry.emit(result);
                         }
                     }
                 }
-                // Process raw rules (advanced firewall)
-                else if (section_name == "raw") {
-                    if (section->get_block()) {
-                        for (const auto* rule_stmt : section->get_block()->get_statements()) {
-                            if (const auto* rule = dynamic_cast<const SectionStatement*>(rule_stmt)) {
-                                std::string rule_name = rule->get_name();
-                                std::string chain = "prerouting"; // Default chain
-                                std::string action = "";
-                                std::string protocol = "";
-                                std::string src_address = "";
-                                std::string dst_address = "";
-                                std::string comment = rule_name;
-                                
-                                // Extract properties for this raw rule
-                                if (rule->get_block()) {
-                                    for (const auto* prop_stmt : rule->get_block()->get_statements()) {
-                                        if (const auto* prop = dynamic_cast<const PropertyStatement*>(prop_stmt)) {
-                                            std::string prop_name = prop->get_name();
-                                            std::string value = "";
-                                            
-                                            if (prop->get_value()) {
-                                                value = prop->get_value()->to_mikrotik("");
-                                                // Remove quotes if present
-                                                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-                                                    value = value.substr(1, value.size() - 2);
-                                                }
-                                            }
-                                            
-                                            if (prop_name == "chain") {
-                                                chain = value;
-                                            } else if (prop_name == "action") {
-                                                action = value;
-                                            } else if (prop_name == "protocol") {
-                                                protocol = value;
-                                            } else if (prop_name == "src_address" || prop_name == "src-address") {
-                                                src_address = value;
-                                            } else if (prop_name == "dst_address" || prop_name == "dst-address") {
-                                                dst_address = value;
-                                            } else if (prop_name == "comment") {
-                                                comment = value;
-                                            }
-                                        }
-                                    }
-                                }
-                                
-                                // Generate the raw rule if an action is specified
-                                if (!action.empty()) {
-                                    result += "/ip firewall raw add chain=" + chain + " action=" + action;
-                                    
-                                    // Add optional parameters
-                                    if (!protocol.empty()) {
-                                        result += " protocol=" + protocol;
-                                    }
-                                    if (!src_address.empty()) {
-                                        result += " src-address=" + src_address;
-                                    }
-                                    if (!dst_address.empty()) {
-                                        result += " dst-address=" + dst_address;
-                                    }
-                                    if (!comment.empty()) {
-                                        result += " comment=\"" + comment + "\"";
-                                    }
-                                    
-                                    result += "\n";
-                                }
-                            }
+            }
+            // Process service-port rules: enabling a helper clears its disabled flag
+            else if (section_name == "service-port") {
+                for (const auto* service_stmt : section->get_block()->get_statements()) {
+                    if (const auto* service_prop = dynamic_cast<const PropertyStatement*>(service_stmt)) {
+                        RouterOSCommand service(commands::SERVICE_PORT);
+                        service.set("", service_prop->get_name());
+                        if (service_prop->get_value()) {
+                            service.set("disabled", expression_text(service_prop->get_value()));
                         }
+                        service.emit(result);
                     }
                 }
             }
@@ -1367,15 +701,7 @@ CustomSection::CustomSection(std::string_view name) noexcept
     this->type = SectionType::CUSTOM;
 }
 
-std::tuple<bool, std::string> CustomSection::validate() const noexcept {
-    const BlockStatement* block = get_block();
-    if (!block) return {false, "Custom section is missing a block statement"};
-    
-    // Custom sections are more permissive
-    return {true, ""};
-}
-
-std::string CustomSection::translate_section(const std::string& ident) const {
+std::string CustomSection::translate_section(const std::string& ident, const TranslationContext& context) const {
     std::string result = ident + "# Custom Configuration: " + get_name() + "\n";
     
     if (get_block()) {
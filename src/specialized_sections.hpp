@@ -1,23 +1,34 @@
 #pragma once
 
 #include "statement.hpp"
+#include "symbol_table.hpp"
+#include "diagnostics.hpp"
 #include <map>
 #include <tuple>
 
+class RuleReorder;
+
+// What one compilation gives its translators. It is passed in rather than
+// stored on the sections, which an included module shares between inputs.
+struct TranslationContext {
+    const SymbolTable* symbol_table = nullptr;   // Resolved references, if built
+    RuleReorder* rule_reorder = nullptr;         // Reorders firewall rules by their counters
+};
+
 // Base class for all specialized sections
 class SpecializedSection : public SectionStatement {
 public:
     SpecializedSection(std::string_view name) noexcept;
     
-    // Add semantic validation method with error message
-    virtual std::tuple<bool, std::string> validate() const noexcept = 0;
-    
     // Override the to_mikrotik method for specialized translation
     std::string to_mikrotik(const std::string& ident) const override;
     
+    // Translate with the symbol table and rule order of a compilation
+    std::string translate(const std::string& ident, const TranslationContext& context) const;
+    
 protected:
     // Helper method to be implemented by derived classes for specialized translation
-    virtual std::string translate_section(const std::string& ident) const = 0;
+    virtual std::string translate_section(const std::string& ident, const TranslationContext& context) const = 0;
 };
 
 // Device section
@@ -25,10 +36,8 @@ class DeviceSection : public SpecializedSection {
 public:
     DeviceSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
 };
 
 // Interfaces section
@@ -36,14 +45,13 @@ class InterfacesSection : public SpecializedSection {
 public:
     InterfacesSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
     
 private:
     // Helper method to process a single interface section
-    std::string process_interface_section(const SectionStatement* section, const std::string& interface_name) const;
+    std::string process_interface_section(const SectionStatement* section, const std::string& interface_name,
+                                          const TranslationContext& context) const;
 };
 
 // IP section
@@ -51,10 +59,8 @@ class IPSection : public SpecializedSection {
 public:
     IPSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
 };
 
 // Routing section
@@ -62,10 +68,8 @@ class RoutingSection : public SpecializedSection {
 public:
     RoutingSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
 };
 
 // Firewall section
@@ -73,10 +77,8 @@ class FirewallSection : public SpecializedSection {
 public:
     FirewallSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
 };
 
 // System section
@@ -90,10 +92,8 @@ class CustomSection : public SpecializedSection {
 public:
     CustomSection(std::string_view name) noexcept;
     
-    std::tuple<bool, std::string> validate() const noexcept override;
-    
 protected:
-    std::string translate_section(const std::string& ident) const override;
+    std::string translate_section(const std::string& ident, const TranslationContext& context) const override;
 };
 
 // Factory function to create the appropriate specialized section
@@ -2,6 +2,40 @@
 #include "declaration.hpp"
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+
+// Statement implementation
+void Statement::set_location(int line, int column) noexcept
+{
+    this->line = line;
+    this->column = column;
+}
+
+int Statement::get_line() const noexcept
+{
+    return line;
+}
+
+int Statement::get_column() const noexcept
+{
+    return column;
+}
+
+void Statement::set_origin(uint32_t origin) noexcept
+{
+    this->origin = origin;
+}
+
+uint32_t Statement::get_origin() const noexcept
+{
+    return origin;
+}
+
+uint32_t Statement::next_origin() noexcept
+{
+    static std::atomic<uint32_t> last_origin{0};
+    return ++last_origin;
+}
 
 // PropertyStatement implementation
 PropertyStatement::PropertyStatement(std::string_view name, Expression* value) noexcept 
@@ -73,6 +107,9 @@ void BlockStatement::add_statement(Statement* statement) noexcept
     if (statement) {
        
         statements.push_back(statement);
+        if (!shared.empty()) {
+            shared.push_back(false);
+        }
         
         // If this statement is a section, look for its parent in the surrounding blocks
         if (dynamic_cast<SectionStatement*>(statement)) {
@@ -83,20 +120,43 @@ void BlockStatement::add_statement(Statement* statement) noexcept
     }
 }
 
+void BlockStatement::add_shared_statement(Statement* statement) noexcept
+{
+    if (statement) {
+        shared.resize(statements.size(), false);
+        statements.push_back(statement);
+        shared.push_back(true);
+    }
+}
+
+bool BlockStatement::is_shared(size_t index) const noexcept
+{
+    return index < shared.size() && shared[index];
+}
+
 const StatementList& BlockStatement::get_statements() const noexcept 
 {
     return statements;
 }
 
+StatementList BlockStatement::release_statements() noexcept
+{
+    StatementList released;
+    released.swap(statements);
+    shared.clear();
+    return released;
+}
+
 void BlockStatement::destroy() noexcept 
 {
-    for (auto* statement : statements) {
-        if (statement) {
-            statement->destroy();
-            delete statement;
+    for (size_t i = 0; i < statements.size(); i++) {
+        if (statements[i] && !is_shared(i)) {
+            statements[i]->destroy();
+            delete statements[i];
         }
     }
     statements.clear();
+    shared.clear();
 }
 
 std::string BlockStatement::to_string() const 
@@ -274,19 +334,11 @@ std::string SectionStatement::to_mikrotik(const std::string& ident) const
                     const std::string& prop_name = prop_stmt->get_name();
                     if (prop_name == "vendor") {
                         if (prop_stmt->get_value()) {
-                            vendor_value = prop_stmt->get_value()->to_mikrotik("");
-                            // Remove quotes if present
-                            if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                                vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                            }
+                            vendor_value = expression_text(prop_stmt->get_value());
                         }
                     } else if (prop_name == "model") {
                         if (prop_stmt->get_value()) {
-                            model_value = prop_stmt->get_value()->to_mikrotik("");
-                            // Remove quotes if present
-                            if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                                model_value = model_value.substr(1, model_value.size() - 2);
-                            }
+                            model_value = expression_text(prop_stmt->get_value());
                         }
                     } else {
                         // Process other statements - BUT NOT vendor or model separately
@@ -301,25 +353,10 @@ std::string SectionStatement::to_mikrotik(const std::string& ident) const
         if (!vendor_value.empty() || !model_value.empty()) {
             std::string device_name;
             if (!vendor_value.empty() && !model_value.empty()) {
-                // Remove quotes if present in both values
-                if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                    vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                }
-                if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                    model_value = model_value.substr(1, model_value.size() - 2);
-                }
                 device_name = vendor_value + "_" + model_value;
             } else if (!vendor_value.empty()) {
-                // Remove quotes if present
-                if (vendor_value.size() >= 2 && vendor_value.front() == '"' && vendor_value.back() == '"') {
-                    vendor_value = vendor_value.substr(1, vendor_value.size() - 2);
-                }
                 device_name = vendor_value;
             } else {
-                // Remove quotes if present
-                if (model_value.size() >= 2 && model_value.front() == '"' && model_value.back() == '"') {
-                    model_value = model_value.substr(1, model_value.size() - 2);
-                }
                 device_name = model_value;
             }
             
@@ -379,11 +416,7 @@ if (type == SectionType::INTERFACES) {
                                 
                                 // Extract the value carefully
                                 if (prop_stmt->get_value()) {
-                                    prop_value = prop_stmt->get_value()->to_mikrotik("");
-                                    // Remove quotes if present
-                                    if (prop_value.size() >= 2 && prop_value.front() == '"' && prop_value.back() == '"') {
-                                        prop_value = prop_value.substr(1, prop_value.size() - 2);
-                                    }
+                                    prop_value = expression_text(prop_stmt->get_value());
                                 }
                                 
                                 // Handle specific properties
@@ -415,11 +448,7 @@ if (type == SectionType::INTERFACES) {
                                         for (const auto* ip_stmt : nested_section->get_block()->get_statements()) {
                                             if (const auto* ip_prop = dynamic_cast<const PropertyStatement*>(ip_stmt)) {
                                                 if (ip_prop->get_name() == "address" && ip_prop->get_value()) {
-                                                    std::string ip_value = ip_prop->get_value()->to_mikrotik("");
-                                                    // Remove quotes if present
-                                                    if (ip_value.size() >= 2 && ip_value.front() == '"' && ip_value.back() == '"') {
-                                                        ip_value = ip_value.substr(1, ip_value.size() - 2);
-                                                    }
+                                                    std::string ip_value = expression_text(ip_prop->get_value());
                                                     
                                                     // Generate /ip address add command - use hardcoded path
                                                     sub_nested_commands << "/ip address add address=" 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "ast_node_interface.hpp"
 #include "expression.hpp"
 #include "datatype.hpp"
@@ -10,7 +12,24 @@ class Declaration;
 // Base class for all statements
 class Statement : public ASTNodeInterface
 {
-    // Empty base class
+public:
+    // Source location where the statement starts (0 if unknown)
+    void set_location(int line, int column) noexcept;
+    int get_line() const noexcept;
+    int get_column() const noexcept;
+
+    // Tells apart statements that start at the same source position, such as
+    // the copies of a template body; 0 for statements parsed from the input
+    void set_origin(uint32_t origin) noexcept;
+    uint32_t get_origin() const noexcept;
+
+    // A fresh origin, never handed out before in this process
+    static uint32_t next_origin() noexcept;
+
+protected:
+    int line = 0;
+    int column = 0;
+    uint32_t origin = 0;
 };
 
 // Property assignment statement (key = value)
@@ -40,13 +59,25 @@ public:
     // Add a statement to this block
     void add_statement(Statement* statement) noexcept;
     
+    // Add a statement owned elsewhere, such as part of an included module;
+    // destroy() leaves it alone
+    void add_shared_statement(Statement* statement) noexcept;
+    
+    // Whether the statement at index was added with add_shared_statement
+    bool is_shared(size_t index) const noexcept;
+    
     const StatementList& get_statements() const noexcept;
+    
+    // Hand the statements over to the caller, leaving the block empty
+    StatementList release_statements() noexcept;
+    
     void destroy() noexcept override;
     std::string to_string() const override;
     std::string to_mikrotik(const std::string& ident) const override;
     
 private:
     StatementList statements;
+    std::vector<bool> shared;   // Empty until the first shared statement is added
 };
 
 // Section statement (named block with type)
@@ -0,0 +1,366 @@
+#include "symbol_table.hpp"
+#include <set>
+
+namespace {
+
+// Interfaces every RouterOS device has without the program declaring them:
+// the default configuration's bridge, the loopback and numbered ports
+const char* const BUILTIN_INTERFACES[] = {"bridge", "lo"};
+const char* const BUILTIN_PORT_PREFIXES[] = {
+    "sfp-sfpplus", "qsfpplus", "qsfp28-", "sfp28-", "ether", "combo", "wlan", "wifi", "sfp", "lte"
+};
+
+// A port prefix followed by a number, or by numbers joined with hyphens as in qsfpplus1-1
+bool is_builtin_port(const std::string& name)
+{
+    for (const char* prefix : BUILTIN_PORT_PREFIXES) {
+        std::string_view start(prefix);
+        if (name.compare(0, start.size(), start) != 0 || name.size() == start.size()) {
+            continue;
+        }
+        bool digit = false;
+        for (size_t i = start.size(); i < name.size(); i++) {
+            if (name[i] >= '0' && name[i] <= '9') {
+                digit = true;
+            } else if (name[i] == '-' && digit) {
+                digit = false;
+            } else {
+                return false;
+            }
+        }
+        return digit;
+    }
+    return false;
+}
+
+} // namespace
+
+std::string SymbolTable::kind_to_string(SymbolKind kind)
+{
+    switch (kind) {
+        case SymbolKind::INTERFACE: return "interface";
+        case SymbolKind::ADDRESS_LIST: return "address-list";
+        case SymbolKind::ROUTING_TABLE: return "routing table";
+        default: return "symbol";
+    }
+}
+
+size_t SymbolTable::SiteHash::operator()(const Site& site) const noexcept
+{
+    uint64_t position = (static_cast<uint64_t>(static_cast<uint32_t>(site.line)) << 32) |
+                        static_cast<uint32_t>(site.column);
+    return std::hash<uint64_t>()(position ^ (static_cast<uint64_t>(site.origin) * 0x9e3779b97f4a7c15ULL));
+}
+
+void SymbolTable::declare(SymbolKind kind, const std::string& name, const FlatAst& ast, FlatAst::NodeId declaration)
+{
+    int line = ast.line(declaration);
+    auto [it, inserted] = symbols_[static_cast<int>(kind)].emplace(name, Symbol{kind, name, line});
+    if (!inserted && kind == SymbolKind::INTERFACE && it->second.line == 0) {
+        // Configuring a built-in port; references already resolved to it stay valid
+        it->second.line = line;
+    } else if (!inserted) {
+        std::string previous_location = it->second.line > 0
+            ? " at line " + std::to_string(it->second.line) : "";
+        duplicates_.push_back({line, ast.column(declaration),
+                               kind_to_string(kind) + " '" + name + "' is already defined" + previous_location});
+    }
+}
+
+void SymbolTable::reference(SymbolKind kind, const std::string& name, const FlatAst& ast, FlatAst::NodeId site,
+                            std::string context)
+{
+    if (name.empty()) {
+        return;
+    }
+    int line = ast.line(site);
+    int column = ast.column(site);
+    references_by_site_[Site{ast.origin(site), line, column}].push_back(references_.size());
+    references_.push_back({kind, name, line, column, std::move(context), nullptr});
+}
+
+void SymbolTable::referenceValues(SymbolKind kind, const FlatAst& ast, FlatAst::NodeId prop, const std::string& context)
+{
+    FlatAst::ValueId value = ast.value(prop);
+    if (value == FlatAst::NONE) {
+        return;
+    }
+    if (ast.value_kind(value) == FlatAst::ValueKind::LIST) {
+        for (uint32_t i = 0; i < ast.list_size(value); i++) {
+            reference(kind, ast.value_text(ast.list_item(value, i)), ast, prop, context);
+        }
+    } else {
+        reference(kind, ast.value_text(value), ast, prop, context);
+    }
+}
+
+void SymbolTable::collectInterfacesSection(const FlatAst& ast, FlatAst::NodeId section)
+{
+    for (FlatAst::NodeId interface = ast.first_child(section); interface != FlatAst::NONE;
+         interface = ast.next_sibling(interface)) {
+        if (ast.kind(interface) != FlatAst::NodeKind::SECTION) {
+            continue;
+        }
+        std::string interface_name(ast.name(interface));
+        declare(SymbolKind::INTERFACE, interface_name, ast, interface);
+
+        for (FlatAst::NodeId prop = ast.first_child(interface); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+            if (ast.kind(prop) != FlatAst::NodeKind::PROPERTY) {
+                continue;
+            }
+            std::string_view prop_name = ast.name(prop);
+            if (prop_name == "interface") {
+                referenceValues(SymbolKind::INTERFACE, ast, prop, "parent interface of '" + interface_name + "'");
+            } else if (prop_name == "slaves") {
+                referenceValues(SymbolKind::INTERFACE, ast, prop, "slaves of '" + interface_name + "'");
+            } else if (prop_name == "ports") {
+                referenceValues(SymbolKind::INTERFACE, ast, prop, "ports of bridge '" + interface_name + "'");
+            }
+        }
+    }
+}
+
+void SymbolTable::collectIPSection(const FlatAst& ast, FlatAst::NodeId section)
+{
+    static const std::set<std::string, std::less<>> non_interface_subsections = {
+        "address", "route", "routes", "firewall", "dhcp-server", "dhcp-client",
+        "dns", "arp", "service", "neighbor", "proxy"
+    };
+
+    for (FlatAst::NodeId subsection = ast.first_child(section); subsection != FlatAst::NONE;
+         subsection = ast.next_sibling(subsection)) {
+        if (ast.kind(subsection) != FlatAst::NodeKind::SECTION) {
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(subsection);
+        if (subsection_name == "dhcp-server") {
+            for (FlatAst::NodeId server = ast.first_child(subsection); server != FlatAst::NONE;
+                 server = ast.next_sibling(server)) {
+                if (ast.kind(server) != FlatAst::NodeKind::SECTION) {
+                    continue;
+                }
+                for (FlatAst::NodeId prop = ast.first_child(server); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                    if (ast.kind(prop) == FlatAst::NodeKind::PROPERTY && ast.name(prop) == "interface") {
+                        referenceValues(SymbolKind::INTERFACE, ast, prop,
+                                        "DHCP server '" + std::string(ast.name(server)) + "'");
+                    }
+                }
+            }
+        } else if (subsection_name == "dhcp-client") {
+            // DHCP clients are keyed by the interface they run on
+            for (FlatAst::NodeId prop = ast.first_child(subsection); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                if (ast.kind(prop) == FlatAst::NodeKind::PROPERTY) {
+                    reference(SymbolKind::INTERFACE, std::string(ast.name(prop)), ast, prop, "DHCP client");
+                }
+            }
+        } else if (!non_interface_subsections.count(subsection_name)) {
+            reference(SymbolKind::INTERFACE, std::string(subsection_name), ast, subsection, "IP address assignment");
+        }
+    }
+}
+
+void SymbolTable::collectRoutingSection(const FlatAst& ast, FlatAst::NodeId section)
+{
+    for (FlatAst::NodeId subsection = ast.first_child(section); subsection != FlatAst::NONE;
+         subsection = ast.next_sibling(subsection)) {
+        if (ast.kind(subsection) != FlatAst::NodeKind::SECTION) {
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(subsection);
+        if (subsection_name == "table" || subsection_name == "tables") {
+            for (FlatAst::NodeId table = ast.first_child(subsection); table != FlatAst::NONE;
+                 table = ast.next_sibling(table)) {
+                if (ast.kind(table) == FlatAst::NodeKind::SECTION) {
+                    declare(SymbolKind::ROUTING_TABLE, std::string(ast.name(table)), ast, table);
+                }
+            }
+        } else if (subsection_name == "rule" || subsection_name == "rules") {
+            for (FlatAst::NodeId rule = ast.first_child(subsection); rule != FlatAst::NONE;
+                 rule = ast.next_sibling(rule)) {
+                if (ast.kind(rule) != FlatAst::NodeKind::SECTION) {
+                    continue;
+                }
+                std::string context = "routing rule '" + std::string(ast.name(rule)) + "'";
+                for (FlatAst::NodeId prop = ast.first_child(rule); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                    if (ast.kind(prop) != FlatAst::NodeKind::PROPERTY) {
+                        continue;
+                    }
+                    if (ast.name(prop) == "table") {
+                        referenceValues(SymbolKind::ROUTING_TABLE, ast, prop, context);
+                    } else if (ast.name(prop) == "interface") {
+                        referenceValues(SymbolKind::INTERFACE, ast, prop, context);
+                    }
+                }
+            }
+        } else if (subsection_name != "filter") {
+            // Static route entry
+            for (FlatAst::NodeId prop = ast.first_child(subsection); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                if (ast.kind(prop) == FlatAst::NodeKind::PROPERTY &&
+                    (ast.name(prop) == "routing-table" || ast.name(prop) == "table")) {
+                    referenceValues(SymbolKind::ROUTING_TABLE, ast, prop,
+                                    "route '" + std::string(subsection_name) + "'");
+                }
+            }
+        }
+    }
+}
+
+void SymbolTable::collectFirewallSection(const FlatAst& ast, FlatAst::NodeId section)
+{
+    for (FlatAst::NodeId subsection = ast.first_child(section); subsection != FlatAst::NONE;
+         subsection = ast.next_sibling(subsection)) {
+        if (ast.kind(subsection) != FlatAst::NodeKind::SECTION) {
+            continue;
+        }
+
+        std::string_view subsection_name = ast.name(subsection);
+        if (subsection_name == "address-list") {
+            for (FlatAst::NodeId list = ast.first_child(subsection); list != FlatAst::NONE;
+                 list = ast.next_sibling(list)) {
+                if (ast.kind(list) == FlatAst::NodeKind::SECTION) {
+                    declare(SymbolKind::ADDRESS_LIST, std::string(ast.name(list)), ast, list);
+                }
+            }
+            continue;
+        }
+
+        // Rule tables: filter, nat, raw, mangle
+        for (FlatAst::NodeId rule = ast.first_child(subsection); rule != FlatAst::NONE;
+             rule = ast.next_sibling(rule)) {
+            if (ast.kind(rule) != FlatAst::NodeKind::SECTION) {
+                continue;
+            }
+            std::string context = std::string(subsection_name) + " rule '" + std::string(ast.name(rule)) + "'";
+            for (FlatAst::NodeId prop = ast.first_child(rule); prop != FlatAst::NONE; prop = ast.next_sibling(prop)) {
+                if (ast.kind(prop) != FlatAst::NodeKind::PROPERTY) {
+                    continue;
+                }
+                std::string_view prop_name = ast.name(prop);
+                if (prop_name == "in_interface" || prop_name == "in-interface" ||
+                    prop_name == "out_interface" || prop_name == "out-interface") {
+                    referenceValues(SymbolKind::INTERFACE, ast, prop, context);
+                } else if (prop_name == "src_address_list" || prop_name == "src-address-list" ||
+                           prop_name == "dst_address_list" || prop_name == "dst-address-list") {
+                    referenceValues(SymbolKind::ADDRESS_LIST, ast, prop, context);
+                }
+            }
+        }
+    }
+}
+
+void SymbolTable::clear()
+{
+    for (auto& symbols : symbols_) {
+        symbols.clear();
+    }
+    references_.clear();
+    references_by_site_.clear();
+    duplicates_.clear();
+
+    // RouterOS always has the main routing table
+    symbols_[static_cast<int>(SymbolKind::ROUTING_TABLE)].emplace(
+        "main", Symbol{SymbolKind::ROUTING_TABLE, "main", 0});
+    for (const char* name : BUILTIN_INTERFACES) {
+        symbols_[static_cast<int>(SymbolKind::INTERFACE)].emplace(
+            name, Symbol{SymbolKind::INTERFACE, name, 0});
+    }
+}
+
+void SymbolTable::add_section(const FlatAst& ast, FlatAst::NodeId section)
+{
+    switch (ast.section_type(section)) {
+        case SectionStatement::SectionType::INTERFACES:
+            collectInterfacesSection(ast, section);
+            break;
+        case SectionStatement::SectionType::IP:
+            collectIPSection(ast, section);
+            break;
+        case SectionStatement::SectionType::ROUTING:
+            collectRoutingSection(ast, section);
+            break;
+        case SectionStatement::SectionType::FIREWALL:
+            collectFirewallSection(ast, section);
+            break;
+        default:
+            break;
+    }
+}
+
+void SymbolTable::resolve()
+{
+    for (Reference& ref : references_) {
+        if (ref.target) {
+            continue;
+        }
+        ref.target = lookup(ref.kind, ref.name);
+        // Numbered ports cannot all be declared up front, so they are declared on first use
+        if (!ref.target && ref.kind == SymbolKind::INTERFACE && is_builtin_port(ref.name)) {
+            ref.target = &symbols_[static_cast<int>(SymbolKind::INTERFACE)].emplace(
+                ref.name, Symbol{SymbolKind::INTERFACE, ref.name, 0}).first->second;
+        }
+    }
+}
+
+void SymbolTable::forget_sites() noexcept
+{
+    references_by_site_.clear();
+}
+
+void SymbolTable::build(const ProgramDeclaration* program)
+{
+    build(FlatAst::build(program));
+}
+
+void SymbolTable::build(const FlatAst& ast)
+{
+    clear();
+    for (FlatAst::NodeId section = ast.root(); section != FlatAst::NONE; section = ast.next_sibling(section)) {
+        add_section(ast, section);
+    }
+
+    // Resolve every reference exactly once
+    resolve();
+}
+
+const SymbolTable::Symbol* SymbolTable::lookup(SymbolKind kind, const std::string& name) const noexcept
+{
+    const auto& symbols = symbols_[static_cast<int>(kind)];
+    auto it = symbols.find(name);
+    return it != symbols.end() ? &it->second : nullptr;
+}
+
+std::vector<const SymbolTable::Reference*> SymbolTable::references_at(const Statement* site) const
+{
+    std::vector<const Reference*> result;
+    if (!site) {
+        return result;
+    }
+    auto it = references_by_site_.find(Site{site->get_origin(), site->get_line(), site->get_column()});
+    if (it != references_by_site_.end()) {
+        for (size_t index : it->second) {
+            result.push_back(&references_[index]);
+        }
+    }
+    return result;
+}
+
+void SymbolTable::validate(Diagnostics& diagnostics) const
+{
+    for (const Redeclaration& duplicate : duplicates_) {
+        diagnostics.report(Diagnostics::Severity::ERROR, duplicate.line, duplicate.column, duplicate.message);
+    }
+
+    for (const Reference& ref : references_) {
+        if (!ref.target) {
+            diagnostics.report(Diagnostics::Severity::ERROR, ref.line, ref.column,
+                               "undefined " + kind_to_string(ref.kind) + " '" + ref.name + "' referenced by " + ref.context);
+        }
+    }
+}
+
+const std::vector<SymbolTable::Reference>& SymbolTable::get_references() const noexcept
+{
+    return references_;
+}
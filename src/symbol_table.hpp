@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "declaration.hpp"
+#include "diagnostics.hpp"
+#include "flat_ast.hpp"
+
+/**
+ * @class SymbolTable
+ * @brief Cross-section table of named objects and the references to them
+ *
+ * A single pass over the program declares every interface, firewall
+ * address-list and routing table, records every place that refers to one
+ * of them by name (firewall rules, IP addresses, DHCP servers and clients,
+ * VLAN parents, bonding slaves, bridge ports, routes and routing rules),
+ * and resolves each reference once. Translators read the recorded entries
+ * instead of re-scanning the AST. The main routing table and the interfaces
+ * a device has without configuration, such as 'bridge' and etherN ports, are
+ * built-in symbols at line 0; a program may still declare a built-in port to
+ * configure it.
+ *
+ * The table is collected from the flat AST. Symbols and references keep
+ * only names and source positions, never AST pointers, and references are
+ * indexed by the position and origin of the statement making them, so
+ * sections can be added one at a time and freed afterwards.
+ */
+class SymbolTable {
+public:
+    enum class SymbolKind {
+        INTERFACE,
+        ADDRESS_LIST,
+        ROUTING_TABLE
+    };
+
+    struct Symbol {
+        SymbolKind kind;
+        std::string name;
+        int line;                // 0 for built-in symbols
+    };
+
+    struct Reference {
+        SymbolKind kind;
+        std::string name;
+        int line;                // Position of the statement containing the reference
+        int column;
+        std::string context;     // Human readable description of the site
+        const Symbol* target;    // nullptr if the reference is dangling
+    };
+
+    /**
+     * @brief Declare all symbols of a program and resolve all references
+     * @param program The program to index
+     */
+    void build(const ProgramDeclaration* program);
+
+    /**
+     * @brief Declare all symbols of a flat program and resolve all references
+     * @param ast The program to index
+     */
+    void build(const FlatAst& ast);
+
+    /**
+     * @brief Forget all symbols and references and declare the built-in ones
+     */
+    void clear();
+
+    /**
+     * @brief Declare the symbols and record the references of one top-level section
+     * @param ast The flat program holding the section; it is not referenced after this call
+     * @param section The section node
+     */
+    void add_section(const FlatAst& ast, FlatAst::NodeId section);
+
+    /**
+     * @brief Resolve every reference recorded so far against the declared symbols
+     */
+    void resolve();
+
+    /**
+     * @brief Drop the statement index of sections that have been translated
+     */
+    void forget_sites() noexcept;
+
+    /**
+     * @brief Find a declared symbol
+     * @param kind The kind of symbol
+     * @param name The symbol name
+     * @return The symbol, or nullptr if it is not declared
+     */
+    const Symbol* lookup(SymbolKind kind, const std::string& name) const noexcept;
+
+    /**
+     * @brief References made by one statement, in source order
+     * @param site The referring statement
+     * @return The references, resolved or not, so a section can be translated
+     *         before the sections declaring its targets have been seen
+     */
+    std::vector<const Reference*> references_at(const Statement* site) const;
+
+    /**
+     * @brief Report semantic errors found while building the table
+     * @param diagnostics Sink receiving dangling references and duplicate declarations
+     */
+    void validate(Diagnostics& diagnostics) const;
+
+    const std::vector<Reference>& get_references() const noexcept;
+
+    static std::string kind_to_string(SymbolKind kind);
+
+private:
+    struct Redeclaration {
+        int line;
+        int column;
+        std::string message;
+    };
+
+    // Statements are identified by where they start and their origin: copies
+    // of a template body start at the same place but have different origins
+    struct Site {
+        uint32_t origin;
+        int line;
+        int column;
+
+        bool operator==(const Site& other) const noexcept
+        {
+            return origin == other.origin && line == other.line && column == other.column;
+        }
+    };
+
+    struct SiteHash {
+        size_t operator()(const Site& site) const noexcept;
+    };
+
+    void declare(SymbolKind kind, const std::string& name, const FlatAst& ast, FlatAst::NodeId declaration);
+    void reference(SymbolKind kind, const std::string& name, const FlatAst& ast, FlatAst::NodeId site,
+                   std::string context);
+
+    // Record one reference per element of a string or list value
+    void referenceValues(SymbolKind kind, const FlatAst& ast, FlatAst::NodeId prop, const std::string& context);
+
+    void collectInterfacesSection(const FlatAst& ast, FlatAst::NodeId section);
+    void collectIPSection(const FlatAst& ast, FlatAst::NodeId section);
+    void collectRoutingSection(const FlatAst& ast, FlatAst::NodeId section);
+    void collectFirewallSection(const FlatAst& ast, FlatAst::NodeId section);
+
+    std::unordered_map<std::string, Symbol> symbols_[3];
+    std::vector<Reference> references_;
+    std::unordered_map<Site, std::vector<size_t>, SiteHash> references_by_site_;
+    std::vector<Redeclaration> duplicates_;
+};
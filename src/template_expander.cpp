@@ -0,0 +1,265 @@
+#include "template_expander.hpp"
+#include "section_factory.hpp"
+
+namespace {
+
+using Bindings = std::unordered_map<std::string_view, const Expression*>;
+
+// Replace the bound ${name} placeholders of a text. A placeholder bound to
+// another parameter is renamed, so an enclosing expansion can fill it in.
+std::string interpolate(std::string_view text, const Bindings& bindings) {
+    std::string result;
+    size_t copied = 0;
+    size_t start = text.find("${");
+    while (start != std::string_view::npos) {
+        size_t end = text.find('}', start + 2);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        auto it = bindings.find(text.substr(start + 2, end - start - 2));
+        if (it != bindings.end()) {
+            result.append(text.substr(copied, start - copied));
+            if (const auto* parameter = dynamic_cast<const ParameterExpression*>(it->second)) {
+                result += "${" + parameter->get_name() + "}";
+            } else {
+                append_expression_text(result, it->second);
+            }
+            copied = end + 1;
+        }
+        start = text.find("${", end + 1);
+    }
+    result.append(text.substr(copied));
+    return result;
+}
+
+Expression* copy_expression(const Expression* expr, const Bindings& bindings) {
+    if (!expr) {
+        return nullptr;
+    }
+    if (const auto* parameter = dynamic_cast<const ParameterExpression*>(expr)) {
+        auto it = bindings.find(parameter->get_name());
+        if (it != bindings.end()) {
+            // Arguments are complete values; copy them as they are
+            return copy_expression(it->second, Bindings());
+        }
+        return new ParameterExpression(parameter->get_name());
+    }
+    if (const auto* str_val = dynamic_cast<const StringValue*>(expr)) {
+        std::string_view text = str_val->get_view();
+        if (bindings.empty() || text.find("${") == std::string_view::npos) {
+            return new StringValue(text, str_val->is_quoted());
+        }
+        return new StringValue(interpolate(text, bindings), str_val->is_quoted());
+    }
+    if (const auto* num_val = dynamic_cast<const NumberValue*>(expr)) {
+        return new NumberValue(num_val->get_value());
+    }
+    if (const auto* bool_val = dynamic_cast<const BooleanValue*>(expr)) {
+        return new BooleanValue(bool_val->get_value());
+    }
+    if (const auto* ip_val = dynamic_cast<const IPAddressValue*>(expr)) {
+        return new IPAddressValue(ip_val->get_view());
+    }
+    if (const auto* cidr_val = dynamic_cast<const IPCIDRValue*>(expr)) {
+        return new IPCIDRValue(cidr_val->get_view());
+    }
+    if (const auto* list_val = dynamic_cast<const ListValue*>(expr)) {
+        ValueList values;
+        values.reserve(list_val->get_values().size());
+        for (const Value* item : list_val->get_values()) {
+            values.push_back(static_cast<Value*>(copy_expression(item, bindings)));
+        }
+        return new ListValue(values);
+    }
+    if (const auto* ident = dynamic_cast<const IdentifierExpression*>(expr)) {
+        return new IdentifierExpression(ident->get_name());
+    }
+    if (const auto* reference = dynamic_cast<const PropertyReference*>(expr)) {
+        return new PropertyReference(copy_expression(reference->get_base(), bindings), reference->get_property_name());
+    }
+    return nullptr;
+}
+
+// Call f(name) for every ${name} placeholder in a text
+template <typename F>
+void for_each_placeholder(std::string_view text, F&& f) {
+    size_t start = text.find("${");
+    while (start != std::string_view::npos) {
+        size_t end = text.find('}', start + 2);
+        if (end == std::string_view::npos) {
+            return;
+        }
+        f(text.substr(start + 2, end - start - 2));
+        start = text.find("${", end + 1);
+    }
+}
+
+// Call f(statement, name) for every parameter a statement or its children use
+template <typename F>
+void for_each_parameter(const Statement* statement, F&& f) {
+    if (const auto* prop = dynamic_cast<const PropertyStatement*>(statement)) {
+        if (const auto* parameter = dynamic_cast<const ParameterExpression*>(prop->get_value())) {
+            f(statement, std::string_view(parameter->get_name()));
+        }
+    } else if (const auto* section = dynamic_cast<const SectionStatement*>(statement)) {
+        for_each_placeholder(section->get_name(), [&](std::string_view name) { f(statement, name); });
+        if (section->get_block()) {
+            for (const auto* child : section->get_block()->get_statements()) {
+                for_each_parameter(child, f);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TemplateExpander::~TemplateExpander() {
+    for (auto& entry : templates_) {
+        entry.second.body->destroy();
+        delete entry.second.body;
+    }
+}
+
+std::tuple<bool, std::string> TemplateExpander::define(std::string_view name, std::vector<std::string> parameters,
+                                                       BlockStatement* body) {
+    std::string error;
+    if (templates_.count(std::string(name))) {
+        error = "Template '" + std::string(name) + "' is already defined";
+    }
+    for (size_t i = 0; i < parameters.size() && error.empty(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (parameters[i] == parameters[j]) {
+                error = "Parameter '" + parameters[i] + "' of template '" + std::string(name) + "' is declared twice";
+                break;
+            }
+        }
+    }
+    for (const auto* statement : body->get_statements()) {
+        for_each_parameter(statement, [&](const Statement*, std::string_view parameter) {
+            bool declared = false;
+            for (const std::string& declared_name : parameters) {
+                declared = declared || declared_name == parameter;
+            }
+            if (!declared && error.empty()) {
+                error = "Template '" + std::string(name) + "' uses undeclared parameter '" + std::string(parameter) + "'";
+            }
+        });
+    }
+
+    if (!error.empty()) {
+        body->destroy();
+        delete body;
+        return {false, error};
+    }
+    templates_.emplace(std::string(name), Template{std::move(parameters), body});
+    return {true, ""};
+}
+
+void TemplateExpander::import(const TemplateExpander& module) {
+    imported_.push_back(&module);
+}
+
+std::tuple<bool, std::string> TemplateExpander::instantiate(std::string_view name,
+                                                            const std::vector<Expression*>& arguments,
+                                                            BlockStatement* into) {
+    const Template* found = find(name);
+    if (!found) {
+        return {false, "Unknown template '" + std::string(name) + "'"};
+    }
+    const Template& definition = *found;
+    if (arguments.size() != definition.parameters.size()) {
+        return {false, "Template '" + std::string(name) + "' takes " + std::to_string(definition.parameters.size()) +
+                       " argument(s) but " + std::to_string(arguments.size()) + " were given"};
+    }
+
+    Bindings bindings;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        bindings[definition.parameters[i]] = arguments[i];
+    }
+    return expandInto(definition.body, bindings, into);
+}
+
+std::tuple<bool, std::string> TemplateExpander::unroll(std::string_view variable, int first, int last,
+                                                       const BlockStatement* body, BlockStatement* into) {
+    std::string range = std::to_string(first) + ".." + std::to_string(last);
+    if (first > last) {
+        return {false, "Loop range " + range + " is empty"};
+    }
+    if (static_cast<long long>(last) - first >= MAX_LOOP_ITERATIONS) {
+        return {false, "Loop range " + range + " has more than " + std::to_string(MAX_LOOP_ITERATIONS) + " values"};
+    }
+
+    for (int value = first; ; value++) {
+        NumberValue number(value);
+        auto [success, error] = expandInto(body, Bindings{{variable, &number}}, into);
+        if (!success) {
+            return {false, error};
+        }
+        if (value == last) {
+            break;
+        }
+    }
+    return {true, ""};
+}
+
+const TemplateExpander::Template* TemplateExpander::find(std::string_view name) const {
+    auto it = templates_.find(std::string(name));
+    if (it != templates_.end()) {
+        return &it->second;
+    }
+    // Later includes take precedence, as if their templates were defined further down
+    for (auto module = imported_.rbegin(); module != imported_.rend(); ++module) {
+        if (const Template* definition = (*module)->find(name)) {
+            return definition;
+        }
+    }
+    return nullptr;
+}
+
+bool TemplateExpander::check_bound(const SectionStatement* section, Diagnostics& diagnostics) {
+    bool bound = true;
+    for_each_parameter(section, [&](const Statement* statement, std::string_view name) {
+        diagnostics.report(Diagnostics::Severity::ERROR, statement->get_line(), statement->get_column(),
+                           "Parameter '" + std::string(name) + "' is used outside a template or loop that defines it");
+        bound = false;
+    });
+    return bound;
+}
+
+std::tuple<bool, std::string> TemplateExpander::expandInto(const BlockStatement* body, const Bindings& bindings,
+                                                           BlockStatement* into) {
+    if (!body) {
+        return {true, ""};
+    }
+    for (const auto* statement : body->get_statements()) {
+        if (expanded_statements_ >= MAX_EXPANDED_STATEMENTS) {
+            return {false, "Templates and loops expand to more than " + std::to_string(MAX_EXPANDED_STATEMENTS) +
+                           " statements"};
+        }
+        into->add_statement(copyStatement(statement, bindings));
+    }
+    return {true, ""};
+}
+
+Statement* TemplateExpander::copyStatement(const Statement* statement, const Bindings& bindings) {
+    Statement* copy = nullptr;
+    if (const auto* prop = dynamic_cast<const PropertyStatement*>(statement)) {
+        copy = new PropertyStatement(prop->get_name(), copy_expression(prop->get_value(), bindings));
+    } else if (const auto* section = dynamic_cast<const SectionStatement*>(statement)) {
+        BlockStatement* block = new BlockStatement();
+        if (section->get_block()) {
+            for (const auto* child : section->get_block()->get_statements()) {
+                block->add_statement(copyStatement(child, bindings));
+            }
+        }
+        copy = SectionFactory::create_section(interpolate(section->get_name(), bindings),
+                                              section->get_section_type(), block);
+    } else {
+        return nullptr;
+    }
+    // Every copy keeps the position of the template, so give each its own origin
+    copy->set_location(statement->get_line(), statement->get_column());
+    copy->set_origin(Statement::next_origin());
+    expanded_statements_++;
+    return copy;
+}
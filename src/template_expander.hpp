@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "diagnostics.hpp"
+#include "statement.hpp"
+
+/**
+ * @class TemplateExpander
+ * @brief Expand templates and bounded loops into ordinary statements while parsing
+ *
+ * A template is a block of statements with named parameters, defined at the
+ * top level and instantiated anywhere after its definition:
+ *
+ *   template vlan_port(id, parent):
+ *       vlan${id}:
+ *           type = "vlan"
+ *           vlan_id = $id
+ *           interface = $parent
+ *
+ *   interfaces:
+ *       for id in 100..899:
+ *           use vlan_port($id, "ether2")
+ *
+ * Inside a body, $name stands for a whole value and ${name} is replaced in
+ * section names and quoted strings. The grammar reduces the innermost
+ * construct first, so a loop or instantiation inside another body is already
+ * expanded when the outer one copies it, and only the outer parameters are
+ * left to substitute. The rest of the compiler never sees a template.
+ */
+class TemplateExpander {
+public:
+    // Most iterations one loop may have
+    static constexpr int MAX_LOOP_ITERATIONS = 65536;
+    // Most statements all expansions of one input may create together
+    static constexpr size_t MAX_EXPANDED_STATEMENTS = size_t(1) << 22;
+
+    TemplateExpander() noexcept = default;
+    ~TemplateExpander();
+
+    TemplateExpander(const TemplateExpander&) = delete;
+    TemplateExpander& operator=(const TemplateExpander&) = delete;
+
+    /**
+     * @brief Register a template; the expander takes ownership of the body
+     * @param name Template name
+     * @param parameters Parameter names, in argument order
+     * @param body Statements of the template
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> define(std::string_view name, std::vector<std::string> parameters,
+                                         BlockStatement* body);
+
+    /**
+     * @brief Make the templates of an included module usable here
+     * @param module Expander of the module; it must outlive this one and is never modified
+     */
+    void import(const TemplateExpander& module);
+
+    /**
+     * @brief Append a copy of a template's body with its parameters bound to arguments
+     * @param name Template name, looked up here first and then in imported modules
+     * @param arguments One value per parameter; they are copied, not taken over
+     * @param into Block receiving the expanded statements
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> instantiate(std::string_view name, const std::vector<Expression*>& arguments,
+                                              BlockStatement* into);
+
+    /**
+     * @brief Append one copy of a loop body per value of an inclusive range
+     * @param variable Loop variable, bound to each number in turn
+     * @param first First value
+     * @param last Last value
+     * @param body Statements of the loop
+     * @param into Block receiving the expanded statements
+     * @return Success flag and error message
+     */
+    std::tuple<bool, std::string> unroll(std::string_view variable, int first, int last,
+                                         const BlockStatement* body, BlockStatement* into);
+
+    /**
+     * @brief Report parameters used outside any template or loop that binds them
+     * @param section A top-level section after expansion
+     * @param diagnostics Sink receiving one error per unbound use
+     * @return True if the section is free of parameters
+     */
+    static bool check_bound(const SectionStatement* section, Diagnostics& diagnostics);
+
+private:
+    using Bindings = std::unordered_map<std::string_view, const Expression*>;
+
+    struct Template {
+        std::vector<std::string> parameters;
+        BlockStatement* body;
+    };
+
+    const Template* find(std::string_view name) const;
+    std::tuple<bool, std::string> expandInto(const BlockStatement* body, const Bindings& bindings,
+                                             BlockStatement* into);
+    Statement* copyStatement(const Statement* statement, const Bindings& bindings);
+
+    std::unordered_map<std::string, Template> templates_;
+    std::vector<const TemplateExpander*> imported_;
+    size_t expanded_statements_ = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads executing submitted tasks in FIFO order.
+// Tasks must not block waiting on other tasks of the same pool: with every
+// worker waiting, nothing would be left to run the tasks they wait for.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t thread_count)
+    {
+        if (thread_count == 0) {
+            thread_count = 1;
+        }
+        workers.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; i++) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task; its result (or exception) is delivered through the future
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([packaged] { (*packaged)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    size_t size() const noexcept { return workers.size(); }
+
+    // Number of threads to use when the user does not say
+    static size_t default_thread_count() noexcept
+    {
+        size_t count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+private:
+    void run()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
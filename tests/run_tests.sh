@@ -0,0 +1,197 @@
+#!/bin/sh
+# Compile every tests/cases/*.dsl and compare the script with the .rsc next to it.
+# Import every tests/imports/*.rsc and compare the DSL with the .dsl next to it.
+# Reorder every tests/reorder/*.dsl by the .counters next to it and compare the
+# report and the script with the .report and .rsc next to it.
+# Replay every tests/simulate/*.csv against the .dsl next to it and compare the
+# hit counts and the matches file with the .hits and .matches next to it.
+# Diff every tests/diff/*.old.dsl against the .new.dsl next to it and compare
+# the changes with the .expected next to it.
+# Look up every tests/routes/*.queries in the example program of the same name
+# and compare the hits and the results with the .hits and .csv next to it, and
+# the output with each interface down with the .down-INTERFACE next to it.
+# Usage: tests/run_tests.sh [compiler]
+
+COMPILER=${1:-./mikrotik_compiler}
+CASES=$(dirname "$0")/cases
+IMPORTS=$(dirname "$0")/imports
+REORDER=$(dirname "$0")/reorder
+SIMULATE=$(dirname "$0")/simulate
+DIFF=$(dirname "$0")/diff
+ROUTES=$(dirname "$0")/routes
+EXAMPLES=$(dirname "$0")/../examples
+GENERATED=$(dirname "$0")/../generated
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+passed=0
+
+fail() {
+    echo "FAIL $1: $2"
+    failed=$((failed + 1))
+}
+
+for input in "$CASES"/*.dsl; do
+    name=$(basename "$input" .dsl)
+    expected="$CASES/$name.rsc"
+    ok=1
+    # Whole-program and section-at-a-time compilation must write the same script
+    for mode in "" "--stream"; do
+        if ! "$COMPILER" "$input" "$WORK/$name.rsc" $mode > "$WORK/$name.log" 2>&1; then
+            fail "$name" "compiler failed${mode:+ with $mode}"
+            cat "$WORK/$name.log"
+            ok=0
+            break
+        fi
+        if ! diff -u "$expected" "$WORK/$name.rsc"; then
+            fail "$name" "unexpected script${mode:+ with $mode}"
+            ok=0
+            break
+        fi
+    done
+    [ $ok -eq 1 ] && passed=$((passed + 1))
+done
+
+# Import an export, compile the DSL, then import and compile the script again;
+# the two scripts must match. The first is left in $WORK/$name.1.rsc.
+round_trip() {
+    name=$1
+    if ! "$COMPILER" --import-rsc "$2" "$WORK/$name.dsl" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "import failed"
+        cat "$WORK/$name.log"
+        return 1
+    fi
+    for pass in 1 2; do
+        if ! "$COMPILER" "$WORK/$name.dsl" "$WORK/$name.$pass.rsc" > "$WORK/$name.log" 2>&1; then
+            fail "$name" "imported program failed to compile"
+            cat "$WORK/$name.log"
+            return 1
+        fi
+        [ $pass -eq 2 ] && break
+        if ! "$COMPILER" --import-rsc "$WORK/$name.1.rsc" "$WORK/$name.dsl" > "$WORK/$name.log" 2>&1; then
+            fail "$name" "import of the compiled script failed"
+            cat "$WORK/$name.log"
+            return 1
+        fi
+    done
+    if ! diff -u "$WORK/$name.1.rsc" "$WORK/$name.2.rsc"; then
+        fail "$name" "script changed on a second round trip"
+        return 1
+    fi
+}
+
+for input in "$IMPORTS"/*.rsc; do
+    name=$(basename "$input" .rsc)
+    if ! "$COMPILER" --import-rsc "$input" "$WORK/$name.import.dsl" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "import failed"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    if ! diff -u "$IMPORTS/$name.dsl" "$WORK/$name.import.dsl"; then
+        fail "$name" "unexpected DSL"
+        continue
+    fi
+    round_trip "$name" "$input" && passed=$((passed + 1))
+done
+
+# The exports of the examples come back unchanged from an import and a compile
+for input in "$GENERATED"/complex.rsc "$GENERATED"/simple.rsc; do
+    name=generated_$(basename "$input" .rsc)
+    round_trip "$name" "$input" || continue
+    if ! diff -u "$input" "$WORK/$name.1.rsc"; then
+        fail "$name" "export changed on a round trip"
+        continue
+    fi
+    passed=$((passed + 1))
+done
+
+for input in "$REORDER"/*.dsl; do
+    name=reorder_$(basename "$input" .dsl)
+    base="${input%.dsl}"
+    if ! "$COMPILER" "$input" "$WORK/$name.rsc" --counters "$base.counters" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "compiler failed"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    grep -v "successfully written" "$WORK/$name.log" | sed "s#$base#NAME#" > "$WORK/$name.report"
+    if ! diff -u "$base.report" "$WORK/$name.report" || ! diff -u "$base.rsc" "$WORK/$name.rsc"; then
+        fail "$name" "unexpected report or order"
+        continue
+    fi
+    passed=$((passed + 1))
+done
+
+for input in "$SIMULATE"/*.dsl; do
+    name=simulate_$(basename "$input" .dsl)
+    base="${input%.dsl}"
+    if ! "$COMPILER" "$input" --simulate "$base.csv" "$WORK/$name.matches" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "simulation failed"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    # The timing line differs from run to run
+    grep -v -e "^Simulated " -e "^Matches written" "$WORK/$name.log" > "$WORK/$name.hits"
+    if ! diff -u "$base.hits" "$WORK/$name.hits" || ! diff -u "$base.matches" "$WORK/$name.matches"; then
+        fail "$name" "unexpected hits or matches"
+        continue
+    fi
+    passed=$((passed + 1))
+done
+
+for input in "$DIFF"/*.old.dsl; do
+    name=diff_$(basename "$input" .old.dsl)
+    base="${input%.old.dsl}"
+    # Exit status 1 means the inputs differ, as with diff(1)
+    "$COMPILER" "$input" --diff "$base.new.dsl" > "$WORK/$name.log" 2>&1
+    status=$?
+    if [ $status -ne 1 ]; then
+        fail "$name" "diff exited with $status"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    sed "s#$base#NAME#" "$WORK/$name.log" > "$WORK/$name.changes"
+    if ! diff -u "$base.expected" "$WORK/$name.changes"; then
+        fail "$name" "unexpected changes"
+        continue
+    fi
+    passed=$((passed + 1))
+done
+
+for queries in "$ROUTES"/*.queries; do
+    name=routes_$(basename "$queries" .queries)
+    base="${queries%.queries}"
+    program="$EXAMPLES/$(basename "$base").dsl"
+    if ! "$COMPILER" "$program" --routes "$queries" "$WORK/$name.csv" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "route lookup failed"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    # The timing line differs from run to run
+    grep -v -e "^Looked up " -e "^Results written" "$WORK/$name.log" > "$WORK/$name.hits"
+    if ! diff -u "$base.hits" "$WORK/$name.hits" || ! diff -u "$base.csv" "$WORK/$name.csv"; then
+        fail "$name" "unexpected hits or results"
+        continue
+    fi
+    ok=1
+    for expected in "$base".down-*; do
+        [ -e "$expected" ] || continue
+        interface=${expected##*.down-}
+        if ! "$COMPILER" "$program" --routes "$queries" --link-down "$interface" > "$WORK/$name.log" 2>&1; then
+            fail "$name" "route lookup with $interface down failed"
+            cat "$WORK/$name.log"
+            ok=0
+            break
+        fi
+        grep -v "^Looked up " "$WORK/$name.log" > "$WORK/$name.down"
+        if ! diff -u "$expected" "$WORK/$name.down"; then
+            fail "$name" "unexpected failover with $interface down"
+            ok=0
+            break
+        fi
+    done
+    [ $ok -eq 1 ] && passed=$((passed + 1))
+done
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]